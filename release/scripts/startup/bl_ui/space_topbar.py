@@ -474,6 +474,8 @@ class TOPBAR_MT_file_import(Menu):
 
         self.layout.operator("wm.gpencil_import_svg", text="SVG as Grease Pencil")
 
+        self.layout.operator("wm.obj_import", text="Wavefront (.obj) (experimental)")
+
 
 class TOPBAR_MT_file_export(Menu):
     bl_idname = "TOPBAR_MT_file_export"
@@ -267,6 +267,23 @@ BVHTree *BKE_bvhtree_from_mesh_get(struct BVHTreeFromMesh *data,
                                    BVHCacheType bvh_cache_type,
                                    int tree_type);
 
+/**
+ * Same as #BKE_bvhtree_from_mesh_get, but the tree is also shared with other meshes that have the
+ * same positions and topology, even when they don't exist at the same time. This avoids building
+ * the same tree again for meshes that are recreated on every evaluation without changing, like the
+ * inputs of geometry nodes. Trees are found by hashing the mesh data, and the data is compared
+ * with a copy kept with the tree when the hash matches. This costs much less than building a tree
+ * but more than a lookup in the mesh cache. When only the positions changed, an unused tree built
+ * for the same topology is refit, which makes this fast for deforming meshes.
+ *
+ * Only #BVHTREE_FROM_VERTS, #BVHTREE_FROM_EDGES and #BVHTREE_FROM_LOOPTRI are shared, other types
+ * are only cached on the mesh.
+ */
+BVHTree *BKE_bvhtree_from_mesh_get_shared(struct BVHTreeFromMesh *data,
+                                          const struct Mesh *mesh,
+                                          BVHCacheType bvh_cache_type,
+                                          int tree_type);
+
 /**
  * Builds or queries a BVH-cache for the cache BVH-tree of the request type.
  */
@@ -324,6 +341,17 @@ struct BVHCache *bvhcache_init(void);
  * Frees a BVH-cache.
  */
 void bvhcache_free(struct BVHCache *bvh_cache);
+/**
+ * Tag the trees of a BVH-cache to be refit instead of rebuilt when they are used next,
+ * after the positions of the mesh changed without changing its topology.
+ */
+void bvhcache_tag_deformed(struct BVHCache *bvh_cache);
+
+/**
+ * Frees the shared trees that are not used by any mesh anymore,
+ * see #BKE_bvhtree_from_mesh_get_shared.
+ */
+void BKE_bvhtree_shared_cache_free(void);
 
 #ifdef __cplusplus
 }
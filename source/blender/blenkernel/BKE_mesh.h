@@ -407,6 +407,12 @@ const float (*BKE_mesh_poly_normals_ensure(const struct Mesh *mesh))[3];
  */
 void BKE_mesh_normals_tag_dirty(struct Mesh *mesh);
 
+/**
+ * Call after changing vertex positions without changing the topology. Normals are tagged dirty,
+ * and cached BVH trees are refit when they are used next instead of being built again.
+ */
+void BKE_mesh_tag_coords_changed(struct Mesh *mesh);
+
 /**
  * Check that a mesh with non-dirty normals has vertex and face custom data layers.
  * If these asserts fail, it means some area cleared the dirty flag but didn't copy or add the
@@ -502,6 +508,35 @@ void BKE_mesh_calc_normals_poly_and_vertex(struct MVert *mvert,
                                            float (*r_poly_normals)[3],
                                            float (*r_vert_normals)[3]);
 
+/**
+ * Create data for #BKE_mesh_normals_update_with_partial, for updating the normals after
+ * the vertices in \a verts_mask were moved.
+ *
+ * \param verts_mask: A #BLI_bitmap of changed vertices.
+ * \param verts_mask_count: The number of vertices enabled in \a verts_mask.
+ */
+MeshNormalsPartial *BKE_mesh_normals_partial_create_from_verts(const struct Mesh *mesh,
+                                                               const unsigned int *verts_mask,
+                                                               int verts_mask_count)
+    ATTR_NONNULL(1, 2) ATTR_WARN_UNUSED_RESULT;
+/**
+ * A version of #BKE_mesh_normals_partial_create_from_verts for when all vertices of the
+ * polygons in \a polys_mask were moved.
+ */
+MeshNormalsPartial *BKE_mesh_normals_partial_create_from_polys(const struct Mesh *mesh,
+                                                               const unsigned int *polys_mask,
+                                                               int polys_mask_count)
+    ATTR_NONNULL(1, 2) ATTR_WARN_UNUSED_RESULT;
+void BKE_mesh_normals_partial_destroy(MeshNormalsPartial *partial) ATTR_NONNULL(1);
+
+/**
+ * Recalculate the normals affected by moving the vertices \a partial was created for,
+ * instead of tagging all normals dirty with #BKE_mesh_normals_tag_dirty.
+ * When the normals are dirty already, they're all calculated instead.
+ */
+void BKE_mesh_normals_update_with_partial(struct Mesh *mesh, const MeshNormalsPartial *partial)
+    ATTR_NONNULL(1, 2);
+
 /**
  * Calculate vertex and face normals, storing the result in custom data layers on the mesh.
  *
@@ -675,6 +710,27 @@ void BKE_mesh_normals_loop_split(const struct MVert *mverts,
                                  short (*clnors_data)[2],
                                  int *r_loop_to_poly);
 
+/**
+ * Same as #BKE_mesh_normals_loop_split, but without the auto-smooth angle (always the case with
+ * custom normals), the smooth fans are cached in the mesh's runtime data. Meshes sharing their
+ * topology (see #BKE_mesh_loop_split_cache_share) share the cache too, so that only the vector
+ * math is done again when positions change.
+ */
+void BKE_mesh_normals_loop_split_cached(struct Mesh *mesh,
+                                        const float (*vert_normals)[3],
+                                        const float (*polynors)[3],
+                                        float (*r_loopnors)[3],
+                                        bool use_split_normals,
+                                        float split_angle,
+                                        MLoopNorSpaceArray *r_lnors_spacearr,
+                                        short (*clnors_data)[2]);
+/**
+ * Let \a mesh_dst use the smooth fans cache of \a mesh_src, which it shares its topology with.
+ * The cache is detached again when the topologies become different.
+ */
+void BKE_mesh_loop_split_cache_share(const struct Mesh *mesh_src, struct Mesh *mesh_dst);
+void BKE_mesh_loop_split_cache_release(struct Mesh *mesh);
+
 void BKE_mesh_normals_loop_custom_set(const struct MVert *mverts,
                                       const float (*vert_normals)[3],
                                       int numVerts,
@@ -30,3 +30,27 @@ typedef enum eMeshBatchDirtyMode {
   BKE_MESH_BATCH_DIRTY_UVEDIT_ALL,
   BKE_MESH_BATCH_DIRTY_UVEDIT_SELECT,
 } eMeshBatchDirtyMode;
+
+/**
+ * Cached data to speed up partial normal updates,
+ * see #BKE_mesh_normals_partial_create_from_verts.
+ *
+ * Creating this data loops over the whole mesh, so it should be reused across multiple updates
+ * of the same vertices (while transforming or deforming part of the mesh for example).
+ * It's only valid while the topology of the mesh doesn't change.
+ */
+typedef struct MeshNormalsPartial {
+  /** Polygons that use a changed vertex. */
+  int *polys;
+  int polys_len;
+  /** All vertices of #polys, their normals depend on the changed vertices. */
+  int *verts;
+  int verts_len;
+  /**
+   * The face corners of each vertex in #verts, from `verts_corner_offsets[i]` to
+   * `verts_corner_offsets[i + 1]`, as loop and polygon indices.
+   */
+  int *verts_corner_offsets;
+  int *corner_loops;
+  int *corner_polys;
+} MeshNormalsPartial;
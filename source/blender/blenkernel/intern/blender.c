@@ -42,6 +42,7 @@
 #include "BKE_blender_version.h" /* own include */
 #include "BKE_blendfile.h"
 #include "BKE_brush.h"
+#include "BKE_bvhutils.h"
 #include "BKE_cachefile.h"
 #include "BKE_callbacks.h"
 #include "BKE_global.h"
@@ -81,6 +82,9 @@ void BKE_blender_free(void)
   BKE_main_free(G_MAIN);
   G_MAIN = NULL;
 
+  /* After freeing main, so that meshes don't use any shared tree anymore. */
+  BKE_bvhtree_shared_cache_free();
+
   if (G.log.file != NULL) {
     fclose(G.log.file);
   }
@@ -21,17 +21,24 @@
  * \ingroup bke
  */
 
+#include <atomic>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <mutex>
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
 #include "DNA_pointcloud_types.h"
 
+#include "BLI_array.hh"
 #include "BLI_linklist.h"
+#include "BLI_map.hh"
 #include "BLI_math.h"
+#include "BLI_math_vec_types.hh"
 #include "BLI_task.h"
+#include "BLI_task.hh"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
@@ -48,6 +55,10 @@
 
 struct BVHCacheItem {
   bool is_filled;
+  /** The tree is owned by the shared tree cache, see #BKE_bvhtree_from_mesh_get_shared. */
+  bool is_shared;
+  /** The positions changed since the tree was built, see #bvhcache_tag_deformed. */
+  bool is_deformed;
   BVHTree *tree;
 };
 
@@ -147,17 +158,44 @@ static void bvhcache_insert(BVHCache *bvh_cache, BVHTree *tree, BVHCacheType typ
   item->is_filled = true;
 }
 
+static void shared_bvhtree_release(BVHTree *tree);
+
 void bvhcache_free(BVHCache *bvh_cache)
 {
   for (int index = 0; index < BVHTREE_MAX_ITEM; index++) {
     BVHCacheItem *item = &bvh_cache->items[index];
-    BLI_bvhtree_free(item->tree);
+    if (item->is_shared) {
+      shared_bvhtree_release(item->tree);
+    }
+    else {
+      BLI_bvhtree_free(item->tree);
+    }
     item->tree = nullptr;
   }
   BLI_mutex_end(&bvh_cache->mutex);
   MEM_freeN(bvh_cache);
 }
 
+void bvhcache_tag_deformed(BVHCache *bvh_cache)
+{
+  for (int index = 0; index < BVHTREE_MAX_ITEM; index++) {
+    BVHCacheItem *item = &bvh_cache->items[index];
+    if (item->tree == nullptr) {
+      continue;
+    }
+    if (item->is_shared) {
+      /* Other meshes may use the tree, a tree for the new positions is found when needed. */
+      shared_bvhtree_release(item->tree);
+      item->tree = nullptr;
+      item->is_filled = false;
+      item->is_shared = false;
+    }
+    else {
+      item->is_deformed = true;
+    }
+  }
+}
+
 /**
  * BVH-tree balancing inside a mutex lock must be run in isolation. Balancing
  * is multithreaded, and we do not want the current thread to start another task
@@ -180,6 +218,101 @@ static void bvhtree_balance(BVHTree *tree, const bool isolate)
   }
 }
 
+/**
+ * Update the bounds of a tree that contains all elements of the mesh after its positions changed,
+ * which is much faster than building a new tree. Like balancing, this is run in isolation because
+ * it is multi-threaded and called while the mesh cache is locked.
+ *
+ * \return False when the tree can't be refit and has to be built again.
+ */
+static bool bvhtree_refit_from_mesh(BVHTree *tree,
+                                    const Mesh &mesh,
+                                    const BVHCacheType bvh_cache_type)
+{
+  using namespace blender;
+  const MVert *verts = mesh.mvert;
+  auto refit = [&](const int elements_num, const auto &update_element) {
+    if (BLI_bvhtree_get_len(tree) != elements_num) {
+      return false;
+    }
+    threading::isolate_task([&]() {
+      threading::parallel_for(IndexRange(elements_num), 1024, [&](const IndexRange range) {
+        for (const int i : range) {
+          update_element(i);
+        }
+      });
+      BLI_bvhtree_update_tree(tree);
+    });
+    return true;
+  };
+
+  switch (bvh_cache_type) {
+    case BVHTREE_FROM_VERTS:
+      return refit(mesh.totvert, [&](const int i) {
+        BLI_bvhtree_update_node(tree, i, verts[i].co, nullptr, 1);
+      });
+    case BVHTREE_FROM_EDGES: {
+      const MEdge *edges = mesh.medge;
+      return refit(mesh.totedge, [&](const int i) {
+        float co[2][3];
+        copy_v3_v3(co[0], verts[edges[i].v1].co);
+        copy_v3_v3(co[1], verts[edges[i].v2].co);
+        BLI_bvhtree_update_node(tree, i, co[0], nullptr, 2);
+      });
+    }
+    case BVHTREE_FROM_FACES: {
+      const MFace *faces = mesh.mface;
+      return refit(mesh.totface, [&](const int i) {
+        float co[4][3];
+        copy_v3_v3(co[0], verts[faces[i].v1].co);
+        copy_v3_v3(co[1], verts[faces[i].v2].co);
+        copy_v3_v3(co[2], verts[faces[i].v3].co);
+        if (faces[i].v4) {
+          copy_v3_v3(co[3], verts[faces[i].v4].co);
+        }
+        BLI_bvhtree_update_node(tree, i, co[0], nullptr, faces[i].v4 ? 4 : 3);
+      });
+    }
+    case BVHTREE_FROM_LOOPTRI: {
+      const MLoop *loops = mesh.mloop;
+      const MLoopTri *looptris = BKE_mesh_runtime_looptri_ensure(&mesh);
+      return refit(BKE_mesh_runtime_looptri_len(&mesh), [&](const int i) {
+        float co[3][3];
+        copy_v3_v3(co[0], verts[loops[looptris[i].tri[0]].v].co);
+        copy_v3_v3(co[1], verts[loops[looptris[i].tri[1]].v].co);
+        copy_v3_v3(co[2], verts[loops[looptris[i].tri[2]].v].co);
+        BLI_bvhtree_update_node(tree, i, co[0], nullptr, 3);
+      });
+    }
+    default:
+      /* Trees that only contain some elements depend on more than the positions. */
+      return false;
+  }
+}
+
+/**
+ * Refit a cached tree tagged with #bvhcache_tag_deformed before it is used.
+ * Trees that can't be refit are removed from the cache, so they are built again.
+ */
+static void bvhcache_refit_deformed(const Mesh &mesh, const BVHCacheType bvh_cache_type)
+{
+  BVHCache *bvh_cache = mesh.runtime.bvh_cache;
+  if (bvh_cache == nullptr || !bvh_cache->items[bvh_cache_type].is_deformed) {
+    return;
+  }
+  BLI_mutex_lock(&bvh_cache->mutex);
+  BVHCacheItem &item = bvh_cache->items[bvh_cache_type];
+  if (item.is_deformed) {
+    if (!bvhtree_refit_from_mesh(item.tree, mesh, bvh_cache_type)) {
+      BLI_bvhtree_free(item.tree);
+      item.tree = nullptr;
+      item.is_filled = false;
+    }
+    item.is_deformed = false;
+  }
+  BLI_mutex_unlock(&bvh_cache->mutex);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -1430,6 +1563,7 @@ BVHTree *BKE_bvhtree_from_mesh_get(struct BVHTreeFromMesh *data,
   BVHCache **bvh_cache_p = (BVHCache **)&mesh->runtime.bvh_cache;
   ThreadMutex *mesh_eval_mutex = (ThreadMutex *)mesh->runtime.eval_mutex;
 
+  bvhcache_refit_deformed(*mesh, bvh_cache_type);
   const bool is_cached = bvhcache_find(bvh_cache_p, bvh_cache_type, &tree, nullptr, nullptr);
 
   if (is_cached && tree == nullptr) {
@@ -1720,6 +1854,518 @@ BVHTree *BKE_bvhtree_from_editmesh_get(BVHTreeFromEditMesh *data,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Shared Trees
+ *
+ * Trees that are shared between meshes with the same data. They are found with a hash of the data
+ * they are built from, which is then compared with a copy of that data, and are reference counted
+ * by the mesh caches that contain them. Trees without users are kept for meshes that are created
+ * later, until there are too many of them.
+ * \{ */
+
+struct SharedBVHTreeKey {
+  BVHCacheType type;
+  int tree_type;
+  int elements_num;
+  /** Hash of the elements without their positions, to find trees that can be refit. */
+  uint64_t topology_hash;
+  uint64_t data_hash;
+
+  uint64_t hash() const
+  {
+    return blender::get_default_hash_4(int(type), tree_type, elements_num, data_hash);
+  }
+
+  friend bool operator==(const SharedBVHTreeKey &a, const SharedBVHTreeKey &b)
+  {
+    return a.type == b.type && a.tree_type == b.tree_type && a.elements_num == b.elements_num &&
+           a.topology_hash == b.topology_hash && a.data_hash == b.data_hash;
+  }
+
+  bool has_same_topology(const SharedBVHTreeKey &other) const
+  {
+    return type == other.type && tree_type == other.tree_type &&
+           elements_num == other.elements_num && topology_hash == other.topology_hash;
+  }
+};
+
+/** The data a shared tree was built from, a matching hash alone is not enough to share a tree. */
+struct SharedBVHTreeData {
+  blender::Array<blender::float3> positions;
+  /** The vertices of every element, empty for trees of vertices. */
+  blender::Array<int> element_verts;
+};
+
+struct SharedBVHTree {
+  SharedBVHTreeKey key;
+  /** Doesn't change while the tree has users, so it can be read without locking the cache. */
+  SharedBVHTreeData data;
+  BVHTree *tree;
+  int users;
+  /** Number of times the tree was refit for other positions since it was built. */
+  int refits;
+  /** Used to free the least recently used or released trees first. */
+  uint64_t last_use;
+};
+
+struct SharedBVHTreeCache {
+  std::mutex mutex;
+  blender::Map<SharedBVHTreeKey, std::unique_ptr<SharedBVHTree>> trees;
+  blender::Map<const BVHTree *, SharedBVHTree *> tree_owners;
+  uint64_t use_counter = 0;
+  /** Number of elements in trees without users. */
+  int64_t unused_elements_num = 0;
+};
+
+/**
+ * Limits the memory used by trees that are only kept in case they are needed again. The limit is
+ * raised to the size of the largest tree that is in use or was just released, so that the trees of
+ * large deforming meshes are still kept to be refit on the next frame.
+ */
+static constexpr int64_t shared_bvhtree_max_unused_elements = 4 * 1024 * 1024;
+/**
+ * Refitting keeps the structure of the tree, which gets less efficient as the positions move
+ * further away from the ones it was built for. Build the tree again after this many refits.
+ */
+static constexpr int shared_bvhtree_max_refits = 16;
+
+static SharedBVHTreeCache &shared_bvhtree_cache()
+{
+  static SharedBVHTreeCache cache;
+  return cache;
+}
+
+static uint64_t shared_bvhtree_hash_combine(const uint64_t hash, const uint64_t value)
+{
+  return hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+}
+
+/**
+ * Hash fixed size chunks of the elements in parallel and combine them in order,
+ * so that the result does not depend on scheduling.
+ */
+template<typename HashElementFn>
+static uint64_t shared_bvhtree_hash_elements(const int elements_num,
+                                             const HashElementFn &hash_element)
+{
+  const int64_t chunk_size = 4096;
+  blender::Array<uint64_t> chunk_hashes((elements_num + chunk_size - 1) / chunk_size);
+  blender::threading::parallel_for(
+      chunk_hashes.index_range(), 8, [&](const blender::IndexRange range) {
+        for (const int64_t chunk : range) {
+          const int64_t end = std::min<int64_t>(elements_num, (chunk + 1) * chunk_size);
+          uint64_t hash = 0;
+          for (int64_t i = chunk * chunk_size; i < end; i++) {
+            hash = hash_element(hash, i);
+          }
+          chunk_hashes[chunk] = hash;
+        }
+      });
+  uint64_t hash = 0;
+  for (const uint64_t chunk_hash : chunk_hashes) {
+    hash = shared_bvhtree_hash_combine(hash, chunk_hash);
+  }
+  return hash;
+}
+
+static uint64_t shared_bvhtree_hash_pair(const uint64_t hash, const uint32_t a, const uint32_t b)
+{
+  return shared_bvhtree_hash_combine(hash, (uint64_t(a) << 32) | b);
+}
+
+static SharedBVHTreeKey shared_bvhtree_key(const Mesh &mesh,
+                                           const BVHCacheType bvh_cache_type,
+                                           const int tree_type)
+{
+  const MVert *verts = mesh.mvert;
+  auto hash_position = [&](const uint64_t hash, const int64_t i) {
+    uint32_t bits[3];
+    memcpy(bits, verts[i].co, sizeof(bits));
+    return shared_bvhtree_hash_combine(shared_bvhtree_hash_pair(hash, bits[0], bits[1]), bits[2]);
+  };
+
+  SharedBVHTreeKey key;
+  key.type = bvh_cache_type;
+  key.tree_type = tree_type;
+  key.topology_hash = 0;
+  switch (bvh_cache_type) {
+    case BVHTREE_FROM_VERTS: {
+      key.elements_num = mesh.totvert;
+      break;
+    }
+    case BVHTREE_FROM_EDGES: {
+      const MEdge *edges = mesh.medge;
+      key.elements_num = mesh.totedge;
+      key.topology_hash = shared_bvhtree_hash_elements(
+          mesh.totedge, [&](const uint64_t hash, const int64_t i) {
+            return shared_bvhtree_hash_pair(hash, edges[i].v1, edges[i].v2);
+          });
+      break;
+    }
+    case BVHTREE_FROM_LOOPTRI: {
+      const MLoop *loops = mesh.mloop;
+      const MLoopTri *looptris = BKE_mesh_runtime_looptri_ensure(&mesh);
+      key.elements_num = BKE_mesh_runtime_looptri_len(&mesh);
+      key.topology_hash = shared_bvhtree_hash_elements(
+          key.elements_num, [&](const uint64_t hash, const int64_t i) {
+            const uint(&tri)[3] = looptris[i].tri;
+            return shared_bvhtree_hash_combine(
+                shared_bvhtree_hash_pair(hash, loops[tri[0]].v, loops[tri[1]].v),
+                loops[tri[2]].v);
+          });
+      break;
+    }
+    default:
+      BLI_assert_unreachable();
+      break;
+  }
+  key.data_hash = shared_bvhtree_hash_combine(
+      shared_bvhtree_hash_elements(mesh.totvert, hash_position), key.topology_hash);
+  return key;
+}
+
+static int64_t shared_bvhtree_element_verts_num(const Mesh &mesh,
+                                                const BVHCacheType bvh_cache_type)
+{
+  switch (bvh_cache_type) {
+    case BVHTREE_FROM_EDGES:
+      return int64_t(mesh.totedge) * 2;
+    case BVHTREE_FROM_LOOPTRI:
+      return int64_t(BKE_mesh_runtime_looptri_len(&mesh)) * 3;
+    default:
+      return 0;
+  }
+}
+
+static int shared_bvhtree_element_vert(const Mesh &mesh,
+                                       const MLoopTri *looptris,
+                                       const BVHCacheType bvh_cache_type,
+                                       const int64_t index)
+{
+  if (bvh_cache_type == BVHTREE_FROM_EDGES) {
+    const MEdge &edge = mesh.medge[index / 2];
+    return (index % 2) ? edge.v2 : edge.v1;
+  }
+  return mesh.mloop[looptris[index / 3].tri[index % 3]].v;
+}
+
+static SharedBVHTreeData shared_bvhtree_data(const Mesh &mesh, const BVHCacheType bvh_cache_type)
+{
+  using namespace blender;
+  const MLoopTri *looptris = bvh_cache_type == BVHTREE_FROM_LOOPTRI ?
+                                 BKE_mesh_runtime_looptri_ensure(&mesh) :
+                                 nullptr;
+  SharedBVHTreeData data;
+  data.positions.reinitialize(mesh.totvert);
+  data.element_verts.reinitialize(shared_bvhtree_element_verts_num(mesh, bvh_cache_type));
+  threading::parallel_for(data.positions.index_range(), 4096, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      copy_v3_v3(data.positions[i], mesh.mvert[i].co);
+    }
+  });
+  threading::parallel_for(data.element_verts.index_range(), 4096, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      data.element_verts[i] = shared_bvhtree_element_vert(mesh, looptris, bvh_cache_type, i);
+    }
+  });
+  return data;
+}
+
+/**
+ * Compare the positions bitwise like the hash does, so that meshes which only differ in the sign
+ * of zero coordinates don't share a tree either.
+ */
+static bool shared_bvhtree_data_matches(const SharedBVHTreeData &data,
+                                        const Mesh &mesh,
+                                        const BVHCacheType bvh_cache_type)
+{
+  using namespace blender;
+  if (data.positions.size() != mesh.totvert ||
+      data.element_verts.size() != shared_bvhtree_element_verts_num(mesh, bvh_cache_type)) {
+    return false;
+  }
+  const MLoopTri *looptris = bvh_cache_type == BVHTREE_FROM_LOOPTRI ?
+                                 BKE_mesh_runtime_looptri_ensure(&mesh) :
+                                 nullptr;
+  std::atomic<bool> matches = true;
+  threading::parallel_for(data.positions.index_range(), 4096, [&](const IndexRange range) {
+    if (!matches.load(std::memory_order_relaxed)) {
+      return;
+    }
+    for (const int64_t i : range) {
+      if (memcmp(&data.positions[i], mesh.mvert[i].co, sizeof(float[3])) != 0) {
+        matches.store(false, std::memory_order_relaxed);
+        return;
+      }
+    }
+  });
+  threading::parallel_for(data.element_verts.index_range(), 4096, [&](const IndexRange range) {
+    if (!matches.load(std::memory_order_relaxed)) {
+      return;
+    }
+    for (const int64_t i : range) {
+      const int vert = shared_bvhtree_element_vert(mesh, looptris, bvh_cache_type, i);
+      if (data.element_verts[i] != vert) {
+        matches.store(false, std::memory_order_relaxed);
+        return;
+      }
+    }
+  });
+  return matches;
+}
+
+static BVHTree *shared_bvhtree_create(const Mesh &mesh,
+                                      const BVHCacheType bvh_cache_type,
+                                      const int tree_type)
+{
+  BVHTree *tree = nullptr;
+  switch (bvh_cache_type) {
+    case BVHTREE_FROM_VERTS:
+      tree = bvhtree_from_mesh_verts_create_tree(
+          0.0f, tree_type, 6, mesh.mvert, mesh.totvert, nullptr, -1);
+      break;
+    case BVHTREE_FROM_EDGES:
+      tree = bvhtree_from_mesh_edges_create_tree(
+          mesh.mvert, mesh.medge, mesh.totedge, nullptr, -1, 0.0f, tree_type, 6);
+      break;
+    case BVHTREE_FROM_LOOPTRI:
+      tree = bvhtree_from_mesh_looptri_create_tree(0.0f,
+                                                   tree_type,
+                                                   6,
+                                                   mesh.mvert,
+                                                   mesh.mloop,
+                                                   BKE_mesh_runtime_looptri_ensure(&mesh),
+                                                   BKE_mesh_runtime_looptri_len(&mesh),
+                                                   nullptr,
+                                                   -1);
+      break;
+    default:
+      BLI_assert_unreachable();
+      break;
+  }
+  /* The mesh cache is locked while the tree is built. */
+  bvhtree_balance(tree, true);
+  return tree;
+}
+
+static void shared_bvhtree_free_unused(SharedBVHTreeCache &cache, const int64_t max_elements)
+{
+  while (cache.unused_elements_num > max_elements) {
+    SharedBVHTree *oldest = nullptr;
+    for (const std::unique_ptr<SharedBVHTree> &shared : cache.trees.values()) {
+      if (shared->users == 0 && (oldest == nullptr || shared->last_use < oldest->last_use)) {
+        oldest = shared.get();
+      }
+    }
+    if (oldest == nullptr) {
+      BLI_assert_unreachable();
+      break;
+    }
+    cache.unused_elements_num -= oldest->key.elements_num;
+    cache.tree_owners.remove(oldest->tree);
+    BLI_bvhtree_free(oldest->tree);
+    cache.trees.remove(oldest->key);
+  }
+}
+
+static BVHTree *shared_bvhtree_acquire_locked(SharedBVHTreeCache &cache, SharedBVHTree &shared)
+{
+  if (shared.users == 0) {
+    cache.unused_elements_num -= shared.key.elements_num;
+  }
+  shared.users++;
+  shared.last_use = ++cache.use_counter;
+  return shared.tree;
+}
+
+/**
+ * Add a user to the tree for the key and return it, without comparing its data yet.
+ */
+static SharedBVHTree *shared_bvhtree_lookup_and_acquire(SharedBVHTreeCache &cache,
+                                                        const SharedBVHTreeKey &key)
+{
+  std::lock_guard lock{cache.mutex};
+  std::unique_ptr<SharedBVHTree> *shared = cache.trees.lookup_ptr(key);
+  if (shared == nullptr) {
+    return nullptr;
+  }
+  shared_bvhtree_acquire_locked(cache, **shared);
+  return shared->get();
+}
+
+/**
+ * \return A tree built from the same data as the mesh with an added user, or null if there is
+ * none.
+ */
+static BVHTree *shared_bvhtree_acquire(const SharedBVHTreeKey &key, const Mesh &mesh)
+{
+  SharedBVHTreeCache &cache = shared_bvhtree_cache();
+  SharedBVHTree *shared = shared_bvhtree_lookup_and_acquire(cache, key);
+  if (shared == nullptr) {
+    return nullptr;
+  }
+  if (!shared_bvhtree_data_matches(shared->data, mesh, key.type)) {
+    /* The hash of different data matched. */
+    shared_bvhtree_release(shared->tree);
+    return nullptr;
+  }
+  return shared->tree;
+}
+
+/**
+ * Remove the most recently used tree without users that was built for the same topology as the
+ * key, so it can be refit to the positions of a deformed mesh instead of building a new tree.
+ *
+ * \return The tree, now owned by the caller, or null if there is none.
+ */
+static BVHTree *shared_bvhtree_take_deformed(const SharedBVHTreeKey &key, int *r_refits)
+{
+  SharedBVHTreeCache &cache = shared_bvhtree_cache();
+  std::lock_guard lock{cache.mutex};
+  SharedBVHTree *found = nullptr;
+  for (const std::unique_ptr<SharedBVHTree> &shared : cache.trees.values()) {
+    if (shared->users == 0 && shared->refits < shared_bvhtree_max_refits &&
+        shared->key.has_same_topology(key) &&
+        (found == nullptr || shared->last_use > found->last_use)) {
+      found = shared.get();
+    }
+  }
+  if (found == nullptr) {
+    return nullptr;
+  }
+  BVHTree *tree = found->tree;
+  *r_refits = found->refits;
+  cache.unused_elements_num -= found->key.elements_num;
+  cache.tree_owners.remove(tree);
+  cache.trees.remove(found->key);
+  return tree;
+}
+
+/**
+ * Add a new tree built from the mesh with one user. When another thread added a tree for the same
+ * data in the meantime, the given tree is freed and the existing one is returned instead. When the
+ * key is used by a tree for different data, the given tree is returned without sharing it.
+ */
+static BVHTree *shared_bvhtree_add(const SharedBVHTreeKey &key,
+                                   const Mesh &mesh,
+                                   BVHTree *tree,
+                                   const int refits,
+                                   bool *r_is_shared)
+{
+  SharedBVHTreeCache &cache = shared_bvhtree_cache();
+  /* Copied before locking the cache, it is rarely unused. */
+  SharedBVHTreeData data = shared_bvhtree_data(mesh, key.type);
+  SharedBVHTree *existing = nullptr;
+  {
+    std::lock_guard lock{cache.mutex};
+    if (std::unique_ptr<SharedBVHTree> *found = cache.trees.lookup_ptr(key)) {
+      existing = found->get();
+      shared_bvhtree_acquire_locked(cache, *existing);
+    }
+    else {
+      std::unique_ptr<SharedBVHTree> shared = std::make_unique<SharedBVHTree>();
+      shared->key = key;
+      shared->data = std::move(data);
+      shared->tree = tree;
+      shared->users = 1;
+      shared->refits = refits;
+      shared->last_use = ++cache.use_counter;
+      cache.tree_owners.add_new(tree, shared.get());
+      cache.trees.add_new(key, std::move(shared));
+      *r_is_shared = true;
+      return tree;
+    }
+  }
+  if (shared_bvhtree_data_matches(existing->data, mesh, key.type)) {
+    BLI_bvhtree_free(tree);
+    *r_is_shared = true;
+    return existing->tree;
+  }
+  shared_bvhtree_release(existing->tree);
+  *r_is_shared = false;
+  return tree;
+}
+
+static void shared_bvhtree_release(BVHTree *tree)
+{
+  SharedBVHTreeCache &cache = shared_bvhtree_cache();
+  std::lock_guard lock{cache.mutex};
+  SharedBVHTree &shared = *cache.tree_owners.lookup(tree);
+  BLI_assert(shared.users > 0);
+  shared.users--;
+  if (shared.users == 0) {
+    cache.unused_elements_num += shared.key.elements_num;
+    /* Free the released tree last, a deforming mesh refits it when it is evaluated again. */
+    shared.last_use = ++cache.use_counter;
+    int64_t max_elements = std::max<int64_t>(shared_bvhtree_max_unused_elements,
+                                             shared.key.elements_num);
+    for (const std::unique_ptr<SharedBVHTree> &other : cache.trees.values()) {
+      if (other->users > 0) {
+        max_elements = std::max<int64_t>(max_elements, other->key.elements_num);
+      }
+    }
+    shared_bvhtree_free_unused(cache, max_elements);
+  }
+}
+
+BVHTree *BKE_bvhtree_from_mesh_get_shared(struct BVHTreeFromMesh *data,
+                                          const struct Mesh *mesh,
+                                          const BVHCacheType bvh_cache_type,
+                                          const int tree_type)
+{
+  if (!ELEM(bvh_cache_type, BVHTREE_FROM_VERTS, BVHTREE_FROM_EDGES, BVHTREE_FROM_LOOPTRI)) {
+    return BKE_bvhtree_from_mesh_get(data, mesh, bvh_cache_type, tree_type);
+  }
+
+  BVHCache **bvh_cache_p = (BVHCache **)&mesh->runtime.bvh_cache;
+  ThreadMutex *mesh_eval_mutex = (ThreadMutex *)mesh->runtime.eval_mutex;
+
+  bvhcache_refit_deformed(*mesh, bvh_cache_type);
+  BVHTree *tree = nullptr;
+  if (!bvhcache_find(bvh_cache_p, bvh_cache_type, &tree, nullptr, nullptr)) {
+    /* Hashing is multi-threaded, so it is done before locking the mesh cache. */
+    const SharedBVHTreeKey key = shared_bvhtree_key(*mesh, bvh_cache_type, tree_type);
+    bool lock_started = false;
+    if (!bvhcache_find(bvh_cache_p, bvh_cache_type, &tree, &lock_started, mesh_eval_mutex)) {
+      tree = shared_bvhtree_acquire(key, *mesh);
+      bool is_shared = tree != nullptr;
+      if (tree == nullptr) {
+        /* A deforming mesh usually has the same topology as the mesh of the previous frame,
+         * whose tree isn't used anymore. */
+        int refits = 0;
+        tree = shared_bvhtree_take_deformed(key, &refits);
+        if (tree != nullptr && bvhtree_refit_from_mesh(tree, *mesh, bvh_cache_type)) {
+          refits++;
+        }
+        else {
+          BLI_bvhtree_free(tree);
+          tree = shared_bvhtree_create(*mesh, bvh_cache_type, tree_type);
+          refits = 0;
+        }
+        if (tree != nullptr) {
+          tree = shared_bvhtree_add(key, *mesh, tree, refits, &is_shared);
+        }
+      }
+      BVHCache *bvh_cache = *bvh_cache_p;
+      bvhcache_insert(bvh_cache, tree, bvh_cache_type);
+      bvh_cache->items[bvh_cache_type].is_shared = is_shared;
+    }
+    bvhcache_unlock(*bvh_cache_p, lock_started);
+  }
+
+  /* Setup the data from the tree in the mesh cache. */
+  return BKE_bvhtree_from_mesh_get(data, mesh, bvh_cache_type, tree_type);
+}
+
+void BKE_bvhtree_shared_cache_free()
+{
+  SharedBVHTreeCache &cache = shared_bvhtree_cache();
+  std::lock_guard lock{cache.mutex};
+  shared_bvhtree_free_unused(cache, 0);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Free Functions
  * \{ */
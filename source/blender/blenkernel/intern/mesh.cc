@@ -152,6 +152,11 @@ static void mesh_copy_data(Main *bmain, ID *id_dst, const ID *id_src, const int
 
   BKE_mesh_update_customdata_pointers(mesh_dst, do_tessface);
 
+  if (alloc_type == CD_REFERENCE) {
+    /* The topology is shared, so are the smooth fans of split normals. */
+    BKE_mesh_loop_split_cache_share(mesh_src, mesh_dst);
+  }
+
   mesh_dst->cd_flag = mesh_src->cd_flag;
 
   mesh_dst->edit_mesh = nullptr;
@@ -1913,7 +1918,7 @@ void BKE_mesh_vert_coords_apply(Mesh *mesh, const float (*vert_coords)[3])
   for (int i = 0; i < mesh->totvert; i++, mv++) {
     copy_v3_v3(mv->co, vert_coords[i]);
   }
-  BKE_mesh_normals_tag_dirty(mesh);
+  BKE_mesh_tag_coords_changed(mesh);
 }
 
 void BKE_mesh_vert_coords_apply_with_mat4(Mesh *mesh,
@@ -1927,7 +1932,7 @@ void BKE_mesh_vert_coords_apply_with_mat4(Mesh *mesh,
   for (int i = 0; i < mesh->totvert; i++, mv++) {
     mul_v3_m4v3(mv->co, mat, vert_coords[i]);
   }
-  BKE_mesh_normals_tag_dirty(mesh);
+  BKE_mesh_tag_coords_changed(mesh);
 }
 
 void BKE_mesh_anonymous_attributes_remove(Mesh *mesh)
@@ -1963,22 +1968,14 @@ void BKE_mesh_calc_normals_split_ex(Mesh *mesh, MLoopNorSpaceArray *r_lnors_spac
   /* may be nullptr */
   clnors = (short(*)[2])CustomData_get_layer(&mesh->ldata, CD_CUSTOMLOOPNORMAL);
 
-  BKE_mesh_normals_loop_split(mesh->mvert,
-                              BKE_mesh_vertex_normals_ensure(mesh),
-                              mesh->totvert,
-                              mesh->medge,
-                              mesh->totedge,
-                              mesh->mloop,
-                              r_loopnors,
-                              mesh->totloop,
-                              mesh->mpoly,
-                              BKE_mesh_poly_normals_ensure(mesh),
-                              mesh->totpoly,
-                              use_split_normals,
-                              split_angle,
-                              r_lnors_spacearr,
-                              clnors,
-                              nullptr);
+  BKE_mesh_normals_loop_split_cached(mesh,
+                                     BKE_mesh_vertex_normals_ensure(mesh),
+                                     BKE_mesh_poly_normals_ensure(mesh),
+                                     r_loopnors,
+                                     use_split_normals,
+                                     split_angle,
+                                     r_lnors_spacearr,
+                                     clnors);
 
   BKE_mesh_assert_normals_dirty_or_calculated(mesh);
 
@@ -34,6 +34,7 @@
 
 #include "BLI_alloca.h"
 #include "BLI_bitmap.h"
+#include "BLI_hash_mm2a.h"
 
 #include "BLI_linklist.h"
 #include "BLI_linklist_stack.h"
@@ -44,6 +45,7 @@
 #include "BLI_stack.h"
 #include "BLI_task.h"
 #include "BLI_task.hh"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_customdata.h"
@@ -53,6 +55,7 @@
 
 #include "atomic_ops.h"
 
+using blender::IndexRange;
 using blender::Span;
 
 // #define DEBUG_TIME
@@ -235,6 +238,28 @@ void BKE_mesh_calc_normals_poly(const MVert *mvert,
  * meshes can slow down high-poly meshes. For details on performance, see D11993.
  * \{ */
 
+/**
+ * Inline version of #BKE_mesh_calc_poly_normal, using Newell's method for all polygons,
+ * so partial updates calculate the same normals.
+ */
+BLI_INLINE void mesh_calc_poly_normal_newell(const MVert *mverts,
+                                             const MLoop *ml,
+                                             const int totloop,
+                                             float r_pnor[3])
+{
+  zero_v3(r_pnor);
+  /* Newell's Method */
+  const float *v_curr = mverts[ml[totloop - 1].v].co;
+  for (int i_next = 0; i_next < totloop; i_next++) {
+    const float *v_next = mverts[ml[i_next].v].co;
+    add_newell_cross_v3_v3v3(r_pnor, v_curr, v_next);
+    v_curr = v_next;
+  }
+  if (UNLIKELY(normalize_v3(r_pnor) == 0.0f)) {
+    r_pnor[2] = 1.0f; /* Other axes set to zero. */
+  }
+}
+
 struct MeshCalcNormalsData_PolyAndVertex {
   /** Write into vertex normals #MVert.no. */
   MVert *mvert;
@@ -261,21 +286,8 @@ static void mesh_calc_normals_poly_and_vertex_accum_fn(
 
   const int i_end = mp->totloop - 1;
 
-  /* Polygon Normal and edge-vector. */
-  /* Inline version of #BKE_mesh_calc_poly_normal, also does edge-vectors. */
-  {
-    zero_v3(pnor);
-    /* Newell's Method */
-    const float *v_curr = mverts[ml[i_end].v].co;
-    for (int i_next = 0; i_next <= i_end; i_next++) {
-      const float *v_next = mverts[ml[i_next].v].co;
-      add_newell_cross_v3_v3v3(pnor, v_curr, v_next);
-      v_curr = v_next;
-    }
-    if (UNLIKELY(normalize_v3(pnor) == 0.0f)) {
-      pnor[2] = 1.0f; /* Other axes set to zero. */
-    }
-  }
+  /* Polygon Normal. */
+  mesh_calc_poly_normal_newell(mverts, ml, mp->totloop, pnor);
 
   /* Accumulate angle weighted face normal into the vertex normal. */
   /* Inline version of #accumulate_vertex_normals_poly_v3. */
@@ -547,6 +559,211 @@ cleanup:
   }
 }
 
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Partial Mesh Normal Calculation
+ *
+ * Recalculate normals of the polygons using changed vertices, and of the vertices of these
+ * polygons. Vertex normals are gathered from the polygons around each vertex, so unlike
+ * #BKE_mesh_calc_normals_poly_and_vertex this doesn't need atomics.
+ *
+ * \see bmesh_mesh_partial_update.c for the equivalent #BMesh functionality.
+ * \{ */
+
+MeshNormalsPartial *BKE_mesh_normals_partial_create_from_verts(const Mesh *mesh,
+                                                               const BLI_bitmap *verts_mask,
+                                                               const int verts_mask_count)
+{
+  const MPoly *mpoly = mesh->mpoly;
+  const MLoop *mloop = mesh->mloop;
+
+  MeshNormalsPartial *partial = MEM_cnew<MeshNormalsPartial>(__func__);
+  if (verts_mask_count == 0) {
+    partial->verts_corner_offsets = (int *)MEM_calloc_arrayN(1, sizeof(int), __func__);
+    return partial;
+  }
+
+  /* Polygons using a changed vertex, and the vertices of these polygons. */
+  BLI_bitmap *polys_affected = BLI_BITMAP_NEW(mesh->totpoly, __func__);
+  BLI_bitmap *verts_affected = BLI_BITMAP_NEW(mesh->totvert, __func__);
+  for (int i = 0; i < mesh->totpoly; i++) {
+    const MPoly *mp = &mpoly[i];
+    const MLoop *ml = &mloop[mp->loopstart];
+    bool is_affected = false;
+    for (int j = 0; j < mp->totloop; j++) {
+      if (BLI_BITMAP_TEST(verts_mask, ml[j].v)) {
+        is_affected = true;
+        break;
+      }
+    }
+    if (!is_affected) {
+      continue;
+    }
+    BLI_BITMAP_ENABLE(polys_affected, i);
+    partial->polys_len++;
+    for (int j = 0; j < mp->totloop; j++) {
+      BLI_BITMAP_ENABLE(verts_affected, ml[j].v);
+    }
+  }
+
+  partial->polys = (int *)MEM_malloc_arrayN(partial->polys_len, sizeof(int), __func__);
+  for (int i = 0, i_affected = 0; i < mesh->totpoly; i++) {
+    if (BLI_BITMAP_TEST(polys_affected, i)) {
+      partial->polys[i_affected++] = i;
+    }
+  }
+
+  int *vert_to_affected = (int *)MEM_malloc_arrayN(mesh->totvert, sizeof(int), __func__);
+  for (int i = 0; i < mesh->totvert; i++) {
+    vert_to_affected[i] = BLI_BITMAP_TEST(verts_affected, i) ? partial->verts_len++ : -1;
+  }
+  partial->verts = (int *)MEM_malloc_arrayN(partial->verts_len, sizeof(int), __func__);
+  for (int i = 0; i < mesh->totvert; i++) {
+    if (vert_to_affected[i] != -1) {
+      partial->verts[vert_to_affected[i]] = i;
+    }
+  }
+
+  /* All corners of the affected vertices, including the ones of polygons that didn't change,
+   * since they contribute to the vertex normals too. */
+  int *offsets = (int *)MEM_calloc_arrayN(partial->verts_len + 1, sizeof(int), __func__);
+  for (int i = 0; i < mesh->totloop; i++) {
+    const int vert = vert_to_affected[mloop[i].v];
+    if (vert != -1) {
+      offsets[vert + 1]++;
+    }
+  }
+  for (int i = 0; i < partial->verts_len; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+  const int corners_len = offsets[partial->verts_len];
+  partial->verts_corner_offsets = offsets;
+  partial->corner_loops = (int *)MEM_malloc_arrayN(corners_len, sizeof(int), __func__);
+  partial->corner_polys = (int *)MEM_malloc_arrayN(corners_len, sizeof(int), __func__);
+
+  int *corner_fill = (int *)MEM_malloc_arrayN(partial->verts_len, sizeof(int), __func__);
+  memcpy(corner_fill, offsets, sizeof(int) * (size_t)partial->verts_len);
+  for (int i = 0; i < mesh->totpoly; i++) {
+    const MPoly *mp = &mpoly[i];
+    for (int j = mp->loopstart; j < mp->loopstart + mp->totloop; j++) {
+      const int vert = vert_to_affected[mloop[j].v];
+      if (vert != -1) {
+        const int corner = corner_fill[vert]++;
+        partial->corner_loops[corner] = j;
+        partial->corner_polys[corner] = i;
+      }
+    }
+  }
+
+  MEM_freeN(corner_fill);
+  MEM_freeN(vert_to_affected);
+  MEM_freeN(verts_affected);
+  MEM_freeN(polys_affected);
+  return partial;
+}
+
+MeshNormalsPartial *BKE_mesh_normals_partial_create_from_polys(const Mesh *mesh,
+                                                               const BLI_bitmap *polys_mask,
+                                                               const int polys_mask_count)
+{
+  BLI_bitmap *verts_mask = BLI_BITMAP_NEW(mesh->totvert, __func__);
+  int verts_mask_count = 0;
+  if (polys_mask_count != 0) {
+    for (int i = 0; i < mesh->totpoly; i++) {
+      if (!BLI_BITMAP_TEST(polys_mask, i)) {
+        continue;
+      }
+      const MPoly *mp = &mesh->mpoly[i];
+      const MLoop *ml = &mesh->mloop[mp->loopstart];
+      for (int j = 0; j < mp->totloop; j++) {
+        if (!BLI_BITMAP_TEST(verts_mask, ml[j].v)) {
+          BLI_BITMAP_ENABLE(verts_mask, ml[j].v);
+          verts_mask_count++;
+        }
+      }
+    }
+  }
+
+  MeshNormalsPartial *partial = BKE_mesh_normals_partial_create_from_verts(
+      mesh, verts_mask, verts_mask_count);
+  MEM_freeN(verts_mask);
+  return partial;
+}
+
+void BKE_mesh_normals_partial_destroy(MeshNormalsPartial *partial)
+{
+  MEM_SAFE_FREE(partial->polys);
+  MEM_SAFE_FREE(partial->verts);
+  MEM_SAFE_FREE(partial->verts_corner_offsets);
+  MEM_SAFE_FREE(partial->corner_loops);
+  MEM_SAFE_FREE(partial->corner_polys);
+  MEM_freeN(partial);
+}
+
+/** The angle of a polygon corner, which weights the polygon normal in the vertex normal. */
+BLI_INLINE float mesh_poly_corner_angle(const MVert *mverts,
+                                        const MLoop *ml,
+                                        const int totloop,
+                                        const int corner)
+{
+  const float *v_prev = mverts[ml[(corner + totloop - 1) % totloop].v].co;
+  const float *v_curr = mverts[ml[corner].v].co;
+  const float *v_next = mverts[ml[(corner + 1) % totloop].v].co;
+  float edvec_prev[3], edvec_next[3];
+  sub_v3_v3v3(edvec_prev, v_prev, v_curr);
+  normalize_v3(edvec_prev);
+  sub_v3_v3v3(edvec_next, v_curr, v_next);
+  normalize_v3(edvec_next);
+  return saacos(-dot_v3v3(edvec_prev, edvec_next));
+}
+
+void BKE_mesh_normals_update_with_partial(Mesh *mesh, const MeshNormalsPartial *partial)
+{
+  if (BKE_mesh_vertex_normals_are_dirty(mesh) || BKE_mesh_poly_normals_are_dirty(mesh)) {
+    /* There are no normals to update. */
+    BKE_mesh_vertex_normals_ensure(mesh);
+    return;
+  }
+
+  const MVert *mverts = mesh->mvert;
+  const MLoop *mloop = mesh->mloop;
+  const MPoly *mpoly = mesh->mpoly;
+  float(*poly_normals)[3] = mesh->runtime.poly_normals;
+  float(*vert_normals)[3] = mesh->runtime.vert_normals;
+
+  blender::threading::parallel_for(IndexRange(partial->polys_len), 1024, [&](IndexRange range) {
+    for (const int i : range) {
+      const MPoly *mp = &mpoly[partial->polys[i]];
+      mesh_calc_poly_normal_newell(
+          mverts, &mloop[mp->loopstart], mp->totloop, poly_normals[partial->polys[i]]);
+    }
+  });
+
+  blender::threading::parallel_for(IndexRange(partial->verts_len), 1024, [&](IndexRange range) {
+    for (const int i : range) {
+      const int vert = partial->verts[i];
+      float no[3] = {0.0f, 0.0f, 0.0f};
+      for (int corner = partial->verts_corner_offsets[i];
+           corner < partial->verts_corner_offsets[i + 1];
+           corner++) {
+        const int poly = partial->corner_polys[corner];
+        const MPoly *mp = &mpoly[poly];
+        const float fac = mesh_poly_corner_angle(mverts,
+                                                 &mloop[mp->loopstart],
+                                                 mp->totloop,
+                                                 partial->corner_loops[corner] - mp->loopstart);
+        madd_v3_v3fl(no, poly_normals[poly], fac);
+      }
+      if (UNLIKELY(normalize_v3(no) == 0.0f)) {
+        /* Following Mesh convention; we use vertex coordinate itself for normal in this case. */
+        normalize_v3_v3(no, mverts[vert].co);
+      }
+      copy_v3_v3(vert_normals[vert], no);
+    }
+  });
+}
+
 void BKE_lnor_spacearr_init(MLoopNorSpaceArray *lnors_spacearr,
                             const int numLoops,
                             const char data_type)
@@ -1768,6 +1985,375 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
 #endif
 }
 
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Loop Split Cache
+ *
+ * Without the auto-smooth angle (always the case with custom normals), the smooth fans found by
+ * #loop_split_generator only depend on topology and on the sharp edge and smooth face flags.
+ * They are cached on the mesh, and shared with copies that reference the same topology (like the
+ * result of deform modifiers), so only the vector math is done again when positions change.
+ * \{ */
+
+/** A smooth fan or a single loop, as found by #loop_split_generator. */
+struct LoopSplitCacheTask {
+  int ml_curr_index;
+  int ml_prev_index;
+  int mp_index;
+  bool is_fan;
+};
+
+/**
+ * The data the smooth fans depend on, other changes like the selection don't rebuild the cache.
+ * The sharp edge and smooth face flags are compared exactly. The loops and polygon ranges are too
+ * large to keep a copy of, so they are hashed.
+ */
+struct LoopSplitCacheKey {
+  /** Two 32-bit Murmur2A hashes with different seeds. */
+  uint64_t topology_hash;
+  BLI_bitmap *sharp_edges;
+  BLI_bitmap *smooth_polys;
+};
+
+struct MeshLoopSplitCache {
+  /** Number of meshes using the cache. */
+  int users;
+  ThreadMutex mutex;
+
+  /**
+   * The topology the cache was built for. Copies referencing the same custom data layers have
+   * the same pointers, and referenced layers are never modified in place.
+   */
+  const MLoop *mloop;
+  const MEdge *medge;
+  const MPoly *mpoly;
+  int totloop;
+  int totedge;
+  int totpoly;
+  /** Topology and sharp edge and smooth face flags can be changed in place. */
+  LoopSplitCacheKey key;
+  bool is_valid;
+
+  int (*edge_to_loops)[2];
+  int *loop_to_poly;
+  LoopSplitCacheTask *tasks;
+  int tasks_len;
+};
+
+static void loop_split_cache_key_free(LoopSplitCacheKey *key)
+{
+  MEM_SAFE_FREE(key->sharp_edges);
+  MEM_SAFE_FREE(key->smooth_polys);
+}
+
+static void loop_split_cache_clear(MeshLoopSplitCache *cache)
+{
+  loop_split_cache_key_free(&cache->key);
+  MEM_SAFE_FREE(cache->edge_to_loops);
+  MEM_SAFE_FREE(cache->loop_to_poly);
+  MEM_SAFE_FREE(cache->tasks);
+  cache->tasks_len = 0;
+  cache->is_valid = false;
+}
+
+static void loop_split_cache_free(MeshLoopSplitCache *cache)
+{
+  loop_split_cache_clear(cache);
+  BLI_mutex_end(&cache->mutex);
+  MEM_freeN(cache);
+}
+
+static MeshLoopSplitCache *loop_split_cache_ensure(const Mesh *mesh)
+{
+  Mesh_Runtime *runtime = &const_cast<Mesh *>(mesh)->runtime;
+  if (runtime->loop_split_cache) {
+    return runtime->loop_split_cache;
+  }
+
+  MeshLoopSplitCache *cache = MEM_cnew<MeshLoopSplitCache>(__func__);
+  cache->users = 1;
+  BLI_mutex_init(&cache->mutex);
+
+  /* The mesh may be used by other threads too. */
+  MeshLoopSplitCache *cache_prev = (MeshLoopSplitCache *)atomic_cas_ptr(
+      (void **)&runtime->loop_split_cache, nullptr, cache);
+  if (cache_prev) {
+    loop_split_cache_free(cache);
+    return cache_prev;
+  }
+  return cache;
+}
+
+void BKE_mesh_loop_split_cache_share(const Mesh *mesh_src, Mesh *mesh_dst)
+{
+  BLI_assert(mesh_dst->runtime.loop_split_cache == nullptr);
+  MeshLoopSplitCache *cache = loop_split_cache_ensure(mesh_src);
+  atomic_add_and_fetch_int32(&cache->users, 1);
+  mesh_dst->runtime.loop_split_cache = cache;
+}
+
+void BKE_mesh_loop_split_cache_release(Mesh *mesh)
+{
+  MeshLoopSplitCache *cache = mesh->runtime.loop_split_cache;
+  if (cache == nullptr) {
+    return;
+  }
+  mesh->runtime.loop_split_cache = nullptr;
+  if (atomic_sub_and_fetch_int32(&cache->users, 1) == 0) {
+    loop_split_cache_free(cache);
+  }
+}
+
+static uint32_t loop_split_cache_topology_hash(const Mesh *mesh, const uint32_t seed)
+{
+  BLI_HashMurmur2A mm2;
+  BLI_hash_mm2a_init(&mm2, seed);
+  BLI_hash_mm2a_add(&mm2, (const uchar *)mesh->mloop, sizeof(MLoop) * (size_t)mesh->totloop);
+  for (int i = 0; i < mesh->totpoly; i++) {
+    BLI_hash_mm2a_add_int(&mm2, mesh->mpoly[i].loopstart);
+    BLI_hash_mm2a_add_int(&mm2, mesh->mpoly[i].totloop);
+  }
+  return BLI_hash_mm2a_end(&mm2);
+}
+
+/** Much cheaper than finding the fans, since the arrays are read sequentially. */
+static LoopSplitCacheKey loop_split_cache_key_create(const Mesh *mesh)
+{
+  LoopSplitCacheKey key;
+  key.topology_hash = (uint64_t(loop_split_cache_topology_hash(mesh, 0)) << 32) |
+                      loop_split_cache_topology_hash(mesh, 0x9747b28c);
+  key.sharp_edges = BLI_BITMAP_NEW(mesh->totedge, __func__);
+  for (int i = 0; i < mesh->totedge; i++) {
+    BLI_BITMAP_SET(key.sharp_edges, i, (mesh->medge[i].flag & ME_SHARP) != 0);
+  }
+  key.smooth_polys = BLI_BITMAP_NEW(mesh->totpoly, __func__);
+  for (int i = 0; i < mesh->totpoly; i++) {
+    BLI_BITMAP_SET(key.smooth_polys, i, (mesh->mpoly[i].flag & ME_SMOOTH) != 0);
+  }
+  return key;
+}
+
+static bool loop_split_cache_matches(const MeshLoopSplitCache *cache,
+                                     const Mesh *mesh,
+                                     const LoopSplitCacheKey &key)
+{
+  return cache->is_valid && cache->mloop == mesh->mloop && cache->medge == mesh->medge &&
+         cache->mpoly == mesh->mpoly && cache->totloop == mesh->totloop &&
+         cache->totedge == mesh->totedge && cache->totpoly == mesh->totpoly &&
+         cache->key.topology_hash == key.topology_hash &&
+         memcmp(cache->key.sharp_edges, key.sharp_edges, BLI_BITMAP_SIZE(mesh->totedge)) == 0 &&
+         memcmp(cache->key.smooth_polys, key.smooth_polys, BLI_BITMAP_SIZE(mesh->totpoly)) == 0;
+}
+
+/** Find the smooth fans like #loop_split_generator, but store them instead of processing them. */
+static void loop_split_cache_build(MeshLoopSplitCache *cache,
+                                   const Mesh *mesh,
+                                   LoopSplitCacheKey *key)
+{
+  const MLoop *mloops = mesh->mloop;
+  const MPoly *mpolys = mesh->mpoly;
+
+  loop_split_cache_clear(cache);
+  cache->edge_to_loops = (int(*)[2])MEM_calloc_arrayN(
+      (size_t)mesh->totedge, sizeof(*cache->edge_to_loops), __func__);
+  cache->loop_to_poly = (int *)MEM_malloc_arrayN(
+      (size_t)mesh->totloop, sizeof(*cache->loop_to_poly), __func__);
+
+  LoopSplitTaskDataCommon common_data = {};
+  common_data.medges = mesh->medge;
+  common_data.mloops = mloops;
+  common_data.mpolys = mpolys;
+  common_data.edge_to_loops = cache->edge_to_loops;
+  common_data.loop_to_poly = cache->loop_to_poly;
+  common_data.numEdges = mesh->totedge;
+  common_data.numLoops = mesh->totloop;
+  common_data.numPolys = mesh->totpoly;
+  mesh_edges_sharp_tag(&common_data, false, (float)M_PI, false);
+
+  const int(*edge_to_loops)[2] = cache->edge_to_loops;
+  BLI_bitmap *skip_loops = BLI_BITMAP_NEW(mesh->totloop, __func__);
+  /* There are never more fans than loops. */
+  cache->tasks = (LoopSplitCacheTask *)MEM_malloc_arrayN(
+      (size_t)mesh->totloop, sizeof(*cache->tasks), __func__);
+
+  for (int mp_index = 0; mp_index < mesh->totpoly; mp_index++) {
+    const MPoly *mp = &mpolys[mp_index];
+    const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
+    int ml_prev_index = ml_last_index;
+
+    for (int ml_curr_index = mp->loopstart; ml_curr_index <= ml_last_index; ml_curr_index++) {
+      const MLoop *ml_curr = &mloops[ml_curr_index];
+      const MLoop *ml_prev = &mloops[ml_prev_index];
+      const int *e2l_curr = edge_to_loops[ml_curr->e];
+      const int *e2l_prev = edge_to_loops[ml_prev->e];
+
+      if (IS_EDGE_SHARP(e2l_curr) ||
+          (!BLI_BITMAP_TEST(skip_loops, ml_curr_index) &&
+           loop_split_generator_check_cyclic_smooth_fan(mloops,
+                                                        mpolys,
+                                                        edge_to_loops,
+                                                        cache->loop_to_poly,
+                                                        e2l_prev,
+                                                        skip_loops,
+                                                        ml_curr,
+                                                        ml_prev,
+                                                        ml_curr_index,
+                                                        ml_prev_index,
+                                                        mp_index))) {
+        LoopSplitCacheTask *task = &cache->tasks[cache->tasks_len++];
+        task->ml_curr_index = ml_curr_index;
+        task->ml_prev_index = ml_prev_index;
+        task->mp_index = mp_index;
+        task->is_fan = !(IS_EDGE_SHARP(e2l_curr) && IS_EDGE_SHARP(e2l_prev));
+      }
+
+      ml_prev_index = ml_curr_index;
+    }
+  }
+  MEM_freeN(skip_loops);
+
+  cache->mloop = mloops;
+  cache->medge = mesh->medge;
+  cache->mpoly = mpolys;
+  cache->totloop = mesh->totloop;
+  cache->totedge = mesh->totedge;
+  cache->totpoly = mesh->totpoly;
+  /* The cache takes ownership of the key. */
+  cache->key = *key;
+  *key = {};
+  cache->is_valid = true;
+}
+
+void BKE_mesh_normals_loop_split_cached(Mesh *mesh,
+                                        const float (*vert_normals)[3],
+                                        const float (*polynors)[3],
+                                        float (*r_loopnors)[3],
+                                        const bool use_split_normals,
+                                        const float split_angle,
+                                        MLoopNorSpaceArray *r_lnors_spacearr,
+                                        short (*clnors_data)[2])
+{
+  const bool check_angle = (split_angle < (float)M_PI) && (clnors_data == nullptr);
+  if (!use_split_normals || check_angle) {
+    /* Sharp edges depend on the positions with the auto-smooth angle. */
+    BKE_mesh_normals_loop_split(mesh->mvert,
+                                vert_normals,
+                                mesh->totvert,
+                                mesh->medge,
+                                mesh->totedge,
+                                mesh->mloop,
+                                r_loopnors,
+                                mesh->totloop,
+                                mesh->mpoly,
+                                polynors,
+                                mesh->totpoly,
+                                use_split_normals,
+                                split_angle,
+                                r_lnors_spacearr,
+                                clnors_data,
+                                nullptr);
+    return;
+  }
+
+#ifdef DEBUG_TIME
+  TIMEIT_START_AVERAGED(BKE_mesh_normals_loop_split_cached);
+#endif
+
+  LoopSplitCacheKey key = loop_split_cache_key_create(mesh);
+  MeshLoopSplitCache *cache = loop_split_cache_ensure(mesh);
+  BLI_mutex_lock(&cache->mutex);
+  if (!loop_split_cache_matches(cache, mesh, key)) {
+    if (cache->is_valid && cache->users > 1) {
+      /* This mesh doesn't use the topology of the meshes it shares the cache with anymore. */
+      BLI_mutex_unlock(&cache->mutex);
+      BKE_mesh_loop_split_cache_release(mesh);
+      cache = loop_split_cache_ensure(mesh);
+      BLI_mutex_lock(&cache->mutex);
+    }
+    loop_split_cache_build(cache, mesh, &key);
+  }
+  /* A valid cache is only rebuilt when no other mesh uses it. */
+  BLI_mutex_unlock(&cache->mutex);
+  loop_split_cache_key_free(&key);
+
+  const MLoop *mloops = mesh->mloop;
+
+  /* Pre-populate all loop normals as if their verts were all-smooth,
+   * like #mesh_edges_sharp_tag does. */
+  blender::threading::parallel_for(IndexRange(mesh->totloop), 4096, [&](IndexRange range) {
+    for (const int i : range) {
+      copy_v3_v3(r_loopnors[i], vert_normals[mloops[i].v]);
+    }
+  });
+
+  MLoopNorSpaceArray _lnors_spacearr = {nullptr};
+  if (!r_lnors_spacearr && clnors_data) {
+    /* We need to compute lnor spacearr if some custom lnor data are given to us! */
+    r_lnors_spacearr = &_lnors_spacearr;
+  }
+
+  /* Spaces are created in the same order as #loop_split_generator does, since #MemArena is not
+   * thread-safe. */
+  MLoopNorSpace **lnor_spaces = nullptr;
+  if (r_lnors_spacearr) {
+    BKE_lnor_spacearr_init(r_lnors_spacearr, mesh->totloop, MLNOR_SPACEARR_LOOP_INDEX);
+    lnor_spaces = (MLoopNorSpace **)MEM_malloc_arrayN(
+        (size_t)cache->tasks_len, sizeof(*lnor_spaces), __func__);
+    for (int i = 0; i < cache->tasks_len; i++) {
+      lnor_spaces[i] = BKE_lnor_space_create(r_lnors_spacearr);
+    }
+  }
+
+  LoopSplitTaskDataCommon common_data = {};
+  common_data.lnors_spacearr = r_lnors_spacearr;
+  common_data.loopnors = r_loopnors;
+  common_data.clnors_data = clnors_data;
+  common_data.mverts = mesh->mvert;
+  common_data.medges = mesh->medge;
+  common_data.mloops = mloops;
+  common_data.mpolys = mesh->mpoly;
+  common_data.edge_to_loops = cache->edge_to_loops;
+  common_data.loop_to_poly = cache->loop_to_poly;
+  common_data.polynors = polynors;
+  common_data.vert_normals = vert_normals;
+  common_data.numEdges = mesh->totedge;
+  common_data.numLoops = mesh->totloop;
+  common_data.numPolys = mesh->totpoly;
+
+  blender::threading::parallel_for(
+      IndexRange(cache->tasks_len), LOOP_SPLIT_TASK_BLOCK_SIZE, [&](IndexRange range) {
+        /* Temp edge vectors stack, only used when computing lnor spacearr. */
+        BLI_Stack *edge_vectors = r_lnors_spacearr ? BLI_stack_new(sizeof(float[3]), __func__) :
+                                                     nullptr;
+        for (const int i : range) {
+          const LoopSplitCacheTask &task = cache->tasks[i];
+          LoopSplitTaskData data = {};
+          data.lnor_space = lnor_spaces ? lnor_spaces[i] : nullptr;
+          data.lnor = &r_loopnors[task.ml_curr_index];
+          data.ml_curr = &mloops[task.ml_curr_index];
+          data.ml_prev = &mloops[task.ml_prev_index];
+          data.ml_curr_index = task.ml_curr_index;
+          data.ml_prev_index = task.ml_prev_index;
+          data.e2l_prev = task.is_fan ? cache->edge_to_loops[data.ml_prev->e] : nullptr;
+          data.mp_index = task.mp_index;
+          loop_split_worker_do(&common_data, &data, edge_vectors);
+        }
+        if (edge_vectors) {
+          BLI_stack_free(edge_vectors);
+        }
+      });
+
+  MEM_SAFE_FREE(lnor_spaces);
+  if (r_lnors_spacearr == &_lnors_spacearr) {
+    BKE_lnor_spacearr_free(r_lnors_spacearr);
+  }
+
+#ifdef DEBUG_TIME
+  TIMEIT_END_AVERAGED(BKE_mesh_normals_loop_split_cached);
+#endif
+}
+
 #undef INDEX_UNSET
 #undef INDEX_INVALID
 #undef IS_EDGE_SHARP
@@ -0,0 +1,294 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
+#include "BLI_bitmap.h"
+#include "BLI_math.h"
+#include "BLI_math_vec_types.hh"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+
+namespace blender::bke::tests {
+
+class mesh_normals : public testing::Test {
+ protected:
+  static void SetUpTestSuite()
+  {
+    BKE_idtype_init();
+  }
+};
+
+/** A grid of quads in the XY plane, without edges since normals don't use them. */
+static Mesh *grid_mesh_create(const int size)
+{
+  Mesh *mesh = BKE_mesh_new_nomain((size + 1) * (size + 1), 0, 0, size * size * 4, size * size);
+  auto vert_index = [&](const int x, const int y) { return y * (size + 1) + x; };
+
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      MVert &vert = mesh->mvert[vert_index(x, y)];
+      vert.co[0] = (float)x;
+      vert.co[1] = (float)y;
+      vert.co[2] = 0.0f;
+    }
+  }
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const int i = y * size + x;
+      mesh->mpoly[i].loopstart = i * 4;
+      mesh->mpoly[i].totloop = 4;
+      MLoop *loops = &mesh->mloop[i * 4];
+      loops[0].v = vert_index(x, y);
+      loops[1].v = vert_index(x + 1, y);
+      loops[2].v = vert_index(x + 1, y + 1);
+      loops[3].v = vert_index(x, y + 1);
+    }
+  }
+  return mesh;
+}
+
+/** The cached normals of the mesh match normals calculated from scratch. */
+static void expect_normals_calculated(Mesh *mesh)
+{
+  ASSERT_FALSE(BKE_mesh_vertex_normals_are_dirty(mesh));
+  ASSERT_FALSE(BKE_mesh_poly_normals_are_dirty(mesh));
+
+  Array<float3> vert_normals(mesh->totvert);
+  Array<float3> poly_normals(mesh->totpoly);
+  BKE_mesh_calc_normals_poly_and_vertex(mesh->mvert,
+                                        mesh->totvert,
+                                        mesh->mloop,
+                                        mesh->totloop,
+                                        mesh->mpoly,
+                                        mesh->totpoly,
+                                        (float(*)[3])poly_normals.data(),
+                                        (float(*)[3])vert_normals.data());
+
+  const float(*mesh_vert_normals)[3] = BKE_mesh_vertex_normals_ensure(mesh);
+  const float(*mesh_poly_normals)[3] = BKE_mesh_poly_normals_ensure(mesh);
+  for (const int i : vert_normals.index_range()) {
+    EXPECT_V3_NEAR(mesh_vert_normals[i], vert_normals[i], 1e-6f);
+  }
+  for (const int i : poly_normals.index_range()) {
+    EXPECT_V3_NEAR(mesh_poly_normals[i], poly_normals[i], 1e-6f);
+  }
+}
+
+static void deform_verts(Mesh *mesh, const BLI_bitmap *verts_mask, const float fac)
+{
+  for (int i = 0; i < mesh->totvert; i++) {
+    if (BLI_BITMAP_TEST(verts_mask, i)) {
+      float *co = mesh->mvert[i].co;
+      co[2] = sinf(co[0] * fac) + cosf(co[1] * fac);
+    }
+  }
+}
+
+TEST_F(mesh_normals, PartialUpdateFromVerts)
+{
+  Mesh *mesh = grid_mesh_create(100);
+  BKE_mesh_vertex_normals_ensure(mesh);
+
+  /* A region in a corner of the grid. */
+  BLI_bitmap *verts_mask = BLI_BITMAP_NEW(mesh->totvert, __func__);
+  int verts_mask_count = 0;
+  for (int i = 0; i < mesh->totvert; i++) {
+    if (mesh->mvert[i].co[0] < 40.0f && mesh->mvert[i].co[1] < 30.0f) {
+      BLI_BITMAP_ENABLE(verts_mask, i);
+      verts_mask_count++;
+    }
+  }
+
+  MeshNormalsPartial *partial = BKE_mesh_normals_partial_create_from_verts(
+      mesh, verts_mask, verts_mask_count);
+  /* Polygons using the region's vertices, and all of their vertices. */
+  EXPECT_EQ(partial->polys_len, 40 * 30);
+  EXPECT_EQ(partial->verts_len, 41 * 31);
+
+  for (int i = 1; i <= 3; i++) {
+    deform_verts(mesh, verts_mask, 0.1f * (float)i);
+    BKE_mesh_normals_update_with_partial(mesh, partial);
+    expect_normals_calculated(mesh);
+  }
+
+  /* Dirty normals are calculated completely. */
+  deform_verts(mesh, verts_mask, 0.5f);
+  BKE_mesh_normals_tag_dirty(mesh);
+  BKE_mesh_normals_update_with_partial(mesh, partial);
+  expect_normals_calculated(mesh);
+
+  BKE_mesh_normals_partial_destroy(partial);
+  MEM_freeN(verts_mask);
+  BKE_id_free(nullptr, mesh);
+}
+
+TEST_F(mesh_normals, PartialUpdateFromPolys)
+{
+  Mesh *mesh = grid_mesh_create(50);
+  BKE_mesh_vertex_normals_ensure(mesh);
+
+  BLI_bitmap *polys_mask = BLI_BITMAP_NEW(mesh->totpoly, __func__);
+  BLI_BITMAP_ENABLE(polys_mask, 0);
+  BLI_BITMAP_ENABLE(polys_mask, 1010);
+
+  MeshNormalsPartial *partial = BKE_mesh_normals_partial_create_from_polys(mesh, polys_mask, 2);
+  /* Every polygon sharing a vertex with one of the two polygons. */
+  EXPECT_EQ(partial->polys_len, 4 + 9);
+
+  BLI_bitmap *verts_mask = BLI_BITMAP_NEW(mesh->totvert, __func__);
+  for (const int i : {0, 1010}) {
+    const MPoly &poly = mesh->mpoly[i];
+    for (int j = 0; j < poly.totloop; j++) {
+      BLI_BITMAP_ENABLE(verts_mask, mesh->mloop[poly.loopstart + j].v);
+    }
+  }
+  deform_verts(mesh, verts_mask, 1.0f);
+  BKE_mesh_normals_update_with_partial(mesh, partial);
+  expect_normals_calculated(mesh);
+
+  BKE_mesh_normals_partial_destroy(partial);
+  MEM_freeN(verts_mask);
+  MEM_freeN(polys_mask);
+  BKE_id_free(nullptr, mesh);
+}
+
+TEST_F(mesh_normals, PartialUpdateEmpty)
+{
+  Mesh *mesh = grid_mesh_create(4);
+  BKE_mesh_vertex_normals_ensure(mesh);
+
+  BLI_bitmap *verts_mask = BLI_BITMAP_NEW(mesh->totvert, __func__);
+  MeshNormalsPartial *partial = BKE_mesh_normals_partial_create_from_verts(mesh, verts_mask, 0);
+  EXPECT_EQ(partial->polys_len, 0);
+  EXPECT_EQ(partial->verts_len, 0);
+  BKE_mesh_normals_update_with_partial(mesh, partial);
+  expect_normals_calculated(mesh);
+
+  BKE_mesh_normals_partial_destroy(partial);
+  MEM_freeN(verts_mask);
+  BKE_id_free(nullptr, mesh);
+}
+
+/** The cached split normals match split normals calculated from scratch. */
+static void expect_loop_normals_calculated(Mesh *mesh, short (*clnors)[2])
+{
+  const float(*vert_normals)[3] = BKE_mesh_vertex_normals_ensure(mesh);
+  const float(*poly_normals)[3] = BKE_mesh_poly_normals_ensure(mesh);
+
+  Array<float3> loop_normals(mesh->totloop);
+  BKE_mesh_normals_loop_split(mesh->mvert,
+                              vert_normals,
+                              mesh->totvert,
+                              mesh->medge,
+                              mesh->totedge,
+                              mesh->mloop,
+                              (float(*)[3])loop_normals.data(),
+                              mesh->totloop,
+                              mesh->mpoly,
+                              poly_normals,
+                              mesh->totpoly,
+                              true,
+                              (float)M_PI,
+                              nullptr,
+                              clnors,
+                              nullptr);
+
+  Array<float3> cached_loop_normals(mesh->totloop);
+  BKE_mesh_normals_loop_split_cached(mesh,
+                                     vert_normals,
+                                     poly_normals,
+                                     (float(*)[3])cached_loop_normals.data(),
+                                     true,
+                                     (float)M_PI,
+                                     nullptr,
+                                     clnors);
+  for (const int i : loop_normals.index_range()) {
+    EXPECT_V3_NEAR(cached_loop_normals[i], loop_normals[i], 1e-6f);
+  }
+}
+
+TEST_F(mesh_normals, LoopSplitCached)
+{
+  Mesh *mesh = grid_mesh_create(50);
+  BKE_mesh_calc_edges(mesh, false, false);
+  for (int i = 0; i < mesh->totedge; i++) {
+    mesh->medge[i].flag |= (i % 7 == 0) ? ME_SHARP : 0;
+  }
+  for (int i = 0; i < mesh->totpoly; i++) {
+    mesh->mpoly[i].flag |= (i % 11 == 0) ? 0 : ME_SMOOTH;
+  }
+  short(*clnors)[2] = (short(*)[2])CustomData_add_layer(
+      &mesh->ldata, CD_CUSTOMLOOPNORMAL, CD_CALLOC, nullptr, mesh->totloop);
+  for (int i = 0; i < mesh->totloop; i++) {
+    clnors[i][0] = (short)((i * 37) % 2000 - 1000);
+    clnors[i][1] = (short)((i * 91) % 2000 - 1000);
+  }
+
+  BLI_bitmap *verts_mask = BLI_BITMAP_NEW(mesh->totvert, __func__);
+  BLI_bitmap_set_all(verts_mask, true, mesh->totvert);
+  deform_verts(mesh, verts_mask, 0.3f);
+  expect_loop_normals_calculated(mesh, clnors);
+
+  /* Only positions changed. */
+  deform_verts(mesh, verts_mask, 0.7f);
+  BKE_mesh_normals_tag_dirty(mesh);
+  expect_loop_normals_calculated(mesh, clnors);
+
+  /* Flags changed in place. */
+  mesh->medge[5].flag ^= ME_SHARP;
+  mesh->mpoly[8].flag ^= ME_SMOOTH;
+  expect_loop_normals_calculated(mesh, clnors);
+
+  /* Copies referencing the topology share the cache. */
+  Mesh *mesh_copy = BKE_mesh_copy_for_eval(mesh, true);
+  EXPECT_EQ(mesh_copy->runtime.loop_split_cache, mesh->runtime.loop_split_cache);
+  expect_loop_normals_calculated(mesh_copy, clnors);
+  BKE_id_free(nullptr, mesh_copy);
+
+  MEM_freeN(verts_mask);
+  BKE_id_free(nullptr, mesh);
+}
+
+TEST_F(mesh_normals, LoopSplitCachedDetach)
+{
+  Mesh *mesh = grid_mesh_create(20);
+  BKE_mesh_calc_edges(mesh, false, false);
+  for (int i = 0; i < mesh->totpoly; i++) {
+    mesh->mpoly[i].flag |= ME_SMOOTH;
+  }
+  expect_loop_normals_calculated(mesh, nullptr);
+
+  Mesh *mesh_copy = BKE_mesh_copy_for_eval(mesh, true);
+  EXPECT_EQ(mesh_copy->runtime.loop_split_cache, mesh->runtime.loop_split_cache);
+
+  /* The copy gets its own edges with a different sharp edge, so its topology diverges. */
+  CustomData_duplicate_referenced_layer(&mesh_copy->edata, CD_MEDGE, mesh_copy->totedge);
+  BKE_mesh_update_customdata_pointers(mesh_copy, false);
+  for (int i = 0; i < mesh_copy->totedge; i += 3) {
+    mesh_copy->medge[i].flag |= ME_SHARP;
+  }
+  expect_loop_normals_calculated(mesh_copy, nullptr);
+  EXPECT_NE(mesh_copy->runtime.loop_split_cache, mesh->runtime.loop_split_cache);
+
+  /* The source mesh keeps using the cache for its own topology. */
+  expect_loop_normals_calculated(mesh, nullptr);
+
+  /* Topology changed in place, with the same pointers and sizes. */
+  mesh_copy->medge[1].flag |= ME_SHARP;
+  expect_loop_normals_calculated(mesh_copy, nullptr);
+
+  BKE_id_free(nullptr, mesh_copy);
+  expect_loop_normals_calculated(mesh, nullptr);
+  BKE_id_free(nullptr, mesh);
+}
+
+}  // namespace blender::bke::tests
@@ -103,6 +103,7 @@ void BKE_mesh_runtime_reset_on_copy(Mesh *mesh, const int UNUSED(flag))
   memset(&runtime->looptris, 0, sizeof(runtime->looptris));
   runtime->bvh_cache = NULL;
   runtime->shrinkwrap_data = NULL;
+  runtime->loop_split_cache = NULL;
 
   runtime->vert_normals_dirty = true;
   runtime->poly_normals_dirty = true;
@@ -276,6 +277,17 @@ void BKE_mesh_runtime_clear_geometry(Mesh *mesh)
     mesh->runtime.subdiv_ccg = NULL;
   }
   BKE_shrinkwrap_discard_boundary_data(mesh);
+  BKE_mesh_loop_split_cache_release(mesh);
+}
+
+void BKE_mesh_tag_coords_changed(Mesh *mesh)
+{
+  BKE_mesh_normals_tag_dirty(mesh);
+  if (mesh->runtime.bvh_cache) {
+    bvhcache_tag_deformed(mesh->runtime.bvh_cache);
+  }
+  /* The boundary data contains normals computed from the positions. */
+  BKE_shrinkwrap_discard_boundary_data(mesh);
 }
 
 /** \} */
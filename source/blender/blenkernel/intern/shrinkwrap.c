@@ -131,7 +131,7 @@ bool BKE_shrinkwrap_init_tree(
   data->mesh = mesh;
 
   if (shrinkType == MOD_SHRINKWRAP_NEAREST_VERTEX) {
-    data->bvh = BKE_bvhtree_from_mesh_get(&data->treeData, mesh, BVHTREE_FROM_VERTS, 2);
+    data->bvh = BKE_bvhtree_from_mesh_get_shared(&data->treeData, mesh, BVHTREE_FROM_VERTS, 2);
 
     return data->bvh != NULL;
   }
@@ -140,7 +140,7 @@ bool BKE_shrinkwrap_init_tree(
     return false;
   }
 
-  data->bvh = BKE_bvhtree_from_mesh_get(&data->treeData, mesh, BVHTREE_FROM_LOOPTRI, 4);
+  data->bvh = BKE_bvhtree_from_mesh_get_shared(&data->treeData, mesh, BVHTREE_FROM_LOOPTRI, 4);
 
   if (data->bvh == NULL) {
     return false;
@@ -88,6 +88,22 @@ typedef struct BVHTreeRayHit {
   float dist;
 } BVHTreeRayHit;
 
+/**
+ * Triangles referenced by the leaf indices of a tree, for #BLI_bvhtree_ray_cast_triangles.
+ * Strides are in bytes, so mesh arrays can be used without copying them.
+ */
+typedef struct BVHTreeTriangles {
+  /** Vertex positions, e.g. #MVert.co with a stride of `sizeof(MVert)`. */
+  const float *positions;
+  size_t positions_stride;
+  /** Three corner indices for every triangle, e.g. #MLoopTri.tri. */
+  const unsigned int *tri_corners;
+  size_t tri_corners_stride;
+  /** Vertex index of every corner, e.g. #MLoop.v. Null when corners are vertex indices. */
+  const unsigned int *corner_verts;
+  size_t corner_verts_stride;
+} BVHTreeTriangles;
+
 enum {
   /* Use a priority queue to process nodes in the optimal order (for slow callbacks) */
   BVH_OVERLAP_USE_THREADING = (1 << 0),
@@ -101,6 +117,12 @@ enum {
   /* calculate IsectRayPrecalc data */
   BVH_RAYCAST_WATERTIGHT = (1 << 0),
 };
+enum {
+  /** Split at the median of the largest axis, all leafs are on the last two levels. */
+  BVH_BUILD_MEDIAN = 0,
+  /** Split with the surface area heuristic, which makes queries faster on uneven data. */
+  BVH_BUILD_SAH = 1,
+};
 #define BVH_RAYCAST_DEFAULT (BVH_RAYCAST_WATERTIGHT)
 #define BVH_RAYCAST_DIST_MAX (FLT_MAX / 2.0f)
 
@@ -169,16 +191,23 @@ void BLI_bvhtree_free(BVHTree *tree);
  * Construct: first insert points, then call balance.
  */
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints);
+/**
+ * Build the tree with #BVH_BUILD_SAH, or #BVH_BUILD_MEDIAN for 18-DOP trees, which are the only
+ * ones without X, Y and Z axes.
+ */
 void BLI_bvhtree_balance(BVHTree *tree);
+void BLI_bvhtree_balance_ex(BVHTree *tree, int build_method);
 
 /**
  * Update: first update points/nodes, then call update_tree to refit the bounding volumes.
+ * Different nodes can be updated from multiple threads at the same time.
  * \note call before #BLI_bvhtree_update_tree().
  */
 bool BLI_bvhtree_update_node(
     BVHTree *tree, int index, const float co[3], const float co_moving[3], int numpoints);
 /**
  * Call #BLI_bvhtree_update_node() first for every node/point/triangle.
+ * Large trees are refit in parallel.
  */
 void BLI_bvhtree_update_tree(BVHTree *tree);
 
@@ -293,6 +322,25 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
                               BVHTree_RayCastCallback callback,
                               void *userdata);
 
+/**
+ * Cast many rays at a tree built from triangles, like #BLI_bvhtree_ray_cast with a callback
+ * that intersects the ray with the triangle of every leaf.
+ *
+ * Rays are traversed in small packets, so rays that are close and have similar directions
+ * should be next to each other in the arrays. Directions must be normalized.
+ *
+ * \param hits: Used like the hit of #BLI_bvhtree_ray_cast, so the distance must be initialized
+ * to the length of each ray.
+ * \return The number of rays with a hit.
+ */
+int BLI_bvhtree_ray_cast_triangles(const BVHTree *tree,
+                                   const BVHTreeTriangles *triangles,
+                                   const float (*origins)[3],
+                                   const float (*directions)[3],
+                                   BVHTreeRayHit *hits,
+                                   int rays_num,
+                                   int flag);
+
 float BLI_bvhtree_bb_raycast(const float bv[6],
                              const float light_start[3],
                              const float light_end[3],
@@ -67,6 +67,31 @@ void BLI_kdtree_nd_(range_search_cb)(
     bool (*search_cb)(void *user_data, int index, const float co[KD_DIMS], float dist_sq),
     void *user_data);
 
+/**
+ * Find the nearest point for many points at once, in parallel.
+ * Large batches are sorted spatially first, so consecutive queries visit mostly the same nodes.
+ *
+ * \param r_nearest: An array of \a co_len results. The index is -1 when the tree is empty.
+ */
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        uint co_len,
+                                        KDTreeNearest *r_nearest) ATTR_NONNULL(1, 4);
+/**
+ * A batched version of #BLI_kdtree_3d_range_search_cb, like #BLI_kdtree_3d_find_nearest_batch.
+ *
+ * \param search_cb: Called from multiple threads, though all calls for the same query point
+ * (at \a co_index) are made on one thread. A false return value ends the search for that point.
+ */
+void BLI_kdtree_nd_(range_search_batch_cb)(
+    const KDTree *tree,
+    const float (*co)[KD_DIMS],
+    uint co_len,
+    float range,
+    bool (*search_cb)(
+        void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq),
+    void *user_data) ATTR_NONNULL(1);
+
 int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
                                          float range,
                                          bool use_index_order,
@@ -41,6 +41,12 @@ extern
     long int
     PIL_check_seconds_timer_i(void);
 
+/**
+ * Return the CPU time in seconds that has been used by the calling thread. Unlike
+ * #PIL_check_seconds_timer, this does not include time the thread was waiting.
+ */
+double PIL_check_thread_seconds_timer(void);
+
 /**
  * Platform-independent sleep function.
  * \param ms: Number of milliseconds to sleep
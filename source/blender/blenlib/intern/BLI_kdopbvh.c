@@ -30,6 +30,8 @@
  *
  * - Ray-cast:
  *   #BLI_bvhtree_ray_cast, #BVHRayCastData
+ * - Batched ray-cast on triangles:
+ *   #BLI_bvhtree_ray_cast_triangles, #BVHRayPacket
  * - Nearest point on surface:
  *   #BLI_bvhtree_find_nearest, #BVHNearestData
  * - Overlapping 2 trees:
@@ -44,6 +46,7 @@
 #include "BLI_heap_simple.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_math.h"
+#include "BLI_simd.h"
 #include "BLI_stack.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
@@ -155,6 +158,29 @@ typedef struct BVHRayCastData {
   BVHTreeRayHit hit;
 } BVHRayCastData;
 
+/** Number of rays traversed together by #BLI_bvhtree_ray_cast_triangles. */
+#define BVH_RAY_PACKET_SIZE 4
+
+typedef struct BVHRayPacket {
+  const BVHTree *tree;
+  const BVHTreeTriangles *triangles;
+  bool use_watertight;
+
+  /* Structure of arrays layout, so one box test handles all rays of the packet. */
+  float origin[3][BVH_RAY_PACKET_SIZE];
+  float idot_axis[3][BVH_RAY_PACKET_SIZE];
+  /* Distance of the current hit, negative for lanes without a ray. */
+  float dist[BVH_RAY_PACKET_SIZE];
+  /* Sum of the ray directions projected on the tree axes, used to choose the child order. */
+  float dir_dot_axis[13];
+
+  BVHTreeRay rays[BVH_RAY_PACKET_SIZE];
+  BVHTreeRayHit *hits[BVH_RAY_PACKET_SIZE];
+#ifdef USE_KDOPBVH_WATERTIGHT
+  struct IsectRayPrecalc isect_precalc[BVH_RAY_PACKET_SIZE];
+#endif
+} BVHRayPacket;
+
 typedef struct BVHNearestProjectedData {
   const BVHTree *tree;
   struct DistProjectedAABBPrecalc precalc;
@@ -863,6 +889,635 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Binned SAH Build
+ *
+ * Alternative to the implicit tree build that splits branches with the surface area heuristic,
+ * evaluated on bins of the leaf centroids. The resulting trees are faster to traverse when the
+ * leafs are distributed unevenly, which is common for meshes.
+ *
+ * The tree is built level by level like the implicit tree. That way the root is the first branch,
+ * children always have a larger index than their parent, and the numbering does not depend on
+ * scheduling. Branches with many leafs near the root are binned and partitioned with multiple
+ * threads, lower levels are processed with a task per branch.
+ * \{ */
+
+#define BVH_SAH_BINS 16
+
+/* Branches with more leafs are split with multiple threads. */
+#define BVH_SAH_THREAD_LEAF_THRESHOLD (KDOPBVH_THREAD_LEAF_THRESHOLD * 64)
+
+/* Use median splits below this depth, to limit the depth of degenerate trees. Median splits halve
+ * the number of leafs at least, so the total number of levels stays below #BVH_SAH_MAX_LEVELS.
+ * Should the levels reach that limit anyway, the tree is built with median splits only. */
+#define BVH_SAH_MAX_DEPTH 64
+#define BVH_SAH_MAX_LEVELS (BVH_SAH_MAX_DEPTH + 33)
+
+typedef struct BVHSAHBounds {
+  float bounds[6];
+} BVHSAHBounds;
+
+typedef struct BVHSAHBin {
+  BVHSAHBounds bounds;
+  int count;
+} BVHSAHBin;
+
+typedef struct BVHSAHBins {
+  BVHSAHBin bins[3][BVH_SAH_BINS];
+} BVHSAHBins;
+
+typedef struct BVHSAHSplitData {
+  BVHNode **leafs;
+  int begin;
+  int end;
+
+  /** Bounds of the leaf centroids, used to map the centroids to bins. */
+  BVHSAHBounds centroid_bounds;
+  float bin_scale[3];
+
+  /** Leafs with a bin index up to `split_bin` on `split_axis` go to the first part. */
+  int split_axis;
+  int split_bin;
+
+  /** Partitioning of large ranges in chunks, through a temporary array. */
+  int chunk_size;
+  int *chunk_offsets;
+  int first_part_len;
+  BVHNode **leafs_tmp;
+} BVHSAHSplitData;
+
+static void sah_bounds_init(BVHSAHBounds *bounds)
+{
+  for (int axis = 0; axis < 3; axis++) {
+    bounds->bounds[2 * axis] = FLT_MAX;
+    bounds->bounds[2 * axis + 1] = -FLT_MAX;
+  }
+}
+
+static void sah_bounds_join(BVHSAHBounds *bounds, const float other[6])
+{
+  for (int axis = 0; axis < 3; axis++) {
+    bounds->bounds[2 * axis] = min_ff(bounds->bounds[2 * axis], other[2 * axis]);
+    bounds->bounds[2 * axis + 1] = max_ff(bounds->bounds[2 * axis + 1], other[2 * axis + 1]);
+  }
+}
+
+/** Half of the surface area, the factor doesn't matter when comparing costs. */
+static float sah_bounds_area(const BVHSAHBounds *bounds)
+{
+  const float *b = bounds->bounds;
+  if (b[0] > b[1]) {
+    return 0.0f;
+  }
+  const float dx = b[1] - b[0];
+  const float dy = b[3] - b[2];
+  const float dz = b[5] - b[4];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+/** Twice the centroid, only used for comparisons. */
+BLI_INLINE float sah_leaf_centroid(const BVHNode *leaf, const int axis)
+{
+  return leaf->bv[2 * axis] + leaf->bv[2 * axis + 1];
+}
+
+BLI_INLINE int sah_leaf_bin(const BVHSAHSplitData *data, const BVHNode *leaf, const int axis)
+{
+  const float offset = sah_leaf_centroid(leaf, axis) - data->centroid_bounds.bounds[2 * axis];
+  const int bin = (int)(offset * data->bin_scale[axis]);
+  return min_ii(bin, BVH_SAH_BINS - 1);
+}
+
+static void sah_centroid_bounds_cb(void *__restrict userdata,
+                                   const int i,
+                                   const TaskParallelTLS *__restrict tls)
+{
+  const BVHSAHSplitData *data = userdata;
+  BVHSAHBounds *bounds = tls->userdata_chunk;
+  for (int axis = 0; axis < 3; axis++) {
+    const float centroid = sah_leaf_centroid(data->leafs[i], axis);
+    bounds->bounds[2 * axis] = min_ff(bounds->bounds[2 * axis], centroid);
+    bounds->bounds[2 * axis + 1] = max_ff(bounds->bounds[2 * axis + 1], centroid);
+  }
+}
+
+static void sah_bounds_reduce(const void *__restrict UNUSED(userdata),
+                              void *__restrict chunk_join,
+                              void *__restrict chunk)
+{
+  sah_bounds_join(chunk_join, ((const BVHSAHBounds *)chunk)->bounds);
+}
+
+static void sah_bin_cb(void *__restrict userdata,
+                       const int i,
+                       const TaskParallelTLS *__restrict tls)
+{
+  const BVHSAHSplitData *data = userdata;
+  BVHSAHBins *bins = tls->userdata_chunk;
+  const BVHNode *leaf = data->leafs[i];
+  for (int axis = 0; axis < 3; axis++) {
+    if (data->bin_scale[axis] > 0.0f) {
+      BVHSAHBin *bin = &bins->bins[axis][sah_leaf_bin(data, leaf, axis)];
+      sah_bounds_join(&bin->bounds, leaf->bv);
+      bin->count++;
+    }
+  }
+}
+
+static void sah_bins_reduce(const void *__restrict UNUSED(userdata),
+                            void *__restrict chunk_join,
+                            void *__restrict chunk)
+{
+  BVHSAHBins *bins_join = chunk_join;
+  const BVHSAHBins *bins = chunk;
+  for (int axis = 0; axis < 3; axis++) {
+    for (int i = 0; i < BVH_SAH_BINS; i++) {
+      sah_bounds_join(&bins_join->bins[axis][i].bounds, bins->bins[axis][i].bounds.bounds);
+      bins_join->bins[axis][i].count += bins->bins[axis][i].count;
+    }
+  }
+}
+
+BLI_INLINE bool sah_leaf_in_first_part(const BVHSAHSplitData *data, const BVHNode *leaf)
+{
+  return sah_leaf_bin(data, leaf, data->split_axis) <= data->split_bin;
+}
+
+static void sah_partition_count_cb(void *__restrict userdata,
+                                   const int chunk,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSAHSplitData *data = userdata;
+  const int begin = data->begin + chunk * data->chunk_size;
+  const int end = min_ii(begin + data->chunk_size, data->end);
+  int count = 0;
+  for (int i = begin; i < end; i++) {
+    count += sah_leaf_in_first_part(data, data->leafs[i]);
+  }
+  data->chunk_offsets[chunk] = count;
+}
+
+static void sah_partition_scatter_cb(void *__restrict userdata,
+                                     const int chunk,
+                                     const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSAHSplitData *data = userdata;
+  const int begin = data->begin + chunk * data->chunk_size;
+  const int end = min_ii(begin + data->chunk_size, data->end);
+  /* Leafs of the chunk in the second part come after the leafs of previous chunks in it. */
+  int first = data->chunk_offsets[chunk];
+  int second = data->first_part_len + (begin - data->begin) - first;
+  for (int i = begin; i < end; i++) {
+    BVHNode *leaf = data->leafs[i];
+    if (sah_leaf_in_first_part(data, leaf)) {
+      data->leafs_tmp[first++] = leaf;
+    }
+    else {
+      data->leafs_tmp[second++] = leaf;
+    }
+  }
+}
+
+static void sah_partition_copy_cb(void *__restrict userdata,
+                                  const int chunk,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSAHSplitData *data = userdata;
+  const int begin = chunk * data->chunk_size;
+  const int end = min_ii(begin + data->chunk_size, data->end - data->begin);
+  memcpy(&data->leafs[data->begin + begin],
+         &data->leafs_tmp[begin],
+         sizeof(*data->leafs) * (size_t)(end - begin));
+}
+
+/**
+ * Reorder the leafs in the range so that the leafs in the first part come first,
+ * keeping the order within the parts.
+ */
+static void sah_partition_parallel(BVHSAHSplitData *data, const TaskParallelSettings *settings)
+{
+  const int leafs_len = data->end - data->begin;
+  data->chunk_size = max_ii(4096, leafs_len / 256);
+  const int chunks_len = (leafs_len + data->chunk_size - 1) / data->chunk_size;
+  data->chunk_offsets = MEM_mallocN(sizeof(int) * (size_t)chunks_len, __func__);
+  data->leafs_tmp = MEM_mallocN(sizeof(*data->leafs) * (size_t)leafs_len, __func__);
+
+  TaskParallelSettings chunk_settings = *settings;
+  chunk_settings.min_iter_per_thread = 1;
+
+  BLI_task_parallel_range(0, chunks_len, data, sah_partition_count_cb, &chunk_settings);
+  int offset = 0;
+  for (int chunk = 0; chunk < chunks_len; chunk++) {
+    const int count = data->chunk_offsets[chunk];
+    data->chunk_offsets[chunk] = offset;
+    offset += count;
+  }
+  data->first_part_len = offset;
+  BLI_task_parallel_range(0, chunks_len, data, sah_partition_scatter_cb, &chunk_settings);
+  BLI_task_parallel_range(0, chunks_len, data, sah_partition_copy_cb, &chunk_settings);
+
+  MEM_freeN(data->chunk_offsets);
+  MEM_freeN(data->leafs_tmp);
+}
+
+static void sah_partition(BVHSAHSplitData *data)
+{
+  BVHNode **leafs = data->leafs;
+  int i = data->begin;
+  int j = data->end - 1;
+  while (i <= j) {
+    if (sah_leaf_in_first_part(data, leafs[i])) {
+      i++;
+    }
+    else {
+      SWAP(BVHNode *, leafs[i], leafs[j]);
+      j--;
+    }
+  }
+  data->first_part_len = i - data->begin;
+}
+
+static int sah_largest_axis(const BVHSAHBounds *bounds)
+{
+  const float *b = bounds->bounds;
+  int axis = 0;
+  for (int i = 1; i < 3; i++) {
+    if (b[2 * i + 1] - b[2 * i] > b[2 * axis + 1] - b[2 * axis]) {
+      axis = i;
+    }
+  }
+  return axis;
+}
+
+static void sah_centroid_bounds(BVHNode **leafs,
+                                const int begin,
+                                const int end,
+                                BVHSAHBounds *r_bounds)
+{
+  sah_bounds_init(r_bounds);
+  for (int i = begin; i < end; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      const float centroid = sah_leaf_centroid(leafs[i], axis);
+      r_bounds->bounds[2 * axis] = min_ff(r_bounds->bounds[2 * axis], centroid);
+      r_bounds->bounds[2 * axis + 1] = max_ff(r_bounds->bounds[2 * axis + 1], centroid);
+    }
+  }
+}
+
+/**
+ * Split the leafs in the range in two parts with the lowest surface area cost, or at the median
+ * of the largest axis when `use_median` is true.
+ * \return The index of the first leaf in the second part.
+ */
+static int sah_split(BVHNode **leafs,
+                     const int begin,
+                     const int end,
+                     const bool use_median,
+                     int *r_axis)
+{
+  BVHSAHSplitData data = {
+      .leafs = leafs,
+      .begin = begin,
+      .end = end,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (end - begin > BVH_SAH_THREAD_LEAF_THRESHOLD);
+  settings.min_iter_per_thread = 1024;
+
+  sah_bounds_init(&data.centroid_bounds);
+  settings.userdata_chunk = &data.centroid_bounds;
+  settings.userdata_chunk_size = sizeof(data.centroid_bounds);
+  settings.func_reduce = sah_bounds_reduce;
+  BLI_task_parallel_range(begin, end, &data, sah_centroid_bounds_cb, &settings);
+
+  if (use_median) {
+    const int mid = (begin + end) / 2;
+    *r_axis = sah_largest_axis(&data.centroid_bounds);
+    partition_nth_element(leafs, begin, end, mid, 2 * *r_axis + 1);
+    return mid;
+  }
+
+  bool has_extent = false;
+  for (int axis = 0; axis < 3; axis++) {
+    const float extent = data.centroid_bounds.bounds[2 * axis + 1] -
+                         data.centroid_bounds.bounds[2 * axis];
+    data.bin_scale[axis] = (extent > 0.0f) ? (float)BVH_SAH_BINS / extent : 0.0f;
+    has_extent |= (extent > 0.0f);
+  }
+  if (!has_extent) {
+    /* All centroids are the same, any split is as good as another. */
+    *r_axis = 0;
+    return (begin + end) / 2;
+  }
+
+  BVHSAHBins bins;
+  for (int axis = 0; axis < 3; axis++) {
+    for (int i = 0; i < BVH_SAH_BINS; i++) {
+      sah_bounds_init(&bins.bins[axis][i].bounds);
+      bins.bins[axis][i].count = 0;
+    }
+  }
+  settings.userdata_chunk = &bins;
+  settings.userdata_chunk_size = sizeof(bins);
+  settings.func_reduce = sah_bins_reduce;
+  BLI_task_parallel_range(begin, end, &data, sah_bin_cb, &settings);
+
+  float best_cost = FLT_MAX;
+  data.split_axis = -1;
+  for (int axis = 0; axis < 3; axis++) {
+    if (data.bin_scale[axis] == 0.0f) {
+      continue;
+    }
+    const BVHSAHBin *axis_bins = bins.bins[axis];
+    float second_areas[BVH_SAH_BINS - 1];
+    int second_counts[BVH_SAH_BINS - 1];
+    BVHSAHBounds bounds;
+    sah_bounds_init(&bounds);
+    int count = 0;
+    for (int i = BVH_SAH_BINS - 1; i > 0; i--) {
+      sah_bounds_join(&bounds, axis_bins[i].bounds.bounds);
+      count += axis_bins[i].count;
+      second_areas[i - 1] = sah_bounds_area(&bounds);
+      second_counts[i - 1] = count;
+    }
+    sah_bounds_init(&bounds);
+    count = 0;
+    for (int i = 0; i < BVH_SAH_BINS - 1; i++) {
+      sah_bounds_join(&bounds, axis_bins[i].bounds.bounds);
+      count += axis_bins[i].count;
+      if (count == 0 || second_counts[i] == 0) {
+        continue;
+      }
+      const float cost = sah_bounds_area(&bounds) * (float)count +
+                         second_areas[i] * (float)second_counts[i];
+      if (cost < best_cost) {
+        best_cost = cost;
+        data.split_axis = axis;
+        data.split_bin = i;
+      }
+    }
+  }
+  /* The smallest and largest centroid are always in the first and last bin of an axis. */
+  BLI_assert(data.split_axis != -1);
+
+  if (settings.use_threading) {
+    settings.userdata_chunk = NULL;
+    settings.userdata_chunk_size = 0;
+    settings.func_reduce = NULL;
+    sah_partition_parallel(&data, &settings);
+  }
+  else {
+    sah_partition(&data);
+  }
+
+  *r_axis = data.split_axis;
+  return begin + data.first_part_len;
+}
+
+typedef struct BVHSAHBranch {
+  int leafs_begin;
+  int leafs_end;
+  /** Number of children with more than one leaf, which become branches on the next level. */
+  int child_branches_len;
+  int first_child_branch;
+  char totnode;
+  char main_axis;
+} BVHSAHBranch;
+
+typedef struct BVHSAHBuildData {
+  BVHTree *tree;
+  BVHNode **leafs;
+  BVHSAHBranch *branches;
+  /** Leaf ranges of the children, `tree_type + 1` values per branch. */
+  int *branches_nth;
+  int depth;
+} BVHSAHBuildData;
+
+static void sah_split_branch_cb(void *__restrict userdata,
+                                const int j,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSAHBuildData *data = userdata;
+  const int tree_type = data->tree->tree_type;
+  BVHSAHBranch *branch = &data->branches[j];
+  int *nth = &data->branches_nth[j * (tree_type + 1)];
+  const int begin = branch->leafs_begin;
+  const int end = branch->leafs_end;
+  int totnode;
+
+  if (end - begin <= tree_type) {
+    /* All leafs are children, sorted like in the implicit tree. */
+    BVHSAHBounds centroid_bounds;
+    sah_centroid_bounds(data->leafs, begin, end, &centroid_bounds);
+    const int axis = sah_largest_axis(&centroid_bounds);
+    bvh_insertionsort(data->leafs, begin, end, 2 * axis + 1);
+    totnode = end - begin;
+    for (int k = 0; k <= totnode; k++) {
+      nth[k] = begin + k;
+    }
+    branch->main_axis = (char)axis;
+  }
+  else {
+    /* Split the child with the most leafs until there are enough children. */
+    nth[0] = begin;
+    nth[1] = end;
+    totnode = 1;
+    while (totnode < tree_type) {
+      int largest = 0;
+      for (int k = 1; k < totnode; k++) {
+        if (nth[k + 1] - nth[k] > nth[largest + 1] - nth[largest]) {
+          largest = k;
+        }
+      }
+      int axis;
+      const int mid = sah_split(data->leafs,
+                                nth[largest],
+                                nth[largest + 1],
+                                data->depth >= BVH_SAH_MAX_DEPTH,
+                                &axis);
+      if (totnode == 1) {
+        /* Save split axis (this can be used on ray-tracing to speedup the query time). */
+        branch->main_axis = (char)axis;
+      }
+      memmove(&nth[largest + 2], &nth[largest + 1], sizeof(int) * (size_t)(totnode - largest));
+      nth[largest + 1] = mid;
+      totnode++;
+    }
+  }
+
+  branch->totnode = (char)totnode;
+  branch->child_branches_len = 0;
+  for (int k = 0; k < totnode; k++) {
+    BLI_assert(nth[k + 1] > nth[k]);
+    if (nth[k + 1] - nth[k] > 1) {
+      branch->child_branches_len++;
+    }
+  }
+}
+
+static void sah_add_child_branches_cb(void *__restrict userdata,
+                                      const int j,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSAHBuildData *data = userdata;
+  const BVHSAHBranch *branch = &data->branches[j];
+  const int *nth = &data->branches_nth[j * (data->tree->tree_type + 1)];
+  int child_branch = branch->first_child_branch;
+  for (int k = 0; k < branch->totnode; k++) {
+    if (nth[k + 1] - nth[k] > 1) {
+      data->branches[child_branch].leafs_begin = nth[k];
+      data->branches[child_branch].leafs_end = nth[k + 1];
+      child_branch++;
+    }
+  }
+}
+
+static void sah_link_branch_cb(void *__restrict userdata,
+                               const int j,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSAHBuildData *data = userdata;
+  BVHTree *tree = data->tree;
+  const BVHSAHBranch *branch = &data->branches[j];
+  const int *nth = &data->branches_nth[j * (tree->tree_type + 1)];
+  BVHNode *node = &tree->nodearray[tree->totleaf + j];
+  tree->nodes[tree->totleaf + j] = node;
+
+  int child_branch = branch->first_child_branch;
+  for (int k = 0; k < tree->tree_type; k++) {
+    if (k >= branch->totnode) {
+      node->children[k] = NULL;
+      continue;
+    }
+    BVHNode *child = (nth[k + 1] - nth[k] > 1) ? &tree->nodearray[tree->totleaf + child_branch++] :
+                                                 data->leafs[nth[k]];
+    child->parent = node;
+    node->children[k] = child;
+  }
+  node->totnode = branch->totnode;
+  node->main_axis = branch->main_axis;
+}
+
+static void sah_join_branch_cb(void *__restrict userdata,
+                               const int j,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSAHBuildData *data = userdata;
+  node_join(data->tree, &data->tree->nodearray[data->tree->totleaf + j]);
+}
+
+/**
+ * Make sure there is room for the branches, the SAH build can need more branches than the
+ * implicit tree that the arrays are allocated for.
+ */
+static void bvhtree_ensure_branches_len(BVHTree *tree, const int branches_len)
+{
+  const size_t nodes_allocated = MEM_allocN_len(tree->nodearray) / sizeof(BVHNode);
+  const size_t nodes_len = (size_t)(tree->totleaf + branches_len);
+  if (nodes_len <= nodes_allocated) {
+    return;
+  }
+
+  BVHNode *nodearray = MEM_callocN(sizeof(BVHNode) * nodes_len, "BVHNodeArray");
+  memcpy(nodearray, tree->nodearray, sizeof(BVHNode) * (size_t)tree->totleaf);
+  for (int i = 0; i < tree->totleaf; i++) {
+    tree->nodes[i] = &nodearray[tree->nodes[i] - tree->nodearray];
+  }
+  MEM_freeN(tree->nodearray);
+  tree->nodearray = nodearray;
+
+  tree->nodes = MEM_recallocN(tree->nodes, sizeof(BVHNode *) * nodes_len);
+  tree->nodebv = MEM_recallocN(tree->nodebv, sizeof(float) * tree->axis * nodes_len);
+  tree->nodechild = MEM_recallocN(tree->nodechild,
+                                  sizeof(BVHNode *) * (size_t)tree->tree_type * nodes_len);
+  for (size_t i = 0; i < nodes_len; i++) {
+    tree->nodearray[i].bv = &tree->nodebv[i * tree->axis];
+    tree->nodearray[i].children = &tree->nodechild[i * (size_t)tree->tree_type];
+  }
+}
+
+/**
+ * \return False when the tree has too many levels, then the leafs are in a different order but
+ * the tree is not built.
+ */
+static bool sah_bvh_build(BVHTree *tree)
+{
+  const int tree_type = tree->tree_type;
+  int branches_allocated = implicit_needed_branches(tree_type, tree->totleaf);
+
+  BVHSAHBuildData data = {
+      .tree = tree,
+      .leafs = tree->nodes,
+      .branches = MEM_mallocN(sizeof(BVHSAHBranch) * (size_t)branches_allocated, __func__),
+      .branches_nth = MEM_mallocN(sizeof(int) * (size_t)((tree_type + 1) * branches_allocated),
+                                  __func__),
+  };
+  data.branches[0].leafs_begin = 0;
+  data.branches[0].leafs_end = tree->totleaf;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (tree->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD);
+
+  int level_starts[BVH_SAH_MAX_LEVELS + 1];
+  int levels_len = 0;
+  int level_begin = 0;
+  int level_end = 1;
+  while (level_begin < level_end) {
+    if (levels_len == BVH_SAH_MAX_LEVELS) {
+      BLI_assert_unreachable();
+      MEM_freeN(data.branches);
+      MEM_freeN(data.branches_nth);
+      return false;
+    }
+    level_starts[levels_len] = level_begin;
+    data.depth = levels_len;
+    levels_len++;
+
+    BLI_task_parallel_range(level_begin, level_end, &data, sah_split_branch_cb, &settings);
+
+    /* Number the branches of the next level. */
+    int next_level_end = level_end;
+    for (int j = level_begin; j < level_end; j++) {
+      data.branches[j].first_child_branch = next_level_end;
+      next_level_end += data.branches[j].child_branches_len;
+    }
+    if (next_level_end > branches_allocated) {
+      branches_allocated = max_ii(next_level_end, branches_allocated * 2);
+      data.branches = MEM_reallocN(data.branches,
+                                   sizeof(BVHSAHBranch) * (size_t)branches_allocated);
+      data.branches_nth = MEM_reallocN(
+          data.branches_nth, sizeof(int) * (size_t)((tree_type + 1) * branches_allocated));
+    }
+    BLI_task_parallel_range(level_begin, level_end, &data, sah_add_child_branches_cb, &settings);
+
+    level_begin = level_end;
+    level_end = next_level_end;
+  }
+  level_starts[levels_len] = level_end;
+
+  bvhtree_ensure_branches_len(tree, level_end);
+  data.leafs = tree->nodes;
+  tree->totbranch = level_end;
+
+  BLI_task_parallel_range(0, level_end, &data, sah_link_branch_cb, &settings);
+  tree->nodearray[tree->totleaf].parent = NULL;
+
+  /* Compute the bounds bottom-up, one level at a time. */
+  for (int level = levels_len - 1; level >= 0; level--) {
+    BLI_task_parallel_range(
+        level_starts[level], level_starts[level + 1], &data, sah_join_branch_cb, &settings);
+  }
+
+  MEM_freeN(data.branches);
+  MEM_freeN(data.branches_nth);
+  return true;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
@@ -951,6 +1606,11 @@ void BLI_bvhtree_free(BVHTree *tree)
 }
 
 void BLI_bvhtree_balance(BVHTree *tree)
+{
+  BLI_bvhtree_balance_ex(tree, BVH_BUILD_SAH);
+}
+
+void BLI_bvhtree_balance_ex(BVHTree *tree, const int build_method)
 {
   BVHNode **leafs_array = tree->nodes;
 
@@ -958,15 +1618,23 @@ void BLI_bvhtree_balance(BVHTree *tree)
    * (some big bug goes here if its being called more than once per tree) */
   BLI_assert(tree->totbranch == 0);
 
-  /* Build the implicit tree */
-  non_recursive_bvh_div_nodes(
-      tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+  /* The SAH build bins the first three axes, which are X, Y and Z for all k-DOPs except the
+   * 18-DOP. The other axes of 8, 14 and 26-DOPs are only part of the node bounds. */
+  bool is_built = false;
+  if (build_method == BVH_BUILD_SAH && tree->start_axis == 0 && tree->totleaf > 1) {
+    is_built = sah_bvh_build(tree);
+  }
+  if (!is_built) {
+    /* Build the implicit tree */
+    non_recursive_bvh_div_nodes(
+        tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
 
-  /* current code expects the branches to be linked to the nodes array
-   * we perform that linkage here */
-  tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
-  for (int i = 0; i < tree->totbranch; i++) {
-    tree->nodes[tree->totleaf + i] = &tree->nodearray[tree->totleaf + i];
+    /* current code expects the branches to be linked to the nodes array
+     * we perform that linkage here */
+    tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
+    for (int i = 0; i < tree->totbranch; i++) {
+      tree->nodes[tree->totleaf + i] = &tree->nodearray[tree->totleaf + i];
+    }
   }
 
 #ifdef USE_SKIP_LINKS
@@ -1034,18 +1702,79 @@ bool BLI_bvhtree_update_node(
   return true;
 }
 
-void BLI_bvhtree_update_tree(BVHTree *tree)
+/** Minimum number of sub-trees to refit in parallel in #BLI_bvhtree_update_tree. */
+#define BVH_UPDATE_SUBTREES_MIN 64
+
+typedef struct BVHUpdateData {
+  BVHTree *tree;
+  BVHNode **subtrees;
+} BVHUpdateData;
+
+static void bvhtree_update_subtree(BVHTree *tree, BVHNode *node)
+{
+  for (int i = 0; i < node->totnode; i++) {
+    if (node->children[i]->totnode != 0) {
+      bvhtree_update_subtree(tree, node->children[i]);
+    }
+  }
+  node_join(tree, node);
+}
+
+static void bvhtree_update_subtree_cb(void *__restrict userdata,
+                                      const int i,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  /* Update bottom=>top
-   * TRICKY: the way we build the tree all the children have an index greater than the parent
-   * This allows us todo a bottom up update by starting on the bigger numbered branch. */
+  BVHUpdateData *data = (BVHUpdateData *)userdata;
+  bvhtree_update_subtree(data->tree, data->subtrees[i]);
+}
 
+void BLI_bvhtree_update_tree(BVHTree *tree)
+{
   BVHNode **root = tree->nodes + tree->totleaf;
-  BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
 
-  for (; index >= root; index--) {
-    node_join(tree, *index);
+  if (tree->totleaf <= KDOPBVH_THREAD_LEAF_THRESHOLD || *root == NULL) {
+    /* Update bottom=>top
+     * TRICKY: the way we build the tree all the children have an index greater than the parent
+     * This allows us todo a bottom up update by starting on the bigger numbered branch. */
+    BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
+
+    for (; index >= root; index--) {
+      node_join(tree, *index);
+    }
+    return;
+  }
+
+  /* Collect the upper levels of the tree breadth first, until a level has enough branches to
+   * refit their sub-trees in parallel. The upper levels are joined afterwards, in reverse. */
+  BVHNode **branches = MEM_mallocN(sizeof(*branches) * (size_t)tree->totbranch, __func__);
+  int level_start = 0;
+  int level_end = 1;
+  branches[0] = *root;
+  while (level_end - level_start < BVH_UPDATE_SUBTREES_MIN) {
+    int branches_len = level_end;
+    for (int i = level_start; i < level_end; i++) {
+      for (int j = 0; j < branches[i]->totnode; j++) {
+        if (branches[i]->children[j]->totnode != 0) {
+          branches[branches_len++] = branches[i]->children[j];
+        }
+      }
+    }
+    if (branches_len == level_end) {
+      break;
+    }
+    level_start = level_end;
+    level_end = branches_len;
+  }
+
+  BVHUpdateData data = {tree, branches + level_start};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, level_end - level_start, &data, bvhtree_update_subtree_cb, &settings);
+
+  for (int i = level_start - 1; i >= 0; i--) {
+    node_join(tree, branches[i]);
   }
+  MEM_freeN(branches);
 }
 int BLI_bvhtree_get_len(const BVHTree *tree)
 {
@@ -2042,6 +2771,223 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_ray_cast_triangles
+ *
+ * Rays are grouped in packets which traverse the tree together. Every node bounds test is done
+ * for the whole packet at once, and leaves are intersected with triangles directly instead of
+ * calling a callback for every ray.
+ *
+ * \{ */
+
+/**
+ * Bit mask of the packet lanes whose ray hits the axis aligned bounds of the node
+ * closer than the current hit.
+ */
+static int ray_packet_nearest_hit_mask(const BVHRayPacket *packet, const float bv[6])
+{
+#ifdef BLI_HAVE_SSE2
+  __m128 t_near = _mm_setzero_ps();
+  __m128 t_far = _mm_loadu_ps(packet->dist);
+  for (int axis = 0; axis < 3; axis++) {
+    const __m128 origin = _mm_loadu_ps(packet->origin[axis]);
+    const __m128 idot = _mm_loadu_ps(packet->idot_axis[axis]);
+    const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[2 * axis]), origin), idot);
+    const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[2 * axis + 1]), origin), idot);
+    t_near = _mm_max_ps(t_near, _mm_min_ps(t1, t2));
+    t_far = _mm_min_ps(t_far, _mm_max_ps(t1, t2));
+  }
+  return _mm_movemask_ps(_mm_cmple_ps(t_near, t_far));
+#else
+  int mask = 0;
+  for (int lane = 0; lane < BVH_RAY_PACKET_SIZE; lane++) {
+    float t_near = 0.0f;
+    float t_far = packet->dist[lane];
+    for (int axis = 0; axis < 3; axis++) {
+      const float t1 = (bv[2 * axis] - packet->origin[axis][lane]) * packet->idot_axis[axis][lane];
+      const float t2 = (bv[2 * axis + 1] - packet->origin[axis][lane]) *
+                       packet->idot_axis[axis][lane];
+      t_near = max_ff(t_near, min_ff(t1, t2));
+      t_far = min_ff(t_far, max_ff(t1, t2));
+    }
+    if (t_near <= t_far) {
+      mask |= 1 << lane;
+    }
+  }
+  return mask;
+#endif
+}
+
+BLI_INLINE const float *bvhtree_triangles_vert_co(const BVHTreeTriangles *triangles,
+                                                  const int tri,
+                                                  const int corner)
+{
+  const uint *tri_corners = (const uint *)((const char *)triangles->tri_corners +
+                                           triangles->tri_corners_stride * (size_t)tri);
+  uint vert = tri_corners[corner];
+  if (triangles->corner_verts) {
+    vert = *(const uint *)((const char *)triangles->corner_verts +
+                           triangles->corner_verts_stride * vert);
+  }
+  return (const float *)((const char *)triangles->positions + triangles->positions_stride * vert);
+}
+
+static void ray_packet_leaf(BVHRayPacket *packet, const int index, const int mask)
+{
+  const float *v0 = bvhtree_triangles_vert_co(packet->triangles, index, 0);
+  const float *v1 = bvhtree_triangles_vert_co(packet->triangles, index, 1);
+  const float *v2 = bvhtree_triangles_vert_co(packet->triangles, index, 2);
+
+  for (int lane = 0; lane < BVH_RAY_PACKET_SIZE; lane++) {
+    if (!(mask & (1 << lane))) {
+      continue;
+    }
+    const BVHTreeRay *ray = &packet->rays[lane];
+    float dist;
+    bool isect;
+#ifdef USE_KDOPBVH_WATERTIGHT
+    if (packet->use_watertight) {
+      isect = isect_ray_tri_watertight_v3(
+          ray->origin, ray->isect_precalc, v0, v1, v2, &dist, NULL);
+    }
+    else
+#endif
+    {
+      isect = isect_ray_tri_epsilon_v3(
+          ray->origin, ray->direction, v0, v1, v2, &dist, NULL, FLT_EPSILON);
+    }
+
+    if (isect && dist >= 0.0f && dist < packet->dist[lane]) {
+      BVHTreeRayHit *hit = packet->hits[lane];
+      hit->index = index;
+      hit->dist = dist;
+      madd_v3_v3v3fl(hit->co, ray->origin, ray->direction, dist);
+      normal_tri_v3(hit->no, v0, v1, v2);
+      packet->dist[lane] = dist;
+    }
+  }
+}
+
+static void dfs_raycast_packet(BVHRayPacket *packet, const BVHNode *node)
+{
+  const int mask = ray_packet_nearest_hit_mask(packet, node->bv);
+  if (mask == 0) {
+    return;
+  }
+
+  if (node->totnode == 0) {
+    ray_packet_leaf(packet, node->index, mask);
+  }
+  else {
+    /* Pick the loop direction that visits the children closer to most rays first. */
+    if (packet->dir_dot_axis[node->main_axis] > 0.0f) {
+      for (int i = 0; i != node->totnode; i++) {
+        dfs_raycast_packet(packet, node->children[i]);
+      }
+    }
+    else {
+      for (int i = node->totnode - 1; i >= 0; i--) {
+        dfs_raycast_packet(packet, node->children[i]);
+      }
+    }
+  }
+}
+
+static void bvhtree_ray_packet_init(BVHRayPacket *packet,
+                                    const float (*origins)[3],
+                                    const float (*directions)[3],
+                                    BVHTreeRayHit *hits,
+                                    const int rays_num)
+{
+  float dir_sum[3] = {0.0f, 0.0f, 0.0f};
+
+  for (int lane = 0; lane < BVH_RAY_PACKET_SIZE; lane++) {
+    if (lane >= rays_num) {
+      /* A negative distance makes the lane miss every node. */
+      for (int axis = 0; axis < 3; axis++) {
+        packet->origin[axis][lane] = 0.0f;
+        packet->idot_axis[axis][lane] = 0.0f;
+      }
+      packet->dist[lane] = -1.0f;
+      packet->hits[lane] = NULL;
+      continue;
+    }
+
+    BVHTreeRay *ray = &packet->rays[lane];
+    BLI_ASSERT_UNIT_V3(directions[lane]);
+    copy_v3_v3(ray->origin, origins[lane]);
+    copy_v3_v3(ray->direction, directions[lane]);
+    ray->radius = 0.0f;
+#ifdef USE_KDOPBVH_WATERTIGHT
+    if (packet->use_watertight) {
+      isect_ray_tri_watertight_v3_precalc(&packet->isect_precalc[lane], ray->direction);
+      ray->isect_precalc = &packet->isect_precalc[lane];
+    }
+    else {
+      ray->isect_precalc = NULL;
+    }
+#endif
+
+    for (int axis = 0; axis < 3; axis++) {
+      packet->origin[axis][lane] = ray->origin[axis];
+      /* Same as #bvhtree_ray_cast_data_precalc, avoids infinite values for axis aligned rays. */
+      packet->idot_axis[axis][lane] = (fabsf(ray->direction[axis]) < FLT_EPSILON) ?
+                                          FLT_MAX :
+                                          1.0f / ray->direction[axis];
+    }
+    packet->dist[lane] = hits[lane].dist;
+    packet->hits[lane] = &hits[lane];
+    add_v3_v3(dir_sum, ray->direction);
+  }
+
+  for (axis_t axis_iter = packet->tree->start_axis; axis_iter != packet->tree->stop_axis;
+       axis_iter++) {
+    packet->dir_dot_axis[axis_iter] = dot_v3v3(dir_sum, bvhtree_kdop_axes[axis_iter]);
+  }
+}
+
+int BLI_bvhtree_ray_cast_triangles(const BVHTree *tree,
+                                   const BVHTreeTriangles *triangles,
+                                   const float (*origins)[3],
+                                   const float (*directions)[3],
+                                   BVHTreeRayHit *hits,
+                                   const int rays_num,
+                                   const int flag)
+{
+  const BVHNode *root = tree->nodes[tree->totleaf];
+  BVHRayPacket packet;
+  int hits_num = 0;
+
+  /* The packet bounds test only uses the X/Y/Z axes. */
+  BLI_assert(tree->start_axis == 0);
+
+  packet.tree = tree;
+  packet.triangles = triangles;
+#ifdef USE_KDOPBVH_WATERTIGHT
+  packet.use_watertight = (flag & BVH_RAYCAST_WATERTIGHT) != 0;
+#else
+  packet.use_watertight = false;
+  UNUSED_VARS(flag);
+#endif
+
+  for (int start = 0; start < rays_num; start += BVH_RAY_PACKET_SIZE) {
+    bvhtree_ray_packet_init(
+        &packet, &origins[start], &directions[start], &hits[start], rays_num - start);
+    if (root) {
+      dfs_raycast_packet(&packet, root);
+    }
+  }
+
+  for (int i = 0; i < rays_num; i++) {
+    if (hits[i].index != -1) {
+      hits_num++;
+    }
+  }
+  return hits_num;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree_range_query
  *
@@ -28,10 +28,44 @@
 #include "BLI_endian_switch.h"
 #include "BLI_filereader.h"
 #include "BLI_math_base.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "MEM_guardedalloc.h"
 
-typedef struct {
+/**
+ * When reading sequentially through a seekable file, decompress up to this many frames
+ * per thread ahead of the read position on the task scheduler.
+ */
+#define ZSTD_READ_AHEAD_FRAMES_PER_THREAD 2
+/** Upper bound for the number of frames kept in memory (frames are 1mb when written by Blender). */
+#define ZSTD_READ_AHEAD_FRAMES_MAX 32
+
+typedef enum eZstdFrameState {
+  ZSTD_FRAME_EMPTY = 0,
+  ZSTD_FRAME_QUEUED,
+  ZSTD_FRAME_RUNNING,
+  ZSTD_FRAME_DONE,
+  ZSTD_FRAME_ERROR,
+} eZstdFrameState;
+
+/** Storage for one decompressed frame, frames are assigned to slots by their number. */
+typedef struct ZstdFrameSlot {
+  struct ZstdReader *zstd;
+  ZSTD_DCtx *ctx;
+
+  /** The frame stored in this slot or -1. */
+  int frame;
+  /** Protected by the reader's mutex, only changes from #ZSTD_FRAME_DONE on the reading thread. */
+  eZstdFrameState state;
+
+  char *compressed_data;
+  size_t compressed_size;
+  char *uncompressed_data;
+  size_t uncompressed_size;
+} ZstdFrameSlot;
+
+typedef struct ZstdReader {
   FileReader reader;
 
   FileReader *base;
@@ -45,8 +79,17 @@ typedef struct {
     size_t *compressed_ofs;
     size_t *uncompressed_ofs;
 
+    /** Last frame returned by #zstd_ensure_cache, only accessed from the reading thread. */
     char *cached_content;
     int cached_frame;
+
+    /** Frame slots, there is only one when read-ahead is disabled (no #task_pool). */
+    ZstdFrameSlot *slots;
+    int num_slots;
+
+    TaskPool *task_pool;
+    ThreadMutex mutex;
+    ThreadCondition condition;
   } seek;
 } ZstdReader;
 
@@ -170,41 +213,217 @@ static int zstd_frame_from_pos(ZstdReader *zstd, size_t pos)
   return low;
 }
 
-/* Ensure that the currently loaded frame is the correct one. */
-static const char *zstd_ensure_cache(ZstdReader *zstd, int frame)
+static bool zstd_frame_decompress(ZstdFrameSlot *slot)
 {
-  if (zstd->seek.cached_frame == frame) {
-    /* Cached frame matches, so just return it. */
-    return zstd->seek.cached_content;
+  size_t res = ZSTD_decompressDCtx(slot->ctx,
+                                   slot->uncompressed_data,
+                                   slot->uncompressed_size,
+                                   slot->compressed_data,
+                                   slot->compressed_size);
+  MEM_SAFE_FREE(slot->compressed_data);
+  return !(ZSTD_isError(res) || res < slot->uncompressed_size);
+}
+
+static void zstd_frame_decompress_task(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  ZstdFrameSlot *slot = taskdata;
+  ZstdReader *zstd = slot->zstd;
+
+  BLI_mutex_lock(&zstd->seek.mutex);
+  if (slot->state != ZSTD_FRAME_QUEUED) {
+    /* Already handled by the reading thread, or by an earlier task for the same slot. */
+    BLI_mutex_unlock(&zstd->seek.mutex);
+    return;
+  }
+  slot->state = ZSTD_FRAME_RUNNING;
+  BLI_mutex_unlock(&zstd->seek.mutex);
+
+  const bool success = zstd_frame_decompress(slot);
+
+  BLI_mutex_lock(&zstd->seek.mutex);
+  slot->state = success ? ZSTD_FRAME_DONE : ZSTD_FRAME_ERROR;
+  BLI_mutex_unlock(&zstd->seek.mutex);
+  BLI_condition_notify_all(&zstd->seek.condition);
+}
+
+/* Wait until the slot isn't used by a task anymore, the mutex must be locked. */
+static void zstd_frame_slot_wait(ZstdReader *zstd, ZstdFrameSlot *slot)
+{
+  while (slot->state == ZSTD_FRAME_RUNNING) {
+    BLI_condition_wait(&zstd->seek.condition, &zstd->seek.mutex);
+  }
+}
+
+/**
+ * Read the compressed data of the frame into its slot. Unless `is_async` is false, a task is
+ * pushed to decompress it, otherwise the caller is responsible for decompressing.
+ * The base #FileReader is only ever accessed from the reading thread.
+ */
+static ZstdFrameSlot *zstd_frame_load(ZstdReader *zstd, int frame, bool is_async)
+{
+  ZstdFrameSlot *slot = &zstd->seek.slots[frame % zstd->seek.num_slots];
+
+  if (zstd->seek.task_pool) {
+    BLI_mutex_lock(&zstd->seek.mutex);
+    zstd_frame_slot_wait(zstd, slot);
+    if (slot->frame == frame && slot->state != ZSTD_FRAME_ERROR) {
+      BLI_mutex_unlock(&zstd->seek.mutex);
+      return slot;
+    }
+    /* Claim the slot, a task that is still pending for the previous frame will skip it. */
+    slot->state = ZSTD_FRAME_EMPTY;
+    BLI_mutex_unlock(&zstd->seek.mutex);
+  }
+  else if (slot->frame == frame && slot->state == ZSTD_FRAME_DONE) {
+    return slot;
+  }
+
+  /* The slot may hold the cached frame, which is about to be replaced. */
+  if (zstd->seek.cached_frame == slot->frame) {
+    zstd->seek.cached_frame = -1;
+    zstd->seek.cached_content = NULL;
   }
 
-  /* Cached frame doesn't match, so discard it and cache the wanted one instead. */
-  MEM_SAFE_FREE(zstd->seek.cached_content);
+  MEM_SAFE_FREE(slot->compressed_data);
+  slot->frame = -1;
+  slot->state = ZSTD_FRAME_EMPTY;
 
   size_t compressed_size = zstd->seek.compressed_ofs[frame + 1] - zstd->seek.compressed_ofs[frame];
   size_t uncompressed_size = zstd->seek.uncompressed_ofs[frame + 1] -
                              zstd->seek.uncompressed_ofs[frame];
 
-  char *uncompressed_data = MEM_mallocN(uncompressed_size, __func__);
+  if (slot->uncompressed_size != uncompressed_size) {
+    MEM_SAFE_FREE(slot->uncompressed_data);
+    slot->uncompressed_data = MEM_mallocN(uncompressed_size, __func__);
+    slot->uncompressed_size = uncompressed_size;
+  }
+
   char *compressed_data = MEM_mallocN(compressed_size, __func__);
   if (zstd->base->seek(zstd->base, zstd->seek.compressed_ofs[frame], SEEK_SET) < 0 ||
       zstd->base->read(zstd->base, compressed_data, compressed_size) < compressed_size) {
     MEM_freeN(compressed_data);
-    MEM_freeN(uncompressed_data);
     return NULL;
   }
 
-  size_t res = ZSTD_decompressDCtx(
-      zstd->ctx, uncompressed_data, uncompressed_size, compressed_data, compressed_size);
-  MEM_freeN(compressed_data);
-  if (ZSTD_isError(res) || res < uncompressed_size) {
-    MEM_freeN(uncompressed_data);
+  slot->compressed_data = compressed_data;
+  slot->compressed_size = compressed_size;
+  slot->frame = frame;
+
+  if (zstd->seek.task_pool) {
+    BLI_mutex_lock(&zstd->seek.mutex);
+    slot->state = ZSTD_FRAME_QUEUED;
+    BLI_mutex_unlock(&zstd->seek.mutex);
+  }
+  else {
+    slot->state = ZSTD_FRAME_QUEUED;
+  }
+
+  if (is_async) {
+    BLI_task_pool_push(zstd->seek.task_pool, zstd_frame_decompress_task, slot, false, NULL);
+  }
+
+  return slot;
+}
+
+/* Ensure that the currently loaded frame is the correct one. */
+static const char *zstd_ensure_cache(ZstdReader *zstd, int frame)
+{
+  if (zstd->seek.cached_frame == frame) {
+    /* Cached frame matches, so just return it. */
+    return zstd->seek.cached_content;
+  }
+
+  /* Only read ahead when moving forward through the file, reading isolated blocks
+   * (as done for #BHead data that is read on demand) only needs the one frame. */
+  const bool use_read_ahead = zstd->seek.task_pool != NULL && zstd->seek.cached_frame != -1 &&
+                              frame > zstd->seek.cached_frame &&
+                              frame <= zstd->seek.cached_frame + zstd->seek.num_slots;
+
+  ZstdFrameSlot *slot = zstd_frame_load(zstd, frame, false);
+  if (slot == NULL) {
+    return NULL;
+  }
+
+  if (use_read_ahead) {
+    const int frame_end = min_ii(frame + zstd->seek.num_slots, zstd->seek.num_frames);
+    for (int i = frame + 1; i < frame_end; i++) {
+      if (zstd_frame_load(zstd, i, true) == NULL) {
+        break;
+      }
+    }
+  }
+
+  if (zstd->seek.task_pool) {
+    BLI_mutex_lock(&zstd->seek.mutex);
+    if (slot->state == ZSTD_FRAME_QUEUED) {
+      /* Decompress on this thread instead of waiting for a task to pick it up. */
+      slot->state = ZSTD_FRAME_RUNNING;
+      BLI_mutex_unlock(&zstd->seek.mutex);
+      const bool success = zstd_frame_decompress(slot);
+      BLI_mutex_lock(&zstd->seek.mutex);
+      slot->state = success ? ZSTD_FRAME_DONE : ZSTD_FRAME_ERROR;
+    }
+    else {
+      zstd_frame_slot_wait(zstd, slot);
+    }
+    BLI_mutex_unlock(&zstd->seek.mutex);
+  }
+  else if (slot->state == ZSTD_FRAME_QUEUED) {
+    slot->state = zstd_frame_decompress(slot) ? ZSTD_FRAME_DONE : ZSTD_FRAME_ERROR;
+  }
+
+  if (slot->state != ZSTD_FRAME_DONE) {
     return NULL;
   }
 
   zstd->seek.cached_frame = frame;
-  zstd->seek.cached_content = uncompressed_data;
-  return uncompressed_data;
+  zstd->seek.cached_content = slot->uncompressed_data;
+  return slot->uncompressed_data;
+}
+
+static void zstd_read_ahead_init(ZstdReader *zstd)
+{
+  const int num_threads = BLI_task_scheduler_num_threads();
+  /* Read-ahead isn't useful without threads or for files with very few frames. */
+  const bool use_read_ahead = num_threads > 1 && zstd->seek.num_frames > 2;
+
+  zstd->seek.num_slots = use_read_ahead ?
+                             min_ii(num_threads * ZSTD_READ_AHEAD_FRAMES_PER_THREAD,
+                                    ZSTD_READ_AHEAD_FRAMES_MAX) :
+                             1;
+  zstd->seek.slots = MEM_calloc_arrayN(zstd->seek.num_slots, sizeof(ZstdFrameSlot), __func__);
+  for (int i = 0; i < zstd->seek.num_slots; i++) {
+    ZstdFrameSlot *slot = &zstd->seek.slots[i];
+    slot->zstd = zstd;
+    slot->ctx = use_read_ahead ? ZSTD_createDCtx() : zstd->ctx;
+    slot->frame = -1;
+  }
+
+  if (use_read_ahead) {
+    zstd->seek.task_pool = BLI_task_pool_create_background(zstd, TASK_PRIORITY_HIGH);
+    BLI_mutex_init(&zstd->seek.mutex);
+    BLI_condition_init(&zstd->seek.condition);
+  }
+}
+
+static void zstd_read_ahead_free(ZstdReader *zstd)
+{
+  if (zstd->seek.task_pool) {
+    BLI_task_pool_cancel(zstd->seek.task_pool);
+    BLI_task_pool_free(zstd->seek.task_pool);
+    BLI_mutex_end(&zstd->seek.mutex);
+    BLI_condition_end(&zstd->seek.condition);
+  }
+
+  for (int i = 0; i < zstd->seek.num_slots; i++) {
+    ZstdFrameSlot *slot = &zstd->seek.slots[i];
+    if (slot->ctx != zstd->ctx) {
+      ZSTD_freeDCtx(slot->ctx);
+    }
+    MEM_SAFE_FREE(slot->compressed_data);
+    MEM_SAFE_FREE(slot->uncompressed_data);
+  }
+  MEM_freeN(zstd->seek.slots);
 }
 
 static ssize_t zstd_read_seekable(FileReader *reader, void *buffer, size_t size)
@@ -293,15 +512,15 @@ static void zstd_close(FileReader *reader)
 {
   ZstdReader *zstd = (ZstdReader *)reader;
 
-  ZSTD_freeDCtx(zstd->ctx);
   if (zstd->reader.seek) {
+    zstd_read_ahead_free(zstd);
     MEM_freeN(zstd->seek.uncompressed_ofs);
     MEM_freeN(zstd->seek.compressed_ofs);
-    MEM_freeN(zstd->seek.cached_content);
   }
   else {
     MEM_freeN((void *)zstd->in_buf.src);
   }
+  ZSTD_freeDCtx(zstd->ctx);
 
   zstd->base->close(zstd->base);
   MEM_freeN(zstd);
@@ -317,6 +536,7 @@ FileReader *BLI_filereader_new_zstd(FileReader *base)
   if (zstd_read_seek_table(zstd)) {
     zstd->reader.read = zstd_read_seekable;
     zstd->reader.seek = zstd_seek;
+    zstd_read_ahead_init(zstd);
   }
   else {
     zstd->reader.read = zstd_read;
@@ -22,6 +22,7 @@
 
 #include "BLI_kdtree_impl.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_strict_flags.h"
 #include "BLI_utildefines.h"
 
@@ -58,6 +59,11 @@ struct KDTree {
 
 #define KD_NODE_UNSET ((uint)-1)
 
+/** Trees with fewer nodes are balanced on a single thread. */
+#define KD_BALANCE_THREAD_LEN 4096
+/** Number of sub-trees to balance in parallel, after splitting the upper levels of the tree. */
+#define KD_BALANCE_SUBTREES_NUM 256
+
 /**
  * When set we know all values are unbalanced,
  * otherwise clear them when re-balancing: see T62210.
@@ -145,20 +151,17 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+/**
+ * Quick-sort style sorting around the median on the axis: afterwards the median is in the middle,
+ * with smaller values before it and larger values after it.
+ *
+ * \return The index of the median.
+ */
+static uint kdtree_balance_partition(KDTreeNode *nodes, uint nodes_len, uint axis)
 {
-  KDTreeNode *node;
   float co;
   uint left, right, median, i, j;
 
-  if (nodes_len <= 0) {
-    return KD_NODE_UNSET;
-  }
-  else if (nodes_len == 1) {
-    return 0 + ofs;
-  }
-
-  /* Quick-sort style sorting around median. */
   left = 0;
   right = nodes_len - 1;
   median = nodes_len / 2;
@@ -190,6 +193,23 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
     }
   }
 
+  return median;
+}
+
+static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+{
+  KDTreeNode *node;
+  uint median;
+
+  if (nodes_len <= 0) {
+    return KD_NODE_UNSET;
+  }
+  else if (nodes_len == 1) {
+    return 0 + ofs;
+  }
+
+  median = kdtree_balance_partition(nodes, nodes_len, axis);
+
   /* Set node and sort sub-nodes. */
   node = &nodes[median];
   node->d = axis;
@@ -201,6 +221,112 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
   return median + ofs;
 }
 
+/** A range of nodes that becomes a sub-tree when balancing in parallel. */
+typedef struct KDTreeBalanceRange {
+  uint ofs, len, axis;
+  /** Set to the root of the sub-tree, the parent's child index or the tree root. */
+  uint *r_root;
+} KDTreeBalanceRange;
+
+typedef struct KDTreeBalanceData {
+  KDTreeNode *nodes;
+  KDTreeBalanceRange *ranges;
+} KDTreeBalanceData;
+
+static void kdtree_balance_partition_cb(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBalanceData *data = userdata;
+  const KDTreeBalanceRange *range = &data->ranges[i];
+  KDTreeNode *nodes = data->nodes + range->ofs;
+  const uint median = kdtree_balance_partition(nodes, range->len, range->axis);
+  nodes[median].d = range->axis;
+  *range->r_root = range->ofs + median;
+}
+
+static void kdtree_balance_subtree_cb(void *__restrict userdata,
+                                      const int i,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBalanceData *data = userdata;
+  const KDTreeBalanceRange *range = &data->ranges[i];
+  *range->r_root = kdtree_balance(
+      data->nodes + range->ofs, range->len, range->axis, range->ofs);
+}
+
+/**
+ * Partition the upper levels of the tree one level at a time, the ranges of each level in
+ * parallel. Once there are enough ranges, the remaining sub-trees are balanced in parallel.
+ * The result is the same as #kdtree_balance.
+ */
+static void kdtree_balance_parallel(KDTree *tree)
+{
+  KDTreeBalanceRange *ranges = MEM_malloc_arrayN(
+      KD_BALANCE_SUBTREES_NUM * 2, sizeof(*ranges), __func__);
+  KDTreeBalanceRange *ranges_next = MEM_malloc_arrayN(
+      KD_BALANCE_SUBTREES_NUM * 2, sizeof(*ranges), __func__);
+  KDTreeBalanceData data = {tree->nodes, ranges};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  int ranges_len = 1;
+  ranges[0].ofs = 0;
+  ranges[0].len = tree->nodes_len;
+  ranges[0].axis = 0;
+  ranges[0].r_root = &tree->root;
+
+  while (ranges_len < KD_BALANCE_SUBTREES_NUM) {
+    /* Ranges this small are left to the sub-tree balancing. */
+    int split_len = 0;
+    for (int i = 0; i < ranges_len; i++) {
+      if (ranges[i].len > 1) {
+        SWAP(KDTreeBalanceRange, ranges[i], ranges[split_len]);
+        split_len++;
+      }
+    }
+    if (split_len == 0) {
+      break;
+    }
+
+    data.ranges = ranges;
+    BLI_task_parallel_range(0, split_len, &data, kdtree_balance_partition_cb, &settings);
+
+    int ranges_next_len = 0;
+    for (int i = 0; i < split_len; i++) {
+      const KDTreeBalanceRange *range = &ranges[i];
+      KDTreeNode *node = &tree->nodes[*range->r_root];
+      const uint median = *range->r_root;
+      const uint axis = (range->axis + 1) % KD_DIMS;
+
+      KDTreeBalanceRange *left = &ranges_next[ranges_next_len++];
+      left->ofs = range->ofs;
+      left->len = median - range->ofs;
+      left->axis = axis;
+      left->r_root = &node->left;
+
+      KDTreeBalanceRange *right = &ranges_next[ranges_next_len++];
+      right->ofs = median + 1;
+      right->len = range->ofs + range->len - (median + 1);
+      right->axis = axis;
+      right->r_root = &node->right;
+    }
+    for (int i = split_len; i < ranges_len; i++) {
+      ranges_next[ranges_next_len++] = ranges[i];
+    }
+
+    SWAP(KDTreeBalanceRange *, ranges, ranges_next);
+    ranges_len = ranges_next_len;
+  }
+
+  data.ranges = ranges;
+  BLI_task_parallel_range(0, ranges_len, &data, kdtree_balance_subtree_cb, &settings);
+
+  MEM_freeN(ranges);
+  MEM_freeN(ranges_next);
+}
+
 void BLI_kdtree_nd_(balance)(KDTree *tree)
 {
   if (tree->root != KD_NODE_ROOT_IS_INIT) {
@@ -210,7 +336,12 @@ void BLI_kdtree_nd_(balance)(KDTree *tree)
     }
   }
 
-  tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  if (tree->nodes_len >= KD_BALANCE_THREAD_LEN) {
+    kdtree_balance_parallel(tree);
+  }
+  else {
+    tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  }
 
 #ifdef DEBUG
   tree->is_balanced = true;
@@ -820,6 +951,215 @@ static uint *kdtree_order(const KDTree *tree)
   return order;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Batched Queries
+ *
+ * Many queries are done in parallel. Large batches are sorted along a Z-order curve first,
+ * so that consecutive queries mostly visit the same nodes, which are then still cached.
+ * \{ */
+
+/** Batches with fewer queries are not sorted. */
+#define KD_BATCH_SORT_LEN 4096
+/** Number of bits for each dimension of the Z-order keys, all dimensions fit in 32 bits. */
+#define KD_ZORDER_BITS (KD_DIMS < 3 ? 16 : 32 / KD_DIMS)
+
+typedef struct KDTreeBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  /** Order of the queries, or null to keep the given order. */
+  const uint *order;
+
+  /* Z-order keys. */
+  float zorder_min[KD_DIMS];
+  float zorder_scale[KD_DIMS];
+  uint *zorder_keys;
+
+  /* Nearest search. */
+  KDTreeNearest *r_nearest;
+
+  /* Range search. */
+  float range;
+  bool (*search_cb)(
+      void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq);
+  void *user_data;
+} KDTreeBatchData;
+
+static void kdtree_zorder_key_cb(void *__restrict userdata,
+                                 const int i,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  KDTreeBatchData *data = userdata;
+  const float max_value = (float)((1u << KD_ZORDER_BITS) - 1u);
+  uint quantized[KD_DIMS];
+  for (uint j = 0; j < KD_DIMS; j++) {
+    const float value = (data->co[i][j] - data->zorder_min[j]) * data->zorder_scale[j];
+    /* Also handles NaN. */
+    quantized[j] = (value > 0.0f) ? (uint)min_ff(value, max_value) : 0u;
+  }
+  uint key = 0;
+  for (uint bit = 0; bit < KD_ZORDER_BITS; bit++) {
+    for (uint j = 0; j < KD_DIMS; j++) {
+      key |= ((quantized[j] >> bit) & 1u) << (bit * KD_DIMS + j);
+    }
+  }
+  data->zorder_keys[i] = key;
+}
+
+/**
+ * \return The order of the queries along a Z-order curve in their bounds.
+ */
+static uint *kdtree_batch_order(KDTreeBatchData *data, const uint co_len)
+{
+  float max[KD_DIMS];
+  for (uint j = 0; j < KD_DIMS; j++) {
+    data->zorder_min[j] = FLT_MAX;
+    max[j] = -FLT_MAX;
+  }
+  for (uint i = 0; i < co_len; i++) {
+    for (uint j = 0; j < KD_DIMS; j++) {
+      data->zorder_min[j] = min_ff(data->zorder_min[j], data->co[i][j]);
+      max[j] = max_ff(max[j], data->co[i][j]);
+    }
+  }
+  for (uint j = 0; j < KD_DIMS; j++) {
+    const float size = max[j] - data->zorder_min[j];
+    data->zorder_scale[j] = (size > 0.0f) ? (float)((1u << KD_ZORDER_BITS) - 1u) / size : 0.0f;
+  }
+
+  uint *keys = MEM_malloc_arrayN(co_len, sizeof(uint), __func__);
+  uint *keys_tmp = MEM_malloc_arrayN(co_len, sizeof(uint), __func__);
+  uint *order = MEM_malloc_arrayN(co_len, sizeof(uint), __func__);
+  uint *order_tmp = MEM_malloc_arrayN(co_len, sizeof(uint), __func__);
+
+  data->zorder_keys = keys;
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(0, (int)co_len, data, kdtree_zorder_key_cb, &settings);
+  data->zorder_keys = NULL;
+
+  for (uint i = 0; i < co_len; i++) {
+    order[i] = i;
+  }
+
+  /* Radix sort, one byte at a time. An even number of passes leaves the result in `order`. */
+  for (uint shift = 0; shift < 32; shift += 8) {
+    uint offsets[256] = {0};
+    for (uint i = 0; i < co_len; i++) {
+      offsets[(keys[i] >> shift) & 0xffu]++;
+    }
+    uint offset = 0;
+    for (uint digit = 0; digit < 256; digit++) {
+      const uint count = offsets[digit];
+      offsets[digit] = offset;
+      offset += count;
+    }
+    for (uint i = 0; i < co_len; i++) {
+      const uint dst = offsets[(keys[i] >> shift) & 0xffu]++;
+      keys_tmp[dst] = keys[i];
+      order_tmp[dst] = order[i];
+    }
+    SWAP(uint *, keys, keys_tmp);
+    SWAP(uint *, order, order_tmp);
+  }
+
+  MEM_freeN(keys);
+  MEM_freeN(keys_tmp);
+  MEM_freeN(order_tmp);
+  return order;
+}
+
+static void kdtree_batch_run(KDTreeBatchData *data, const uint co_len, TaskParallelRangeFunc func)
+{
+  uint *order = NULL;
+  if (co_len >= KD_BATCH_SORT_LEN && data->tree->root != KD_NODE_UNSET) {
+    order = kdtree_batch_order(data, co_len);
+  }
+  data->order = order;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 256;
+  BLI_task_parallel_range(0, (int)co_len, data, func, &settings);
+
+  if (order) {
+    MEM_freeN(order);
+  }
+}
+
+static void kdtree_find_nearest_batch_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  const uint co_index = data->order ? data->order[i] : (uint)i;
+  KDTreeNearest *nearest = &data->r_nearest[co_index];
+  if (BLI_kdtree_nd_(find_nearest)(data->tree, data->co[co_index], nearest) == -1) {
+    nearest->index = -1;
+  }
+}
+
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        uint co_len,
+                                        KDTreeNearest *r_nearest)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .r_nearest = r_nearest,
+  };
+  kdtree_batch_run(&data, co_len, kdtree_find_nearest_batch_cb);
+}
+
+typedef struct KDTreeBatchRangeQuery {
+  const KDTreeBatchData *data;
+  int co_index;
+} KDTreeBatchRangeQuery;
+
+static bool kdtree_range_search_batch_query_cb(void *user_data,
+                                               int index,
+                                               const float co[KD_DIMS],
+                                               float dist_sq)
+{
+  const KDTreeBatchRangeQuery *query = user_data;
+  return query->data->search_cb(query->data->user_data, query->co_index, index, co, dist_sq);
+}
+
+static void kdtree_range_search_batch_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  KDTreeBatchRangeQuery query = {data, data->order ? (int)data->order[i] : i};
+  BLI_kdtree_nd_(range_search_cb)(data->tree,
+                                  data->co[query.co_index],
+                                  data->range,
+                                  kdtree_range_search_batch_query_cb,
+                                  &query);
+}
+
+void BLI_kdtree_nd_(range_search_batch_cb)(
+    const KDTree *tree,
+    const float (*co)[KD_DIMS],
+    uint co_len,
+    float range,
+    bool (*search_cb)(
+        void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq),
+    void *user_data)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .range = range,
+      .search_cb = search_cb,
+      .user_data = user_data,
+  };
+  kdtree_batch_run(&data, co_len, kdtree_range_search_batch_cb);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_kdtree_3d_calc_duplicates_fast
  * \{ */
@@ -866,6 +1206,246 @@ static void deduplicate_recursive(const struct DeDuplicateParams *p, uint i)
   }
 }
 
+/** Trees with fewer nodes find duplicates on a single thread. */
+#define KD_DUPLICATES_THREAD_LEN 4096
+/** Number of points of which the neighbors are found at once, to limit memory usage. */
+#define KD_DUPLICATES_BLOCK_LEN 65536
+/** Number of points of which the neighbors are found by one task. */
+#define KD_DUPLICATES_CHUNK_LEN 256
+/**
+ * Maximum number of neighbors stored for one chunk. Dense clusters of points would otherwise
+ * store the whole cluster for every point of it, although the first point merges all others.
+ */
+#define KD_DUPLICATES_CHUNK_NEIGHBORS_MAX (KD_DUPLICATES_CHUNK_LEN * 64)
+
+/**
+ * Finding duplicates in parallel is split in two steps: the points in range of every point are
+ * found in parallel first. Then the points are merged in order on a single thread, which gives
+ * the same result as searching one point at a time.
+ */
+typedef struct KDTreeDuplicatesChunk {
+  /** The indices of points in range of each point. */
+  int *neighbors;
+  uint neighbors_len, neighbors_alloc;
+  /** Start of each point's neighbors in #neighbors, with the end at the last position. */
+  uint offsets[KD_DUPLICATES_CHUNK_LEN + 1];
+  /**
+   * Set when the points have more than #KD_DUPLICATES_CHUNK_NEIGHBORS_MAX neighbors,
+   * the chunk's points are then searched on a single thread when merging.
+   */
+  bool is_overflow;
+} KDTreeDuplicatesChunk;
+
+typedef struct KDTreeDuplicatesData {
+  const KDTree *tree;
+  /** Points are processed in #KDTreeNode.index order when set. */
+  const uint *order;
+  const int *duplicates;
+  float range, range_sq;
+  uint block_start, block_len;
+  KDTreeDuplicatesChunk *chunks;
+} KDTreeDuplicatesData;
+
+struct DeDuplicateNeighborsParams {
+  const KDTreeNode *nodes;
+  float range;
+  float range_sq;
+  KDTreeDuplicatesChunk *chunk;
+
+  /* Per Search */
+  float search_co[KD_DIMS];
+  int search;
+};
+
+/** Like #deduplicate_recursive, but collect all points in range. */
+static void deduplicate_neighbors_recursive(const struct DeDuplicateNeighborsParams *p, uint i)
+{
+  if (p->chunk->is_overflow) {
+    return;
+  }
+  const KDTreeNode *node = &p->nodes[i];
+  if (p->search_co[node->d] + p->range <= node->co[node->d]) {
+    if (node->left != KD_NODE_UNSET) {
+      deduplicate_neighbors_recursive(p, node->left);
+    }
+  }
+  else if (p->search_co[node->d] - p->range >= node->co[node->d]) {
+    if (node->right != KD_NODE_UNSET) {
+      deduplicate_neighbors_recursive(p, node->right);
+    }
+  }
+  else {
+    if (p->search != node->index) {
+      if (len_squared_vnvn(node->co, p->search_co) <= p->range_sq) {
+        KDTreeDuplicatesChunk *chunk = p->chunk;
+        if (UNLIKELY(chunk->neighbors_len == KD_DUPLICATES_CHUNK_NEIGHBORS_MAX)) {
+          chunk->is_overflow = true;
+          return;
+        }
+        if (UNLIKELY(chunk->neighbors_len == chunk->neighbors_alloc)) {
+          chunk->neighbors_alloc = min_uu(max_uu(64, chunk->neighbors_alloc * 2),
+                                          KD_DUPLICATES_CHUNK_NEIGHBORS_MAX);
+          chunk->neighbors = MEM_reallocN(chunk->neighbors,
+                                          sizeof(*chunk->neighbors) * chunk->neighbors_alloc);
+        }
+        chunk->neighbors[chunk->neighbors_len++] = node->index;
+      }
+    }
+    if (node->left != KD_NODE_UNSET) {
+      deduplicate_neighbors_recursive(p, node->left);
+    }
+    if (node->right != KD_NODE_UNSET) {
+      deduplicate_neighbors_recursive(p, node->right);
+    }
+  }
+}
+
+BLI_INLINE void kdtree_duplicates_point(const KDTree *tree,
+                                        const uint *order,
+                                        const uint i,
+                                        uint *r_node_index,
+                                        int *r_index)
+{
+  if (order) {
+    *r_node_index = order[i];
+    *r_index = (int)i;
+  }
+  else {
+    *r_node_index = i;
+    *r_index = tree->nodes[i].index;
+  }
+}
+
+static void kdtree_duplicates_neighbors_cb(void *__restrict userdata,
+                                           const int chunk_index,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeDuplicatesData *data = userdata;
+  KDTreeDuplicatesChunk *chunk = &data->chunks[chunk_index];
+  const uint start = data->block_start + (uint)chunk_index * KD_DUPLICATES_CHUNK_LEN;
+  const uint len = min_uu(KD_DUPLICATES_CHUNK_LEN, data->block_start + data->block_len - start);
+
+  struct DeDuplicateNeighborsParams p = {
+      .nodes = data->tree->nodes,
+      .range = data->range,
+      .range_sq = data->range_sq,
+      .chunk = chunk,
+  };
+
+  chunk->neighbors_len = 0;
+  chunk->is_overflow = false;
+  for (uint i = 0; i < len && !chunk->is_overflow; i++) {
+    chunk->offsets[i] = chunk->neighbors_len;
+    uint node_index;
+    int index;
+    kdtree_duplicates_point(data->tree, data->order, start + i, &node_index, &index);
+    /* Points merged in earlier blocks don't search. */
+    if (ELEM(data->duplicates[index], -1, index)) {
+      p.search = index;
+      copy_vn_vn(p.search_co, data->tree->nodes[node_index].co);
+      deduplicate_neighbors_recursive(&p, data->tree->root);
+    }
+  }
+  chunk->offsets[len] = chunk->neighbors_len;
+}
+
+/** Search the points of a chunk one at a time, like the single threaded loop. */
+static void kdtree_duplicates_chunk_serial(const KDTree *tree,
+                                           const uint *order,
+                                           struct DeDuplicateParams *p,
+                                           const uint start,
+                                           const uint len)
+{
+  for (uint i = 0; i < len; i++) {
+    uint node_index;
+    int index;
+    kdtree_duplicates_point(tree, order, start + i, &node_index, &index);
+    if (ELEM(p->duplicates[index], -1, index)) {
+      p->search = index;
+      copy_vn_vn(p->search_co, tree->nodes[node_index].co);
+      const int found_prev = *p->duplicates_found;
+      deduplicate_recursive(p, tree->root);
+      if (*p->duplicates_found != found_prev) {
+        /* Prevent chains of doubles. */
+        p->duplicates[index] = index;
+      }
+    }
+  }
+}
+
+static int kdtree_calc_duplicates_parallel(const KDTree *tree,
+                                           const uint *order,
+                                           const float range,
+                                           int *duplicates)
+{
+  const uint chunks_num = KD_DUPLICATES_BLOCK_LEN / KD_DUPLICATES_CHUNK_LEN;
+  KDTreeDuplicatesData data = {
+      .tree = tree,
+      .order = order,
+      .duplicates = duplicates,
+      .range = range,
+      .range_sq = square_f(range),
+      .chunks = MEM_calloc_arrayN(chunks_num, sizeof(KDTreeDuplicatesChunk), __func__),
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  int found = 0;
+  struct DeDuplicateParams p = {
+      .nodes = tree->nodes,
+      .range = range,
+      .range_sq = data.range_sq,
+      .duplicates = duplicates,
+      .duplicates_found = &found,
+  };
+
+  for (data.block_start = 0; data.block_start < tree->nodes_len;
+       data.block_start += KD_DUPLICATES_BLOCK_LEN) {
+    data.block_len = min_uu(KD_DUPLICATES_BLOCK_LEN, tree->nodes_len - data.block_start);
+    const uint block_chunks_num = divide_ceil_u(data.block_len, KD_DUPLICATES_CHUNK_LEN);
+    BLI_task_parallel_range(
+        0, (int)block_chunks_num, &data, kdtree_duplicates_neighbors_cb, &settings);
+
+    for (uint chunk_index = 0; chunk_index < block_chunks_num; chunk_index++) {
+      const KDTreeDuplicatesChunk *chunk = &data.chunks[chunk_index];
+      const uint start = data.block_start + chunk_index * KD_DUPLICATES_CHUNK_LEN;
+      const uint len = min_uu(KD_DUPLICATES_CHUNK_LEN, data.block_start + data.block_len - start);
+      if (chunk->is_overflow) {
+        /* Most of these points are merged by the time they are searched. */
+        kdtree_duplicates_chunk_serial(tree, order, &p, start, len);
+        continue;
+      }
+      for (uint i = 0; i < len; i++) {
+        uint node_index;
+        int index;
+        kdtree_duplicates_point(tree, order, start + i, &node_index, &index);
+        if (ELEM(duplicates[index], -1, index)) {
+          const int found_prev = found;
+          for (uint j = chunk->offsets[i]; j < chunk->offsets[i + 1]; j++) {
+            const int neighbor = chunk->neighbors[j];
+            if (duplicates[neighbor] == -1) {
+              duplicates[neighbor] = index;
+              found += 1;
+            }
+          }
+          if (found != found_prev) {
+            /* Prevent chains of doubles. */
+            duplicates[index] = index;
+          }
+        }
+      }
+    }
+  }
+
+  for (uint chunk_index = 0; chunk_index < chunks_num; chunk_index++) {
+    MEM_SAFE_FREE(data.chunks[chunk_index].neighbors);
+  }
+  MEM_freeN(data.chunks);
+  return found;
+}
+
 /**
  * Find duplicate points in \a range.
  * Favors speed over quality since it doesn't find the best target vertex for merging.
@@ -898,7 +1478,14 @@ int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
       .duplicates_found = &found,
   };
 
-  if (use_index_order) {
+  if (tree->nodes_len >= KD_DUPLICATES_THREAD_LEN && tree->root != KD_NODE_UNSET) {
+    uint *order = use_index_order ? kdtree_order(tree) : NULL;
+    found = kdtree_calc_duplicates_parallel(tree, order, range, duplicates);
+    if (order) {
+      MEM_freeN(order);
+    }
+  }
+  else if (use_index_order) {
     uint *order = kdtree_order(tree);
     for (uint i = 0; i < tree->nodes_len; i++) {
       const uint node_index = order[i];
@@ -67,6 +67,21 @@ long int PIL_check_seconds_timer_i(void)
   return (long int)PIL_check_seconds_timer();
 }
 
+double PIL_check_thread_seconds_timer(void)
+{
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) {
+    return 0.0;
+  }
+  ULARGE_INTEGER kernel, user;
+  kernel.LowPart = kernel_time.dwLowDateTime;
+  kernel.HighPart = kernel_time.dwHighDateTime;
+  user.LowPart = user_time.dwLowDateTime;
+  user.HighPart = user_time.dwHighDateTime;
+  /* The times are in 100 nanosecond intervals. */
+  return (double)(kernel.QuadPart + user.QuadPart) * 1e-7;
+}
+
 void PIL_sleep_ms(int ms)
 {
   Sleep(ms);
@@ -75,6 +90,7 @@ void PIL_sleep_ms(int ms)
 #else
 
 #  include <sys/time.h>
+#  include <time.h>
 #  include <unistd.h>
 
 double PIL_check_seconds_timer(void)
@@ -97,6 +113,15 @@ long int PIL_check_seconds_timer_i(void)
   return tv.tv_sec;
 }
 
+double PIL_check_thread_seconds_timer(void)
+{
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return 0.0;
+  }
+  return (double)ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
 void PIL_sleep_ms(int ms)
 {
   if (ms >= 1000) {
@@ -8,6 +8,7 @@
 
 #include "BLI_compiler_attrs.h"
 #include "BLI_kdopbvh.h"
+#include "BLI_math_geom.h"
 #include "BLI_math_vector.h"
 #include "BLI_rand.h"
 
@@ -132,3 +133,363 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/**
+ * Move all points after the tree is built and refit it instead of building it again.
+ */
+static void update_tree_test(int points_len, int tree_type, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, tree_type, 6);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  float min[3], max[3];
+  INIT_MINMAX(min, max);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 2.0f);
+    EXPECT_TRUE(BLI_bvhtree_update_node(tree, i, points[i], nullptr, 1));
+    minmax_v3v3_v3(min, max, points[i]);
+  }
+  BLI_bvhtree_update_tree(tree);
+
+  float bb_min[3], bb_max[3];
+  BLI_bvhtree_get_bounding_box(tree, bb_min, bb_max);
+  EXPECT_V3_NEAR(bb_min, min, 1e-5f);
+  EXPECT_V3_NEAR(bb_max, max, 1e-5f);
+
+  for (int i = 0; i < points_len; i++) {
+    const int j = BLI_bvhtree_find_nearest(tree, points[i], nullptr, nullptr, nullptr);
+    EXPECT_GE(j, 0);
+    EXPECT_LT(j, points_len);
+    EXPECT_EQ_ARRAY(points[i], points[j], 3);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, UpdateTree_1)
+{
+  update_tree_test(1, 4, 1234);
+}
+TEST(kdopbvh, UpdateTree_Binary)
+{
+  update_tree_test(5000, 2, 12);
+}
+TEST(kdopbvh, UpdateTree_Quad)
+{
+  update_tree_test(5000, 4, 123);
+}
+
+static bool count_leafs_parent_callback(const BVHTreeAxisRange *UNUSED(bounds),
+                                        void *UNUSED(userdata))
+{
+  return true;
+}
+
+static bool count_leafs_leaf_callback(const BVHTreeAxisRange *UNUSED(bounds),
+                                      int index,
+                                      void *userdata)
+{
+  int *counts = (int *)userdata;
+  counts[index]++;
+  return true;
+}
+
+static bool count_leafs_order_callback(const BVHTreeAxisRange *UNUSED(bounds),
+                                       char UNUSED(axis),
+                                       void *UNUSED(userdata))
+{
+  return true;
+}
+
+/**
+ * Build trees with both build methods from the same points, and check that every leaf is in the
+ * tree once and that queries give the same results.
+ */
+static void build_methods_test(const float (*points)[3],
+                               const int points_len,
+                               const int tree_type,
+                               const int random_seed,
+                               const int axis = 6)
+{
+  BVHTree *tree_median = BLI_bvhtree_new(points_len, 0.0, tree_type, axis);
+  BVHTree *tree_sah = BLI_bvhtree_new(points_len, 0.0, tree_type, axis);
+  for (int i = 0; i < points_len; i++) {
+    BLI_bvhtree_insert(tree_median, i, points[i], 1);
+    BLI_bvhtree_insert(tree_sah, i, points[i], 1);
+  }
+  BLI_bvhtree_balance_ex(tree_median, BVH_BUILD_MEDIAN);
+  BLI_bvhtree_balance_ex(tree_sah, BVH_BUILD_SAH);
+
+  int *counts = (int *)MEM_callocN(sizeof(int) * points_len, __func__);
+  BLI_bvhtree_walk_dfs(tree_sah,
+                       count_leafs_parent_callback,
+                       count_leafs_leaf_callback,
+                       count_leafs_order_callback,
+                       counts);
+  for (int i = 0; i < points_len; i++) {
+    EXPECT_EQ(counts[i], 1);
+  }
+  MEM_freeN(counts);
+
+  struct RNG *rng = BLI_rng_new(random_seed);
+  for (int i = 0; i < 100; i++) {
+    float co[3];
+    rng_v3_round(co, 3, rng, 1000, 2.0f);
+
+    /* The default nearest callback only supports bounding boxes. */
+    if (axis == 6) {
+      BVHTreeNearest nearest_median = {-1};
+      BVHTreeNearest nearest_sah = {-1};
+      nearest_median.dist_sq = nearest_sah.dist_sq = FLT_MAX;
+      BLI_bvhtree_find_nearest(tree_median, co, &nearest_median, nullptr, nullptr);
+      BLI_bvhtree_find_nearest(tree_sah, co, &nearest_sah, nullptr, nullptr);
+      EXPECT_FLOAT_EQ(nearest_median.dist_sq, nearest_sah.dist_sq);
+    }
+
+    float dir[3];
+    rng_v3_round(dir, 3, rng, 1000, 1.0f);
+    if (normalize_v3(dir) == 0.0f) {
+      continue;
+    }
+    BVHTreeRayHit hit_median = {-1};
+    BVHTreeRayHit hit_sah = {-1};
+    hit_median.dist = hit_sah.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree_median, co, dir, 0.01f, &hit_median, nullptr, nullptr);
+    BLI_bvhtree_ray_cast(tree_sah, co, dir, 0.01f, &hit_sah, nullptr, nullptr);
+    EXPECT_EQ(hit_median.index == -1, hit_sah.index == -1);
+    EXPECT_FLOAT_EQ(hit_median.dist, hit_sah.dist);
+  }
+  BLI_rng_free(rng);
+
+  BLI_bvhtree_free(tree_median);
+  BLI_bvhtree_free(tree_sah);
+}
+
+static void build_methods_random_test(const int points_len,
+                                      const int tree_type,
+                                      const int random_seed,
+                                      const int axis = 6)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    /* Cluster half of the points, so that the SAH splits differ from median splits. */
+    if (i % 2) {
+      mul_v3_fl(points[i], 0.01f);
+    }
+  }
+  build_methods_test(points, points_len, tree_type, random_seed, axis);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, BuildMethods_Binary)
+{
+  build_methods_random_test(2, 2, 1);
+  build_methods_random_test(3, 2, 2);
+  build_methods_random_test(10000, 2, 3);
+}
+
+TEST(kdopbvh, BuildMethods_Quad)
+{
+  build_methods_random_test(3, 4, 4);
+  build_methods_random_test(5, 4, 5);
+  build_methods_random_test(10000, 4, 6);
+}
+
+TEST(kdopbvh, BuildMethods_Oct)
+{
+  build_methods_random_test(9, 8, 7);
+  build_methods_random_test(10000, 8, 8);
+}
+
+TEST(kdopbvh, BuildMethods_KDOP)
+{
+  /* 8, 14 and 26-DOPs are built with SAH too, 18-DOPs always use median splits. */
+  build_methods_random_test(10000, 4, 11, 8);
+  build_methods_random_test(10000, 4, 12, 14);
+  build_methods_random_test(10000, 4, 13, 18);
+  build_methods_random_test(10000, 4, 14, 26);
+}
+
+TEST(kdopbvh, BuildMethods_SamePoints)
+{
+  const int points_len = 1000;
+  float(*points)[3] = (float(*)[3])MEM_callocN(sizeof(float[3]) * points_len, __func__);
+  build_methods_test(points, points_len, 4, 9);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, BuildMethods_Deep)
+{
+  /* Each SAH split only separates the largest point, so the depth has to be limited. */
+  const int points_len = 200;
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    points[i][0] = powf(1.5f, (float)i);
+    points[i][1] = points[i][2] = 0.0f;
+  }
+  build_methods_test(points, points_len, 2, 10);
+  MEM_freeN(points);
+}
+
+struct RayCastTriangles {
+  const float (*positions)[3];
+  const uint (*tris)[3];
+};
+
+static void ray_cast_triangles_callback(void *userdata,
+                                        int index,
+                                        const BVHTreeRay *ray,
+                                        BVHTreeRayHit *hit)
+{
+  const RayCastTriangles *data = (const RayCastTriangles *)userdata;
+  const float *v0 = data->positions[data->tris[index][0]];
+  const float *v1 = data->positions[data->tris[index][1]];
+  const float *v2 = data->positions[data->tris[index][2]];
+  float dist;
+  if (isect_ray_tri_watertight_v3(ray->origin, ray->isect_precalc, v0, v1, v2, &dist, nullptr) &&
+      dist >= 0.0f && dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+    madd_v3_v3v3fl(hit->co, ray->origin, ray->direction, dist);
+    normal_tri_v3(hit->no, v0, v1, v2);
+  }
+}
+
+/**
+ * Compare batched ray casts with casting the rays one by one. The triangles reference their
+ * vertices through corners, like mesh triangles.
+ */
+static void ray_cast_triangles_test(const int tris_len, const int rays_len, const int tree_type)
+{
+  const int verts_len = tris_len * 3;
+  float(*positions)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * verts_len, __func__);
+  uint(*tris)[3] = (uint(*)[3])MEM_mallocN(sizeof(uint[3]) * tris_len, __func__);
+  uint *corner_verts = (uint *)MEM_mallocN(sizeof(uint) * verts_len, __func__);
+
+  RNG *rng = BLI_rng_new(tris_len);
+  BVHTree *tree = BLI_bvhtree_new(tris_len, 0.0f, tree_type, 6);
+  for (int i = 0; i < tris_len; i++) {
+    float center[3];
+    BLI_rng_get_float_unit_v3(rng, center);
+    for (int j = 0; j < 3; j++) {
+      float offset[3];
+      BLI_rng_get_float_unit_v3(rng, offset);
+      madd_v3_v3v3fl(positions[i * 3 + j], center, offset, 0.1f);
+      /* Store the corners in reverse order, so the corner and vertex indices differ. */
+      tris[i][j] = uint(verts_len - 1 - (i * 3 + j));
+      corner_verts[tris[i][j]] = uint(i * 3 + j);
+    }
+    BLI_bvhtree_insert(tree, i, positions[i * 3], 3);
+  }
+  BLI_bvhtree_balance(tree);
+
+  float(*origins)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * rays_len, __func__);
+  float(*directions)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * rays_len, __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(BVHTreeRayHit) * rays_len, __func__);
+  for (int i = 0; i < rays_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, origins[i]);
+    mul_v3_fl(origins[i], 2.0f);
+    if (i % 5 == 0) {
+      /* Axis aligned rays. */
+      zero_v3(directions[i]);
+      directions[i][i % 3] = (origins[i][i % 3] > 0.0f) ? -1.0f : 1.0f;
+    }
+    else {
+      float target[3];
+      BLI_rng_get_float_unit_v3(rng, target);
+      mul_v3_fl(target, 0.5f);
+      sub_v3_v3v3(directions[i], target, origins[i]);
+      normalize_v3(directions[i]);
+    }
+    hits[i].index = -1;
+    hits[i].dist = (i % 7 == 0) ? 1.0f : BVH_RAYCAST_DIST_MAX;
+  }
+
+  /* Resolve the corners for the callback. */
+  uint(*tri_verts)[3] = (uint(*)[3])MEM_mallocN(sizeof(uint[3]) * tris_len, __func__);
+  for (int i = 0; i < tris_len; i++) {
+    for (int j = 0; j < 3; j++) {
+      tri_verts[i][j] = corner_verts[tris[i][j]];
+    }
+  }
+  RayCastTriangles data = {positions, tri_verts};
+
+  int expected_hits_num = 0;
+  for (int i = 0; i < rays_len; i++) {
+    BVHTreeRayHit hit;
+    hit.index = -1;
+    hit.dist = hits[i].dist;
+    if (BLI_bvhtree_ray_cast(
+            tree, origins[i], directions[i], 0.0f, &hit, ray_cast_triangles_callback, &data) !=
+        -1) {
+      expected_hits_num++;
+    }
+    /* Store the expected result in place of the input, it's compared below. */
+    hits[i] = hit;
+  }
+
+  BVHTreeRayHit *batch_hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(BVHTreeRayHit) * rays_len,
+                                                           __func__);
+  for (int i = 0; i < rays_len; i++) {
+    batch_hits[i].index = -1;
+    batch_hits[i].dist = (i % 7 == 0) ? 1.0f : BVH_RAYCAST_DIST_MAX;
+  }
+
+  BVHTreeTriangles triangles;
+  triangles.positions = positions[0];
+  triangles.positions_stride = sizeof(float[3]);
+  triangles.tri_corners = tris[0];
+  triangles.tri_corners_stride = sizeof(uint[3]);
+  triangles.corner_verts = corner_verts;
+  triangles.corner_verts_stride = sizeof(uint);
+  const int hits_num = BLI_bvhtree_ray_cast_triangles(
+      tree, &triangles, origins, directions, batch_hits, rays_len, BVH_RAYCAST_DEFAULT);
+
+  EXPECT_EQ(hits_num, expected_hits_num);
+  for (int i = 0; i < rays_len; i++) {
+    EXPECT_EQ(batch_hits[i].index, hits[i].index);
+    if (hits[i].index != -1) {
+      EXPECT_EQ(batch_hits[i].dist, hits[i].dist);
+      EXPECT_V3_NEAR(batch_hits[i].co, hits[i].co, 1e-6f);
+      EXPECT_V3_NEAR(batch_hits[i].no, hits[i].no, 1e-6f);
+    }
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(positions);
+  MEM_freeN(tris);
+  MEM_freeN(tri_verts);
+  MEM_freeN(corner_verts);
+  MEM_freeN(origins);
+  MEM_freeN(directions);
+  MEM_freeN(hits);
+  MEM_freeN(batch_hits);
+}
+
+TEST(kdopbvh, RayCastTriangles_Single)
+{
+  ray_cast_triangles_test(1, 7, 4);
+}
+
+TEST(kdopbvh, RayCastTriangles_Binary)
+{
+  ray_cast_triangles_test(1000, 1001, 2);
+}
+
+TEST(kdopbvh, RayCastTriangles_Quad)
+{
+  ray_cast_triangles_test(1000, 1002, 4);
+}
@@ -0,0 +1,273 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static void rng_co(float *co, int co_len, struct RNG *rng)
+{
+  for (int i = 0; i < co_len; i++) {
+    co[i] = BLI_rng_get_float(rng) * 2.0f - 1.0f;
+  }
+}
+
+static KDTree_3d *kdtree_3d_from_coords(const float (*co)[3], const int co_len)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new((uint)co_len);
+  for (int i = 0; i < co_len; i++) {
+    BLI_kdtree_3d_insert(tree, i, co[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  return tree;
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+static void find_nearest_brute_force_test(const int tree_len, const int seed)
+{
+  RNG *rng = BLI_rng_new(seed);
+  float(*co)[3] = (float(*)[3])MEM_malloc_arrayN(tree_len, sizeof(*co), __func__);
+  rng_co((float *)co, tree_len * 3, rng);
+  KDTree_3d *tree = kdtree_3d_from_coords(co, tree_len);
+
+  /* Every point is found at its own position. */
+  for (int i = 0; i < tree_len; i++) {
+    KDTreeNearest_3d nearest;
+    EXPECT_EQ(BLI_kdtree_3d_find_nearest(tree, co[i], &nearest), i);
+    EXPECT_EQ(nearest.dist, 0.0f);
+  }
+
+  for (int i = 0; i < 100; i++) {
+    float query[3];
+    rng_co(query, 3, rng);
+    float dist_sq_min = FLT_MAX;
+    for (int j = 0; j < tree_len; j++) {
+      dist_sq_min = min_ff(dist_sq_min, len_squared_v3v3(query, co[j]));
+    }
+    KDTreeNearest_3d nearest;
+    BLI_kdtree_3d_find_nearest(tree, query, &nearest);
+    EXPECT_EQ(nearest.dist, sqrtf(dist_sq_min));
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(co);
+  BLI_rng_free(rng);
+}
+
+TEST(kdtree, FindNearest_Small)
+{
+  find_nearest_brute_force_test(100, 1);
+}
+
+TEST(kdtree, FindNearest_Large)
+{
+  /* Large enough to be balanced in parallel. */
+  find_nearest_brute_force_test(100000, 2);
+}
+
+TEST(kdtree, FindNearestBatch_Empty)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(0);
+  BLI_kdtree_3d_balance(tree);
+  const float co[1][3] = {{0.0f, 0.0f, 0.0f}};
+  KDTreeNearest_3d nearest;
+  BLI_kdtree_3d_find_nearest_batch(tree, co, 1, &nearest);
+  EXPECT_EQ(nearest.index, -1);
+  BLI_kdtree_3d_free(tree);
+}
+
+static void find_nearest_batch_test(const int tree_len, const int queries_len, const int seed)
+{
+  RNG *rng = BLI_rng_new(seed);
+  float(*co)[3] = (float(*)[3])MEM_malloc_arrayN(tree_len, sizeof(*co), __func__);
+  float(*queries)[3] = (float(*)[3])MEM_malloc_arrayN(queries_len, sizeof(*queries), __func__);
+  rng_co((float *)co, tree_len * 3, rng);
+  rng_co((float *)queries, queries_len * 3, rng);
+  KDTree_3d *tree = kdtree_3d_from_coords(co, tree_len);
+
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_malloc_arrayN(
+      queries_len, sizeof(*nearest), __func__);
+  BLI_kdtree_3d_find_nearest_batch(tree, queries, (uint)queries_len, nearest);
+  for (int i = 0; i < queries_len; i++) {
+    KDTreeNearest_3d expected;
+    EXPECT_EQ(BLI_kdtree_3d_find_nearest(tree, queries[i], &expected), nearest[i].index);
+    EXPECT_EQ(expected.dist, nearest[i].dist);
+  }
+
+  MEM_freeN(nearest);
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(queries);
+  MEM_freeN(co);
+  BLI_rng_free(rng);
+}
+
+TEST(kdtree, FindNearestBatch_Small)
+{
+  find_nearest_batch_test(1000, 100, 3);
+}
+
+TEST(kdtree, FindNearestBatch_Large)
+{
+  /* Large enough for the queries to be sorted. */
+  find_nearest_batch_test(50000, 20000, 4);
+}
+
+TEST(kdtree, FindNearestBatch_1d)
+{
+  const int tree_len = 10000;
+  const int queries_len = 10000;
+  RNG *rng = BLI_rng_new(5);
+  KDTree_1d *tree = BLI_kdtree_1d_new(tree_len);
+  for (int i = 0; i < tree_len; i++) {
+    float co;
+    rng_co(&co, 1, rng);
+    BLI_kdtree_1d_insert(tree, i, &co);
+  }
+  BLI_kdtree_1d_balance(tree);
+
+  float(*queries)[1] = (float(*)[1])MEM_malloc_arrayN(queries_len, sizeof(*queries), __func__);
+  rng_co((float *)queries, queries_len, rng);
+  KDTreeNearest_1d *nearest = (KDTreeNearest_1d *)MEM_malloc_arrayN(
+      queries_len, sizeof(*nearest), __func__);
+  BLI_kdtree_1d_find_nearest_batch(tree, queries, queries_len, nearest);
+  for (int i = 0; i < queries_len; i++) {
+    KDTreeNearest_1d expected;
+    EXPECT_EQ(BLI_kdtree_1d_find_nearest(tree, queries[i], &expected), nearest[i].index);
+  }
+
+  MEM_freeN(nearest);
+  MEM_freeN(queries);
+  BLI_kdtree_1d_free(tree);
+  BLI_rng_free(rng);
+}
+
+TEST(kdtree, RangeSearchBatch)
+{
+  const int tree_len = 20000;
+  const int queries_len = 10000;
+  const float range = 0.05f;
+  RNG *rng = BLI_rng_new(6);
+  float(*co)[3] = (float(*)[3])MEM_malloc_arrayN(tree_len, sizeof(*co), __func__);
+  float(*queries)[3] = (float(*)[3])MEM_malloc_arrayN(queries_len, sizeof(*queries), __func__);
+  rng_co((float *)co, tree_len * 3, rng);
+  rng_co((float *)queries, queries_len * 3, rng);
+  KDTree_3d *tree = kdtree_3d_from_coords(co, tree_len);
+
+  /* Each query is handled by a single thread, so the counts don't need to be atomic. */
+  int *counts = (int *)MEM_calloc_arrayN(queries_len, sizeof(int), __func__);
+  BLI_kdtree_3d_range_search_batch_cb(
+      tree,
+      queries,
+      queries_len,
+      range,
+      [](void *user_data, int co_index, int /*index*/, const float /*co*/[3], float dist_sq) {
+        EXPECT_LE(dist_sq, 0.05f * 0.05f);
+        ((int *)user_data)[co_index]++;
+        return true;
+      },
+      counts);
+
+  for (int i = 0; i < queries_len; i++) {
+    int expected = 0;
+    for (int j = 0; j < tree_len; j++) {
+      if (len_squared_v3v3(queries[i], co[j]) <= range * range) {
+        expected++;
+      }
+    }
+    EXPECT_EQ(counts[i], expected);
+  }
+
+  MEM_freeN(counts);
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(queries);
+  MEM_freeN(co);
+  BLI_rng_free(rng);
+}
+
+static void calc_duplicates_fast_test(const int tree_len,
+                                      const int seed,
+                                      const int cluster_len = 0)
+{
+  const float range = 0.05f;
+  RNG *rng = BLI_rng_new(seed);
+  float(*co)[3] = (float(*)[3])MEM_malloc_arrayN(tree_len, sizeof(*co), __func__);
+  rng_co((float *)co, tree_len * 3, rng);
+  /* A cluster of points that are all in range of each other, spread over the indices. */
+  for (int i = 0; i < cluster_len; i++) {
+    mul_v3_fl(co[i * tree_len / cluster_len], range * 0.1f);
+  }
+  /* Some exact duplicates, which are merged regardless of the range. */
+  for (int i = 0; i < tree_len; i += 10) {
+    copy_v3_v3(co[i], co[BLI_rng_get_uint(rng) % (uint)tree_len]);
+  }
+  KDTree_3d *tree = kdtree_3d_from_coords(co, tree_len);
+
+  /* Points are merged into the first unmerged point in range, in index order. */
+  int *expected = (int *)MEM_malloc_arrayN(tree_len, sizeof(int), __func__);
+  copy_vn_i(expected, tree_len, -1);
+  int expected_found = 0;
+  for (int i = 0; i < tree_len; i++) {
+    if (!ELEM(expected[i], -1, i)) {
+      continue;
+    }
+    bool found = false;
+    for (int j = 0; j < tree_len; j++) {
+      if (j != i && expected[j] == -1 && len_squared_v3v3(co[i], co[j]) <= range * range) {
+        expected[j] = i;
+        expected_found++;
+        found = true;
+      }
+    }
+    if (found) {
+      expected[i] = i;
+    }
+  }
+
+  int *duplicates = (int *)MEM_malloc_arrayN(tree_len, sizeof(int), __func__);
+  copy_vn_i(duplicates, tree_len, -1);
+  EXPECT_EQ(BLI_kdtree_3d_calc_duplicates_fast(tree, range, true, duplicates), expected_found);
+  for (int i = 0; i < tree_len; i++) {
+    EXPECT_EQ(duplicates[i], expected[i]);
+  }
+
+  /* Without the index order, every point is merged into a point in range that is kept. */
+  copy_vn_i(duplicates, tree_len, -1);
+  EXPECT_GT(BLI_kdtree_3d_calc_duplicates_fast(tree, range, false, duplicates), 0);
+  for (int i = 0; i < tree_len; i++) {
+    if (duplicates[i] != -1) {
+      EXPECT_EQ(duplicates[duplicates[i]], duplicates[i]);
+      EXPECT_LE(len_squared_v3v3(co[i], co[duplicates[i]]), range * range);
+    }
+  }
+
+  MEM_freeN(duplicates);
+  MEM_freeN(expected);
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(co);
+  BLI_rng_free(rng);
+}
+
+TEST(kdtree, CalcDuplicatesFast_Small)
+{
+  calc_duplicates_fast_test(1000, 7);
+}
+
+TEST(kdtree, CalcDuplicatesFast_Large)
+{
+  /* Large enough to find the duplicates on multiple threads. */
+  calc_duplicates_fast_test(12000, 8);
+}
+
+TEST(kdtree, CalcDuplicatesFast_DenseCluster)
+{
+  /* Merging a cluster larger than the multi-threading threshold into one point. */
+  calc_duplicates_fast_test(12000, 9, 8000);
+}
@@ -0,0 +1,278 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_math_geom.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "PIL_time.h"
+
+#define NUM_RUN_AVERAGED 5
+#define NUM_RAYS 1000000
+
+struct Triangles {
+  float (*coords)[3][3];
+  int len;
+};
+
+/**
+ * Small triangles on a sphere, with a dense cluster in one part of it, like the distribution of
+ * faces in a sculpted mesh.
+ */
+static Triangles triangles_create(const int len)
+{
+  Triangles triangles;
+  triangles.len = len;
+  triangles.coords = (float(*)[3][3])MEM_mallocN(sizeof(*triangles.coords) * len, __func__);
+  RNG *rng = BLI_rng_new(0);
+  for (int i = 0; i < len; i++) {
+    float center[3];
+    BLI_rng_get_float_unit_v3(rng, center);
+    if (i % 4 != 0) {
+      /* Most triangles are close to the top of the sphere. */
+      center[2] = fabsf(center[2]) * 4.0f + 4.0f;
+      normalize_v3(center);
+    }
+    const float size = (i % 4 != 0) ? 0.001f : 0.01f;
+    for (int j = 0; j < 3; j++) {
+      float offset[3];
+      BLI_rng_get_float_unit_v3(rng, offset);
+      madd_v3_v3v3fl(triangles.coords[i][j], center, offset, size);
+    }
+  }
+  BLI_rng_free(rng);
+  return triangles;
+}
+
+static BVHTree *triangles_tree_build(const Triangles &triangles, const int build_method)
+{
+  BVHTree *tree = BLI_bvhtree_new(triangles.len, 0.0f, 4, 6);
+  for (int i = 0; i < triangles.len; i++) {
+    BLI_bvhtree_insert(tree, i, triangles.coords[i][0], 3);
+  }
+  BLI_bvhtree_balance_ex(tree, build_method);
+  return tree;
+}
+
+static void triangles_raycast_cb(void *userdata,
+                                 int index,
+                                 const BVHTreeRay *ray,
+                                 BVHTreeRayHit *hit)
+{
+  const Triangles *triangles = (const Triangles *)userdata;
+  const float(*tri)[3] = triangles->coords[index];
+  float dist;
+  if (isect_ray_tri_watertight_v3(
+          ray->origin, ray->isect_precalc, tri[0], tri[1], tri[2], &dist, nullptr) &&
+      dist >= 0.0f && dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+  }
+}
+
+struct RaycastData {
+  BVHTree *tree;
+  const Triangles *triangles;
+};
+
+static void raycast_task_cb(void *__restrict userdata,
+                            const int i,
+                            const TaskParallelTLS *__restrict tls)
+{
+  RaycastData *data = (RaycastData *)userdata;
+  /* Rays from outside the sphere towards a random point near the center. */
+  RNG *rng = BLI_rng_new((uint)i);
+  float origin[3], target[3], dir[3];
+  BLI_rng_get_float_unit_v3(rng, origin);
+  mul_v3_fl(origin, 2.0f);
+  BLI_rng_get_float_unit_v3(rng, target);
+  mul_v3_fl(target, 0.5f);
+  sub_v3_v3v3(dir, target, origin);
+  normalize_v3(dir);
+  BLI_rng_free(rng);
+
+  BVHTreeRayHit hit;
+  hit.index = -1;
+  hit.dist = BVH_RAYCAST_DIST_MAX;
+  BLI_bvhtree_ray_cast(
+      data->tree, origin, dir, 0.0f, &hit, triangles_raycast_cb, (void *)data->triangles);
+  if (hit.index != -1) {
+    (*(int *)tls->userdata_chunk)++;
+  }
+}
+
+static void hits_reduce(const void *__restrict UNUSED(userdata),
+                        void *__restrict chunk_join,
+                        void *__restrict chunk)
+{
+  *(int *)chunk_join += *(int *)chunk;
+}
+
+static int triangles_raycast(BVHTree *tree, const Triangles &triangles)
+{
+  RaycastData data = {tree, &triangles};
+  int hits = 0;
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.userdata_chunk = &hits;
+  settings.userdata_chunk_size = sizeof(hits);
+  settings.func_reduce = hits_reduce;
+  BLI_task_parallel_range(0, NUM_RAYS, &data, raycast_task_cb, &settings);
+  return hits;
+}
+
+static void bvhtree_build_methods_test(const char *id, const int triangles_len)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+  BLI_threadapi_init();
+
+  Triangles triangles = triangles_create(triangles_len);
+  int expected_hits = -1;
+
+  for (const int build_method : {BVH_BUILD_MEDIAN, BVH_BUILD_SAH}) {
+    const char *name = (build_method == BVH_BUILD_SAH) ? "SAH" : "Median";
+    double build_time = 0.0;
+    double raycast_time = 0.0;
+    for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+      double start_time = PIL_check_seconds_timer();
+      BVHTree *tree = triangles_tree_build(triangles, build_method);
+      build_time += PIL_check_seconds_timer() - start_time;
+
+      start_time = PIL_check_seconds_timer();
+      const int hits = triangles_raycast(tree, triangles);
+      raycast_time += PIL_check_seconds_timer() - start_time;
+
+      /* Both trees must give the same results. */
+      if (expected_hits == -1) {
+        expected_hits = hits;
+      }
+      EXPECT_EQ(hits, expected_hits);
+      BLI_bvhtree_free(tree);
+    }
+    printf("\t%s: build in %fs, %d ray casts in %fs on average over %d runs\n",
+           name,
+           build_time / NUM_RUN_AVERAGED,
+           NUM_RAYS,
+           raycast_time / NUM_RUN_AVERAGED,
+           NUM_RUN_AVERAGED);
+  }
+
+  MEM_freeN(triangles.coords);
+  BLI_threadapi_exit();
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+static void rays_create(float (*origins)[3], float (*directions)[3], const int rays_len)
+{
+  /* Nearby rays from a camera-like origin, so consecutive rays are coherent. */
+  const int grid_size = (int)sqrtf((float)rays_len);
+  for (int i = 0; i < rays_len; i++) {
+    const float target[3] = {(float)(i % grid_size) / (float)grid_size - 0.5f,
+                             (float)(i / grid_size) / (float)grid_size - 0.5f,
+                             1.0f};
+    const float origin[3] = {0.0f, 0.0f, -2.0f};
+    copy_v3_v3(origins[i], origin);
+    sub_v3_v3v3(directions[i], target, origin);
+    normalize_v3(directions[i]);
+  }
+}
+
+static void bvhtree_ray_cast_triangles_test(const char *id, const int triangles_len)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  Triangles triangles = triangles_create(triangles_len);
+  BVHTree *tree = triangles_tree_build(triangles, BVH_BUILD_SAH);
+
+  float(*origins)[3] = (float(*)[3])MEM_mallocN(sizeof(*origins) * NUM_RAYS, __func__);
+  float(*directions)[3] = (float(*)[3])MEM_mallocN(sizeof(*directions) * NUM_RAYS, __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * NUM_RAYS, __func__);
+  rays_create(origins, directions, NUM_RAYS);
+
+  BVHTreeTriangles batch_triangles;
+  batch_triangles.positions = triangles.coords[0][0];
+  batch_triangles.positions_stride = sizeof(float[3]);
+  /* Corners are vertex indices, and the vertices of each triangle are stored together. */
+  uint(*tri_corners)[3] = (uint(*)[3])MEM_mallocN(sizeof(*tri_corners) * triangles_len, __func__);
+  for (int i = 0; i < triangles_len; i++) {
+    tri_corners[i][0] = (uint)i * 3;
+    tri_corners[i][1] = (uint)i * 3 + 1;
+    tri_corners[i][2] = (uint)i * 3 + 2;
+  }
+  batch_triangles.tri_corners = tri_corners[0];
+  batch_triangles.tri_corners_stride = sizeof(*tri_corners);
+  batch_triangles.corner_verts = nullptr;
+  batch_triangles.corner_verts_stride = 0;
+
+  double callback_time = 0.0;
+  double batch_time = 0.0;
+  int callback_hits = 0;
+  int batch_hits = 0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    double start_time = PIL_check_seconds_timer();
+    callback_hits = 0;
+    for (int i = 0; i < NUM_RAYS; i++) {
+      BVHTreeRayHit hit;
+      hit.index = -1;
+      hit.dist = BVH_RAYCAST_DIST_MAX;
+      if (BLI_bvhtree_ray_cast(tree,
+                               origins[i],
+                               directions[i],
+                               0.0f,
+                               &hit,
+                               triangles_raycast_cb,
+                               (void *)&triangles) != -1) {
+        callback_hits++;
+      }
+    }
+    callback_time += PIL_check_seconds_timer() - start_time;
+
+    start_time = PIL_check_seconds_timer();
+    for (int i = 0; i < NUM_RAYS; i++) {
+      hits[i].index = -1;
+      hits[i].dist = BVH_RAYCAST_DIST_MAX;
+    }
+    batch_hits = BLI_bvhtree_ray_cast_triangles(
+        tree, &batch_triangles, origins, directions, hits, NUM_RAYS, BVH_RAYCAST_DEFAULT);
+    batch_time += PIL_check_seconds_timer() - start_time;
+  }
+  EXPECT_EQ(callback_hits, batch_hits);
+
+  printf("\tCallback: %d ray casts in %fs on average over %d runs\n",
+         NUM_RAYS,
+         callback_time / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+  printf("\tBatched: %d ray casts in %fs on average over %d runs\n",
+         NUM_RAYS,
+         batch_time / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  BLI_bvhtree_free(tree);
+  MEM_freeN(triangles.coords);
+  MEM_freeN(tri_corners);
+  MEM_freeN(origins);
+  MEM_freeN(directions);
+  MEM_freeN(hits);
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdopbvh, BuildMethods100k)
+{
+  bvhtree_build_methods_test("BVH tree build methods - 100000 triangles", 100000);
+}
+
+TEST(kdopbvh, BuildMethods1M)
+{
+  bvhtree_build_methods_test("BVH tree build methods - 1000000 triangles", 1000000);
+}
+
+TEST(kdopbvh, RayCastTriangles1M)
+{
+  bvhtree_ray_cast_triangles_test("BVH tree ray cast triangles - 1000000 triangles", 1000000);
+}
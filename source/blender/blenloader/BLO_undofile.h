@@ -34,8 +34,12 @@ typedef struct {
   const char *buf;
   /** Size in bytes. */
   size_t size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** When true, this chunk is identical to the matching chunk of the previous step,
+   * it doesn't own the memory (implies #is_shared). */
   bool is_identical;
+  /** When true, this chunk doesn't own the memory, it's shared with another #MemFileChunk
+   * that has the same content, from a previous step or earlier in the same #MemFile. */
+  bool is_shared;
   /** When true, this chunk is also identical to the one in the next step (used by undo code to
    * detect unchanged IDs).
    * Defined when writing the next step (i.e. last undo step has those always false). */
@@ -43,6 +47,8 @@ typedef struct {
   /** Session UUID of the ID being currently written (MAIN_ID_SESSION_UUID_UNSET when not writing
    * ID-related data). Used to find matching chunks in previous memundo step. */
   uint id_session_uuid;
+  /** Hash of the content, used to share memory between chunks with identical content. */
+  uint hash;
 } MemFileChunk;
 
 typedef struct MemFile {
@@ -59,6 +65,9 @@ typedef struct MemFileWriteData {
 
   /** Maps an ID session uuid to its first reference MemFileChunk, if existing. */
   struct GHash *id_session_uuid_mapping;
+  /** Maps a content hash to a MemFileChunk from the reference or written memfile that owns
+   * or shares a buffer with that content. */
+  struct GHash *content_hash_mapping;
 } MemFileWriteData;
 
 typedef struct MemFileUndoData {
@@ -85,6 +94,13 @@ void BLO_memfile_write_init(MemFileWriteData *mem_data,
 void BLO_memfile_write_finalize(MemFileWriteData *mem_data);
 
 void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t size);
+/**
+ * Add the chunks of an unchanged ID from the reference memfile to the written one, instead of
+ * writing the ID again.
+ *
+ * \return false when the reference memfile has no chunks for this ID, it must then be written.
+ */
+bool BLO_memfile_chunks_reuse_id(MemFileWriteData *mem_data, uint id_session_uuid);
 
 /* exports */
 
@@ -69,6 +69,7 @@
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "PIL_time.h"
@@ -214,6 +215,21 @@ typedef struct BHeadN {
  * because ID names are used in lookup tables. */
 #define BHEAD_USE_READ_ON_DEMAND(bhead) ((bhead)->code == DATA)
 
+/**
+ * When the file is memory-mapped, ID blocks are delayed too since reading them later is cheap.
+ * This matters most for library files where only a few of the ID's are ever linked.
+ * Only the start of the ID is kept (see #BHEAD_ID_PREFIX_LEN), which contains the name
+ * and asset data pointer that are needed for lookups before the ID itself is read.
+ */
+#define BHEAD_ID_USE_READ_ON_DEMAND(fd, bhead) \
+  (((fd)->flags & FD_FLAGS_IS_MMAP) && blo_bhead_is_id_valid_type(bhead))
+
+/**
+ * Number of bytes of a delayed ID block that are read immediately,
+ * must contain #ID.name and #ID.asset_data for the files DNA, see #read_file_dna.
+ */
+#define BHEAD_ID_PREFIX_LEN 256
+
 void BLO_reportf_wrap(BlendFileReadReport *reports, eReportType type, const char *format, ...)
 {
   char fixed_buf[1024]; /* should be long enough */
@@ -834,22 +850,30 @@ static BHeadN *get_bhead(FileData *fd)
         /* pass */
       }
 #ifdef USE_BHEAD_READ_ON_DEMAND
-      else if (fd->file->seek != NULL && BHEAD_USE_READ_ON_DEMAND(&bhead)) {
-        /* Delay reading bhead content. */
-        new_bhead = MEM_mallocN(sizeof(BHeadN), "new_bhead");
+      else if (fd->file->seek != NULL && (BHEAD_USE_READ_ON_DEMAND(&bhead) ||
+                                          BHEAD_ID_USE_READ_ON_DEMAND(fd, &bhead))) {
+        /* Delay reading bhead content, ID's keep their first bytes for name lookups. */
+        const size_t prefix_len = BHEAD_USE_READ_ON_DEMAND(&bhead) ?
+                                      0 :
+                                      MIN2((size_t)bhead.len, BHEAD_ID_PREFIX_LEN);
+        new_bhead = MEM_mallocN(sizeof(BHeadN) + prefix_len, "new_bhead");
         if (new_bhead) {
           new_bhead->next = new_bhead->prev = NULL;
           new_bhead->file_offset = fd->file->offset;
           new_bhead->has_data = false;
           new_bhead->is_memchunk_identical = false;
           new_bhead->bhead = bhead;
-          off64_t seek_new = fd->file->seek(fd->file, bhead.len, SEEK_CUR);
+          off64_t seek_new = -1;
+          if (prefix_len == 0 ||
+              fd->file->read(fd->file, new_bhead + 1, prefix_len) == (ssize_t)prefix_len) {
+            seek_new = fd->file->seek(fd->file, bhead.len - (off64_t)prefix_len, SEEK_CUR);
+          }
           if (seek_new == -1) {
             fd->is_eof = true;
             MEM_freeN(new_bhead);
             new_bhead = NULL;
           }
-          BLI_assert(fd->file->offset == seek_new);
+          BLI_assert(new_bhead == NULL || fd->file->offset == seek_new);
         }
         else {
           fd->is_eof = true;
@@ -988,6 +1012,37 @@ static BHead *blo_bhead_read_full(FileData *fd, BHead *thisblock)
   }
   return &new_bhead_data->bhead;
 }
+
+/**
+ * Delayed ID blocks only store #BHEAD_ID_PREFIX_LEN bytes, in the unlikely case this
+ * doesn't contain the ID name & asset pointer of the files DNA, read them fully.
+ */
+static bool blo_bhead_id_prefix_ensure(FileData *fd)
+{
+  if (!(fd->flags & FD_FLAGS_IS_MMAP)) {
+    return true;
+  }
+  const int pointer_size = (fd->flags & FD_FLAGS_FILE_POINTSIZE_IS_4) ? 4 : 8;
+  if ((fd->id_name_offset + MAX_ID_NAME <= BHEAD_ID_PREFIX_LEN) &&
+      (fd->id_asset_data_offset + pointer_size <= BHEAD_ID_PREFIX_LEN)) {
+    return true;
+  }
+
+  LISTBASE_FOREACH_MUTABLE (BHeadN *, new_bhead, &fd->bhead_list) {
+    if (new_bhead->has_data || !blo_bhead_is_id_valid_type(&new_bhead->bhead)) {
+      continue;
+    }
+    BHead *bhead_full = blo_bhead_read_full(fd, &new_bhead->bhead);
+    if (bhead_full == NULL) {
+      return false;
+    }
+    BLI_insertlinkreplace(&fd->bhead_list, new_bhead, BHEADN_FROM_BHEAD(bhead_full));
+    MEM_freeN(new_bhead);
+  }
+  /* Following blocks are read fully. */
+  fd->flags &= ~FD_FLAGS_IS_MMAP;
+  return true;
+}
 #endif /* USE_BHEAD_READ_ON_DEMAND */
 
 const char *blo_bhead_id_name(const FileData *fd, const BHead *bhead)
@@ -1083,6 +1138,13 @@ static bool read_file_dna(FileData *fd, const char **r_error_message)
         fd->id_asset_data_offset = DNA_elem_offset(
             fd->filesdna, "ID", "AssetMetaData", "*asset_data");
 
+#ifdef USE_BHEAD_READ_ON_DEMAND
+        if (!blo_bhead_id_prefix_ensure(fd)) {
+          *r_error_message = "Unable to read ID blocks";
+          return false;
+        }
+#endif
+
         return true;
       }
 
@@ -1211,10 +1273,13 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   /* Rewind the file after reading the header. */
   rawfile->seek(rawfile, 0, SEEK_SET);
 
+  bool is_mmap = false;
+
   /* Check if we have a regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
     /* Try opening the file with memory-mapped IO. */
     file = BLI_filereader_new_mmap(filedes);
+    is_mmap = (file != NULL);
     if (file == NULL) {
       /* mmap failed, so just keep using rawfile. */
       file = rawfile;
@@ -1245,6 +1310,9 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   FileData *fd = filedata_new(reports);
   fd->file = file;
+  if (is_mmap) {
+    fd->flags |= FD_FLAGS_IS_MMAP;
+  }
 
   return fd;
 }
@@ -1350,7 +1418,8 @@ void blo_filedata_free(FileData *fd)
 #else
     /* Sanity check we're not keeping memory we don't need. */
     LISTBASE_FOREACH_MUTABLE (BHeadN *, new_bhead, &fd->bhead_list) {
-      if (fd->file->seek != NULL && BHEAD_USE_READ_ON_DEMAND(&new_bhead->bhead)) {
+      if (fd->file->seek != NULL && (BHEAD_USE_READ_ON_DEMAND(&new_bhead->bhead) ||
+                                     BHEAD_ID_USE_READ_ON_DEMAND(fd, &new_bhead->bhead))) {
         BLI_assert(new_bhead->has_data == 0);
       }
       MEM_freeN(new_bhead);
@@ -1861,6 +1930,70 @@ static void switch_endian_structs(const struct SDNA *filesdna, BHead *bhead)
   }
 }
 
+/**
+ * Number of structs converted by a single task in #read_struct_reconstruct,
+ * arrays smaller than this are converted on the calling thread.
+ */
+#define RECONSTRUCT_BLOCKS_PER_TASK 4096
+
+typedef struct ReconstructTaskData {
+  const struct DNA_ReconstructInfo *reconstruct_info;
+  int old_struct_nr;
+  int blocks;
+  const char *old_blocks;
+  int old_block_size;
+  char *new_blocks;
+  int new_block_size;
+} ReconstructTaskData;
+
+static void read_struct_reconstruct_task(void *__restrict userdata,
+                                         const int chunk_index,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ReconstructTaskData *data = userdata;
+  const int start = chunk_index * RECONSTRUCT_BLOCKS_PER_TASK;
+  const int blocks = min_ii(RECONSTRUCT_BLOCKS_PER_TASK, data->blocks - start);
+  DNA_struct_reconstruct_into(data->reconstruct_info,
+                              data->old_struct_nr,
+                              blocks,
+                              data->old_blocks + (size_t)start * data->old_block_size,
+                              data->new_blocks + (size_t)start * data->new_block_size);
+}
+
+/**
+ * Convert a block from the files DNA to the current DNA,
+ * large arrays (mesh data for example) are split into chunks which are converted in parallel.
+ */
+static void *read_struct_reconstruct(FileData *fd, BHead *bh)
+{
+  if (bh->nr <= RECONSTRUCT_BLOCKS_PER_TASK) {
+    return DNA_struct_reconstruct(fd->reconstruct_info, bh->SDNAnr, bh->nr, (bh + 1));
+  }
+
+  const int new_block_size = DNA_struct_reconstruct_size(fd->reconstruct_info, bh->SDNAnr);
+  if (new_block_size == 0) {
+    return NULL;
+  }
+
+  ReconstructTaskData data = {
+      .reconstruct_info = fd->reconstruct_info,
+      .old_struct_nr = bh->SDNAnr,
+      .blocks = bh->nr,
+      .old_blocks = (const char *)(bh + 1),
+      .old_block_size = fd->filesdna->types_size[fd->filesdna->structs[bh->SDNAnr]->type],
+      .new_blocks = MEM_calloc_arrayN((size_t)bh->nr, (size_t)new_block_size, "reconstruct"),
+      .new_block_size = new_block_size,
+  };
+
+  const int chunks = divide_ceil_u(bh->nr, RECONSTRUCT_BLOCKS_PER_TASK);
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, chunks, &data, read_struct_reconstruct_task, &settings);
+
+  return data.new_blocks;
+}
+
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 {
   void *temp = NULL;
@@ -1895,7 +2028,7 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
           }
         }
 #endif
-        temp = DNA_struct_reconstruct(fd->reconstruct_info, bh->SDNAnr, bh->nr, (bh + 1));
+        temp = read_struct_reconstruct(fd, bh);
       }
       else {
         /* SDNA_CMP_EQUAL */
@@ -53,6 +53,8 @@ enum eFileDataFlag {
   FD_FLAGS_IS_MEMFILE = 1 << 4,
   /* XXX Unused in practice (checked once but never set). */
   FD_FLAGS_NOT_MY_LIBMAP = 1 << 5,
+  /** The file is read through a memory-mapped #FileReader, so random access is cheap. */
+  FD_FLAGS_IS_MMAP = 1 << 6,
 };
 
 /* Disallow since it's 32bit on ms-windows. */
@@ -42,6 +42,7 @@
 
 #include "BLI_blenlib.h"
 #include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
 
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
@@ -60,7 +61,7 @@ void BLO_memfile_free(MemFile *memfile)
   MemFileChunk *chunk;
 
   while ((chunk = BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
+    if (chunk->is_shared == false) {
       MEM_freeN((void *)chunk->buf);
     }
     MEM_freeN(chunk);
@@ -75,22 +76,26 @@ void BLO_memfile_merge(MemFile *first, MemFile *second)
   GHash *buffer_to_second_memchunk = BLI_ghash_new(
       BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, __func__);
 
-  /* First, detect all memchunks in second memfile that are not owned by it. */
+  /* First, detect all memchunks in second memfile that are not owned by it.
+   * Several chunks may share the same buffer, only the first one takes the ownership. */
   for (MemFileChunk *sc = second->chunks.first; sc != NULL; sc = sc->next) {
-    if (sc->is_identical) {
-      BLI_ghash_insert(buffer_to_second_memchunk, (void *)sc->buf, sc);
+    if (sc->is_shared) {
+      void **entry;
+      if (!BLI_ghash_ensure_p(buffer_to_second_memchunk, (void *)sc->buf, &entry)) {
+        *entry = sc;
+      }
     }
   }
 
   /* Now, check all chunks from first memfile (the one we are removing), and if a memchunk owned by
    * it is also used by the second memfile, transfer the ownership. */
   for (MemFileChunk *fc = first->chunks.first; fc != NULL; fc = fc->next) {
-    if (!fc->is_identical) {
+    if (!fc->is_shared) {
       MemFileChunk *sc = BLI_ghash_lookup(buffer_to_second_memchunk, fc->buf);
       if (sc != NULL) {
-        BLI_assert(sc->is_identical);
-        sc->is_identical = false;
-        fc->is_identical = true;
+        BLI_assert(sc->is_shared);
+        sc->is_shared = false;
+        fc->is_shared = true;
       }
       /* Note that if the second memfile does not use that chunk, we assume that the first one
        * fully owns it without sharing it with any other memfile, and hence it should be freed with
@@ -110,6 +115,35 @@ void BLO_memfile_clear_future(MemFile *memfile)
   }
 }
 
+static uint memfile_chunk_hash(const char *buf, size_t size)
+{
+  return BLI_hash_mm2((const uchar *)buf, size, 0);
+}
+
+static void memfile_chunk_content_add(MemFileWriteData *mem_data, MemFileChunk *mem_chunk)
+{
+  /* On hash collisions the first chunk is kept, chunks with the same content share one
+   * buffer, so it doesn't matter which of them is referenced. */
+  void **entry;
+  if (!BLI_ghash_ensure_p(
+          mem_data->content_hash_mapping, POINTER_FROM_UINT(mem_chunk->hash), &entry)) {
+    *entry = mem_chunk;
+  }
+}
+
+static MemFileChunk *memfile_chunk_content_find(MemFileWriteData *mem_data,
+                                                const char *buf,
+                                                size_t size,
+                                                uint hash)
+{
+  MemFileChunk *mem_chunk = BLI_ghash_lookup(mem_data->content_hash_mapping,
+                                             POINTER_FROM_UINT(hash));
+  if (mem_chunk != NULL && mem_chunk->size == size && memcmp(mem_chunk->buf, buf, size) == 0) {
+    return mem_chunk;
+  }
+  return NULL;
+}
+
 void BLO_memfile_write_init(MemFileWriteData *mem_data,
                             MemFile *written_memfile,
                             MemFile *reference_memfile)
@@ -142,6 +176,16 @@ void BLO_memfile_write_init(MemFileWriteData *mem_data,
       }
     }
   }
+
+  /* Chunks are also looked up by their content, so identical data is stored only once, even when
+   * it moved compared to the previous step (e.g. after inserting data in front of it). */
+  mem_data->content_hash_mapping = BLI_ghash_new(
+      BLI_ghashutil_inthash_p_simple, BLI_ghashutil_intcmp, __func__);
+  if (reference_memfile != NULL) {
+    LISTBASE_FOREACH (MemFileChunk *, mem_chunk, &reference_memfile->chunks) {
+      memfile_chunk_content_add(mem_data, mem_chunk);
+    }
+  }
 }
 
 void BLO_memfile_write_finalize(MemFileWriteData *mem_data)
@@ -149,6 +193,9 @@ void BLO_memfile_write_finalize(MemFileWriteData *mem_data)
   if (mem_data->id_session_uuid_mapping != NULL) {
     BLI_ghash_free(mem_data->id_session_uuid_mapping, NULL, NULL);
   }
+  if (mem_data->content_hash_mapping != NULL) {
+    BLI_ghash_free(mem_data->content_hash_mapping, NULL, NULL);
+  }
 }
 
 void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t size)
@@ -160,6 +207,7 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   curchunk->size = size;
   curchunk->buf = NULL;
   curchunk->is_identical = false;
+  curchunk->is_shared = false;
   /* This is unsafe in the sense that an app handler or other code that does not
    * perform an undo push may make changes after the last undo push that
    * will then not be undo. Though it's not entirely clear that is wrong behavior. */
@@ -173,22 +221,69 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
     if (compchunk->size == curchunk->size) {
       if (memcmp(compchunk->buf, buf, size) == 0) {
         curchunk->buf = compchunk->buf;
+        curchunk->hash = compchunk->hash;
         curchunk->is_identical = true;
+        curchunk->is_shared = true;
         compchunk->is_identical_future = true;
       }
     }
     *compchunk_step = compchunk->next;
   }
 
+  if (curchunk->buf == NULL) {
+    curchunk->hash = memfile_chunk_hash(buf, size);
+
+    /* Not equal to the matching chunk, but the same content may exist elsewhere.
+     * The chunk is not considered identical, since the data it belongs to did change. */
+    MemFileChunk *contentchunk = memfile_chunk_content_find(mem_data, buf, size, curchunk->hash);
+    if (contentchunk != NULL) {
+      curchunk->buf = contentchunk->buf;
+      curchunk->is_shared = true;
+    }
+  }
+
   /* not equal... */
   if (curchunk->buf == NULL) {
     char *buf_new = MEM_mallocN(size, "Chunk buffer");
     memcpy(buf_new, buf, size);
     curchunk->buf = buf_new;
     memfile->size += size;
+    memfile_chunk_content_add(mem_data, curchunk);
   }
 }
 
+bool BLO_memfile_chunks_reuse_id(MemFileWriteData *mem_data, uint id_session_uuid)
+{
+  if (mem_data->id_session_uuid_mapping == NULL) {
+    return false;
+  }
+  MemFileChunk *refchunk = BLI_ghash_lookup(mem_data->id_session_uuid_mapping,
+                                            POINTER_FROM_UINT(id_session_uuid));
+  if (refchunk == NULL) {
+    return false;
+  }
+
+  MemFile *memfile = mem_data->written_memfile;
+  /* All chunks of an ID are contiguous, since the write buffer is flushed after each ID. */
+  for (; refchunk != NULL && refchunk->id_session_uuid == id_session_uuid;
+       refchunk = refchunk->next) {
+    MemFileChunk *curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
+    curchunk->buf = refchunk->buf;
+    curchunk->size = refchunk->size;
+    curchunk->hash = refchunk->hash;
+    curchunk->is_identical = true;
+    curchunk->is_shared = true;
+    curchunk->is_identical_future = true;
+    curchunk->id_session_uuid = id_session_uuid;
+    BLI_addtail(&memfile->chunks, curchunk);
+
+    refchunk->is_identical_future = true;
+  }
+  mem_data->reference_current_chunk = refchunk;
+
+  return true;
+}
+
 struct Main *BLO_memfile_main_get(struct MemFile *memfile,
                                   struct Main *bmain,
                                   struct Scene **r_scene)
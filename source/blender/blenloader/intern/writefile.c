@@ -95,6 +95,7 @@
 #include "DNA_collection_types.h"
 #include "DNA_fileglobal_types.h"
 #include "DNA_genfile.h"
+#include "DNA_object_types.h"
 #include "DNA_sdna_types.h"
 
 #include "BLI_bitmap.h"
@@ -105,6 +106,7 @@
 #include "BLI_linklist.h"
 #include "BLI_math_base.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "MEM_guardedalloc.h" /* MEM_freeN */
 
@@ -149,6 +151,12 @@
 
 #define ZSTD_COMPRESSION_LEVEL 3
 
+/**
+ * Maximum number of frames per thread that are queued for compression or waiting to be written.
+ * Keeps memory usage bounded when serializing is faster than compressing or writing.
+ */
+#define ZSTD_FRAMES_PENDING_PER_THREAD 2
+
 /** Use if we want to store how many bytes have been written to the file. */
 // #define USE_WRITE_DATA_LEN
 
@@ -184,12 +192,19 @@ struct WriteWrap {
   /* internal */
   int file_handle;
   struct {
-    ListBase threadpool;
+    TaskPool *task_pool;
+    /** Frames being compressed or waiting to be written, in file order (#ZstdWriteBlockTask). */
     ListBase tasks;
+    /** Protects `tasks`, `contexts`, `num_frames_pending` and `is_writing`. */
     ThreadMutex mutex;
+    /** Notified when frames have been written. */
     ThreadCondition condition;
-    int next_frame;
-    int num_frames;
+    int num_frames_pending;
+    int max_frames_pending;
+    /** Set while a thread writes finished frames, others leave their frames to that thread. */
+    bool is_writing;
+    /** Compression contexts that are not in use, reused between frames. */
+    LinkNode *contexts;
 
     int level;
     ListBase frames;
@@ -248,54 +263,97 @@ static size_t ww_write_callback(WriteWrap *ww, const char *buf, size_t buf_len)
 
 /* zstd */
 
-typedef struct {
+typedef struct ZstdWriteBlockTask {
   struct ZstdWriteBlockTask *next, *prev;
+  /** Uncompressed data, replaced by the compressed data once `is_done` is set. */
   void *data;
   size_t size;
-  int frame_number;
-  WriteWrap *ww;
+  size_t compressed_size;
+  bool is_done;
+  bool is_error;
 } ZstdWriteBlockTask;
 
-static void *zstd_write_task(void *userdata)
+static ZSTD_CCtx *zstd_context_acquire(WriteWrap *ww)
 {
-  ZstdWriteBlockTask *task = userdata;
-  WriteWrap *ww = task->ww;
-
-  size_t out_buf_len = ZSTD_compressBound(task->size);
-  void *out_buf = MEM_mallocN(out_buf_len, "Zstd out buffer");
-  size_t out_size = ZSTD_compress(
-      out_buf, out_buf_len, task->data, task->size, ZSTD_COMPRESSION_LEVEL);
+  BLI_mutex_lock(&ww->zstd.mutex);
+  ZSTD_CCtx *ctx = BLI_linklist_pop(&ww->zstd.contexts);
+  BLI_mutex_unlock(&ww->zstd.mutex);
 
-  MEM_freeN(task->data);
+  return ctx ? ctx : ZSTD_createCCtx();
+}
 
+static void zstd_context_release(WriteWrap *ww, ZSTD_CCtx *ctx)
+{
   BLI_mutex_lock(&ww->zstd.mutex);
+  BLI_linklist_prepend(&ww->zstd.contexts, ctx);
+  BLI_mutex_unlock(&ww->zstd.mutex);
+}
 
-  while (ww->zstd.next_frame != task->frame_number) {
-    BLI_condition_wait(&ww->zstd.condition, &ww->zstd.mutex);
+/**
+ * Write all frames at the start of the task list that finished compressing.
+ * Must be called with the mutex locked, which is temporarily released during writing.
+ *
+ * Only one thread writes at a time. A thread that finishes a frame while another one is writing
+ * doesn't wait, the writing thread picks up the frame before it stops.
+ */
+static void zstd_write_finished_frames(WriteWrap *ww)
+{
+  if (ww->zstd.is_writing) {
+    return;
   }
+  ww->zstd.is_writing = true;
 
-  if (ZSTD_isError(out_size)) {
-    ww->zstd.write_error = true;
-  }
-  else {
-    if (ww_write_none(ww, out_buf, out_size) == out_size) {
+  ZstdWriteBlockTask *task;
+  while ((task = ww->zstd.tasks.first) && task->is_done) {
+    BLI_remlink(&ww->zstd.tasks, task);
+    BLI_mutex_unlock(&ww->zstd.mutex);
+
+    /* `frames` and `write_error` are only modified by the writing thread. */
+    if (task->is_error || ww->zstd.write_error) {
+      ww->zstd.write_error = true;
+    }
+    else if (ww_write_none(ww, task->data, task->compressed_size) == task->compressed_size) {
       ZstdFrame *frameinfo = MEM_mallocN(sizeof(ZstdFrame), "zstd frameinfo");
       frameinfo->uncompressed_size = task->size;
-      frameinfo->compressed_size = out_size;
+      frameinfo->compressed_size = task->compressed_size;
       BLI_addtail(&ww->zstd.frames, frameinfo);
     }
     else {
       ww->zstd.write_error = true;
     }
+
+    MEM_SAFE_FREE(task->data);
+    MEM_freeN(task);
+
+    BLI_mutex_lock(&ww->zstd.mutex);
+    ww->zstd.num_frames_pending--;
+    BLI_condition_notify_all(&ww->zstd.condition);
   }
 
-  ww->zstd.next_frame++;
+  ww->zstd.is_writing = false;
+}
 
-  BLI_mutex_unlock(&ww->zstd.mutex);
-  BLI_condition_notify_all(&ww->zstd.condition);
+static void zstd_write_task(TaskPool *__restrict pool, void *taskdata)
+{
+  ZstdWriteBlockTask *task = taskdata;
+  WriteWrap *ww = BLI_task_pool_user_data(pool);
 
-  MEM_freeN(out_buf);
-  return NULL;
+  ZSTD_CCtx *ctx = zstd_context_acquire(ww);
+  size_t out_buf_len = ZSTD_compressBound(task->size);
+  void *out_buf = MEM_mallocN(out_buf_len, "Zstd out buffer");
+  size_t out_size = ZSTD_compressCCtx(
+      ctx, out_buf, out_buf_len, task->data, task->size, ww->zstd.level);
+  zstd_context_release(ww, ctx);
+
+  MEM_freeN(task->data);
+  task->data = out_buf;
+
+  BLI_mutex_lock(&ww->zstd.mutex);
+  task->is_error = ZSTD_isError(out_size);
+  task->compressed_size = task->is_error ? 0 : out_size;
+  task->is_done = true;
+  zstd_write_finished_frames(ww);
+  BLI_mutex_unlock(&ww->zstd.mutex);
 }
 
 static bool ww_open_zstd(WriteWrap *ww, const char *filepath)
@@ -304,9 +362,12 @@ static bool ww_open_zstd(WriteWrap *ww, const char *filepath)
     return false;
   }
 
-  /* Leave one thread open for the main writing logic, unless we only have one HW thread. */
-  int num_threads = max_ii(1, BLI_system_thread_count() - 1);
-  BLI_threadpool_init(&ww->zstd.threadpool, zstd_write_task, num_threads);
+  /* Frames are compressed on the task scheduler while the main thread keeps serializing,
+   * the background pool ensures they run even when there are no worker threads. */
+  ww->zstd.task_pool = BLI_task_pool_create_background(ww, TASK_PRIORITY_HIGH);
+  ww->zstd.max_frames_pending = max_ii(1, BLI_system_thread_count()) *
+                                ZSTD_FRAMES_PENDING_PER_THREAD;
+  ww->zstd.level = ZSTD_COMPRESSION_LEVEL;
   BLI_mutex_init(&ww->zstd.mutex);
   BLI_condition_init(&ww->zstd.condition);
 
@@ -334,7 +395,7 @@ static void zstd_write_seekable_frames(WriteWrap *ww)
   /* Write seek table header (magic number and frame size). */
   zstd_write_u32_le(ww, 0x184D2A5E);
 
-  /* The actual frame number might not match ww->zstd.num_frames if there was a write error. */
+  /* Frames that failed to compress or write are not in the list, but then the file is invalid. */
   const uint32_t num_frames = BLI_listbase_count(&ww->zstd.frames);
   /* Each frame consists of two u32, so 8 bytes each.
    * After the frames, a footer containing two u32 and one byte (9 bytes total) is written. */
@@ -356,9 +417,11 @@ static void zstd_write_seekable_frames(WriteWrap *ww)
 
 static bool ww_close_zstd(WriteWrap *ww)
 {
-  BLI_threadpool_end(&ww->zstd.threadpool);
-  BLI_freelistN(&ww->zstd.tasks);
+  BLI_task_pool_work_and_wait(ww->zstd.task_pool);
+  BLI_task_pool_free(ww->zstd.task_pool);
+  BLI_assert(BLI_listbase_is_empty(&ww->zstd.tasks));
 
+  BLI_linklist_free(ww->zstd.contexts, (LinkNodeFreeFP)ZSTD_freeCCtx);
   BLI_mutex_end(&ww->zstd.mutex);
   BLI_condition_end(&ww->zstd.condition);
 
@@ -374,32 +437,21 @@ static size_t ww_write_zstd(WriteWrap *ww, const char *buf, size_t buf_len)
     return 0;
   }
 
-  ZstdWriteBlockTask *task = MEM_mallocN(sizeof(ZstdWriteBlockTask), __func__);
+  ZstdWriteBlockTask *task = MEM_callocN(sizeof(ZstdWriteBlockTask), __func__);
   task->data = MEM_mallocN(buf_len, __func__);
   memcpy(task->data, buf, buf_len);
   task->size = buf_len;
-  task->frame_number = ww->zstd.num_frames++;
-  task->ww = ww;
 
   BLI_mutex_lock(&ww->zstd.mutex);
+  /* Wait for earlier frames to be written when too many are in flight. */
+  while (ww->zstd.num_frames_pending >= ww->zstd.max_frames_pending) {
+    BLI_condition_wait(&ww->zstd.condition, &ww->zstd.mutex);
+  }
   BLI_addtail(&ww->zstd.tasks, task);
-
-  /* If there's a free worker thread, just push the block into that thread.
-   * Otherwise, we wait for the earliest thread to finish.
-   * We look up the earliest thread while holding the mutex, but release it
-   * before joining the thread to prevent a deadlock. */
-  ZstdWriteBlockTask *first_task = ww->zstd.tasks.first;
+  ww->zstd.num_frames_pending++;
   BLI_mutex_unlock(&ww->zstd.mutex);
-  if (!BLI_available_threads(&ww->zstd.threadpool)) {
-    BLI_threadpool_remove(&ww->zstd.threadpool, first_task);
 
-    /* If the task list was empty before we pushed our task, there should
-     * always be a free thread. */
-    BLI_assert(first_task != task);
-    BLI_remlink(&ww->zstd.tasks, first_task);
-    MEM_freeN(first_task);
-  }
-  BLI_threadpool_insert(&ww->zstd.threadpool, task);
+  BLI_task_pool_push(ww->zstd.task_pool, zstd_write_task, task, false, NULL);
 
   return buf_len;
 }
@@ -1121,6 +1173,34 @@ static void write_thumb(WriteData *wd, const BlendThumbnail *thumb)
 /** \name File Writing (Private)
  * \{ */
 
+/**
+ * Whether an ID did not change since the previous undo push, so its chunks of the previous
+ * memfile can be used instead of writing it again, see #BLO_memfile_chunks_reuse_id.
+ *
+ * Changes are detected from the depsgraph update tags accumulated in
+ * #ID.recalc_after_undo_push, which must be called before they are cleared for the next push.
+ * ID types whose edits are not reliably tagged are always written.
+ */
+static bool write_undo_id_is_unchanged(const ID *id)
+{
+  const ID_Type id_type = GS(id->name);
+  if (!ID_TYPE_IS_COW(id_type) || ELEM(id_type, ID_SCE, ID_TXT)) {
+    return false;
+  }
+  /* Pose channels point to bones of the armature, which may be re-allocated. */
+  if (id_type == ID_OB && ((const Object *)id)->type == OB_ARMATURE) {
+    return false;
+  }
+  if (id->recalc_after_undo_push != 0) {
+    return false;
+  }
+  const bNodeTree *nodetree = ntreeFromID((ID *)id);
+  if (nodetree != NULL && nodetree->id.recalc_after_undo_push != 0) {
+    return false;
+  }
+  return true;
+}
+
 /* if MemFile * there's filesave to memory */
 static bool write_file_handle(Main *mainvar,
                               WriteWrap *ww,
@@ -1160,6 +1240,12 @@ static bool write_file_handle(Main *mainvar,
                                                  NULL :
                                                  BKE_lib_override_library_operations_store_init();
 
+  /* Reuse the previous undo step's data of IDs that did not change since then. Only valid when
+   * all IDs were written in that step, and Main was not re-read from another one since. */
+  const bool use_undo_id_reuse = wd->use_memfile && compare != NULL &&
+                                 mainvar->is_memfile_undo_written &&
+                                 USER_EXPERIMENTAL_TEST(&U, use_undo_incremental_write);
+
 #define ID_BUFFER_STATIC_SIZE 8192
   /* This outer loop allows to save first data-blocks from real mainvar,
    * then the temp ones from override process,
@@ -1204,6 +1290,8 @@ static bool write_file_handle(Main *mainvar,
           BKE_lib_override_library_operations_store_start(bmain, override_storage, id);
         }
 
+        const bool is_undo_id_unchanged = use_undo_id_reuse && write_undo_id_is_unchanged(id);
+
         if (wd->use_memfile) {
           /* Record the changes that happened up to this undo push in
            * recalc_up_to_undo_push, and clear recalc_after_undo_push again
@@ -1228,6 +1316,14 @@ static bool write_file_handle(Main *mainvar,
 
         mywrite_id_begin(wd, id);
 
+        if (is_undo_id_unchanged) {
+          BLI_assert(wd->buffer.used_len == 0);
+          if (BLO_memfile_chunks_reuse_id(&wd->mem, id->session_uuid)) {
+            mywrite_id_end(wd, id);
+            continue;
+          }
+        }
+
         memcpy(id_buffer, id, idtype_struct_size);
 
         /* Clear runtime data to reduce false detection of changed data in undo/redo context. */
@@ -992,6 +992,114 @@ void BM_elem_float_data_set(CustomData *cd, void *element, int type, const float
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Layer Arrays
+ * \{ */
+
+typedef struct BMDataLayerArrayData {
+  int cd_offset;
+  size_t elem_size;
+  /** Copy into this array when set. */
+  char *array_dst;
+  /** Copy from this array when set. */
+  const char *array_src;
+} BMDataLayerArrayData;
+
+BLI_INLINE void bm_data_layer_array_elem_copy(const BMDataLayerArrayData *data, BMElem *ele)
+{
+  void *elem_data = BM_ELEM_CD_GET_VOID_P(ele, data->cd_offset);
+  const size_t offset = (size_t)BM_elem_index_get(ele) * data->elem_size;
+  if (data->array_dst) {
+    memcpy(data->array_dst + offset, elem_data, data->elem_size);
+  }
+  else {
+    memcpy(elem_data, data->array_src + offset, data->elem_size);
+  }
+}
+
+static void bm_data_layer_array_elem_fn(void *userdata,
+                                        MempoolIterData *iter,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  bm_data_layer_array_elem_copy(userdata, (BMElem *)iter);
+}
+
+static void bm_data_layer_array_face_loops_fn(void *userdata,
+                                              MempoolIterData *iter,
+                                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BMFace *f = (BMFace *)iter;
+  BMLoop *l_iter, *l_first;
+  l_iter = l_first = BM_FACE_FIRST_LOOP(f);
+  do {
+    bm_data_layer_array_elem_copy(userdata, (BMElem *)l_iter);
+  } while ((l_iter = l_iter->next) != l_first);
+}
+
+/**
+ * Copy between the layer and either `array_dst` or `array_src`, the other one is null.
+ */
+static void bm_data_layer_array_copy(
+    BMesh *bm, CustomData *data, int type, int n, void *array_dst, const void *array_src)
+{
+  BLI_assert((array_dst == NULL) != (array_src == NULL));
+  BMDataLayerArrayData userdata = {
+      .cd_offset = CustomData_get_n_offset(data, type, n),
+      .elem_size = (size_t)CustomData_sizeof(type),
+      .array_dst = array_dst,
+      .array_src = array_src,
+  };
+  BLI_assert(userdata.cd_offset != -1);
+
+  char htype, iter_type;
+  int elem_len;
+  if (&bm->vdata == data) {
+    htype = BM_VERT;
+    iter_type = BM_VERTS_OF_MESH;
+    elem_len = bm->totvert;
+  }
+  else if (&bm->edata == data) {
+    htype = BM_EDGE;
+    iter_type = BM_EDGES_OF_MESH;
+    elem_len = bm->totedge;
+  }
+  else if (&bm->pdata == data) {
+    htype = BM_FACE;
+    iter_type = BM_FACES_OF_MESH;
+    elem_len = bm->totface;
+  }
+  else {
+    BLI_assert(&bm->ldata == data);
+    htype = BM_LOOP;
+    iter_type = BM_FACES_OF_MESH;
+    elem_len = bm->totloop;
+  }
+
+  BM_mesh_elem_index_ensure(bm, htype);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = elem_len >= BM_OMP_LIMIT;
+  BM_iter_parallel(bm,
+                   iter_type,
+                   (htype == BM_LOOP) ? bm_data_layer_array_face_loops_fn :
+                                        bm_data_layer_array_elem_fn,
+                   &userdata,
+                   &settings);
+}
+
+void BM_data_layer_array_get(BMesh *bm, CustomData *data, int type, int n, void *r_array)
+{
+  bm_data_layer_array_copy(bm, data, type, n, r_array, NULL);
+}
+
+void BM_data_layer_array_set(BMesh *bm, CustomData *data, int type, int n, const void *array)
+{
+  bm_data_layer_array_copy(bm, data, type, n, NULL, array);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Loop interpolation functions: BM_vert_loop_groups_data_layer_***
  *
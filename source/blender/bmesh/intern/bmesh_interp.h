@@ -76,6 +76,23 @@ void BM_data_layer_free(BMesh *bm, CustomData *data, int type);
 void BM_data_layer_free_n(BMesh *bm, CustomData *data, int type, int n);
 void BM_data_layer_copy(BMesh *bm, CustomData *data, int type, int src_n, int dst_n);
 
+/**
+ * Copy the values of a custom-data layer of all elements into a contiguous array,
+ * ordered by element index. Operators that process one layer of the whole mesh can work on
+ * the array instead of reading every element's custom-data block.
+ *
+ * \param data: One of the #BMesh custom-data, to choose the element type.
+ * \param r_array: An array with a value for every element of the type, see #CustomData_sizeof.
+ *
+ * \note This is a shallow copy, which remains valid until elements are added or removed.
+ * Element indices are ensured, so #BM_elem_index_get can be used to access the values.
+ */
+void BM_data_layer_array_get(BMesh *bm, CustomData *data, int type, int n, void *r_array);
+/**
+ * Write values from an array filled by #BM_data_layer_array_get back into the elements.
+ */
+void BM_data_layer_array_set(BMesh *bm, CustomData *data, int type, int n, const void *array);
+
 float BM_elem_float_data_get(CustomData *cd, void *element, int type);
 void BM_elem_float_data_set(CustomData *cd, void *element, int type, float val);
 
@@ -97,6 +97,7 @@
 #include "BLI_listbase.h"
 #include "BLI_math_vector.h"
 #include "BLI_span.hh"
+#include "BLI_task.hh"
 
 #include "BKE_customdata.h"
 #include "BKE_mesh.h"
@@ -369,44 +370,17 @@ void BM_mesh_bm_from_me(BMesh *bm, const Mesh *me, const struct BMeshFromMeshPar
                                            CustomData_get_offset(&bm->vdata, CD_SHAPE_KEYINDEX) :
                                            -1;
 
+  /* Elements are created on a single thread, since that changes the connectivity of elements
+   * created before them and the memory pools aren't thread-safe. All other data is filled
+   * in parallel afterwards, the custom-data blocks are allocated here to make that possible. */
+
   Span<MVert> mvert{me->mvert, me->totvert};
   Array<BMVert *> vtable(me->totvert);
   for (const int i : mvert.index_range()) {
     BMVert *v = vtable[i] = BM_vert_create(
         bm, keyco ? keyco[i] : mvert[i].co, nullptr, BM_CREATE_SKIP_CD);
     BM_elem_index_set(v, i); /* set_ok */
-
-    /* Transfer flag. */
-    v->head.hflag = BM_vert_flag_from_mflag(mvert[i].flag & ~SELECT);
-
-    /* This is necessary for selection counts to work properly. */
-    if (mvert[i].flag & SELECT) {
-      BM_vert_select_set(bm, v, true);
-    }
-
-    if (vert_normals) {
-      copy_v3_v3(v->no, vert_normals[i]);
-    }
-
-    /* Copy Custom Data */
-    CustomData_to_bmesh_block(&me->vdata, &bm->vdata, i, &v->head.data, true);
-
-    if (cd_vert_bweight_offset != -1) {
-      BM_ELEM_CD_SET_FLOAT(v, cd_vert_bweight_offset, (float)mvert[i].bweight / 255.0f);
-    }
-
-    /* Set shape key original index. */
-    if (cd_shape_keyindex_offset != -1) {
-      BM_ELEM_CD_SET_INT(v, cd_shape_keyindex_offset, i);
-    }
-
-    /* Set shape-key data. */
-    if (tot_shape_keys) {
-      float(*co_dst)[3] = (float(*)[3])BM_ELEM_CD_GET_VOID_P(v, cd_shape_key_offset);
-      for (int j = 0; j < tot_shape_keys; j++, co_dst++) {
-        copy_v3_v3(*co_dst, shape_key_table[j][i]);
-      }
-    }
+    CustomData_bmesh_alloc_block(&bm->vdata, &v->head.data);
   }
   if (is_new) {
     bm->elem_index_dirty &= ~BM_VERT; /* Added in order, clear dirty flag. */
@@ -418,24 +392,7 @@ void BM_mesh_bm_from_me(BMesh *bm, const Mesh *me, const struct BMeshFromMeshPar
     BMEdge *e = etable[i] = BM_edge_create(
         bm, vtable[medge[i].v1], vtable[medge[i].v2], nullptr, BM_CREATE_SKIP_CD);
     BM_elem_index_set(e, i); /* set_ok */
-
-    /* Transfer flags. */
-    e->head.hflag = BM_edge_flag_from_mflag(medge[i].flag & ~SELECT);
-
-    /* This is necessary for selection counts to work properly. */
-    if (medge[i].flag & SELECT) {
-      BM_edge_select_set(bm, e, true);
-    }
-
-    /* Copy Custom Data */
-    CustomData_to_bmesh_block(&me->edata, &bm->edata, i, &e->head.data, true);
-
-    if (cd_edge_bweight_offset != -1) {
-      BM_ELEM_CD_SET_FLOAT(e, cd_edge_bweight_offset, (float)medge[i].bweight / 255.0f);
-    }
-    if (cd_edge_crease_offset != -1) {
-      BM_ELEM_CD_SET_FLOAT(e, cd_edge_crease_offset, (float)medge[i].crease / 255.0f);
-    }
+    CustomData_bmesh_alloc_block(&bm->edata, &e->head.data);
   }
   if (is_new) {
     bm->elem_index_dirty &= ~BM_EDGE; /* Added in order, clear dirty flag. */
@@ -444,20 +401,11 @@ void BM_mesh_bm_from_me(BMesh *bm, const Mesh *me, const struct BMeshFromMeshPar
   Span<MPoly> mpoly{me->mpoly, me->totpoly};
   Span<MLoop> mloop{me->mloop, me->totloop};
 
-  /* Only needed for selection. */
-
-  Array<BMFace *> ftable;
-  if (me->mselect && me->totselect != 0) {
-    ftable.reinitialize(me->totpoly);
-  }
-
+  Array<BMFace *> ftable(me->totpoly);
   int totloops = 0;
   for (const int i : mpoly.index_range()) {
-    BMFace *f = bm_face_create_from_mpoly(
+    BMFace *f = ftable[i] = bm_face_create_from_mpoly(
         *bm, mloop.slice(mpoly[i].loopstart, mpoly[i].totloop), vtable, etable);
-    if (!ftable.is_empty()) {
-      ftable[i] = f;
-    }
 
     if (UNLIKELY(f == nullptr)) {
       printf(
@@ -471,42 +419,121 @@ void BM_mesh_bm_from_me(BMesh *bm, const Mesh *me, const struct BMeshFromMeshPar
 
     /* Don't use 'i' since we may have skipped the face. */
     BM_elem_index_set(f, bm->totface - 1); /* set_ok */
+    CustomData_bmesh_alloc_block(&bm->pdata, &f->head.data);
 
-    /* Transfer flag. */
-    f->head.hflag = BM_face_flag_from_mflag(mpoly[i].flag & ~ME_FACE_SEL);
-
-    /* This is necessary for selection counts to work properly. */
-    if (mpoly[i].flag & ME_FACE_SEL) {
-      BM_face_select_set(bm, f, true);
-    }
-
-    f->mat_nr = mpoly[i].mat_nr;
-    if (i == me->act_face) {
-      bm->act_face = f;
-    }
-
-    int j = mpoly[i].loopstart;
     BMLoop *l_first = BM_FACE_FIRST_LOOP(f);
     BMLoop *l_iter = l_first;
     do {
-      /* Don't use 'j' since we may have skipped some faces, hence some loops. */
+      /* Don't use the #MLoop index since we may have skipped some faces, hence some loops. */
       BM_elem_index_set(l_iter, totloops++); /* set_ok */
-
-      /* Save index of corresponding #MLoop. */
-      CustomData_to_bmesh_block(&me->ldata, &bm->ldata, j++, &l_iter->head.data, true);
+      CustomData_bmesh_alloc_block(&bm->ldata, &l_iter->head.data);
     } while ((l_iter = l_iter->next) != l_first);
 
-    /* Copy Custom Data */
-    CustomData_to_bmesh_block(&me->pdata, &bm->pdata, i, &f->head.data, true);
-
-    if (params->calc_face_normal) {
-      BM_face_normal_update(f);
+    if (i == me->act_face) {
+      bm->act_face = f;
     }
   }
   if (is_new) {
     bm->elem_index_dirty &= ~(BM_FACE | BM_LOOP); /* Added in order, clear dirty flag. */
   }
 
+  blender::threading::parallel_for(mvert.index_range(), 1024, [&](const IndexRange range) {
+    for (const int i : range) {
+      BMVert *v = vtable[i];
+
+      /* Transfer flag. */
+      v->head.hflag = BM_vert_flag_from_mflag(mvert[i].flag & ~SELECT);
+
+      if (vert_normals) {
+        copy_v3_v3(v->no, vert_normals[i]);
+      }
+
+      /* Copy Custom Data */
+      CustomData_to_bmesh_block(&me->vdata, &bm->vdata, i, &v->head.data, true);
+
+      if (cd_vert_bweight_offset != -1) {
+        BM_ELEM_CD_SET_FLOAT(v, cd_vert_bweight_offset, (float)mvert[i].bweight / 255.0f);
+      }
+
+      /* Set shape key original index. */
+      if (cd_shape_keyindex_offset != -1) {
+        BM_ELEM_CD_SET_INT(v, cd_shape_keyindex_offset, i);
+      }
+
+      /* Set shape-key data. */
+      if (tot_shape_keys) {
+        float(*co_dst)[3] = (float(*)[3])BM_ELEM_CD_GET_VOID_P(v, cd_shape_key_offset);
+        for (int j = 0; j < tot_shape_keys; j++, co_dst++) {
+          copy_v3_v3(*co_dst, shape_key_table[j][i]);
+        }
+      }
+    }
+  });
+
+  blender::threading::parallel_for(medge.index_range(), 1024, [&](const IndexRange range) {
+    for (const int i : range) {
+      BMEdge *e = etable[i];
+
+      /* Transfer flags. */
+      e->head.hflag = BM_edge_flag_from_mflag(medge[i].flag & ~SELECT);
+
+      /* Copy Custom Data */
+      CustomData_to_bmesh_block(&me->edata, &bm->edata, i, &e->head.data, true);
+
+      if (cd_edge_bweight_offset != -1) {
+        BM_ELEM_CD_SET_FLOAT(e, cd_edge_bweight_offset, (float)medge[i].bweight / 255.0f);
+      }
+      if (cd_edge_crease_offset != -1) {
+        BM_ELEM_CD_SET_FLOAT(e, cd_edge_crease_offset, (float)medge[i].crease / 255.0f);
+      }
+    }
+  });
+
+  blender::threading::parallel_for(mpoly.index_range(), 1024, [&](const IndexRange range) {
+    for (const int i : range) {
+      BMFace *f = ftable[i];
+      if (f == nullptr) {
+        continue;
+      }
+
+      /* Transfer flag. */
+      f->head.hflag = BM_face_flag_from_mflag(mpoly[i].flag & ~ME_FACE_SEL);
+      f->mat_nr = mpoly[i].mat_nr;
+
+      int j = mpoly[i].loopstart;
+      BMLoop *l_first = BM_FACE_FIRST_LOOP(f);
+      BMLoop *l_iter = l_first;
+      do {
+        CustomData_to_bmesh_block(&me->ldata, &bm->ldata, j++, &l_iter->head.data, true);
+      } while ((l_iter = l_iter->next) != l_first);
+
+      /* Copy Custom Data */
+      CustomData_to_bmesh_block(&me->pdata, &bm->pdata, i, &f->head.data, true);
+
+      if (params->calc_face_normal) {
+        BM_face_normal_update(f);
+      }
+    }
+  });
+
+  /* This is necessary for selection counts to work properly. Selecting faces also selects their
+   * vertices and edges, so this is done after all flags are set. */
+  for (const int i : mvert.index_range()) {
+    if (mvert[i].flag & SELECT) {
+      BM_vert_select_set(bm, vtable[i], true);
+    }
+  }
+  for (const int i : medge.index_range()) {
+    if (medge[i].flag & SELECT) {
+      BM_edge_select_set(bm, etable[i], true);
+    }
+  }
+  for (const int i : mpoly.index_range()) {
+    if ((mpoly[i].flag & ME_FACE_SEL) && ftable[i] != nullptr) {
+      BM_face_select_set(bm, ftable[i], true);
+    }
+  }
+
   /* -------------------------------------------------------------------- */
   /* MSelect clears the array elements (to avoid adding multiple times).
    *
@@ -919,12 +946,30 @@ BLI_INLINE void bmesh_quick_edgedraw_flag(MEdge *med, BMEdge *e)
   }
 }
 
+/**
+ * Ensure the indices and lookup tables used to convert a #BMesh in parallel.
+ *
+ * \return The offset of each face's loops in the #Mesh loop array, with the total at the end.
+ */
+static Array<int> bm_to_mesh_prepare(BMesh *bm)
+{
+  BM_mesh_elem_index_ensure(bm, BM_VERT | BM_EDGE | BM_FACE | BM_LOOP);
+  BM_mesh_elem_table_ensure(bm, BM_VERT | BM_EDGE | BM_FACE);
+
+  Array<int> loop_offsets(bm->totface + 1);
+  int loop_offset = 0;
+  for (const int i : IndexRange(bm->totface)) {
+    loop_offsets[i] = loop_offset;
+    loop_offset += bm->ftable[i]->len;
+  }
+  loop_offsets.last() = loop_offset;
+  BLI_assert(loop_offset == bm->totloop);
+  return loop_offsets;
+}
+
 void BM_mesh_bm_to_me(Main *bmain, BMesh *bm, Mesh *me, const struct BMeshToMeshParams *params)
 {
-  MEdge *med;
-  BMVert *v, *eve;
-  BMEdge *e;
-  BMFace *f;
+  BMVert *eve;
   BMIter iter;
   int i, j;
 
@@ -984,90 +1029,90 @@ void BM_mesh_bm_to_me(Main *bmain, BMesh *bm, Mesh *me, const struct BMeshToMesh
   /* This is called again, 'dotess' arg is used there. */
   BKE_mesh_update_customdata_pointers(me, false);
 
-  i = 0;
-  BM_ITER_MESH (v, &iter, bm, BM_VERTS_OF_MESH) {
-    copy_v3_v3(mvert->co, v->co);
+  const Array<int> loop_offsets = bm_to_mesh_prepare(bm);
 
-    mvert->flag = BM_vert_flag_to_mflag(v);
+  blender::threading::parallel_for(IndexRange(bm->totvert), 1024, [&](const IndexRange range) {
+    for (const int vert_i : range) {
+      BMVert *v = bm->vtable[vert_i];
+      MVert *mv = &mvert[vert_i];
 
-    BM_elem_index_set(v, i); /* set_inline */
+      copy_v3_v3(mv->co, v->co);
 
-    /* Copy over custom-data. */
-    CustomData_from_bmesh_block(&bm->vdata, &me->vdata, v->head.data, i);
+      mv->flag = BM_vert_flag_to_mflag(v);
 
-    if (cd_vert_bweight_offset != -1) {
-      mvert->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(v, cd_vert_bweight_offset);
-    }
+      /* Copy over custom-data. */
+      CustomData_from_bmesh_block(&bm->vdata, &me->vdata, v->head.data, vert_i);
 
-    i++;
-    mvert++;
+      if (cd_vert_bweight_offset != -1) {
+        mv->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(v, cd_vert_bweight_offset);
+      }
 
-    BM_CHECK_ELEMENT(v);
-  }
-  bm->elem_index_dirty &= ~BM_VERT;
+      BM_CHECK_ELEMENT(v);
+    }
+  });
 
-  med = medge;
-  i = 0;
-  BM_ITER_MESH (e, &iter, bm, BM_EDGES_OF_MESH) {
-    med->v1 = BM_elem_index_get(e->v1);
-    med->v2 = BM_elem_index_get(e->v2);
+  blender::threading::parallel_for(IndexRange(bm->totedge), 1024, [&](const IndexRange range) {
+    for (const int edge_i : range) {
+      BMEdge *e = bm->etable[edge_i];
+      MEdge *med = &medge[edge_i];
 
-    med->flag = BM_edge_flag_to_mflag(e);
+      med->v1 = BM_elem_index_get(e->v1);
+      med->v2 = BM_elem_index_get(e->v2);
 
-    BM_elem_index_set(e, i); /* set_inline */
+      med->flag = BM_edge_flag_to_mflag(e);
 
-    /* Copy over custom-data. */
-    CustomData_from_bmesh_block(&bm->edata, &me->edata, e->head.data, i);
+      /* Copy over custom-data. */
+      CustomData_from_bmesh_block(&bm->edata, &me->edata, e->head.data, edge_i);
 
-    bmesh_quick_edgedraw_flag(med, e);
+      bmesh_quick_edgedraw_flag(med, e);
 
-    if (cd_edge_crease_offset != -1) {
-      med->crease = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, cd_edge_crease_offset);
-    }
-    if (cd_edge_bweight_offset != -1) {
-      med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, cd_edge_bweight_offset);
-    }
+      if (cd_edge_crease_offset != -1) {
+        med->crease = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, cd_edge_crease_offset);
+      }
+      if (cd_edge_bweight_offset != -1) {
+        med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, cd_edge_bweight_offset);
+      }
 
-    i++;
-    med++;
-    BM_CHECK_ELEMENT(e);
-  }
-  bm->elem_index_dirty &= ~BM_EDGE;
-
-  i = 0;
-  j = 0;
-  BM_ITER_MESH (f, &iter, bm, BM_FACES_OF_MESH) {
-    BMLoop *l_iter, *l_first;
-    mpoly->loopstart = j;
-    mpoly->totloop = f->len;
-    mpoly->mat_nr = f->mat_nr;
-    mpoly->flag = BM_face_flag_to_mflag(f);
-
-    l_iter = l_first = BM_FACE_FIRST_LOOP(f);
-    do {
-      mloop->e = BM_elem_index_get(l_iter->e);
-      mloop->v = BM_elem_index_get(l_iter->v);
+      BM_CHECK_ELEMENT(e);
+    }
+  });
+
+  blender::threading::parallel_for(IndexRange(bm->totface), 1024, [&](const IndexRange range) {
+    for (const int face_i : range) {
+      BMFace *f = bm->ftable[face_i];
+      MPoly *mp = &mpoly[face_i];
+
+      mp->loopstart = loop_offsets[face_i];
+      mp->totloop = f->len;
+      mp->mat_nr = f->mat_nr;
+      mp->flag = BM_face_flag_to_mflag(f);
+
+      int loop_i = mp->loopstart;
+      BMLoop *l_iter, *l_first;
+      l_iter = l_first = BM_FACE_FIRST_LOOP(f);
+      do {
+        MLoop *ml = &mloop[loop_i];
+        ml->e = BM_elem_index_get(l_iter->e);
+        ml->v = BM_elem_index_get(l_iter->v);
+
+        /* Copy over custom-data. */
+        CustomData_from_bmesh_block(&bm->ldata, &me->ldata, l_iter->head.data, loop_i);
+
+        loop_i++;
+        BM_CHECK_ELEMENT(l_iter);
+        BM_CHECK_ELEMENT(l_iter->e);
+        BM_CHECK_ELEMENT(l_iter->v);
+      } while ((l_iter = l_iter->next) != l_first);
 
       /* Copy over custom-data. */
-      CustomData_from_bmesh_block(&bm->ldata, &me->ldata, l_iter->head.data, j);
-
-      j++;
-      mloop++;
-      BM_CHECK_ELEMENT(l_iter);
-      BM_CHECK_ELEMENT(l_iter->e);
-      BM_CHECK_ELEMENT(l_iter->v);
-    } while ((l_iter = l_iter->next) != l_first);
+      CustomData_from_bmesh_block(&bm->pdata, &me->pdata, f->head.data, face_i);
 
-    if (f == bm->act_face) {
-      me->act_face = i;
+      BM_CHECK_ELEMENT(f);
     }
+  });
 
-    /* Copy over custom-data. */
-    CustomData_from_bmesh_block(&bm->pdata, &me->pdata, f->head.data, i);
-
-    i++;
-    mpoly++;
-    BM_CHECK_ELEMENT(f);
+  if (bm->act_face) {
+    me->act_face = BM_elem_index_get(bm->act_face);
   }
 
   /* Patch hook indices and vertex parents. */
@@ -1213,15 +1258,10 @@ void BM_mesh_bm_to_me_for_eval(BMesh *bm, Mesh *me, const CustomData_MeshMasks *
 
   BKE_mesh_update_customdata_pointers(me, false);
 
-  BMIter iter;
-  BMVert *eve;
-  BMEdge *eed;
-  BMFace *efa;
   MVert *mvert = me->mvert;
   MEdge *medge = me->medge;
   MLoop *mloop = me->mloop;
   MPoly *mpoly = me->mpoly;
-  unsigned int i, j;
 
   const int cd_vert_bweight_offset = CustomData_get_offset(&bm->vdata, CD_BWEIGHT);
   const int cd_edge_bweight_offset = CustomData_get_offset(&bm->edata, CD_BWEIGHT);
@@ -1233,80 +1273,79 @@ void BM_mesh_bm_to_me_for_eval(BMesh *bm, Mesh *me, const CustomData_MeshMasks *
 
   me->runtime.deformed_only = true;
 
-  BM_ITER_MESH_INDEX (eve, &iter, bm, BM_VERTS_OF_MESH, i) {
-    MVert *mv = &mvert[i];
+  const Array<int> loop_offsets = bm_to_mesh_prepare(bm);
 
-    copy_v3_v3(mv->co, eve->co);
+  blender::threading::parallel_for(IndexRange(bm->totvert), 1024, [&](const IndexRange range) {
+    for (const int vert_i : range) {
+      BMVert *eve = bm->vtable[vert_i];
+      MVert *mv = &mvert[vert_i];
 
-    BM_elem_index_set(eve, i); /* set_inline */
+      copy_v3_v3(mv->co, eve->co);
 
-    mv->flag = BM_vert_flag_to_mflag(eve);
+      mv->flag = BM_vert_flag_to_mflag(eve);
 
-    if (cd_vert_bweight_offset != -1) {
-      mv->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(eve, cd_vert_bweight_offset);
-    }
+      if (cd_vert_bweight_offset != -1) {
+        mv->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(eve, cd_vert_bweight_offset);
+      }
 
-    CustomData_from_bmesh_block(&bm->vdata, &me->vdata, eve->head.data, i);
-  }
-  bm->elem_index_dirty &= ~BM_VERT;
+      CustomData_from_bmesh_block(&bm->vdata, &me->vdata, eve->head.data, vert_i);
+    }
+  });
 
-  BM_ITER_MESH_INDEX (eed, &iter, bm, BM_EDGES_OF_MESH, i) {
-    MEdge *med = &medge[i];
+  blender::threading::parallel_for(IndexRange(bm->totedge), 1024, [&](const IndexRange range) {
+    for (const int edge_i : range) {
+      BMEdge *eed = bm->etable[edge_i];
+      MEdge *med = &medge[edge_i];
 
-    BM_elem_index_set(eed, i); /* set_inline */
+      med->v1 = BM_elem_index_get(eed->v1);
+      med->v2 = BM_elem_index_get(eed->v2);
 
-    med->v1 = BM_elem_index_get(eed->v1);
-    med->v2 = BM_elem_index_get(eed->v2);
+      med->flag = BM_edge_flag_to_mflag(eed);
 
-    med->flag = BM_edge_flag_to_mflag(eed);
+      /* Handle this differently to editmode switching,
+       * only enable draw for single user edges rather than calculating angle. */
+      if ((med->flag & ME_EDGEDRAW) == 0) {
+        if (eed->l && eed->l == eed->l->radial_next) {
+          med->flag |= ME_EDGEDRAW;
+        }
+      }
 
-    /* Handle this differently to editmode switching,
-     * only enable draw for single user edges rather than calculating angle. */
-    if ((med->flag & ME_EDGEDRAW) == 0) {
-      if (eed->l && eed->l == eed->l->radial_next) {
-        med->flag |= ME_EDGEDRAW;
+      if (cd_edge_crease_offset != -1) {
+        med->crease = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(eed, cd_edge_crease_offset);
+      }
+      if (cd_edge_bweight_offset != -1) {
+        med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(eed, cd_edge_bweight_offset);
       }
-    }
 
-    if (cd_edge_crease_offset != -1) {
-      med->crease = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(eed, cd_edge_crease_offset);
+      CustomData_from_bmesh_block(&bm->edata, &me->edata, eed->head.data, edge_i);
     }
-    if (cd_edge_bweight_offset != -1) {
-      med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(eed, cd_edge_bweight_offset);
+  });
+
+  blender::threading::parallel_for(IndexRange(bm->totface), 1024, [&](const IndexRange range) {
+    for (const int face_i : range) {
+      BMFace *efa = bm->ftable[face_i];
+      MPoly *mp = &mpoly[face_i];
+
+      mp->totloop = efa->len;
+      mp->flag = BM_face_flag_to_mflag(efa);
+      mp->loopstart = loop_offsets[face_i];
+      mp->mat_nr = efa->mat_nr;
+
+      int loop_i = mp->loopstart;
+      BMLoop *l_iter, *l_first;
+      l_iter = l_first = BM_FACE_FIRST_LOOP(efa);
+      do {
+        MLoop *ml = &mloop[loop_i];
+        ml->v = BM_elem_index_get(l_iter->v);
+        ml->e = BM_elem_index_get(l_iter->e);
+        CustomData_from_bmesh_block(&bm->ldata, &me->ldata, l_iter->head.data, loop_i);
+
+        loop_i++;
+      } while ((l_iter = l_iter->next) != l_first);
+
+      CustomData_from_bmesh_block(&bm->pdata, &me->pdata, efa->head.data, face_i);
     }
-
-    CustomData_from_bmesh_block(&bm->edata, &me->edata, eed->head.data, i);
-  }
-  bm->elem_index_dirty &= ~BM_EDGE;
-
-  j = 0;
-  BM_ITER_MESH_INDEX (efa, &iter, bm, BM_FACES_OF_MESH, i) {
-    BMLoop *l_iter;
-    BMLoop *l_first;
-    MPoly *mp = &mpoly[i];
-
-    BM_elem_index_set(efa, i); /* set_inline */
-
-    mp->totloop = efa->len;
-    mp->flag = BM_face_flag_to_mflag(efa);
-    mp->loopstart = j;
-    mp->mat_nr = efa->mat_nr;
-
-    l_iter = l_first = BM_FACE_FIRST_LOOP(efa);
-    do {
-      mloop->v = BM_elem_index_get(l_iter->v);
-      mloop->e = BM_elem_index_get(l_iter->e);
-      CustomData_from_bmesh_block(&bm->ldata, &me->ldata, l_iter->head.data, j);
-
-      BM_elem_index_set(l_iter, j); /* set_inline */
-
-      j++;
-      mloop++;
-    } while ((l_iter = l_iter->next) != l_first);
-
-    CustomData_from_bmesh_block(&bm->pdata, &me->pdata, efa->head.data, i);
-  }
-  bm->elem_index_dirty &= ~(BM_FACE | BM_LOOP);
+  });
 
   me->cd_flag = BM_mesh_cd_flag_from_bmesh(bm);
 }
@@ -27,6 +27,7 @@
 #include "BLI_noise.h"
 #include "BLI_rand.h"
 #include "BLI_stack.h"
+#include "BLI_task.h"
 
 #include "BKE_customdata.h"
 
@@ -369,6 +370,20 @@ static void alter_co(BMVert *v,
   }
 }
 
+/* offset for smooth or sphere or fractal, and the interpolated normal */
+static void bm_subdivide_vert_alter(BMVert *v_new,
+                                    BMEdge *e_orig,
+                                    const SubDParams *params,
+                                    const float factor_subd,
+                                    const BMVert *v_a,
+                                    const BMVert *v_b)
+{
+  alter_co(v_new, e_orig, params, factor_subd, v_a, v_b);
+
+  interp_v3_v3v3(v_new->no, v_a->no, v_b->no, factor_subd);
+  normalize_v3(v_new->no);
+}
+
 /* assumes in the edge is the correct interpolated vertices already */
 /* percent defines the interpolation, rad and flag are for special options */
 /* results in new vertex with correct coordinate, vertex normal and weight group info */
@@ -388,8 +403,7 @@ static BMVert *bm_subdivide_edge_addvert(BMesh *bm,
 
   BMO_vert_flag_enable(bm, v_new, ELE_INNER);
 
-  /* offset for smooth or sphere or fractal */
-  alter_co(v_new, e_orig, params, factor_subd, v_a, v_b);
+  bm_subdivide_vert_alter(v_new, e_orig, params, factor_subd, v_a, v_b);
 
 #if 0  // BMESH_TODO
   /* clip if needed by mirror modifier */
@@ -406,12 +420,27 @@ static BMVert *bm_subdivide_edge_addvert(BMesh *bm,
   }
 #endif
 
-  interp_v3_v3v3(v_new->no, v_a->no, v_b->no, factor_subd);
-  normalize_v3(v_new->no);
-
   return v_new;
 }
 
+static void subdivide_edge_factors(BMesh *bm,
+                                   BMEdge *edge,
+                                   int curpoint,
+                                   int totpoint,
+                                   const SubDParams *params,
+                                   float *r_factor_edge_split,
+                                   float *r_factor_subd)
+{
+  if (BMO_edge_flag_test(bm, edge, EDGE_PERCENT) && totpoint == 1) {
+    *r_factor_edge_split = BMO_slot_map_float_get(params->slot_edge_percents, edge);
+    *r_factor_subd = 0.0f;
+  }
+  else {
+    *r_factor_edge_split = 1.0f / (float)(totpoint + 1 - curpoint);
+    *r_factor_subd = (float)(curpoint + 1) / (float)(totpoint + 1);
+  }
+}
+
 static BMVert *subdivide_edge_num(BMesh *bm,
                                   BMEdge *edge,
                                   BMEdge *e_orig,
@@ -425,14 +454,8 @@ static BMVert *subdivide_edge_num(BMesh *bm,
   BMVert *v_new;
   float factor_edge_split, factor_subd;
 
-  if (BMO_edge_flag_test(bm, edge, EDGE_PERCENT) && totpoint == 1) {
-    factor_edge_split = BMO_slot_map_float_get(params->slot_edge_percents, edge);
-    factor_subd = 0.0f;
-  }
-  else {
-    factor_edge_split = 1.0f / (float)(totpoint + 1 - curpoint);
-    factor_subd = (float)(curpoint + 1) / (float)(totpoint + 1);
-  }
+  subdivide_edge_factors(
+      bm, edge, curpoint, totpoint, params, &factor_edge_split, &factor_subd);
 
   v_new = bm_subdivide_edge_addvert(
       bm, edge, e_orig, params, factor_edge_split, factor_subd, v_a, v_b, r_edge);
@@ -469,6 +492,114 @@ static void bm_subdivide_multicut(
   alter_co(v2, &e_tmp, params, 1.0, &v1_tmp, &v2_tmp);
 }
 
+/** A vertex added by #bm_subdivide_edges_multicut, positioned after all edges are split. */
+typedef struct SubDEdgeCut {
+  BMVert *v;
+  float factor_subd;
+} SubDEdgeCut;
+
+typedef struct SubDEdgeCutsData {
+  const SubDParams *params;
+  /** The vertices of every edge before it was split. */
+  BMVert *(*edge_verts)[2];
+  /** #SubDParams.numcuts vertices for every edge. */
+  const SubDEdgeCut *cuts;
+} SubDEdgeCutsData;
+
+static void bm_subdivide_edge_cuts_alter_fn(void *__restrict userdata,
+                                            const int i,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SubDEdgeCutsData *data = userdata;
+  const int numcuts = data->params->numcuts;
+  const BMVert *v_a = data->edge_verts[i][0];
+  const BMVert *v_b = data->edge_verts[i][1];
+
+  for (int j = 0; j < numcuts; j++) {
+    const SubDEdgeCut *cut = &data->cuts[i * numcuts + j];
+    bm_subdivide_vert_alter(cut->v, NULL, data->params, cut->factor_subd, v_a, v_b);
+  }
+}
+
+/**
+ * The same as calling #bm_subdivide_multicut for all edges in \a einput.
+ *
+ * Splitting the edges changes topology, so it's done on a single thread. The displaced positions
+ * of the new vertices only depend on the vertices of the edge they're on, which aren't moved
+ * until all displacements are calculated, so smooth and fractal offsets (the expensive part)
+ * are calculated in parallel afterwards.
+ *
+ * \note Can't be used with shape-keys, the offsets are applied to the other shape-keys of the
+ * new vertices, which are interpolated from the already displaced vertices when splitting.
+ */
+static void bm_subdivide_edges_multicut(BMesh *bm, BMOpSlot *einput, const SubDParams *params)
+{
+  const int numcuts = params->numcuts;
+  const int cuts_len = einput->len * numcuts;
+  BMVert *(*edge_verts)[2] = MEM_malloc_arrayN((size_t)einput->len, sizeof(*edge_verts), __func__);
+  SubDEdgeCut *cuts = MEM_malloc_arrayN((size_t)cuts_len, sizeof(*cuts), __func__);
+
+  BLI_assert(params->shape_info.totlayer == 1);
+
+  for (int i = 0; i < einput->len; i++) {
+    BMEdge *edge = einput->data.buf[i];
+    BMEdge *e_new;
+
+    edge_verts[i][0] = edge->v1;
+    edge_verts[i][1] = edge->v2;
+
+    for (int j = 0; j < numcuts; j++) {
+      SubDEdgeCut *cut = &cuts[i * numcuts + j];
+      float factor_edge_split;
+
+      subdivide_edge_factors(bm, edge, j, numcuts, params, &factor_edge_split, &cut->factor_subd);
+      cut->v = BM_edge_split(bm, edge, edge->v1, &e_new, factor_edge_split);
+
+      BMO_vert_flag_enable(bm, cut->v, ELE_INNER | SUBD_SPLIT | ELE_SPLIT);
+      BMO_edge_flag_enable(bm, edge, SUBD_SPLIT | ELE_SPLIT);
+      BMO_edge_flag_enable(bm, e_new, SUBD_SPLIT | ELE_SPLIT);
+    }
+  }
+
+  SubDEdgeCutsData data = {
+      .params = params,
+      .edge_verts = edge_verts,
+      .cuts = cuts,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = cuts_len >= BM_OMP_LIMIT;
+  BLI_task_parallel_range(0, einput->len, &data, bm_subdivide_edge_cuts_alter_fn, &settings);
+
+  /* Edge vertices are shared, the last edge using them sets their displacement. */
+  for (int i = 0; i < einput->len; i++) {
+    alter_co(edge_verts[i][0], NULL, params, 0.0f, edge_verts[i][0], edge_verts[i][1]);
+    alter_co(edge_verts[i][1], NULL, params, 1.0f, edge_verts[i][0], edge_verts[i][1]);
+  }
+
+  MEM_freeN(cuts);
+  MEM_freeN(edge_verts);
+}
+
+static void bm_vert_shape_tmp_apply_fn(void *userdata,
+                                       MempoolIterData *iter,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SubDParams *params = userdata;
+  BMVert *v = (BMVert *)iter;
+  const float *co = BM_ELEM_CD_GET_VOID_P(v, params->shape_info.cd_vert_shape_offset_tmp);
+  copy_v3_v3(v->co, co);
+}
+
+/* copy original-geometry displacements to current coordinates */
+static void bm_vert_shape_tmp_apply(BMesh *bm, SubDParams *params)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = bm->totvert >= BM_OMP_LIMIT;
+  BM_iter_parallel(bm, BM_VERTS_OF_MESH, bm_vert_shape_tmp_apply_fn, params, &settings);
+}
+
 /* NOTE: the patterns are rotated as necessary to
  * match the input geometry.  they're based on the
  * pre-split state of the  face */
@@ -1150,17 +1281,18 @@ void bmo_subdivide_edges_exec(BMesh *bm, BMOperator *op)
   einput = BMO_slot_get(op->slots_in, "edges");
 
   /* go through and split edges */
-  for (i = 0; i < einput->len; i++) {
-    edge = einput->data.buf[i];
-    bm_subdivide_multicut(bm, edge, &params, edge->v1, edge->v2);
+  if (params.shape_info.totlayer == 1) {
+    bm_subdivide_edges_multicut(bm, einput, &params);
   }
-
-  /* copy original-geometry displacements to current coordinates */
-  BM_ITER_MESH (v, &viter, bm, BM_VERTS_OF_MESH) {
-    const float *co = BM_ELEM_CD_GET_VOID_P(v, params.shape_info.cd_vert_shape_offset_tmp);
-    copy_v3_v3(v->co, co);
+  else {
+    for (i = 0; i < einput->len; i++) {
+      edge = einput->data.buf[i];
+      bm_subdivide_multicut(bm, edge, &params, edge->v1, edge->v2);
+    }
   }
 
+  bm_vert_shape_tmp_apply(bm, &params);
+
   for (; !BLI_stack_is_empty(facedata); BLI_stack_discard(facedata)) {
     SubDFaceData *fd = BLI_stack_peek(facedata);
 
@@ -1301,11 +1433,7 @@ void bmo_subdivide_edges_exec(BMesh *bm, BMOperator *op)
     pat->connectexec(bm, face, verts, &params);
   }
 
-  /* copy original-geometry displacements to current coordinates */
-  BM_ITER_MESH (v, &viter, bm, BM_VERTS_OF_MESH) {
-    const float *co = BM_ELEM_CD_GET_VOID_P(v, params.shape_info.cd_vert_shape_offset_tmp);
-    copy_v3_v3(v->co, co);
-  }
+  bm_vert_shape_tmp_apply(bm, &params);
 
   BM_data_layer_free_n(bm, &bm->vdata, CD_SHAPEKEY, params.shape_info.tmpkey);
 
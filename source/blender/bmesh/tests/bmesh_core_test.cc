@@ -38,3 +38,43 @@ TEST(bmesh_core, BMVertCreate)
   EXPECT_EQ(BM_mesh_elem_count(bm, BM_VERT), 3);
   BM_mesh_free(bm);
 }
+
+TEST(bmesh_core, BMDataLayerArray)
+{
+  BMeshCreateParams bmesh_create_params{};
+  BMesh *bm = BM_mesh_create(&bm_mesh_allocsize_default, &bmesh_create_params);
+  BM_data_layer_add(bm, &bm->vdata, CD_PROP_FLOAT);
+  BM_data_layer_add(bm, &bm->ldata, CD_PROP_FLOAT);
+
+  BMVert *verts[4];
+  for (int i = 0; i < 4; i++) {
+    const float co[3] = {float(i & 1), float(i >> 1), 0.0f};
+    verts[i] = BM_vert_create(bm, co, nullptr, BM_CREATE_NOP);
+    BM_elem_float_data_set(&bm->vdata, verts[i], CD_PROP_FLOAT, float(i) * 2.0f);
+  }
+  BMVert *quad[4] = {verts[0], verts[1], verts[3], verts[2]};
+  BMFace *f = BM_face_create_verts(bm, quad, 4, nullptr, BM_CREATE_NOP, true);
+  ASSERT_TRUE(f != nullptr);
+
+  float vert_values[4];
+  BM_data_layer_array_get(bm, &bm->vdata, CD_PROP_FLOAT, 0, vert_values);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(vert_values[BM_elem_index_get(verts[i])], float(i) * 2.0f);
+    vert_values[i] += 1.0f;
+  }
+  BM_data_layer_array_set(bm, &bm->vdata, CD_PROP_FLOAT, 0, vert_values);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(BM_elem_float_data_get(&bm->vdata, verts[i], CD_PROP_FLOAT), float(i) * 2.0f + 1.0f);
+  }
+
+  float loop_values[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+  BM_data_layer_array_set(bm, &bm->ldata, CD_PROP_FLOAT, 0, loop_values);
+  BMLoop *l_iter, *l_first;
+  l_iter = l_first = BM_FACE_FIRST_LOOP(f);
+  do {
+    EXPECT_EQ(BM_elem_float_data_get(&bm->ldata, l_iter, CD_PROP_FLOAT),
+              loop_values[BM_elem_index_get(l_iter)]);
+  } while ((l_iter = l_iter->next) != l_first);
+
+  BM_mesh_free(bm);
+}
@@ -0,0 +1,215 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_math.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+
+#include "bmesh.h"
+
+class bmesh_mesh_convert : public testing::Test {
+ protected:
+  static void SetUpTestSuite()
+  {
+    BKE_idtype_init();
+  }
+};
+
+/**
+ * A grid of quads with a float attribute on vertices, an integer attribute on faces
+ * and every seventh face selected.
+ */
+static Mesh *grid_mesh_create(const int size)
+{
+  const int verts_num = (size + 1) * (size + 1);
+  const int edges_x_num = (size + 1) * size;
+  const int edges_num = edges_x_num * 2;
+  const int faces_num = size * size;
+  Mesh *mesh = BKE_mesh_new_nomain(verts_num, edges_num, 0, faces_num * 4, faces_num);
+
+  auto vert_index = [&](const int x, const int y) { return y * (size + 1) + x; };
+  auto edge_x_index = [&](const int x, const int y) { return y * size + x; };
+  auto edge_y_index = [&](const int x, const int y) { return edges_x_num + y * (size + 1) + x; };
+
+  float *vert_values = (float *)CustomData_add_layer_named(
+      &mesh->vdata, CD_PROP_FLOAT, CD_CALLOC, nullptr, verts_num, "vert_value");
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      const int i = vert_index(x, y);
+      mesh->mvert[i].co[0] = (float)x;
+      mesh->mvert[i].co[1] = (float)y;
+      mesh->mvert[i].co[2] = sinf((float)i);
+      vert_values[i] = (float)i * 0.5f;
+    }
+  }
+
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x < size; x++) {
+      MEdge &edge = mesh->medge[edge_x_index(x, y)];
+      edge.v1 = vert_index(x, y);
+      edge.v2 = vert_index(x + 1, y);
+    }
+  }
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x <= size; x++) {
+      MEdge &edge = mesh->medge[edge_y_index(x, y)];
+      edge.v1 = vert_index(x, y);
+      edge.v2 = vert_index(x, y + 1);
+    }
+  }
+
+  int *face_values = (int *)CustomData_add_layer_named(
+      &mesh->pdata, CD_PROP_INT32, CD_CALLOC, nullptr, faces_num, "face_value");
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const int i = y * size + x;
+      MPoly &poly = mesh->mpoly[i];
+      poly.loopstart = i * 4;
+      poly.totloop = 4;
+      poly.mat_nr = (short)(i % 3);
+      poly.flag = (i % 7 == 0) ? ME_FACE_SEL : 0;
+      face_values[i] = i * 2;
+
+      MLoop *loops = &mesh->mloop[poly.loopstart];
+      loops[0].v = vert_index(x, y);
+      loops[0].e = edge_x_index(x, y);
+      loops[1].v = vert_index(x + 1, y);
+      loops[1].e = edge_y_index(x + 1, y);
+      loops[2].v = vert_index(x + 1, y + 1);
+      loops[2].e = edge_x_index(x, y + 1);
+      loops[3].v = vert_index(x, y + 1);
+      loops[3].e = edge_y_index(x, y);
+    }
+  }
+  mesh->act_face = faces_num / 2;
+
+  return mesh;
+}
+
+static void round_trip_test(const int size)
+{
+  Mesh *mesh = grid_mesh_create(size);
+
+  BMeshCreateParams create_params{};
+  create_params.use_toolflags = true;
+  BMesh *bm = BM_mesh_create(&bm_mesh_allocsize_default, &create_params);
+  BMeshFromMeshParams from_mesh_params{};
+  from_mesh_params.calc_face_normal = true;
+  BM_mesh_bm_from_me(bm, mesh, &from_mesh_params);
+
+  ASSERT_EQ(bm->totvert, mesh->totvert);
+  ASSERT_EQ(bm->totedge, mesh->totedge);
+  ASSERT_EQ(bm->totface, mesh->totpoly);
+  ASSERT_EQ(bm->totloop, mesh->totloop);
+  EXPECT_TRUE(BM_mesh_validate(bm));
+
+  BM_mesh_elem_index_ensure(bm, BM_VERT | BM_EDGE | BM_FACE | BM_LOOP);
+  BM_mesh_elem_table_ensure(bm, BM_VERT | BM_EDGE | BM_FACE);
+  EXPECT_EQ(BM_elem_index_get(bm->act_face), mesh->act_face);
+
+  /* Disk and radial cycles are in the order the elements are created in. */
+  for (int i = 0; i < bm->totvert; i++) {
+    const BMVert *v = bm->vtable[i];
+    const BMEdge *e_iter = v->e;
+    do {
+      const BMEdge *e_next = BM_DISK_EDGE_NEXT(e_iter, v);
+      if (e_next != v->e) {
+        EXPECT_LT(BM_elem_index_get(e_iter), BM_elem_index_get(e_next));
+      }
+      e_iter = e_next;
+    } while (e_iter != v->e);
+  }
+  for (int i = 0; i < bm->totedge; i++) {
+    const BMEdge *e = bm->etable[i];
+    const BMLoop *l_iter = e->l->radial_next;
+    while (l_iter != e->l) {
+      EXPECT_LT(BM_elem_index_get(l_iter), BM_elem_index_get(l_iter->radial_next));
+      l_iter = l_iter->radial_next;
+    }
+  }
+
+  /* Selecting faces selects their vertices and edges too. */
+  int faces_selected_num = 0;
+  for (int i = 0; i < bm->totface; i++) {
+    BMFace *f = bm->ftable[i];
+    const bool is_selected = BM_elem_flag_test(f, BM_ELEM_SELECT);
+    EXPECT_EQ(is_selected, (mesh->mpoly[i].flag & ME_FACE_SEL) != 0);
+    EXPECT_EQ(f->mat_nr, mesh->mpoly[i].mat_nr);
+    if (is_selected) {
+      faces_selected_num++;
+      BMLoop *l_iter, *l_first;
+      l_iter = l_first = BM_FACE_FIRST_LOOP(f);
+      do {
+        EXPECT_TRUE(BM_elem_flag_test(l_iter->v, BM_ELEM_SELECT));
+        EXPECT_TRUE(BM_elem_flag_test(l_iter->e, BM_ELEM_SELECT));
+      } while ((l_iter = l_iter->next) != l_first);
+    }
+  }
+  EXPECT_EQ(bm->totfacesel, faces_selected_num);
+  EXPECT_EQ(bm->totvertsel, BM_iter_mesh_count_flag(BM_VERTS_OF_MESH, bm, BM_ELEM_SELECT, true));
+  EXPECT_EQ(bm->totedgesel, BM_iter_mesh_count_flag(BM_EDGES_OF_MESH, bm, BM_ELEM_SELECT, true));
+
+  Mesh *result = BKE_mesh_new_nomain(0, 0, 0, 0, 0);
+  BMeshToMeshParams to_mesh_params{};
+  BM_mesh_bm_to_me(nullptr, bm, result, &to_mesh_params);
+  BM_mesh_free(bm);
+
+  ASSERT_EQ(result->totvert, mesh->totvert);
+  ASSERT_EQ(result->totedge, mesh->totedge);
+  ASSERT_EQ(result->totpoly, mesh->totpoly);
+  ASSERT_EQ(result->totloop, mesh->totloop);
+  EXPECT_EQ(result->act_face, mesh->act_face);
+
+  const float *vert_values = (const float *)CustomData_get_layer_named(
+      &mesh->vdata, CD_PROP_FLOAT, "vert_value");
+  const float *result_vert_values = (const float *)CustomData_get_layer_named(
+      &result->vdata, CD_PROP_FLOAT, "vert_value");
+  ASSERT_NE(result_vert_values, nullptr);
+  for (int i = 0; i < mesh->totvert; i++) {
+    EXPECT_V3_NEAR(result->mvert[i].co, mesh->mvert[i].co, 0.0f);
+    EXPECT_EQ(result_vert_values[i], vert_values[i]);
+  }
+  for (int i = 0; i < mesh->totedge; i++) {
+    EXPECT_EQ(result->medge[i].v1, mesh->medge[i].v1);
+    EXPECT_EQ(result->medge[i].v2, mesh->medge[i].v2);
+  }
+
+  const int *face_values = (const int *)CustomData_get_layer_named(
+      &mesh->pdata, CD_PROP_INT32, "face_value");
+  const int *result_face_values = (const int *)CustomData_get_layer_named(
+      &result->pdata, CD_PROP_INT32, "face_value");
+  ASSERT_NE(result_face_values, nullptr);
+  for (int i = 0; i < mesh->totpoly; i++) {
+    EXPECT_EQ(result->mpoly[i].loopstart, mesh->mpoly[i].loopstart);
+    EXPECT_EQ(result->mpoly[i].totloop, mesh->mpoly[i].totloop);
+    EXPECT_EQ(result->mpoly[i].mat_nr, mesh->mpoly[i].mat_nr);
+    EXPECT_EQ(result->mpoly[i].flag & ME_FACE_SEL, mesh->mpoly[i].flag & ME_FACE_SEL);
+    EXPECT_EQ(result_face_values[i], face_values[i]);
+  }
+  for (int i = 0; i < mesh->totloop; i++) {
+    EXPECT_EQ(result->mloop[i].v, mesh->mloop[i].v);
+    EXPECT_EQ(result->mloop[i].e, mesh->mloop[i].e);
+  }
+
+  BKE_id_free(nullptr, result);
+  BKE_id_free(nullptr, mesh);
+}
+
+TEST_F(bmesh_mesh_convert, RoundTripSmall)
+{
+  round_trip_test(3);
+}
+
+TEST_F(bmesh_mesh_convert, RoundTripLarge)
+{
+  /* Large enough to be converted on multiple threads. */
+  round_trip_test(300);
+}
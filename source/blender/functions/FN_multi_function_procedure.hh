@@ -284,6 +284,16 @@ class MFProcedure : NonCopyable, NonMovable {
   MFDummyInstruction &new_dummy_instruction();
   MFReturnInstruction &new_return_instruction();
 
+  /**
+   * Remove an instruction that is not referenced by any other instruction anymore. Its outgoing
+   * links and variable uses are removed as well, but the variables themselves are kept.
+   */
+  void delete_instruction(MFInstruction &instruction);
+  /**
+   * Remove a variable that is not used by any instruction or procedure parameter anymore.
+   */
+  void delete_variable(MFVariable &variable);
+
   void add_parameter(MFParamType::InterfaceType interface_type, MFVariable &variable);
   Span<ConstMFParameter> params() const;
 
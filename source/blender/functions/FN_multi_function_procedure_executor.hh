@@ -29,8 +29,16 @@ class MFProcedureExecutor : public MultiFunction {
  private:
   MFSignature signature_;
   const MFProcedure &procedure_;
+  /** The mask can be split into chunks when all parameters are single values. */
+  bool supports_chunking_;
 
  public:
+  /**
+   * Number of indices that are evaluated by all instructions before continuing with the next
+   * chunk. Small enough for intermediate buffers to stay in the CPU cache.
+   */
+  static constexpr int64_t chunk_size = 4096;
+
   MFProcedureExecutor(const MFProcedure &procedure);
 
   void call(IndexMask mask, MFParams params, MFContext context) const override;
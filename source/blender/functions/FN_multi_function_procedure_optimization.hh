@@ -58,4 +58,26 @@ namespace blender::fn::procedure_optimization {
  */
 void move_destructs_up(MFProcedure &procedure, MFInstruction &block_end_instr);
 
+/**
+ * Element-wise multi-functions like math operations are often chained, e.g. when multiple math
+ * nodes are connected. When every function in such a chain is called separately, every
+ * intermediate value needs a buffer as large as the entire mask, which is written once and read
+ * once. This is bound by memory bandwidth rather than by the actual computation.
+ *
+ * This optimization pass replaces consecutive calls of element-wise functions with a single call
+ * to a function that evaluates the whole chain on small blocks of indices at a time. Intermediate
+ * values that are not used outside of the chain only need block-sized buffers then, which stay in
+ * the CPU cache.
+ *
+ * A function is considered element-wise when it only has single inputs and exactly one single
+ * output, and does not depend on the context. That includes all #CustomMF_SI_SO,
+ * #CustomMF_SI_SI_SO etc. functions. Like #move_destructs_up, this only works on a single chain of
+ * instructions, and it should run before destruct instructions are moved.
+ *
+ * \param procedure The procedure that should be optimized.
+ * \param block_end_instr The instruction that points to the last instruction within a linear chain
+ *   of instructions.
+ */
+void fuse_element_wise_calls(MFProcedure &procedure, MFInstruction &block_end_instr);
+
 }  // namespace blender::fn::procedure_optimization
@@ -281,6 +281,7 @@ static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
 
   MFReturnInstruction &return_instr = builder.add_return();
 
+  procedure_optimization::fuse_element_wise_calls(procedure, return_instr);
   procedure_optimization::move_destructs_up(procedure, return_instr);
 
   // std::cout << procedure.to_dot() << "\n";
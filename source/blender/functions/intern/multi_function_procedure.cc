@@ -235,6 +235,65 @@ MFReturnInstruction &MFProcedure::new_return_instruction()
   return instruction;
 }
 
+void MFProcedure::delete_instruction(MFInstruction &instruction)
+{
+  BLI_assert(instruction.prev().is_empty());
+  BLI_assert(entry_ != &instruction);
+  switch (instruction.type()) {
+    case MFInstructionType::Call: {
+      MFCallInstruction &call_instr = static_cast<MFCallInstruction &>(instruction);
+      call_instr.set_next(nullptr);
+      for (const int param_index : call_instr.params().index_range()) {
+        call_instr.set_param_variable(param_index, nullptr);
+      }
+      call_instructions_.remove_first_occurrence_and_reorder(&call_instr);
+      call_instr.~MFCallInstruction();
+      break;
+    }
+    case MFInstructionType::Branch: {
+      MFBranchInstruction &branch_instr = static_cast<MFBranchInstruction &>(instruction);
+      branch_instr.set_condition(nullptr);
+      branch_instr.set_branch_true(nullptr);
+      branch_instr.set_branch_false(nullptr);
+      branch_instructions_.remove_first_occurrence_and_reorder(&branch_instr);
+      branch_instr.~MFBranchInstruction();
+      break;
+    }
+    case MFInstructionType::Destruct: {
+      MFDestructInstruction &destruct_instr = static_cast<MFDestructInstruction &>(instruction);
+      destruct_instr.set_variable(nullptr);
+      destruct_instr.set_next(nullptr);
+      destruct_instructions_.remove_first_occurrence_and_reorder(&destruct_instr);
+      destruct_instr.~MFDestructInstruction();
+      break;
+    }
+    case MFInstructionType::Dummy: {
+      MFDummyInstruction &dummy_instr = static_cast<MFDummyInstruction &>(instruction);
+      dummy_instr.set_next(nullptr);
+      dummy_instructions_.remove_first_occurrence_and_reorder(&dummy_instr);
+      dummy_instr.~MFDummyInstruction();
+      break;
+    }
+    case MFInstructionType::Return: {
+      MFReturnInstruction &return_instr = static_cast<MFReturnInstruction &>(instruction);
+      return_instructions_.remove_first_occurrence_and_reorder(&return_instr);
+      return_instr.~MFReturnInstruction();
+      break;
+    }
+  }
+}
+
+void MFProcedure::delete_variable(MFVariable &variable)
+{
+  BLI_assert(variable.users().is_empty());
+  variables_.remove_first_occurrence_and_reorder(&variable);
+  /* Keep the ids compact, they are used when printing the procedure. */
+  for (const int i : variables_.index_range()) {
+    variables_[i]->id_ = i;
+  }
+  variable.~MFVariable();
+}
+
 void MFProcedure::add_parameter(MFParamType::InterfaceType interface_type, MFVariable &variable)
 {
   params_.append({interface_type, &variable});
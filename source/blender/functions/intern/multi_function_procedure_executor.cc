@@ -17,6 +17,7 @@
 #include "FN_multi_function_procedure_executor.hh"
 
 #include "BLI_stack.hh"
+#include "BLI_task.hh"
 
 namespace blender::fn {
 
@@ -30,6 +31,14 @@ MFProcedureExecutor::MFProcedureExecutor(const MFProcedure &procedure) : procedu
 
   signature_ = signature.build();
   this->set_signature(&signature_);
+
+  supports_chunking_ = true;
+  for (const ConstMFParameter &param : procedure.params()) {
+    if (param.variable->data_type().is_vector()) {
+      /* Vector arrays can't be sliced. */
+      supports_chunking_ = false;
+    }
+  }
 }
 
 using IndicesSplitVectors = std::array<Vector<int64_t>, 2>;
@@ -166,8 +175,16 @@ class ValueAllocator : NonCopyable, NonMovable {
   /** The cached memory buffers can hold #VariableState values. */
   Stack<void *> variable_state_free_list_;
 
+  /**
+   * Span buffers are allocated with at least this many elements. When the same allocator is used
+   * to evaluate multiple chunks, this has to be the largest array size of all of them, so that
+   * buffers can be reused between chunks.
+   */
+  int64_t min_span_size_;
+
  public:
-  ValueAllocator(LinearAllocator<> &linear_allocator) : linear_allocator_(linear_allocator)
+  ValueAllocator(LinearAllocator<> &linear_allocator, const int64_t min_span_size = 0)
+      : linear_allocator_(linear_allocator), min_span_size_(min_span_size)
   {
   }
 
@@ -196,15 +213,16 @@ class ValueAllocator : NonCopyable, NonMovable {
 
     const int64_t element_size = type.size();
     const int64_t alignment = type.alignment();
+    const int64_t buffer_size = std::max<int64_t>(size, min_span_size_);
 
     if (alignment > min_alignment) {
       /* In this rare case we fallback to not reusing existing buffers. */
-      buffer = linear_allocator_.allocate(element_size * size, alignment);
+      buffer = linear_allocator_.allocate(element_size * buffer_size, alignment);
     }
     else {
       Stack<void *> *stack = span_buffers_free_list_.lookup_ptr(element_size);
       if (stack == nullptr || stack->is_empty()) {
-        buffer = linear_allocator_.allocate(element_size * size, min_alignment);
+        buffer = linear_allocator_.allocate(element_size * buffer_size, min_alignment);
       }
       else {
         /* Reuse existing buffer. */
@@ -828,13 +846,13 @@ void ValueAllocator::release_variable_state(VariableState *state)
 /** Keeps track of the states of all variables during evaluation. */
 class VariableStates {
  private:
-  ValueAllocator value_allocator_;
+  ValueAllocator &value_allocator_;
   Map<const MFVariable *, VariableState *> variable_states_;
   IndexMask full_mask_;
 
  public:
-  VariableStates(LinearAllocator<> &linear_allocator, IndexMask full_mask)
-      : value_allocator_(linear_allocator), full_mask_(full_mask)
+  VariableStates(ValueAllocator &value_allocator, IndexMask full_mask)
+      : value_allocator_(value_allocator), full_mask_(full_mask)
   {
   }
 
@@ -1177,17 +1195,18 @@ class InstructionScheduler {
   }
 };
 
-void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext context) const
+static void execute_procedure(const MFProcedureExecutor &fn,
+                              const MFProcedure &procedure,
+                              IndexMask full_mask,
+                              MFParams params,
+                              const MFContext &context,
+                              ValueAllocator &value_allocator)
 {
-  BLI_assert(procedure_.validate());
-
-  LinearAllocator<> linear_allocator;
-
-  VariableStates variable_states{linear_allocator, full_mask};
-  variable_states.add_initial_variable_states(*this, procedure_, params);
+  VariableStates variable_states{value_allocator, full_mask};
+  variable_states.add_initial_variable_states(fn, procedure, params);
 
   InstructionScheduler scheduler;
-  scheduler.add_referenced_indices(*procedure_.entry(), full_mask);
+  scheduler.add_referenced_indices(*procedure.entry(), full_mask);
 
   /* Loop until all indices got to a return instruction. */
   while (NextInstructionInfo instr_info = scheduler.pop_next()) {
@@ -1233,9 +1252,9 @@ void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext c
     }
   }
 
-  for (const int param_index : this->param_indices()) {
-    const MFParamType param_type = this->param_type(param_index);
-    const MFVariable *variable = procedure_.params()[param_index].variable;
+  for (const int param_index : fn.param_indices()) {
+    const MFParamType param_type = fn.param_type(param_index);
+    const MFVariable *variable = procedure.params()[param_index].variable;
     VariableState &variable_state = variable_states.get_variable_state(*variable);
     switch (param_type.interface_type()) {
       case MFParamType::Input: {
@@ -1256,9 +1275,103 @@ void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext c
   }
 }
 
+/**
+ * Execute the procedure for the indices in `chunk_range` of `full_mask`. The indices and all
+ * parameters are offset, so that the intermediate buffers only have to be as large as the chunk.
+ */
+static void execute_procedure_chunk(const MFProcedureExecutor &fn,
+                                    const MFProcedure &procedure,
+                                    const IndexMask full_mask,
+                                    const IndexRange chunk_range,
+                                    MFParams params,
+                                    const MFContext &context,
+                                    ValueAllocator &value_allocator)
+{
+  const IndexMask sliced_mask = full_mask.slice(chunk_range);
+  const int64_t input_slice_start = sliced_mask[0];
+  const int64_t input_slice_size = sliced_mask.last() - input_slice_start + 1;
+  const IndexRange input_slice_range{input_slice_start, input_slice_size};
+
+  Vector<int64_t> offset_mask_indices;
+  const IndexMask offset_mask = full_mask.slice_and_offset(chunk_range, offset_mask_indices);
+
+  MFParamsBuilder offset_params{fn, offset_mask.min_array_size()};
+  for (const int param_index : fn.param_indices()) {
+    const MFParamType param_type = fn.param_type(param_index);
+    switch (param_type.category()) {
+      case MFParamType::SingleInput: {
+        const GVArray &varray = params.readonly_single_input(param_index);
+        offset_params.add_readonly_single_input(varray.slice(input_slice_range));
+        break;
+      }
+      case MFParamType::SingleMutable: {
+        const GMutableSpan span = params.single_mutable(param_index);
+        offset_params.add_single_mutable(span.slice(input_slice_range));
+        break;
+      }
+      case MFParamType::SingleOutput: {
+        const GMutableSpan span = params.uninitialized_single_output_if_required(param_index);
+        if (span.is_empty()) {
+          offset_params.add_ignored_single_output();
+        }
+        else {
+          offset_params.add_uninitialized_single_output(span.slice(input_slice_range));
+        }
+        break;
+      }
+      case MFParamType::VectorInput:
+      case MFParamType::VectorMutable:
+      case MFParamType::VectorOutput: {
+        BLI_assert_unreachable();
+        break;
+      }
+    }
+  }
+
+  execute_procedure(fn, procedure, offset_mask, offset_params, context, value_allocator);
+}
+
+void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext context) const
+{
+  BLI_assert(procedure_.validate());
+
+  if (!supports_chunking_ || full_mask.size() <= chunk_size) {
+    LinearAllocator<> linear_allocator;
+    ValueAllocator value_allocator{linear_allocator};
+    execute_procedure(*this, procedure_, full_mask, params, context, value_allocator);
+    return;
+  }
+
+  threading::parallel_for(full_mask.index_range(), chunk_size, [&](const IndexRange range) {
+    /* Run all instructions on one chunk at a time, instead of running every instruction on the
+     * entire range. That way the intermediate buffers stay in the CPU cache, and they can be
+     * reused for the next chunk. */
+    Vector<IndexRange> chunks;
+    int64_t max_array_size = 0;
+    for (int64_t start = range.start(); start < range.one_after_last(); start += chunk_size) {
+      const IndexRange chunk{start, std::min(chunk_size, range.one_after_last() - start)};
+      chunks.append(chunk);
+      max_array_size = std::max(max_array_size, full_mask[chunk.last()] - full_mask[start] + 1);
+    }
+
+    LinearAllocator<> linear_allocator;
+    ValueAllocator value_allocator{linear_allocator, max_array_size};
+    for (const IndexRange chunk : chunks) {
+      execute_procedure_chunk(
+          *this, procedure_, full_mask, chunk, params, context, value_allocator);
+    }
+  });
+}
+
 MultiFunction::ExecutionHints MFProcedureExecutor::get_execution_hints() const
 {
   ExecutionHints hints;
+  if (supports_chunking_) {
+    /* The mask is split into chunks and distributed over threads in #call already. */
+    hints.allocates_array = false;
+    hints.min_grain_size = INT64_MAX;
+    return hints;
+  }
   hints.allocates_array = true;
   hints.min_grain_size = 10000;
   return hints;
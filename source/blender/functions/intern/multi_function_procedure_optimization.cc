@@ -16,6 +16,9 @@
 
 #include "FN_multi_function_procedure_optimization.hh"
 
+#include "BLI_array.hh"
+#include "BLI_set.hh"
+
 namespace blender::fn::procedure_optimization {
 
 void move_destructs_up(MFProcedure &procedure, MFInstruction &block_end_instr)
@@ -87,4 +90,357 @@ void move_destructs_up(MFProcedure &procedure, MFInstruction &block_end_instr)
   }
 }
 
+/**
+ * Evaluates a chain of element-wise multi-functions on one block of indices at a time.
+ */
+class FusedElementWiseFunction : public MultiFunction {
+ public:
+  /** Where a value that is passed to a function in the chain is stored. */
+  struct Value {
+    enum class Type {
+      /** Input parameter of the fused function. */
+      Input,
+      /** Output parameter of the fused function. */
+      Output,
+      /** Block-sized buffer that only exists during the evaluation. */
+      Temporary,
+    };
+    Type type;
+    /** Parameter index for inputs and outputs, index into the temporary types otherwise. */
+    int index;
+  };
+
+  struct Step {
+    const MultiFunction *fn;
+    /** The values passed to all parameters of the function. */
+    Vector<Value> params;
+  };
+
+ private:
+  /**
+   * Number of indices that all functions are evaluated on before continuing with the next block.
+   * Small enough for all temporary buffers to stay in the CPU cache, but large enough so that the
+   * overhead of calling the functions does not matter much. This is the same as the chunk size of
+   * #MFProcedureExecutor, so chunked procedures evaluate the fused function in a single block.
+   */
+  static constexpr int64_t block_size = 4096;
+
+  MFSignature signature_;
+  Vector<Step> steps_;
+  Vector<const CPPType *> temporary_types_;
+
+ public:
+  FusedElementWiseFunction(MFSignature signature,
+                           Vector<Step> steps,
+                           Vector<const CPPType *> temporary_types)
+      : signature_(std::move(signature)),
+        steps_(std::move(steps)),
+        temporary_types_(std::move(temporary_types))
+  {
+    this->set_signature(&signature_);
+  }
+
+  std::string debug_name() const override
+  {
+    std::string name = "Fused(";
+    for (const int i : steps_.index_range()) {
+      if (i > 0) {
+        name += ", ";
+      }
+      name += steps_[i].fn->debug_name();
+    }
+    return name + ")";
+  }
+
+  void call(IndexMask mask, MFParams params, MFContext context) const override
+  {
+    const int64_t tot_blocks = (mask.size() + block_size - 1) / block_size;
+    auto block_range = [&](const int64_t block_index) {
+      const int64_t start = block_index * block_size;
+      return IndexRange(start, std::min(block_size, mask.size() - start));
+    };
+
+    /* Temporary buffers are shared by all blocks, so they have to be large enough for the block
+     * that spans the most indices. */
+    int64_t max_array_size = 0;
+    for (const int64_t block_index : IndexRange(tot_blocks)) {
+      const IndexRange range = block_range(block_index);
+      max_array_size = std::max(max_array_size, mask[range.last()] - mask[range.first()] + 1);
+    }
+    LinearAllocator<> allocator;
+    Array<void *> temporary_buffers(temporary_types_.size());
+    for (const int i : temporary_types_.index_range()) {
+      const CPPType &type = *temporary_types_[i];
+      temporary_buffers[i] = allocator.allocate(type.size() * max_array_size, type.alignment());
+    }
+
+    for (const int64_t block_index : IndexRange(tot_blocks)) {
+      const IndexRange range = block_range(block_index);
+      const IndexRange array_range{mask[range.first()], mask[range.last()] - mask[range.first()] + 1};
+      Vector<int64_t> offset_mask_indices;
+      const IndexMask offset_mask = mask.slice_and_offset(range, offset_mask_indices);
+      const int64_t array_size = offset_mask.min_array_size();
+
+      for (const Step &step : steps_) {
+        const MultiFunction &fn = *step.fn;
+        MFParamsBuilder step_params{fn, array_size};
+        for (const int param_index : fn.param_indices()) {
+          const MFParamType param_type = fn.param_type(param_index);
+          const CPPType &type = param_type.data_type().single_type();
+          const Value &value = step.params[param_index];
+          if (param_type.interface_type() == MFParamType::Input) {
+            switch (value.type) {
+              case Value::Type::Input: {
+                const GVArray &varray = params.readonly_single_input(value.index);
+                if (varray.is_span()) {
+                  step_params.add_readonly_single_input(
+                      varray.get_internal_span().slice(array_range));
+                }
+                else {
+                  step_params.add_readonly_single_input(varray.slice(array_range));
+                }
+                break;
+              }
+              case Value::Type::Output: {
+                /* An output of the fused function that is used by a later function as well. */
+                const GMutableSpan span = params.uninitialized_single_output(value.index);
+                step_params.add_readonly_single_input(GSpan(span.slice(array_range)));
+                break;
+              }
+              case Value::Type::Temporary: {
+                step_params.add_readonly_single_input(
+                    GSpan(type, temporary_buffers[value.index], array_size));
+                break;
+              }
+            }
+          }
+          else {
+            BLI_assert(param_type.interface_type() == MFParamType::Output);
+            if (value.type == Value::Type::Output) {
+              const GMutableSpan span = params.uninitialized_single_output(value.index);
+              step_params.add_uninitialized_single_output(span.slice(array_range));
+            }
+            else {
+              BLI_assert(value.type == Value::Type::Temporary);
+              step_params.add_uninitialized_single_output(
+                  GMutableSpan(type, temporary_buffers[value.index], array_size));
+            }
+          }
+        }
+        fn.call(offset_mask, step_params, context);
+      }
+
+      for (const int i : temporary_types_.index_range()) {
+        temporary_types_[i]->destruct_indices(temporary_buffers[i], offset_mask);
+      }
+    }
+  }
+};
+
+static bool is_element_wise_call(const MFCallInstruction &call_instr)
+{
+  const MultiFunction &fn = call_instr.fn();
+  if (fn.depends_on_context()) {
+    return false;
+  }
+  int tot_inputs = 0;
+  int tot_outputs = 0;
+  for (const int param_index : fn.param_indices()) {
+    const MFParamType param_type = fn.param_type(param_index);
+    if (!param_type.data_type().is_single()) {
+      return false;
+    }
+    if (call_instr.params()[param_index] == nullptr) {
+      return false;
+    }
+    switch (param_type.interface_type()) {
+      case MFParamType::Input:
+        tot_inputs++;
+        break;
+      case MFParamType::Output:
+        tot_outputs++;
+        break;
+      case MFParamType::Mutable:
+        return false;
+    }
+  }
+  /* Functions without inputs are constants, which are better evaluated only once by the
+   * executor. */
+  return tot_inputs > 0 && tot_outputs == 1;
+}
+
+/**
+ * Remove an instruction that has exactly one next instruction, and link its previous
+ * instructions to that next instruction instead.
+ */
+static void remove_instruction_from_chain(MFProcedure &procedure,
+                                          MFInstruction &instr,
+                                          MFInstruction *next_instr)
+{
+  while (!instr.prev().is_empty()) {
+    /* Do a copy of the cursor here, because `instr.prev()` changes when #set_next is called. */
+    const MFInstructionCursor cursor = instr.prev()[0];
+    cursor.set_next(procedure, next_instr);
+  }
+  procedure.delete_instruction(instr);
+}
+
+/**
+ * Replace a run of consecutive element-wise calls with a single call to a fused function.
+ * \return False if the calls could not be fused.
+ */
+static bool fuse_calls(MFProcedure &procedure, Span<MFCallInstruction *> calls)
+{
+  Set<const MFVariable *> procedure_param_variables;
+  for (const ConstMFParameter &param : procedure.params()) {
+    procedure_param_variables.add(param.variable);
+  }
+  Set<const MFInstruction *> calls_set;
+  for (MFCallInstruction *call_instr : calls) {
+    calls_set.add(call_instr);
+  }
+
+  using Value = FusedElementWiseFunction::Value;
+  Vector<MFVariable *> input_variables;
+  Vector<MFVariable *> output_variables;
+  Vector<MFVariable *> temporary_variables;
+  Vector<const CPPType *> temporary_types;
+  Map<const MFVariable *, Value> value_by_variable;
+  Vector<FusedElementWiseFunction::Step> steps;
+
+  for (MFCallInstruction *call_instr : calls) {
+    const MultiFunction &fn = call_instr->fn();
+    FusedElementWiseFunction::Step step;
+    step.fn = &fn;
+    for (const int param_index : fn.param_indices()) {
+      MFVariable *variable = call_instr->params()[param_index];
+      if (fn.param_type(param_index).interface_type() == MFParamType::Input) {
+        const Value value = value_by_variable.lookup_or_add_cb(variable, [&]() {
+          input_variables.append(variable);
+          return Value{Value::Type::Input, int(input_variables.size() - 1)};
+        });
+        step.params.append(value);
+        continue;
+      }
+      if (value_by_variable.contains(variable)) {
+        /* The variable is initialized more than once, or it is used before it is initialized
+         * within the chain. */
+        return false;
+      }
+      /* The value only has to be stored in the output when it is used outside of the chain. */
+      bool used_outside = procedure_param_variables.contains(variable);
+      for (const MFInstruction *user : variable->users()) {
+        if (user->type() != MFInstructionType::Destruct && !calls_set.contains(user)) {
+          used_outside = true;
+        }
+      }
+      Value value;
+      if (used_outside) {
+        output_variables.append(variable);
+        value = {Value::Type::Output, int(output_variables.size() - 1)};
+      }
+      else {
+        temporary_variables.append(variable);
+        temporary_types.append(&variable->data_type().single_type());
+        value = {Value::Type::Temporary, int(temporary_types.size() - 1)};
+      }
+      value_by_variable.add_new(variable, value);
+      step.params.append(value);
+    }
+    steps.append(std::move(step));
+  }
+
+  if (temporary_variables.is_empty()) {
+    /* Nothing would be gained. */
+    return false;
+  }
+
+  /* Parameters of the fused function are all inputs followed by all outputs. */
+  MFSignatureBuilder signature{"Fused Element-Wise"};
+  for (const MFVariable *variable : input_variables) {
+    signature.single_input("In", variable->data_type().single_type());
+  }
+  for (const MFVariable *variable : output_variables) {
+    signature.single_output("Out", variable->data_type().single_type());
+  }
+  for (FusedElementWiseFunction::Step &step : steps) {
+    for (Value &value : step.params) {
+      if (value.type == Value::Type::Output) {
+        value.index += input_variables.size();
+      }
+    }
+  }
+  const MultiFunction &fused_fn = procedure.construct_function<FusedElementWiseFunction>(
+      signature.build(), std::move(steps), std::move(temporary_types));
+
+  MFCallInstruction &fused_instr = procedure.new_call_instruction(fused_fn);
+  Vector<MFVariable *> fused_params;
+  fused_params.extend(input_variables);
+  fused_params.extend(output_variables);
+  fused_instr.set_params(fused_params);
+
+  /* Replace the chain with the new instruction. */
+  fused_instr.set_next(calls.last()->next());
+  MFCallInstruction &first_call = *calls.first();
+  while (!first_call.prev().is_empty()) {
+    const MFInstructionCursor cursor = first_call.prev()[0];
+    cursor.set_next(procedure, &fused_instr);
+  }
+  for (MFCallInstruction *call_instr : calls) {
+    procedure.delete_instruction(*call_instr);
+  }
+
+  /* Remove the variables that are only used within the fused function. */
+  for (MFVariable *variable : temporary_variables) {
+    const Vector<MFInstruction *> users = variable->users();
+    for (MFInstruction *user : users) {
+      BLI_assert(user->type() == MFInstructionType::Destruct);
+      MFDestructInstruction &destruct_instr = static_cast<MFDestructInstruction &>(*user);
+      remove_instruction_from_chain(procedure, destruct_instr, destruct_instr.next());
+    }
+    procedure.delete_variable(*variable);
+  }
+  return true;
+}
+
+void fuse_element_wise_calls(MFProcedure &procedure, MFInstruction &block_end_instr)
+{
+  /* Find the linear chain of instructions that ends at the given instruction. */
+  Vector<MFInstruction *> chain;
+  MFInstruction *current_instr = &block_end_instr;
+  while (current_instr != nullptr) {
+    chain.append(current_instr);
+    const Span<MFInstructionCursor> prev_cursors = current_instr->prev();
+    if (prev_cursors.size() != 1) {
+      /* Stop when there is some branching before this instruction. */
+      break;
+    }
+    current_instr = prev_cursors[0].instruction();
+  }
+  std::reverse(chain.begin(), chain.end());
+
+  /* Find runs of consecutive element-wise calls. The runs are collected before any of them is
+   * fused, because fusing deletes instructions. */
+  Vector<Vector<MFCallInstruction *>> runs;
+  Vector<MFCallInstruction *> current_run;
+  for (MFInstruction *instr : chain) {
+    if (instr->type() == MFInstructionType::Call &&
+        is_element_wise_call(static_cast<MFCallInstruction &>(*instr))) {
+      current_run.append(static_cast<MFCallInstruction *>(instr));
+      continue;
+    }
+    if (current_run.size() >= 2) {
+      runs.append(std::move(current_run));
+    }
+    current_run.clear();
+  }
+  if (current_run.size() >= 2) {
+    runs.append(std::move(current_run));
+  }
+
+  for (const Vector<MFCallInstruction *> &run : runs) {
+    fuse_calls(procedure, run);
+  }
+}
+
 }  // namespace blender::fn::procedure_optimization
@@ -2,9 +2,13 @@
 
 #include "testing/testing.h"
 
+#include "BLI_resource_scope.hh"
+#include "BLI_timeit.hh"
+
 #include "FN_multi_function_builder.hh"
 #include "FN_multi_function_procedure_builder.hh"
 #include "FN_multi_function_procedure_executor.hh"
+#include "FN_multi_function_procedure_optimization.hh"
 #include "FN_multi_function_test_common.hh"
 
 namespace blender::fn::tests {
@@ -378,4 +382,197 @@ TEST(multi_function_procedure, BufferReuse)
   EXPECT_EQ(results[4], 53);
 }
 
+TEST(multi_function_procedure, LargeMask)
+{
+  /**
+   * procedure(int a, bool cond, int *out) {
+   *   int b = a + 10;
+   *   if (cond) {
+   *     b += 10;
+   *   }
+   *   out = a + b;
+   * }
+   */
+
+  CustomMF_SI_SO<int, int> add_10_fn{"add 10", [](int a) { return a + 10; }};
+  CustomMF_SM<int> add_10_mutable_fn{"add 10", [](int &a) { a += 10; }};
+  CustomMF_SI_SI_SO<int, int, int> add_fn{"add", [](int a, int b) { return a + b; }};
+
+  MFProcedure procedure;
+  MFProcedureBuilder builder{procedure};
+
+  MFVariable *var_a = &builder.add_single_input_parameter<int>();
+  MFVariable *var_cond = &builder.add_single_input_parameter<bool>();
+  auto [var_b] = builder.add_call<1>(add_10_fn, {var_a});
+  MFProcedureBuilder::Branch branch = builder.add_branch(*var_cond);
+  branch.branch_true.add_call(add_10_mutable_fn, {var_b});
+  builder.set_cursor_after_branch(branch);
+  auto [var_out] = builder.add_call<1>(add_fn, {var_a, var_b});
+  builder.add_destruct({var_a, var_b, var_cond});
+  builder.add_return();
+  builder.add_output_parameter(*var_out);
+
+  EXPECT_TRUE(procedure.validate());
+
+  MFProcedureExecutor procedure_fn{procedure};
+
+  /* Use a sparse mask that is larger than a single chunk, so that the chunks are offset. */
+  const int size = MFProcedureExecutor::chunk_size * 10 + 7;
+  Array<int> values_a(size);
+  Array<bool> values_cond(size);
+  Array<int> results(size, -1);
+  Vector<int64_t> mask_indices;
+  for (const int i : IndexRange(size)) {
+    values_a[i] = i;
+    values_cond[i] = i % 5 == 0;
+    if (i % 3 != 1) {
+      mask_indices.append(i);
+    }
+  }
+
+  MFParamsBuilder params{procedure_fn, size};
+  params.add_readonly_single_input(values_a.as_span());
+  params.add_readonly_single_input(values_cond.as_span());
+  params.add_uninitialized_single_output(results.as_mutable_span());
+
+  MFContextBuilder context;
+  procedure_fn.call(mask_indices.as_span(), params, context);
+
+  for (const int i : IndexRange(size)) {
+    if (i % 3 == 1) {
+      EXPECT_EQ(results[i], -1);
+    }
+    else if (i % 5 == 0) {
+      EXPECT_EQ(results[i], 2 * i + 20);
+    }
+    else {
+      EXPECT_EQ(results[i], 2 * i + 10);
+    }
+  }
+}
+
+/**
+ * procedure(float a, float *c, float *e) {
+ *   float b = a * 2.0f;
+ *   c = a + b;
+ *   float d = c - 1.0f;
+ *   e = d * c;
+ * }
+ */
+static MFReturnInstruction &build_element_wise_chain(MFProcedure &procedure,
+                                                     ResourceScope &scope)
+{
+  auto &mul_2_fn = scope.construct<CustomMF_SI_SO<float, float>>(
+      "mul 2", [](float a) { return a * 2.0f; });
+  auto &sub_1_fn = scope.construct<CustomMF_SI_SO<float, float>>(
+      "sub 1", [](float a) { return a - 1.0f; });
+  auto &add_fn = scope.construct<CustomMF_SI_SI_SO<float, float, float>>(
+      "add", [](float a, float b) { return a + b; });
+  auto &mul_fn = scope.construct<CustomMF_SI_SI_SO<float, float, float>>(
+      "mul", [](float a, float b) { return a * b; });
+
+  MFProcedureBuilder builder{procedure};
+  MFVariable *var_a = &builder.add_single_input_parameter<float>();
+  auto [var_b] = builder.add_call<1>(mul_2_fn, {var_a});
+  auto [var_c] = builder.add_call<1>(add_fn, {var_a, var_b});
+  auto [var_d] = builder.add_call<1>(sub_1_fn, {var_c});
+  auto [var_e] = builder.add_call<1>(mul_fn, {var_d, var_c});
+  builder.add_destruct({var_a, var_b, var_d});
+  MFReturnInstruction &return_instr = builder.add_return();
+  builder.add_output_parameter(*var_c);
+  builder.add_output_parameter(*var_e);
+  return return_instr;
+}
+
+static void call_element_wise_chain(const MFProcedure &procedure,
+                                    IndexMask mask,
+                                    Span<float> a,
+                                    MutableSpan<float> c,
+                                    MutableSpan<float> e)
+{
+  MFProcedureExecutor procedure_fn{procedure};
+  MFParamsBuilder params{procedure_fn, a.size()};
+  params.add_readonly_single_input(a);
+  params.add_uninitialized_single_output(c);
+  params.add_uninitialized_single_output(e);
+  MFContextBuilder context;
+  procedure_fn.call(mask, params, context);
+}
+
+TEST(multi_function_procedure, FuseElementWiseCalls)
+{
+  ResourceScope scope;
+  MFProcedure procedure;
+  MFReturnInstruction &return_instr = build_element_wise_chain(procedure, scope);
+  EXPECT_EQ(procedure.variables().size(), 5);
+
+  procedure_optimization::fuse_element_wise_calls(procedure, return_instr);
+  EXPECT_TRUE(procedure.validate());
+
+  /* All calls are fused into one, `b` and `d` are only needed within the fused function. */
+  EXPECT_EQ(procedure.variables().size(), 3);
+  const MFInstruction *entry = procedure.entry();
+  ASSERT_EQ(entry->type(), MFInstructionType::Call);
+  const MFCallInstruction &fused_instr = static_cast<const MFCallInstruction &>(*entry);
+  EXPECT_EQ(fused_instr.params().size(), 3);
+  ASSERT_EQ(fused_instr.next()->type(), MFInstructionType::Destruct);
+
+  /* Use a sparse mask that spans multiple blocks of the fused function. */
+  const int size = 10000;
+  Array<float> values_a(size);
+  Array<float> results_c(size, -1.0f);
+  Array<float> results_e(size, -1.0f);
+  Vector<int64_t> mask_indices;
+  for (const int i : IndexRange(size)) {
+    values_a[i] = float(i);
+    if (i % 3 != 1) {
+      mask_indices.append(i);
+    }
+  }
+  call_element_wise_chain(procedure, mask_indices.as_span(), values_a, results_c, results_e);
+
+  for (const int i : IndexRange(size)) {
+    if (i % 3 == 1) {
+      EXPECT_EQ(results_c[i], -1.0f);
+      EXPECT_EQ(results_e[i], -1.0f);
+    }
+    else {
+      const float c = 3.0f * i;
+      EXPECT_EQ(results_c[i], c);
+      EXPECT_EQ(results_e[i], (c - 1.0f) * c);
+    }
+  }
+}
+
+#if 0
+TEST(multi_function_procedure, FuseElementWiseCallsBenchmark)
+{
+  const int size = 10'000'000;
+  Array<float> values_a(size);
+  Array<float> results_c(size);
+  Array<float> results_e(size);
+  for (const int i : IndexRange(size)) {
+    values_a[i] = float(i % 100);
+  }
+
+  ResourceScope scope;
+  MFProcedure unfused_procedure;
+  build_element_wise_chain(unfused_procedure, scope);
+  MFProcedure fused_procedure;
+  MFReturnInstruction &return_instr = build_element_wise_chain(fused_procedure, scope);
+  procedure_optimization::fuse_element_wise_calls(fused_procedure, return_instr);
+
+  for (int i = 0; i < 5; i++) {
+    {
+      SCOPED_TIMER("unfused");
+      call_element_wise_chain(unfused_procedure, IndexRange(size), values_a, results_c, results_e);
+    }
+    {
+      SCOPED_TIMER("fused");
+      call_element_wise_chain(fused_procedure, IndexRange(size), values_a, results_c, results_e);
+    }
+  }
+}
+#endif
+
 }  // namespace blender::fn::tests
@@ -0,0 +1,93 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include "BLI_function_ref.hh"
+#include "BLI_vector.hh"
+
+#include "FN_field.hh"
+#include "FN_generic_array.hh"
+
+#include "BKE_geometry_set.hh"
+
+namespace blender::geometry {
+
+/**
+ * Values of a field on all elements of a domain in a geometry, including the geometry it
+ * instances. The instanced geometry is evaluated once per instance reference instead of once per
+ * instance, so the memory usage depends on the unique geometry rather than the number of
+ * instances. Together, the values are the same as when the field is evaluated on the realized
+ * geometry, except that instanced geometry is not transformed by the instance transforms.
+ */
+struct InstancesFieldValues {
+  /** Values on the components of the geometry itself, only for the selected elements. */
+  Vector<fn::GArray<>> component_values;
+
+  struct InstancedValues {
+    /** Values on one geometry that is used by an instance reference. */
+    std::unique_ptr<InstancesFieldValues> values;
+    /** How often the geometry is instanced. */
+    int64_t instances_num;
+  };
+  Vector<InstancedValues> instanced_values;
+
+  /**
+   * Call the function for every array of values, with the number of times the values appear in
+   * the realized geometry.
+   */
+  void foreach_values(FunctionRef<void(fn::GSpan values, int64_t count)> fn) const;
+
+  /** The number of values the realized geometry would have. */
+  int64_t realized_size() const;
+};
+
+/**
+ * Evaluate the field on the geometry set and on all geometry it instances, without realizing the
+ * instances. Only the elements in the selection are evaluated, the selection is evaluated on every
+ * instanced geometry as well. For #ATTR_DOMAIN_INSTANCE, the field is evaluated on nested
+ * instances.
+ */
+InstancesFieldValues evaluate_field_on_instances(const GeometrySet &geometry_set,
+                                                 AttributeDomain domain,
+                                                 const fn::GField &field,
+                                                 const fn::Field<bool> &selection);
+
+/**
+ * Statistics of values that appear a number of times each, like the values returned by
+ * #InstancesFieldValues::foreach_values. The values are not repeated to compute them, so the
+ * memory usage and time depend on the unique values only.
+ */
+struct WeightedStatistics {
+  float sum = 0.0f;
+  float mean = 0.0f;
+  float median = 0.0f;
+  float min = 0.0f;
+  float max = 0.0f;
+  /** The sample variance, like the variance of the repeated values. */
+  float variance = 0.0f;
+};
+
+/**
+ * \param values: Arrays of values, each appearing the number of times at the same index in
+ * \a counts.
+ * \param calc_median: The median requires sorting the values, skip it when it is not needed.
+ */
+WeightedStatistics calc_weighted_statistics(Span<Span<float>> values,
+                                            Span<int64_t> counts,
+                                            bool calc_median);
+
+}  // namespace blender::geometry
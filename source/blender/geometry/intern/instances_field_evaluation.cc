@@ -0,0 +1,283 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <cfloat>
+
+#include "GEO_instances_field_evaluation.hh"
+
+#include "DNA_collection_types.h"
+#include "DNA_layer_types.h"
+#include "DNA_object_types.h"
+
+#include "BLI_array.hh"
+#include "BLI_task.hh"
+
+#include "BKE_collection.h"
+#include "BKE_geometry_set_instances.hh"
+
+namespace blender::geometry {
+
+using blender::bke::GeometryComponentFieldContext;
+using blender::bke::object_get_evaluated_geometry_set;
+using blender::fn::CPPType;
+using blender::fn::Field;
+using blender::fn::FieldEvaluator;
+using blender::fn::GArray;
+using blender::fn::GField;
+using blender::fn::GSpan;
+using blender::fn::GVArray;
+
+void InstancesFieldValues::foreach_values(FunctionRef<void(GSpan values, int64_t count)> fn) const
+{
+  for (const GArray<> &values : component_values) {
+    fn(values.as_span(), 1);
+  }
+  for (const InstancedValues &instanced : instanced_values) {
+    instanced.values->foreach_values([&](const GSpan values, const int64_t count) {
+      fn(values, count * instanced.instances_num);
+    });
+  }
+}
+
+int64_t InstancesFieldValues::realized_size() const
+{
+  int64_t size = 0;
+  this->foreach_values(
+      [&](const GSpan values, const int64_t count) { size += values.size() * count; });
+  return size;
+}
+
+static GArray<> evaluate_field_on_component(const GeometryComponent &component,
+                                            const AttributeDomain domain,
+                                            const GField &field,
+                                            const Field<bool> &selection)
+{
+  const CPPType &type = field.cpp_type();
+  const int domain_size = component.attribute_domain_size(domain);
+  if (domain_size == 0) {
+    return GArray<>(type);
+  }
+  GeometryComponentFieldContext field_context{component, domain};
+  FieldEvaluator evaluator{field_context, domain_size};
+  evaluator.add(field);
+  evaluator.set_selection(selection);
+  evaluator.evaluate();
+  const GVArray &varray = evaluator.get_evaluated(0);
+  const IndexMask mask = evaluator.get_evaluated_selection_as_mask();
+
+  GArray<> values(type, mask.size());
+  if (mask.size() == domain_size) {
+    varray.materialize(values.data());
+  }
+  else {
+    for (const int64_t i : mask.index_range()) {
+      varray.get(mask[i], values[i]);
+    }
+  }
+  return values;
+}
+
+static void evaluate_field_on_geometry(const GeometrySet &geometry_set,
+                                       const AttributeDomain domain,
+                                       const GField &field,
+                                       const Field<bool> &selection,
+                                       InstancesFieldValues &r_values);
+
+/**
+ * Collect the geometry sets that are realized for every instance of the reference. Most
+ * references contain a single geometry, collections contain one for every object.
+ */
+static Vector<GeometrySet> geometries_from_reference(const InstanceReference &reference)
+{
+  Vector<GeometrySet> geometries;
+  switch (reference.type()) {
+    case InstanceReference::Type::Object: {
+      geometries.append(object_get_evaluated_geometry_set(reference.object()));
+      break;
+    }
+    case InstanceReference::Type::Collection: {
+      Collection &collection = reference.collection();
+      FOREACH_COLLECTION_OBJECT_RECURSIVE_BEGIN (&collection, object) {
+        geometries.append(object_get_evaluated_geometry_set(*object));
+      }
+      FOREACH_COLLECTION_OBJECT_RECURSIVE_END;
+      break;
+    }
+    case InstanceReference::Type::GeometrySet: {
+      geometries.append(reference.geometry_set());
+      break;
+    }
+    case InstanceReference::Type::None: {
+      break;
+    }
+  }
+  return geometries;
+}
+
+static void evaluate_field_on_instanced_geometry(const InstancesComponent &instances,
+                                                 const AttributeDomain domain,
+                                                 const GField &field,
+                                                 const Field<bool> &selection,
+                                                 InstancesFieldValues &r_values)
+{
+  const Span<InstanceReference> references = instances.references();
+  Array<int64_t> instances_num_by_reference(references.size(), 0);
+  for (const int handle : instances.instance_reference_handles()) {
+    instances_num_by_reference[handle]++;
+  }
+
+  Array<Vector<GeometrySet>> geometries_by_reference(references.size());
+  for (const int i : references.index_range()) {
+    if (instances_num_by_reference[i] > 0) {
+      geometries_by_reference[i] = geometries_from_reference(references[i]);
+    }
+  }
+
+  /* The references are independent, so they can be evaluated in parallel. */
+  Vector<std::pair<const GeometrySet *, InstancesFieldValues *>> tasks;
+  for (const int i : references.index_range()) {
+    for (const GeometrySet &geometry : geometries_by_reference[i]) {
+      r_values.instanced_values.append(
+          {std::make_unique<InstancesFieldValues>(), instances_num_by_reference[i]});
+      tasks.append({&geometry, r_values.instanced_values.last().values.get()});
+    }
+  }
+  threading::parallel_for(tasks.index_range(), 1, [&](const IndexRange range) {
+    for (const int i : range) {
+      evaluate_field_on_geometry(*tasks[i].first, domain, field, selection, *tasks[i].second);
+    }
+  });
+}
+
+static void evaluate_field_on_geometry(const GeometrySet &geometry_set,
+                                       const AttributeDomain domain,
+                                       const GField &field,
+                                       const Field<bool> &selection,
+                                       InstancesFieldValues &r_values)
+{
+  for (const GeometryComponent *component : geometry_set.get_components_for_read()) {
+    if (component->attribute_domain_supported(domain)) {
+      r_values.component_values.append(
+          evaluate_field_on_component(*component, domain, field, selection));
+    }
+  }
+  if (const InstancesComponent *instances =
+          geometry_set.get_component_for_read<InstancesComponent>()) {
+    evaluate_field_on_instanced_geometry(*instances, domain, field, selection, r_values);
+  }
+}
+
+InstancesFieldValues evaluate_field_on_instances(const GeometrySet &geometry_set,
+                                                 const AttributeDomain domain,
+                                                 const GField &field,
+                                                 const Field<bool> &selection)
+{
+  InstancesFieldValues values;
+  evaluate_field_on_geometry(geometry_set, domain, field, selection, values);
+  return values;
+}
+
+/** The value at position \a index in the sorted values when every value is repeated. */
+static float weighted_value_at(const Span<std::pair<float, int64_t>> sorted_values,
+                               const int64_t index)
+{
+  int64_t end = 0;
+  for (const std::pair<float, int64_t> &item : sorted_values) {
+    end += item.second;
+    if (index < end) {
+      return item.first;
+    }
+  }
+  BLI_assert_unreachable();
+  return 0.0f;
+}
+
+WeightedStatistics calc_weighted_statistics(const Span<Span<float>> values,
+                                            const Span<int64_t> counts,
+                                            const bool calc_median)
+{
+  BLI_assert(values.size() == counts.size());
+  WeightedStatistics statistics;
+
+  int64_t size = 0;
+  int64_t unique_size = 0;
+  double sum = 0.0;
+  float min = FLT_MAX;
+  float max = -FLT_MAX;
+  for (const int i : values.index_range()) {
+    if (values[i].is_empty() || counts[i] == 0) {
+      continue;
+    }
+    double values_sum = 0.0;
+    for (const float value : values[i]) {
+      values_sum += value;
+      min = std::min(min, value);
+      max = std::max(max, value);
+    }
+    sum += values_sum * (double)counts[i];
+    size += values[i].size() * counts[i];
+    unique_size += values[i].size();
+  }
+  if (size == 0) {
+    return statistics;
+  }
+
+  const double mean = sum / (double)size;
+  statistics.sum = (float)sum;
+  statistics.mean = (float)mean;
+  statistics.min = min;
+  statistics.max = max;
+
+  if (size > 1) {
+    double sum_of_squared_differences = 0.0;
+    for (const int i : values.index_range()) {
+      double values_sum = 0.0;
+      for (const float value : values[i]) {
+        const double difference = mean - (double)value;
+        values_sum += difference * difference;
+      }
+      sum_of_squared_differences += values_sum * (double)counts[i];
+    }
+    statistics.variance = (float)(sum_of_squared_differences / (double)(size - 1));
+  }
+
+  if (calc_median) {
+    Vector<std::pair<float, int64_t>> sorted_values;
+    sorted_values.reserve(unique_size);
+    for (const int i : values.index_range()) {
+      if (counts[i] > 0) {
+        for (const float value : values[i]) {
+          sorted_values.append({value, counts[i]});
+        }
+      }
+    }
+    std::sort(sorted_values.begin(),
+              sorted_values.end(),
+              [](const std::pair<float, int64_t> &a, const std::pair<float, int64_t> &b) {
+                return a.first < b.first;
+              });
+    const float median = weighted_value_at(sorted_values, size / 2);
+    /* For an even number of values, the median is the average of the middle two values. */
+    statistics.median = (size % 2 == 0) ?
+                            (median + weighted_value_at(sorted_values, size / 2 - 1)) * 0.5f :
+                            median;
+  }
+
+  return statistics;
+}
+
+}  // namespace blender::geometry
@@ -296,6 +296,53 @@ static Vector<std::pair<int, GSpan>> prepare_attribute_fallbacks(
   return attributes_to_override;
 }
 
+/**
+ * Process tasks in parallel in batches with a similar number of elements. Many small tasks are
+ * batched together to reduce threading overhead, while a large task gets a batch of its own and
+ * splits its work further by element ranges. A grain size based on the number of tasks would do
+ * neither.
+ *
+ * \param get_task_offset: Returns the start of a task's elements in the realized geometry. This
+ *   has to increase with the task index, which is the case because tasks are ordered like their
+ *   output.
+ */
+template<typename GetTaskOffsetFn, typename Fn>
+static void parallel_for_task_batches(const int64_t tasks_num,
+                                      const int64_t elements_num,
+                                      const GetTaskOffsetFn &get_task_offset,
+                                      const Fn &fn)
+{
+  const int64_t batch_size = 4096;
+  const int64_t batches_num = std::max<int64_t>(1, elements_num / batch_size);
+  /* Index of the first task that starts at or after the given offset. */
+  auto find_first_task = [&](const int64_t offset) {
+    int64_t first = 0;
+    int64_t count = tasks_num;
+    while (count > 0) {
+      const int64_t step = count / 2;
+      if (get_task_offset(first + step) < offset) {
+        first += step + 1;
+        count -= step + 1;
+      }
+      else {
+        count = step;
+      }
+    }
+    return first;
+  };
+  threading::parallel_for(IndexRange(batches_num), 1, [&](const IndexRange batch_range) {
+    for (const int64_t batch : batch_range) {
+      const int64_t start = batch == 0 ? 0 : find_first_task(batch * elements_num / batches_num);
+      const int64_t end = batch == batches_num - 1 ?
+                              tasks_num :
+                              find_first_task((batch + 1) * elements_num / batches_num);
+      for (const int64_t task_index : IndexRange(start, end - start)) {
+        fn(task_index);
+      }
+    }
+  });
+}
+
 /**
  * Calls #fn for every geometry in the given #InstanceReference. Also passes on the transformation
  * that is applied to every instance.
@@ -615,9 +662,10 @@ static void execute_realize_pointcloud_task(const RealizeInstancesOptions &optio
       });
     }
   }
-  /* Copy generic attributes. */
+  /* Copy generic attributes. Different attributes are copied concurrently, which helps most when
+   * the elements of a single large geometry are copied. */
   threading::parallel_for(
-      dst_attribute_spans.index_range(), 10, [&](const IndexRange attribute_range) {
+      dst_attribute_spans.index_range(), 1, [&](const IndexRange attribute_range) {
         for (const int attribute_index : attribute_range) {
           GMutableSpan dst_span = dst_attribute_spans[attribute_index].slice(point_slice);
           const CPPType &cpp_type = dst_span.type();
@@ -687,13 +735,14 @@ static void execute_realize_pointcloud_tasks(const RealizeInstancesOptions &opti
   }
 
   /* Actually execute all tasks. */
-  threading::parallel_for(tasks.index_range(), 100, [&](const IndexRange task_range) {
-    for (const int task_index : task_range) {
-      const RealizePointCloudTask &task = tasks[task_index];
-      execute_realize_pointcloud_task(
-          options, task, *dst_pointcloud, dst_attribute_spans, point_ids_span);
-    }
-  });
+  parallel_for_task_batches(
+      tasks.size(),
+      tot_points,
+      [&](const int64_t task_index) { return tasks[task_index].start_index; },
+      [&](const int64_t task_index) {
+        execute_realize_pointcloud_task(
+            options, tasks[task_index], *dst_pointcloud, dst_attribute_spans, point_ids_span);
+      });
 
   /* Save modified attributes. */
   for (OutputAttribute &dst_attribute : dst_attributes) {
@@ -895,9 +944,10 @@ static void execute_realize_mesh_task(const RealizeInstancesOptions &options,
       });
     }
   }
-  /* Copy generic attributes. */
+  /* Copy generic attributes. Different attributes are copied concurrently, which helps most when
+   * the elements of a single large geometry are copied. */
   threading::parallel_for(
-      dst_attribute_spans.index_range(), 10, [&](const IndexRange attribute_range) {
+      dst_attribute_spans.index_range(), 1, [&](const IndexRange attribute_range) {
         for (const int attribute_index : attribute_range) {
           const AttributeDomain domain = ordered_attributes.kinds[attribute_index].domain;
           IndexRange element_slice;
@@ -997,14 +1047,22 @@ static void execute_realize_mesh_tasks(const RealizeInstancesOptions &options,
     dst_attributes.append(std::move(dst_attribute));
   }
 
-  /* Actually execute all tasks. */
-  threading::parallel_for(tasks.index_range(), 100, [&](const IndexRange task_range) {
-    for (const int task_index : task_range) {
-      const RealizeMeshTask &task = tasks[task_index];
-      execute_realize_mesh_task(
-          options, task, ordered_attributes, *dst_mesh, dst_attribute_spans, vertex_ids_span);
-    }
-  });
+  /* Actually execute all tasks. Vertices and corners are used as a measure of the work. */
+  parallel_for_task_batches(
+      tasks.size(),
+      int64_t(tot_vertices) + tot_loops,
+      [&](const int64_t task_index) {
+        const MeshElementStartIndices &start_indices = tasks[task_index].start_indices;
+        return int64_t(start_indices.vertex) + start_indices.loop;
+      },
+      [&](const int64_t task_index) {
+        execute_realize_mesh_task(options,
+                                  tasks[task_index],
+                                  ordered_attributes,
+                                  *dst_mesh,
+                                  dst_attribute_spans,
+                                  vertex_ids_span);
+      });
 
   /* Save modified attributes. */
   for (OutputAttribute &dst_attribute : dst_attributes) {
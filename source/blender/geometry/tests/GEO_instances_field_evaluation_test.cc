@@ -0,0 +1,108 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_geometry_set.hh"
+#include "BKE_idtype.h"
+#include "BKE_mesh.h"
+
+#include "GEO_instances_field_evaluation.hh"
+#include "GEO_realize_instances.hh"
+
+namespace blender::geometry::tests {
+
+class instances_field_evaluation : public testing::Test {
+ protected:
+  static void SetUpTestSuite()
+  {
+    BKE_idtype_init();
+  }
+};
+
+/** A mesh with only vertices, with a "value" attribute on them. */
+static Mesh *points_mesh_create(const int size, const float offset)
+{
+  Mesh *mesh = BKE_mesh_new_nomain(size, 0, 0, 0, 0);
+  float *values = (float *)CustomData_add_layer_named(
+      &mesh->vdata, CD_PROP_FLOAT, CD_CALLOC, nullptr, size, "value");
+  for (int i = 0; i < size; i++) {
+    values[i] = sinf((float)i * 1.3f) + offset;
+  }
+  return mesh;
+}
+
+static WeightedStatistics calc_statistics(const InstancesFieldValues &values)
+{
+  Vector<Span<float>> spans;
+  Vector<int64_t> counts;
+  values.foreach_values([&](const fn::GSpan span, const int64_t count) {
+    spans.append(span.typed<float>());
+    counts.append(count);
+  });
+  return calc_weighted_statistics(spans, counts, true);
+}
+
+TEST_F(instances_field_evaluation, StatisticsMatchRealized)
+{
+  GeometrySet instanced = GeometrySet::create_with_mesh(points_mesh_create(36, 1.0f));
+
+  GeometrySet nested;
+  InstancesComponent &nested_instances = nested.get_component_for_write<InstancesComponent>();
+  const int nested_handle = nested_instances.add_reference(instanced);
+  for (int i = 0; i < 3; i++) {
+    nested_instances.add_instance(nested_handle, float4x4::identity());
+  }
+
+  GeometrySet geometry = GeometrySet::create_with_mesh(points_mesh_create(50, 0.0f));
+  InstancesComponent &instances = geometry.get_component_for_write<InstancesComponent>();
+  const int handle = instances.add_reference(instanced);
+  for (int i = 0; i < 5; i++) {
+    instances.add_instance(handle, float4x4::identity());
+  }
+  const int handle_nested = instances.add_reference(nested);
+  for (int i = 0; i < 2; i++) {
+    instances.add_instance(handle_nested, float4x4::identity());
+  }
+
+  const fn::Field<float> field = bke::AttributeFieldInput::Create<float>("value");
+  const fn::Field<bool> selection = fn::make_constant_field<bool>(true);
+  const InstancesFieldValues values = evaluate_field_on_instances(
+      geometry, ATTR_DOMAIN_POINT, field, selection);
+
+  const GeometrySet realized = realize_instances(geometry, {});
+  const InstancesFieldValues realized_values = evaluate_field_on_instances(
+      realized, ATTR_DOMAIN_POINT, field, selection);
+
+  const int64_t realized_size = 50 + 36 * 5 + 36 * 3 * 2;
+  EXPECT_EQ(values.realized_size(), realized_size);
+  EXPECT_EQ(realized_values.realized_size(), realized_size);
+
+  /* Every instanced geometry is evaluated once. */
+  int64_t values_num = 0;
+  values.foreach_values(
+      [&](const fn::GSpan span, const int64_t UNUSED(count)) { values_num += span.size(); });
+  EXPECT_EQ(values_num, 50 + 36 + 36);
+
+  const WeightedStatistics statistics = calc_statistics(values);
+  const WeightedStatistics realized_statistics = calc_statistics(realized_values);
+  EXPECT_NEAR(statistics.sum, realized_statistics.sum, 1e-3f);
+  EXPECT_NEAR(statistics.mean, realized_statistics.mean, 1e-5f);
+  EXPECT_EQ(statistics.median, realized_statistics.median);
+  EXPECT_EQ(statistics.min, realized_statistics.min);
+  EXPECT_EQ(statistics.max, realized_statistics.max);
+  EXPECT_NEAR(statistics.variance, realized_statistics.variance, 1e-5f);
+}
+
+TEST_F(instances_field_evaluation, StatisticsEmpty)
+{
+  const WeightedStatistics statistics = calc_weighted_statistics({}, {}, true);
+  EXPECT_EQ(statistics.sum, 0.0f);
+  EXPECT_EQ(statistics.median, 0.0f);
+  EXPECT_EQ(statistics.variance, 0.0f);
+}
+
+}  // namespace blender::geometry::tests
@@ -91,8 +91,20 @@ struct OBJExportParams {
   bool smooth_groups_bitflags;
 };
 
+struct OBJImportParams {
+  /** Full path to the source OBJ file to import. */
+  char filepath[FILE_MAX];
+  /* Geometry Transform options. */
+  eTransformAxisForward forward_axis;
+  eTransformAxisUp up_axis;
+  /** Run #BKE_mesh_validate on the imported meshes, useful for files with invalid indices. */
+  bool validate_meshes;
+};
+
 void OBJ_export(bContext *C, const struct OBJExportParams *export_params);
 
+void OBJ_import(bContext *C, const struct OBJImportParams *import_params);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,7 +23,9 @@
 
 #include "BKE_blender_version.h"
 
+#include "BLI_array.hh"
 #include "BLI_path_util.h"
+#include "BLI_task.hh"
 
 #include "obj_export_mesh.hh"
 #include "obj_export_mtl.hh"
@@ -52,7 +54,35 @@ const char *DEFORM_GROUP_DISABLED = "off";
  * So an empty material name is written. */
 const char *MATERIAL_GROUP_DISABLED = "";
 
-void OBJWriter::write_vert_uv_normal_indices(Span<int> vert_indices,
+/**
+ * Number of elements (vertices, polygons...) formatted by one task, and the number of these
+ * blocks that are formatted before they're written to the file. This limits the memory used for
+ * formatted text of large meshes to a few hundred megabytes.
+ */
+const int64_t BLOCK_ELEMENTS_SIZE = 32 * 1024;
+const int64_t BLOCKS_PER_BATCH = 64;
+
+template<typename Fn>
+void OBJWriter::write_in_blocks(const int64_t tot_elements, const Fn &fn) const
+{
+  const int64_t tot_blocks = (tot_elements + BLOCK_ELEMENTS_SIZE - 1) / BLOCK_ELEMENTS_SIZE;
+  for (int64_t batch_start = 0; batch_start < tot_blocks; batch_start += BLOCKS_PER_BATCH) {
+    const IndexRange batch(batch_start, std::min(BLOCKS_PER_BATCH, tot_blocks - batch_start));
+    Array<FormatHandlerOBJ> buffers(batch.size());
+    threading::parallel_for(IndexRange(batch.size()), 1, [&](IndexRange range) {
+      for (const int64_t i : range) {
+        const int64_t start = (batch.start() + i) * BLOCK_ELEMENTS_SIZE;
+        fn(buffers[i], IndexRange(start, std::min(BLOCK_ELEMENTS_SIZE, tot_elements - start)));
+      }
+    });
+    for (FormatHandlerOBJ &buffer : buffers) {
+      file_handler_->append_and_flush(buffer);
+    }
+  }
+}
+
+void OBJWriter::write_vert_uv_normal_indices(FormatHandlerOBJ &fh,
+                                             Span<int> vert_indices,
                                              Span<int> uv_indices,
                                              Span<int> normal_indices,
                                              bool flip) const
@@ -63,13 +93,12 @@ void OBJWriter::write_vert_uv_normal_indices(Span<int> vert_indices,
   const int uv_offset = index_offsets_.uv_vertex_offset + 1;
   const int normal_offset = index_offsets_.normal_offset + 1;
   const int n = vert_indices.size();
-  file_handler_->write<eOBJSyntaxElement::poly_element_begin>();
+  fh.write<eOBJSyntaxElement::poly_element_begin>();
   if (!flip) {
     for (int j = 0; j < n; ++j) {
-      file_handler_->write<eOBJSyntaxElement::vertex_uv_normal_indices>(
-          vert_indices[j] + vertex_offset,
-          uv_indices[j] + uv_offset,
-          normal_indices[j] + normal_offset);
+      fh.write<eOBJSyntaxElement::vertex_uv_normal_indices>(vert_indices[j] + vertex_offset,
+                                                            uv_indices[j] + uv_offset,
+                                                            normal_indices[j] + normal_offset);
     }
   }
   else {
@@ -78,16 +107,16 @@ void OBJWriter::write_vert_uv_normal_indices(Span<int> vert_indices,
      * then go backwards. Same logic in other write_*_indices functions below. */
     for (int k = 0; k < n; ++k) {
       int j = k == 0 ? 0 : n - k;
-      file_handler_->write<eOBJSyntaxElement::vertex_uv_normal_indices>(
-          vert_indices[j] + vertex_offset,
-          uv_indices[j] + uv_offset,
-          normal_indices[j] + normal_offset);
+      fh.write<eOBJSyntaxElement::vertex_uv_normal_indices>(vert_indices[j] + vertex_offset,
+                                                            uv_indices[j] + uv_offset,
+                                                            normal_indices[j] + normal_offset);
     }
   }
-  file_handler_->write<eOBJSyntaxElement::poly_element_end>();
+  fh.write<eOBJSyntaxElement::poly_element_end>();
 }
 
-void OBJWriter::write_vert_normal_indices(Span<int> vert_indices,
+void OBJWriter::write_vert_normal_indices(FormatHandlerOBJ &fh,
+                                          Span<int> vert_indices,
                                           Span<int> /*uv_indices*/,
                                           Span<int> normal_indices,
                                           bool flip) const
@@ -96,24 +125,25 @@ void OBJWriter::write_vert_normal_indices(Span<int> vert_indices,
   const int vertex_offset = index_offsets_.vertex_offset + 1;
   const int normal_offset = index_offsets_.normal_offset + 1;
   const int n = vert_indices.size();
-  file_handler_->write<eOBJSyntaxElement::poly_element_begin>();
+  fh.write<eOBJSyntaxElement::poly_element_begin>();
   if (!flip) {
     for (int j = 0; j < n; ++j) {
-      file_handler_->write<eOBJSyntaxElement::vertex_normal_indices>(
-          vert_indices[j] + vertex_offset, normal_indices[j] + normal_offset);
+      fh.write<eOBJSyntaxElement::vertex_normal_indices>(vert_indices[j] + vertex_offset,
+                                                         normal_indices[j] + normal_offset);
     }
   }
   else {
     for (int k = 0; k < n; ++k) {
       int j = k == 0 ? 0 : n - k;
-      file_handler_->write<eOBJSyntaxElement::vertex_normal_indices>(
-          vert_indices[j] + vertex_offset, normal_indices[j] + normal_offset);
+      fh.write<eOBJSyntaxElement::vertex_normal_indices>(vert_indices[j] + vertex_offset,
+                                                         normal_indices[j] + normal_offset);
     }
   }
-  file_handler_->write<eOBJSyntaxElement::poly_element_end>();
+  fh.write<eOBJSyntaxElement::poly_element_end>();
 }
 
-void OBJWriter::write_vert_uv_indices(Span<int> vert_indices,
+void OBJWriter::write_vert_uv_indices(FormatHandlerOBJ &fh,
+                                      Span<int> vert_indices,
                                       Span<int> uv_indices,
                                       Span<int> /*normal_indices*/,
                                       bool flip) const
@@ -122,43 +152,44 @@ void OBJWriter::write_vert_uv_indices(Span<int> vert_indices,
   const int vertex_offset = index_offsets_.vertex_offset + 1;
   const int uv_offset = index_offsets_.uv_vertex_offset + 1;
   const int n = vert_indices.size();
-  file_handler_->write<eOBJSyntaxElement::poly_element_begin>();
+  fh.write<eOBJSyntaxElement::poly_element_begin>();
   if (!flip) {
     for (int j = 0; j < n; ++j) {
-      file_handler_->write<eOBJSyntaxElement::vertex_uv_indices>(vert_indices[j] + vertex_offset,
-                                                                 uv_indices[j] + uv_offset);
+      fh.write<eOBJSyntaxElement::vertex_uv_indices>(vert_indices[j] + vertex_offset,
+                                                     uv_indices[j] + uv_offset);
     }
   }
   else {
     for (int k = 0; k < n; ++k) {
       int j = k == 0 ? 0 : n - k;
-      file_handler_->write<eOBJSyntaxElement::vertex_uv_indices>(vert_indices[j] + vertex_offset,
-                                                                 uv_indices[j] + uv_offset);
+      fh.write<eOBJSyntaxElement::vertex_uv_indices>(vert_indices[j] + vertex_offset,
+                                                     uv_indices[j] + uv_offset);
     }
   }
-  file_handler_->write<eOBJSyntaxElement::poly_element_end>();
+  fh.write<eOBJSyntaxElement::poly_element_end>();
 }
 
-void OBJWriter::write_vert_indices(Span<int> vert_indices,
+void OBJWriter::write_vert_indices(FormatHandlerOBJ &fh,
+                                   Span<int> vert_indices,
                                    Span<int> /*uv_indices*/,
                                    Span<int> /*normal_indices*/,
                                    bool flip) const
 {
   const int vertex_offset = index_offsets_.vertex_offset + 1;
   const int n = vert_indices.size();
-  file_handler_->write<eOBJSyntaxElement::poly_element_begin>();
+  fh.write<eOBJSyntaxElement::poly_element_begin>();
   if (!flip) {
     for (int j = 0; j < n; ++j) {
-      file_handler_->write<eOBJSyntaxElement::vertex_indices>(vert_indices[j] + vertex_offset);
+      fh.write<eOBJSyntaxElement::vertex_indices>(vert_indices[j] + vertex_offset);
     }
   }
   else {
     for (int k = 0; k < n; ++k) {
       int j = k == 0 ? 0 : n - k;
-      file_handler_->write<eOBJSyntaxElement::vertex_indices>(vert_indices[j] + vertex_offset);
+      fh.write<eOBJSyntaxElement::vertex_indices>(vert_indices[j] + vertex_offset);
     }
   }
-  file_handler_->write<eOBJSyntaxElement::poly_element_end>();
+  fh.write<eOBJSyntaxElement::poly_element_end>();
 }
 
 void OBJWriter::write_header() const
@@ -192,11 +223,13 @@ void OBJWriter::write_object_name(const OBJMesh &obj_mesh_data) const
 
 void OBJWriter::write_vertex_coords(const OBJMesh &obj_mesh_data) const
 {
-  const int tot_vertices = obj_mesh_data.tot_vertices();
-  for (int i = 0; i < tot_vertices; i++) {
-    float3 vertex = obj_mesh_data.calc_vertex_coords(i, export_params_.scaling_factor);
-    file_handler_->write<eOBJSyntaxElement::vertex_coords>(vertex[0], vertex[1], vertex[2]);
-  }
+  const float scaling_factor = export_params_.scaling_factor;
+  write_in_blocks(obj_mesh_data.tot_vertices(), [&](FormatHandlerOBJ &fh, IndexRange range) {
+    for (const int i : range) {
+      float3 vertex = obj_mesh_data.calc_vertex_coords(i, scaling_factor);
+      fh.write<eOBJSyntaxElement::vertex_coords>(vertex[0], vertex[1], vertex[2]);
+    }
+  });
 }
 
 void OBJWriter::write_uv_coords(OBJMesh &r_obj_mesh_data) const
@@ -205,9 +238,11 @@ void OBJWriter::write_uv_coords(OBJMesh &r_obj_mesh_data) const
   /* UV indices are calculated and stored in an OBJMesh member here. */
   r_obj_mesh_data.store_uv_coords_and_indices(uv_coords);
 
-  for (const std::array<float, 2> &uv_vertex : uv_coords) {
-    file_handler_->write<eOBJSyntaxElement::uv_vertex_coords>(uv_vertex[0], uv_vertex[1]);
-  }
+  write_in_blocks(uv_coords.size(), [&](FormatHandlerOBJ &fh, IndexRange range) {
+    for (const std::array<float, 2> &uv_vertex : uv_coords.as_span().slice(range)) {
+      fh.write<eOBJSyntaxElement::uv_vertex_coords>(uv_vertex[0], uv_vertex[1]);
+    }
+  });
 }
 
 void OBJWriter::write_poly_normals(OBJMesh &obj_mesh_data)
@@ -215,37 +250,50 @@ void OBJWriter::write_poly_normals(OBJMesh &obj_mesh_data)
   obj_mesh_data.ensure_mesh_normals();
   Vector<float3> normals;
   obj_mesh_data.store_normal_coords_and_indices(normals);
-  for (const float3 &normal : normals) {
-    file_handler_->write<eOBJSyntaxElement::normal>(normal[0], normal[1], normal[2]);
-  }
+  write_in_blocks(normals.size(), [&](FormatHandlerOBJ &fh, IndexRange range) {
+    for (const float3 &normal : normals.as_span().slice(range)) {
+      fh.write<eOBJSyntaxElement::normal>(normal[0], normal[1], normal[2]);
+    }
+  });
 }
 
-int OBJWriter::write_smooth_group(const OBJMesh &obj_mesh_data,
-                                  const int poly_index,
-                                  const int last_poly_smooth_group) const
+/**
+ * Smooth group of a polygon as it is written to the file, see #OBJWriter::write_smooth_group.
+ */
+static int poly_smooth_group(const OBJMesh &obj_mesh_data,
+                             const OBJExportParams &export_params,
+                             const int poly_index)
 {
-  int current_group = SMOOTH_GROUP_DISABLED;
-  if (!export_params_.export_smooth_groups && obj_mesh_data.is_ith_poly_smooth(poly_index)) {
-    /* Smooth group calculation is disabled, but polygon is smooth-shaded. */
-    current_group = SMOOTH_GROUP_DEFAULT;
+  if (!obj_mesh_data.is_ith_poly_smooth(poly_index)) {
+    return SMOOTH_GROUP_DISABLED;
   }
-  else if (obj_mesh_data.is_ith_poly_smooth(poly_index)) {
-    /* Smooth group calc is enabled and polygon is smooth–shaded, so find the group. */
-    current_group = obj_mesh_data.ith_smooth_group(poly_index);
+  if (!export_params.export_smooth_groups) {
+    /* Smooth group calculation is disabled, but polygon is smooth-shaded. */
+    return SMOOTH_GROUP_DEFAULT;
   }
+  /* Smooth group calc is enabled and polygon is smooth–shaded, so find the group. */
+  return obj_mesh_data.ith_smooth_group(poly_index);
+}
 
+int OBJWriter::write_smooth_group(FormatHandlerOBJ &fh,
+                                  const OBJMesh &obj_mesh_data,
+                                  const int poly_index,
+                                  const int last_poly_smooth_group) const
+{
+  const int current_group = poly_smooth_group(obj_mesh_data, export_params_, poly_index);
   if (current_group == last_poly_smooth_group) {
     /* Group has already been written, even if it is "s 0". */
     return current_group;
   }
-  file_handler_->write<eOBJSyntaxElement::smooth_group>(current_group);
+  fh.write<eOBJSyntaxElement::smooth_group>(current_group);
   return current_group;
 }
 
-int16_t OBJWriter::write_poly_material(const OBJMesh &obj_mesh_data,
+int16_t OBJWriter::write_poly_material(FormatHandlerOBJ &fh,
+                                       const OBJMesh &obj_mesh_data,
                                        const int poly_index,
                                        const int16_t last_poly_mat_nr,
-                                       std::function<const char *(int)> matname_fn) const
+                                       const std::function<const char *(int)> &matname_fn) const
 {
   if (!export_params_.export_materials || obj_mesh_data.tot_materials() <= 0) {
     return last_poly_mat_nr;
@@ -257,7 +305,7 @@ int16_t OBJWriter::write_poly_material(const OBJMesh &obj_mesh_data,
     return current_mat_nr;
   }
   if (current_mat_nr == NOT_FOUND) {
-    file_handler_->write<eOBJSyntaxElement::poly_usemtl>(MATERIAL_GROUP_DISABLED);
+    fh.write<eOBJSyntaxElement::poly_usemtl>(MATERIAL_GROUP_DISABLED);
     return current_mat_nr;
   }
   const char *mat_name = matname_fn(current_mat_nr);
@@ -266,14 +314,15 @@ int16_t OBJWriter::write_poly_material(const OBJMesh &obj_mesh_data,
   }
   if (export_params_.export_material_groups) {
     const std::string object_name = obj_mesh_data.get_object_name();
-    file_handler_->write<eOBJSyntaxElement::object_group>(object_name + "_" + mat_name);
+    fh.write<eOBJSyntaxElement::object_group>(object_name + "_" + mat_name);
   }
-  file_handler_->write<eOBJSyntaxElement::poly_usemtl>(mat_name);
+  fh.write<eOBJSyntaxElement::poly_usemtl>(mat_name);
 
   return current_mat_nr;
 }
 
-int16_t OBJWriter::write_vertex_group(const OBJMesh &obj_mesh_data,
+int16_t OBJWriter::write_vertex_group(FormatHandlerOBJ &fh,
+                                      const OBJMesh &obj_mesh_data,
                                       const int poly_index,
                                       const int16_t last_poly_vertex_group) const
 {
@@ -287,10 +336,10 @@ int16_t OBJWriter::write_vertex_group(const OBJMesh &obj_mesh_data,
     return current_group;
   }
   if (current_group == NOT_FOUND) {
-    file_handler_->write<eOBJSyntaxElement::object_group>(DEFORM_GROUP_DISABLED);
+    fh.write<eOBJSyntaxElement::object_group>(DEFORM_GROUP_DISABLED);
     return current_group;
   }
-  file_handler_->write<eOBJSyntaxElement::object_group>(
+  fh.write<eOBJSyntaxElement::object_group>(
       obj_mesh_data.get_poly_deform_group_name(current_group));
   return current_group;
 }
@@ -315,50 +364,67 @@ OBJWriter::func_vert_uv_normal_indices OBJWriter::get_poly_element_writer(
 }
 
 void OBJWriter::write_poly_elements(const OBJMesh &obj_mesh_data,
-                                    std::function<const char *(int)> matname_fn)
+                                    const std::function<const char *(int)> &matname_fn) const
 {
-  int last_poly_smooth_group = NEGATIVE_INIT;
-  int16_t last_poly_vertex_group = NEGATIVE_INIT;
-  int16_t last_poly_mat_nr = NEGATIVE_INIT;
-
   const func_vert_uv_normal_indices poly_element_writer = get_poly_element_writer(
       obj_mesh_data.tot_uv_vertices());
+  const bool use_materials = export_params_.export_materials &&
+                             obj_mesh_data.tot_materials() > 0;
+
+  write_in_blocks(obj_mesh_data.tot_polygons(), [&](FormatHandlerOBJ &fh, IndexRange range) {
+    int last_poly_smooth_group = NEGATIVE_INIT;
+    int16_t last_poly_vertex_group = NEGATIVE_INIT;
+    int16_t last_poly_mat_nr = NEGATIVE_INIT;
+    if (range.start() > 0) {
+      /* Continue with the groups of the last polygon of the previous block, so the groups are
+       * written exactly like when all polygons are written at once. */
+      const int prev_i = obj_mesh_data.remap_poly_index(range.start() - 1);
+      last_poly_smooth_group = poly_smooth_group(obj_mesh_data, export_params_, prev_i);
+      if (export_params_.export_vertex_groups) {
+        last_poly_vertex_group = obj_mesh_data.get_poly_deform_group_index(prev_i);
+      }
+      if (use_materials) {
+        last_poly_mat_nr = obj_mesh_data.ith_poly_matnr(prev_i);
+      }
+    }
 
-  const int tot_polygons = obj_mesh_data.tot_polygons();
-  for (int idx = 0; idx < tot_polygons; idx++) {
-    /* Polygon order for writing into the file is not necessarily the same
-     * as order in the mesh; it will be sorted by material indices. Remap current
-     * index here according to the order. */
-    int i = obj_mesh_data.remap_poly_index(idx);
-
-    Vector<int> poly_vertex_indices = obj_mesh_data.calc_poly_vertex_indices(i);
-    Span<int> poly_uv_indices = obj_mesh_data.calc_poly_uv_indices(i);
-    Vector<int> poly_normal_indices = obj_mesh_data.calc_poly_normal_indices(i);
-
-    last_poly_smooth_group = write_smooth_group(obj_mesh_data, i, last_poly_smooth_group);
-    last_poly_vertex_group = write_vertex_group(obj_mesh_data, i, last_poly_vertex_group);
-    last_poly_mat_nr = write_poly_material(obj_mesh_data, i, last_poly_mat_nr, matname_fn);
-    (this->*poly_element_writer)(poly_vertex_indices,
-                                 poly_uv_indices,
-                                 poly_normal_indices,
-                                 obj_mesh_data.is_mirrored_transform());
-  }
+    for (const int idx : range) {
+      /* Polygon order for writing into the file is not necessarily the same
+       * as order in the mesh; it will be sorted by material indices. Remap current
+       * index here according to the order. */
+      const int i = obj_mesh_data.remap_poly_index(idx);
+
+      Vector<int> poly_vertex_indices = obj_mesh_data.calc_poly_vertex_indices(i);
+      Span<int> poly_uv_indices = obj_mesh_data.calc_poly_uv_indices(i);
+      Vector<int> poly_normal_indices = obj_mesh_data.calc_poly_normal_indices(i);
+
+      last_poly_smooth_group = write_smooth_group(fh, obj_mesh_data, i, last_poly_smooth_group);
+      last_poly_vertex_group = write_vertex_group(fh, obj_mesh_data, i, last_poly_vertex_group);
+      last_poly_mat_nr = write_poly_material(fh, obj_mesh_data, i, last_poly_mat_nr, matname_fn);
+      (this->*poly_element_writer)(fh,
+                                   poly_vertex_indices,
+                                   poly_uv_indices,
+                                   poly_normal_indices,
+                                   obj_mesh_data.is_mirrored_transform());
+    }
+  });
 }
 
 void OBJWriter::write_edges_indices(const OBJMesh &obj_mesh_data) const
 {
   obj_mesh_data.ensure_mesh_edges();
-  const int tot_edges = obj_mesh_data.tot_edges();
-  for (int edge_index = 0; edge_index < tot_edges; edge_index++) {
-    const std::optional<std::array<int, 2>> vertex_indices =
-        obj_mesh_data.calc_loose_edge_vert_indices(edge_index);
-    if (!vertex_indices) {
-      continue;
+  const int vertex_offset = index_offsets_.vertex_offset + 1;
+  write_in_blocks(obj_mesh_data.tot_edges(), [&](FormatHandlerOBJ &fh, IndexRange range) {
+    for (const int edge_index : range) {
+      const std::optional<std::array<int, 2>> vertex_indices =
+          obj_mesh_data.calc_loose_edge_vert_indices(edge_index);
+      if (!vertex_indices) {
+        continue;
+      }
+      fh.write<eOBJSyntaxElement::edge>((*vertex_indices)[0] + vertex_offset,
+                                        (*vertex_indices)[1] + vertex_offset);
     }
-    file_handler_->write<eOBJSyntaxElement::edge>(
-        (*vertex_indices)[0] + index_offsets_.vertex_offset + 1,
-        (*vertex_indices)[1] + index_offsets_.vertex_offset + 1);
-  }
+  });
 }
 
 void OBJWriter::write_nurbs_curve(const OBJCurve &obj_nurbs_data) const
@@ -83,36 +83,16 @@ class OBJWriter : NonMovable, NonCopyable {
    * \note Normal indices ares stored here, but written with polygons later.
    */
   void write_poly_normals(OBJMesh &obj_mesh_data);
-  /**
-   * Write smooth group if polygon at the given index is shaded smooth else "s 0"
-   */
-  int write_smooth_group(const OBJMesh &obj_mesh_data,
-                         int poly_index,
-                         int last_poly_smooth_group) const;
-  /**
-   * Write material name and material group of a polygon in the .OBJ file.
-   * \return #mat_nr of the polygon at the given index.
-   * \note It doesn't write to the material library.
-   */
-  int16_t write_poly_material(const OBJMesh &obj_mesh_data,
-                              int poly_index,
-                              int16_t last_poly_mat_nr,
-                              std::function<const char *(int)> matname_fn) const;
-  /**
-   * Write the name of the deform group of a polygon.
-   */
-  int16_t write_vertex_group(const OBJMesh &obj_mesh_data,
-                             int poly_index,
-                             int16_t last_poly_vertex_group) const;
   /**
    * Write polygon elements with at least vertex indices, and conditionally with UV vertex
    * indices and polygon normal indices. Also write groups: smooth, vertex, material.
    * The matname_fn turns a 0-indexed material slot number in an Object into the
    * name used in the .obj file.
+   * Smooth, vertex and material groups are written before the first polygon of every group.
    * \note UV indices were stored while writing UV vertices.
    */
   void write_poly_elements(const OBJMesh &obj_mesh_data,
-                           std::function<const char *(int)> matname_fn);
+                           const std::function<const char *(int)> &matname_fn) const;
   /**
    * Write loose edges of a mesh as "l v1 v2".
    */
@@ -129,10 +109,44 @@ class OBJWriter : NonMovable, NonCopyable {
   void update_index_offsets(const OBJMesh &obj_mesh_data);
 
  private:
-  using func_vert_uv_normal_indices = void (OBJWriter::*)(Span<int> vert_indices,
+  using FormatHandlerOBJ = FormatHandler<eFileType::OBJ>;
+  using func_vert_uv_normal_indices = void (OBJWriter::*)(FormatHandlerOBJ &fh,
+                                                          Span<int> vert_indices,
                                                           Span<int> uv_indices,
                                                           Span<int> normal_indices,
                                                           bool flip) const;
+  /**
+   * Format `tot_elements` elements in blocks on multiple threads, and write the blocks to the
+   * file in order. `fn` is called with a #FormatHandler and the #IndexRange of elements to format
+   * into it. Only a limited number of blocks is kept in memory at the same time.
+   */
+  template<typename Fn> void write_in_blocks(int64_t tot_elements, const Fn &fn) const;
+
+  /**
+   * Write smooth group if polygon at the given index is shaded smooth else "s 0"
+   */
+  int write_smooth_group(FormatHandlerOBJ &fh,
+                         const OBJMesh &obj_mesh_data,
+                         int poly_index,
+                         int last_poly_smooth_group) const;
+  /**
+   * Write material name and material group of a polygon in the .OBJ file.
+   * \return #mat_nr of the polygon at the given index.
+   * \note It doesn't write to the material library.
+   */
+  int16_t write_poly_material(FormatHandlerOBJ &fh,
+                              const OBJMesh &obj_mesh_data,
+                              int poly_index,
+                              int16_t last_poly_mat_nr,
+                              const std::function<const char *(int)> &matname_fn) const;
+  /**
+   * Write the name of the deform group of a polygon.
+   */
+  int16_t write_vertex_group(FormatHandlerOBJ &fh,
+                             const OBJMesh &obj_mesh_data,
+                             int poly_index,
+                             int16_t last_poly_vertex_group) const;
+
   /**
    * \return Writer function with appropriate polygon-element syntax.
    */
@@ -141,28 +155,32 @@ class OBJWriter : NonMovable, NonCopyable {
   /**
    * Write one line of polygon indices as "f v1/vt1/vn1 v2/vt2/vn2 ...".
    */
-  void write_vert_uv_normal_indices(Span<int> vert_indices,
+  void write_vert_uv_normal_indices(FormatHandlerOBJ &fh,
+                                    Span<int> vert_indices,
                                     Span<int> uv_indices,
                                     Span<int> normal_indices,
                                     bool flip) const;
   /**
    * Write one line of polygon indices as "f v1//vn1 v2//vn2 ...".
    */
-  void write_vert_normal_indices(Span<int> vert_indices,
+  void write_vert_normal_indices(FormatHandlerOBJ &fh,
+                                 Span<int> vert_indices,
                                  Span<int> /*uv_indices*/,
                                  Span<int> normal_indices,
                                  bool flip) const;
   /**
    * Write one line of polygon indices as "f v1/vt1 v2/vt2 ...".
    */
-  void write_vert_uv_indices(Span<int> vert_indices,
+  void write_vert_uv_indices(FormatHandlerOBJ &fh,
+                             Span<int> vert_indices,
                              Span<int> uv_indices,
                              Span<int> /*normal_indices*/,
                              bool flip) const;
   /**
    * Write one line of polygon indices as "f v1 v2 ...".
    */
-  void write_vert_indices(Span<int> vert_indices,
+  void write_vert_indices(FormatHandlerOBJ &fh,
+                          Span<int> vert_indices,
                           Span<int> /*uv_indices*/,
                           Span<int> /*normal_indices*/,
                           bool flip) const;
@@ -20,7 +20,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <iostream>
 #include <string>
 #include <system_error>
 #include <type_traits>
@@ -29,6 +32,7 @@
 #include "BLI_fileops.h"
 #include "BLI_string_ref.hh"
 #include "BLI_utility_mixins.hh"
+#include "BLI_vector.hh"
 
 namespace blender::io::obj {
 
@@ -266,31 +270,19 @@ constexpr FormattingSyntax syntax_elem_to_formatting(const eMTLSyntaxElement key
 }
 
 /**
- * File format and syntax agnostic file writer.
+ * File format and syntax agnostic text formatter.
+ *
+ * Formats into blocks of memory instead of a file, so that separate parts of a file can be
+ * formatted on different threads and written to the file in order afterwards.
  */
-template<eFileType filetype> class FormattedFileHandler : NonCopyable, NonMovable {
+template<eFileType filetype, size_t buffer_chunk_size = 64 * 1024>
+class FormatHandler : NonCopyable, NonMovable {
  private:
-  std::FILE *outfile_ = nullptr;
-  std::string outfile_path_;
+  /** Lines longer than this are formatted into a heap allocation instead. */
+  static constexpr int line_buffer_size = 256;
+  Vector<Vector<char>> blocks_;
 
  public:
-  FormattedFileHandler(std::string outfile_path) noexcept(false)
-      : outfile_path_(std::move(outfile_path))
-  {
-    outfile_ = BLI_fopen(outfile_path_.c_str(), "w");
-    if (!outfile_) {
-      throw std::system_error(errno, std::system_category(), "Cannot open file " + outfile_path_);
-    }
-  }
-
-  ~FormattedFileHandler()
-  {
-    if (outfile_ && std::fclose(outfile_)) {
-      std::cerr << "Error: could not close the file '" << outfile_path_
-                << "'  properly, it may be corrupted." << std::endl;
-    }
-  }
-
   /**
    * Example invocation: `writer->write<eMTLSyntaxElement::newmtl>("foo")`.
    *
@@ -298,7 +290,7 @@ template<eFileType filetype> class FormattedFileHandler : NonCopyable, NonMovabl
    * `eFileType::MTL`.
    */
   template<typename FileTypeTraits<filetype>::SyntaxType key, typename... T>
-  constexpr void write(T &&...args) const
+  constexpr void write(T &&...args)
   {
     /* Get format syntax, number of arguments expected and whether types of given arguments are
      * valid.
@@ -311,6 +303,35 @@ template<eFileType filetype> class FormattedFileHandler : NonCopyable, NonMovabl
     write_impl(fmt_nargs_valid.fmt, std::forward<T>(args)...);
   }
 
+  bool is_empty() const
+  {
+    return blocks_.is_empty();
+  }
+
+  /** Move all formatted text of `other` to the end of this handler. */
+  void append_from(FormatHandler &other)
+  {
+    blocks_.extend(std::make_move_iterator(other.blocks_.begin()),
+                   std::make_move_iterator(other.blocks_.end()));
+    other.blocks_.clear();
+  }
+
+  /**
+   * Write all formatted text to the file and clear it from memory.
+   * \return False if the file could not be written to.
+   */
+  bool write_to_file(std::FILE *outfile)
+  {
+    bool ok = true;
+    for (const Vector<char> &block : blocks_) {
+      if (std::fwrite(block.data(), 1, block.size(), outfile) != block.size()) {
+        ok = false;
+      }
+    }
+    blocks_.clear();
+    return ok;
+  }
+
  private:
   /* Remove this after upgrading to C++20. */
   template<typename T> using remove_cvref_t = std::remove_cv_t<std::remove_reference_t<T>>;
@@ -339,13 +360,82 @@ template<eFileType filetype> class FormattedFileHandler : NonCopyable, NonMovabl
     }
   }
 
-  template<typename... T> constexpr void write_impl(const char *fmt, T &&...args) const
+  /** Append `size` bytes, starting a new block when the current one is full. */
+  void append(const char *data, const int64_t size)
+  {
+    if (blocks_.is_empty() || blocks_.last().size() + size > buffer_chunk_size) {
+      blocks_.append_as();
+      blocks_.last().reserve(std::max<int64_t>(buffer_chunk_size, size));
+    }
+    blocks_.last().extend_unchecked(data, size);
+  }
+
+  template<typename... T> constexpr void write_impl(const char *fmt, T &&...args)
   {
     if constexpr (sizeof...(T) == 0) {
-      std::fputs(fmt, outfile_);
+      append(fmt, std::strlen(fmt));
     }
     else {
-      std::fprintf(outfile_, fmt, convert_to_primitive(std::forward<T>(args))...);
+      char line[line_buffer_size];
+      const int len = std::snprintf(
+          line, sizeof(line), fmt, convert_to_primitive(args)...);
+      if (len < 0) {
+        return;
+      }
+      if (len < line_buffer_size) {
+        append(line, len);
+        return;
+      }
+      /* Long strings like object or material names. */
+      Vector<char> long_line(len + 1);
+      std::snprintf(
+          long_line.data(), len + 1, fmt, convert_to_primitive(args)...);
+      append(long_line.data(), len);
+    }
+  }
+};
+
+/**
+ * File format and syntax agnostic file writer.
+ *
+ * Text is formatted into memory and written to the file when other formatted text is appended
+ * with #append_and_flush, or when the handler is destructed.
+ */
+template<eFileType filetype> class FormattedFileHandler : public FormatHandler<filetype> {
+ private:
+  std::FILE *outfile_ = nullptr;
+  std::string outfile_path_;
+
+ public:
+  FormattedFileHandler(std::string outfile_path) noexcept(false)
+      : outfile_path_(std::move(outfile_path))
+  {
+    outfile_ = BLI_fopen(outfile_path_.c_str(), "w");
+    if (!outfile_) {
+      throw std::system_error(errno, std::system_category(), "Cannot open file " + outfile_path_);
+    }
+  }
+
+  ~FormattedFileHandler()
+  {
+    if (!outfile_) {
+      return;
+    }
+    const bool write_ok = this->write_to_file(outfile_);
+    if (std::fclose(outfile_) || !write_ok) {
+      std::cerr << "Error: could not close the file '" << outfile_path_
+                << "'  properly, it may be corrupted." << std::endl;
+    }
+  }
+
+  /**
+   * Write the text formatted so far, followed by the text of `other`, to the file.
+   */
+  void append_and_flush(FormatHandler<filetype> &other)
+  {
+    this->append_from(other);
+    if (!this->write_to_file(outfile_)) {
+      std::cerr << "Error: could not write to the file '" << outfile_path_ << "'." << std::endl;
     }
   }
 };
@@ -0,0 +1,476 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup obj
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include "BLI_array.hh"
+#include "BLI_fileops.h"
+#include "BLI_task.hh"
+
+#include "obj_import_file_reader.hh"
+#include "obj_import_string_utils.hh"
+
+namespace blender::io::obj {
+
+/** Material index of faces that use the material of an earlier chunk. */
+static const int MATERIAL_INHERITED = -2;
+
+enum class eRelativeIndexType {
+  Vertex,
+  UVVertex,
+  VertexNormal,
+  EdgeVertex1,
+  EdgeVertex2,
+};
+
+/**
+ * A negative (relative) index in a chunk, which can only be made absolute once the number
+ * of vertices in all previous chunks is known.
+ */
+struct RelativeIndex {
+  int object_index;
+  /** Index of the corner, or of the edge for #eRelativeIndexType::EdgeVertex1/2. */
+  int element_index;
+  eRelativeIndexType type;
+};
+
+/**
+ * Same as #Geometry, but with indices that are local to the chunk.
+ */
+struct ChunkObject {
+  /** False for the first object of a chunk, which continues the object of the previous chunk. */
+  bool starts_new_object = false;
+  std::string name;
+
+  /** Material indices point into #ParsedChunk.material_names. */
+  Vector<PolyElem> face_elements;
+  Vector<PolyCorner> face_corners;
+  Vector<int2> edges;
+  /** The first faces of the object that were added before any `s` line in this chunk. */
+  int inherited_smooth_faces = 0;
+
+  int vertex_declared_min = INT_MAX;
+  int vertex_declared_max = -1;
+
+  bool has_uv_vertices = false;
+  bool has_vertex_normals = false;
+};
+
+struct ParsedChunk {
+  Vector<float3> vertices;
+  Vector<float2> uv_vertices;
+  Vector<float3> vertex_normals;
+
+  Vector<ChunkObject> objects;
+  Vector<std::string> material_names;
+  Vector<RelativeIndex> relative_indices;
+
+  /** State at the end of the chunk, only meaningful when set by a line in this chunk. */
+  bool has_smooth_state = false;
+  bool shaded_smooth = false;
+  int material_index = MATERIAL_INHERITED;
+};
+
+/** State that carries over from one chunk to the next while merging. */
+struct MergeState {
+  bool shaded_smooth = false;
+  std::string material_name;
+};
+
+/**
+ * Convert an OBJ index (one based, or negative for relative to the current end) to a zero based
+ * one. Relative indices are stored local to the chunk and registered for fixing up later.
+ */
+static int resolve_index(const int index,
+                         const int64_t chunk_elements_num,
+                         ParsedChunk &chunk,
+                         const int element_index,
+                         const eRelativeIndexType type)
+{
+  if (index > 0) {
+    return index - 1;
+  }
+  if (index < 0) {
+    chunk.relative_indices.append({int(chunk.objects.size() - 1), element_index, type});
+    return int(chunk_elements_num + index);
+  }
+  /* Zero is not a valid OBJ index. */
+  return INT_MIN;
+}
+
+static void parse_face(StringRef line, ParsedChunk &chunk)
+{
+  ChunkObject &object = chunk.objects.last();
+
+  PolyElem face;
+  face.material_index = chunk.material_index;
+  face.shaded_smooth = chunk.shaded_smooth;
+  face.start_index = int(object.face_corners.size());
+  if (!chunk.has_smooth_state) {
+    object.inherited_smooth_faces++;
+  }
+
+  while (true) {
+    line = drop_whitespace(line);
+    if (line.is_empty()) {
+      break;
+    }
+    int value;
+    StringRef rest = parse_int(line, 0, value);
+    if (rest.begin() == line.begin()) {
+      /* Skip tokens that are not indices. */
+      line = drop_non_whitespace(line);
+      continue;
+    }
+    line = rest;
+    const int corner_index = int(object.face_corners.size());
+
+    PolyCorner corner;
+    corner.vert_index = resolve_index(
+        value, chunk.vertices.size(), chunk, corner_index, eRelativeIndexType::Vertex);
+    if (!line.is_empty() && line[0] == '/') {
+      line = line.drop_prefix(1);
+      if (!line.is_empty() && line[0] != '/') {
+        line = parse_int(line, 0, value);
+        corner.uv_vert_index = resolve_index(
+            value, chunk.uv_vertices.size(), chunk, corner_index, eRelativeIndexType::UVVertex);
+        object.has_uv_vertices = true;
+      }
+      if (!line.is_empty() && line[0] == '/') {
+        line = parse_int(line.drop_prefix(1), 0, value);
+        corner.vertex_normal_index = resolve_index(value,
+                                                   chunk.vertex_normals.size(),
+                                                   chunk,
+                                                   corner_index,
+                                                   eRelativeIndexType::VertexNormal);
+        object.has_vertex_normals = true;
+      }
+    }
+    object.face_corners.append(corner);
+    face.corner_count++;
+  }
+
+  object.face_elements.append(face);
+}
+
+static void parse_edges(StringRef line, ParsedChunk &chunk)
+{
+  ChunkObject &object = chunk.objects.last();
+  const int object_index = int(chunk.objects.size() - 1);
+  int prev_vert_index = 0;
+  bool prev_is_relative = false;
+  bool has_prev = false;
+  while (true) {
+    line = drop_whitespace(line);
+    if (line.is_empty()) {
+      break;
+    }
+    int value;
+    StringRef rest = parse_int(line, 0, value);
+    if (rest.begin() == line.begin()) {
+      line = drop_non_whitespace(line);
+      continue;
+    }
+    /* Texture coordinates of lines (`l v/vt`) are ignored. */
+    line = drop_non_whitespace(rest);
+
+    /* Edges are registered as relative separately, since each vertex is used by two edges. */
+    const bool is_relative = value < 0;
+    const int vert_index = value > 0 ? value - 1 :
+                           is_relative ? int(chunk.vertices.size()) + value :
+                                         INT_MIN;
+    if (has_prev) {
+      const int edge_index = int(object.edges.size());
+      object.edges.append({prev_vert_index, vert_index});
+      if (prev_is_relative) {
+        chunk.relative_indices.append({object_index, edge_index, eRelativeIndexType::EdgeVertex1});
+      }
+      if (is_relative) {
+        chunk.relative_indices.append({object_index, edge_index, eRelativeIndexType::EdgeVertex2});
+      }
+    }
+    prev_vert_index = vert_index;
+    prev_is_relative = is_relative;
+    has_prev = true;
+  }
+}
+
+static std::string parse_name(StringRef line)
+{
+  return drop_whitespace(line).trim();
+}
+
+/**
+ * Parse a part of the file consisting of complete lines, independent of all other chunks.
+ */
+static void parse_chunk(StringRef buffer, ParsedChunk &chunk)
+{
+  /* The first object continues whatever object was active at the end of the previous chunk. */
+  chunk.objects.append({});
+
+  const char *p = buffer.begin();
+  const char *end = buffer.end();
+  while (p < end) {
+    const char *line_end = find_line_end(p, end);
+    StringRef line = drop_whitespace(StringRef(p, line_end));
+    p = line_end < end ? line_end + 1 : end;
+    if (line.is_empty() || line[0] == '#') {
+      continue;
+    }
+
+    const StringRef rest = drop_non_whitespace(line);
+    const StringRef keyword(line.begin(), rest.begin());
+    if (keyword == "v") {
+      float3 co;
+      parse_floats(rest, 0.0f, co, 3);
+      ChunkObject &object = chunk.objects.last();
+      const int vert_index = int(chunk.vertices.size());
+      object.vertex_declared_min = std::min(object.vertex_declared_min, vert_index);
+      object.vertex_declared_max = std::max(object.vertex_declared_max, vert_index);
+      chunk.vertices.append(co);
+    }
+    else if (keyword == "vt") {
+      float2 uv;
+      parse_floats(rest, 0.0f, uv, 2);
+      chunk.uv_vertices.append(uv);
+    }
+    else if (keyword == "vn") {
+      float3 normal;
+      parse_floats(rest, 0.0f, normal, 3);
+      chunk.vertex_normals.append(normal);
+    }
+    else if (keyword == "f") {
+      parse_face(rest, chunk);
+    }
+    else if (keyword == "l") {
+      parse_edges(rest, chunk);
+    }
+    else if (keyword == "o") {
+      ChunkObject object;
+      object.starts_new_object = true;
+      object.name = parse_name(rest);
+      chunk.objects.append(std::move(object));
+    }
+    else if (keyword == "s") {
+      const StringRef value = drop_whitespace(rest).trim();
+      chunk.has_smooth_state = true;
+      chunk.shaded_smooth = !(value == "off" || value == "0" || value.is_empty());
+    }
+    else if (keyword == "usemtl") {
+      const std::string name = parse_name(rest);
+      int index = chunk.material_names.first_index_of_try(name);
+      if (index == -1) {
+        index = int(chunk.material_names.append_and_get_index(name));
+      }
+      chunk.material_index = index;
+    }
+    /* Other keywords (groups, material libraries, free-form geometry...) are not supported. */
+  }
+}
+
+static int geometry_material_index(Geometry &geometry, const StringRef name)
+{
+  if (name.is_empty()) {
+    return -1;
+  }
+  for (const int i : geometry.material_names.index_range()) {
+    if (geometry.material_names[i] == name) {
+      return i;
+    }
+  }
+  return int(geometry.material_names.append_and_get_index(name));
+}
+
+/**
+ * Append the contents of a chunk to the geometries, in file order.
+ */
+static void merge_chunk(ParsedChunk &chunk,
+                        MergeState &state,
+                        Vector<std::unique_ptr<Geometry>> &r_all_geometries,
+                        GlobalVertices &r_global_vertices)
+{
+  const int vertex_offset = int(r_global_vertices.vertices.size());
+  const int uv_vertex_offset = int(r_global_vertices.uv_vertices.size());
+  const int vertex_normal_offset = int(r_global_vertices.vertex_normals.size());
+
+  for (const RelativeIndex &relative : chunk.relative_indices) {
+    ChunkObject &object = chunk.objects[relative.object_index];
+    switch (relative.type) {
+      case eRelativeIndexType::Vertex:
+        object.face_corners[relative.element_index].vert_index += vertex_offset;
+        break;
+      case eRelativeIndexType::UVVertex:
+        object.face_corners[relative.element_index].uv_vert_index += uv_vertex_offset;
+        break;
+      case eRelativeIndexType::VertexNormal:
+        object.face_corners[relative.element_index].vertex_normal_index += vertex_normal_offset;
+        break;
+      case eRelativeIndexType::EdgeVertex1:
+        object.edges[relative.element_index][0] += vertex_offset;
+        break;
+      case eRelativeIndexType::EdgeVertex2:
+        object.edges[relative.element_index][1] += vertex_offset;
+        break;
+    }
+  }
+
+  r_global_vertices.vertices.extend(chunk.vertices);
+  r_global_vertices.uv_vertices.extend(chunk.uv_vertices);
+  r_global_vertices.vertex_normals.extend(chunk.vertex_normals);
+
+  for (ChunkObject &object : chunk.objects) {
+    const bool is_empty = object.face_elements.is_empty() && object.edges.is_empty() &&
+                          object.vertex_declared_max == -1;
+    if (!object.starts_new_object && is_empty) {
+      continue;
+    }
+    if (object.starts_new_object || r_all_geometries.is_empty()) {
+      std::unique_ptr<Geometry> geometry = std::make_unique<Geometry>();
+      geometry->geometry_name = object.name.empty() ? "OBJ Object" : object.name;
+      r_all_geometries.append(std::move(geometry));
+    }
+    Geometry &geometry = *r_all_geometries.last();
+
+    if (object.vertex_declared_max != -1) {
+      geometry.vertex_declared_min = std::min(geometry.vertex_declared_min,
+                                              object.vertex_declared_min + vertex_offset);
+      geometry.vertex_declared_max = std::max(geometry.vertex_declared_max,
+                                              object.vertex_declared_max + vertex_offset);
+    }
+    geometry.has_uv_vertices |= object.has_uv_vertices;
+    geometry.has_vertex_normals |= object.has_vertex_normals;
+
+    Vector<int> material_map(chunk.material_names.size(), -2);
+    int inherited_material = -2;
+    const int corner_offset = int(geometry.face_corners.size());
+    geometry.face_elements.reserve(geometry.face_elements.size() + object.face_elements.size());
+    for (const int i : object.face_elements.index_range()) {
+      PolyElem face = object.face_elements[i];
+      face.start_index += corner_offset;
+      if (i < object.inherited_smooth_faces) {
+        face.shaded_smooth = state.shaded_smooth;
+      }
+      if (face.material_index == MATERIAL_INHERITED) {
+        if (inherited_material == -2) {
+          inherited_material = geometry_material_index(geometry, state.material_name);
+        }
+        face.material_index = inherited_material;
+      }
+      else {
+        int &mapped = material_map[face.material_index];
+        if (mapped == -2) {
+          mapped = geometry_material_index(geometry, chunk.material_names[face.material_index]);
+        }
+        face.material_index = mapped;
+      }
+      geometry.face_elements.append_unchecked(face);
+    }
+    geometry.face_corners.extend(object.face_corners);
+    geometry.edges.extend(object.edges);
+  }
+
+  if (chunk.has_smooth_state) {
+    state.shaded_smooth = chunk.shaded_smooth;
+  }
+  if (chunk.material_index != MATERIAL_INHERITED) {
+    state.material_name = chunk.material_names[chunk.material_index];
+  }
+}
+
+OBJParser::OBJParser(const OBJImportParams &import_params,
+                     const size_t read_buffer_size,
+                     const size_t chunk_size)
+    : import_params_(import_params), read_buffer_size_(read_buffer_size), chunk_size_(chunk_size)
+{
+  obj_file_ = BLI_fopen(import_params_.filepath, "rb");
+  if (!obj_file_) {
+    throw std::system_error(errno,
+                            std::system_category(),
+                            std::string("Cannot read from OBJ file ") + import_params_.filepath);
+  }
+}
+
+OBJParser::~OBJParser()
+{
+  if (obj_file_) {
+    fclose(obj_file_);
+  }
+}
+
+void OBJParser::parse(Vector<std::unique_ptr<Geometry>> &r_all_geometries,
+                      GlobalVertices &r_global_vertices)
+{
+  Vector<char> buffer(read_buffer_size_);
+  /* Bytes of an incomplete line at the end of the previous block, moved to the start. */
+  size_t buffer_used = 0;
+  MergeState state;
+
+  while (true) {
+    const size_t read_len = fread(
+        buffer.data() + buffer_used, 1, buffer.size() - buffer_used, obj_file_);
+    const bool at_eof = buffer_used + read_len < size_t(buffer.size());
+    const char *buffer_start = buffer.data();
+    const char *buffer_end = buffer_start + buffer_used + read_len;
+
+    /* Only parse complete lines, the rest is parsed together with the next block. */
+    const char *block_end = at_eof ? buffer_end : find_last_line_start(buffer_start, buffer_end);
+    if (block_end == nullptr) {
+      /* A single line doesn't fit in the buffer. */
+      buffer_used = buffer.size();
+      buffer.resize(buffer.size() * 2);
+      continue;
+    }
+
+    /* Split the block at line boundaries. */
+    Vector<StringRef> chunks;
+    const char *p = buffer_start;
+    while (p < block_end) {
+      const char *chunk_end = block_end;
+      if (size_t(block_end - p) > chunk_size_) {
+        chunk_end = find_last_line_start(p, p + chunk_size_);
+        if (chunk_end == nullptr) {
+          chunk_end = std::min(find_line_end(p, block_end) + 1, block_end);
+        }
+      }
+      chunks.append(StringRef(p, chunk_end));
+      p = chunk_end;
+    }
+
+    Array<ParsedChunk> parsed_chunks(chunks.size());
+    threading::parallel_for(chunks.index_range(), 1, [&](IndexRange range) {
+      for (const int64_t i : range) {
+        parse_chunk(chunks[i], parsed_chunks[i]);
+      }
+    });
+    for (ParsedChunk &chunk : parsed_chunks) {
+      merge_chunk(chunk, state, r_all_geometries, r_global_vertices);
+    }
+
+    if (at_eof) {
+      break;
+    }
+    buffer_used = size_t(buffer_end - block_end);
+    memmove(buffer.data(), block_end, buffer_used);
+  }
+}
+
+}  // namespace blender::io::obj
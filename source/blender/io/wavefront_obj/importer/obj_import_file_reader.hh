@@ -0,0 +1,67 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup obj
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <memory>
+
+#include "BLI_utility_mixins.hh"
+
+#include "IO_wavefront_obj.h"
+#include "obj_import_objects.hh"
+
+namespace blender::io::obj {
+
+/**
+ * Reads an OBJ file into #Geometry objects, streaming the file in large blocks.
+ *
+ * Every block is split at line boundaries into chunks that are parsed in parallel.
+ * Since OBJ indices are global and negative indices and `usemtl`/`s` states depend
+ * on earlier lines, the chunks are parsed independently and the results are stitched
+ * together in file order afterwards, which is cheap compared to parsing.
+ */
+class OBJParser : NonMovable, NonCopyable {
+ private:
+  const OBJImportParams &import_params_;
+  FILE *obj_file_ = nullptr;
+  /** Number of bytes read from the file at once, lines longer than this grow the buffer. */
+  size_t read_buffer_size_;
+  /** Bytes of each block parsed by a single task. */
+  size_t chunk_size_;
+
+ public:
+  /**
+   * Open the file, throws `std::system_error` when that fails.
+   */
+  OBJParser(const OBJImportParams &import_params,
+            size_t read_buffer_size = 64 * 1024 * 1024,
+            size_t chunk_size = 1024 * 1024) noexcept(false);
+  ~OBJParser();
+
+  /**
+   * Read the whole file, filling `r_all_geometries` in the order in which they appear
+   * and `r_global_vertices` with the vertex data shared by all of them.
+   */
+  void parse(Vector<std::unique_ptr<Geometry>> &r_all_geometries,
+             GlobalVertices &r_global_vertices);
+};
+
+}  // namespace blender::io::obj
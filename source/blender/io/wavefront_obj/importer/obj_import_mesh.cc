@@ -0,0 +1,308 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup obj
+ */
+
+#include "DNA_material_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_lib_id.h"
+#include "BKE_material.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+
+#include "BLI_math_matrix.h"
+#include "BLI_math_rotation.h"
+#include "BLI_task.hh"
+
+#include "obj_import_mesh.hh"
+
+namespace blender::io::obj {
+
+Mesh *MeshFromGeometry::create_mesh(const OBJImportParams &import_params)
+{
+  this->create_vertex_map();
+  if (tot_verts_ == 0) {
+    return nullptr;
+  }
+
+  Mesh *mesh = BKE_mesh_new_nomain(
+      tot_verts_, tot_loose_edges_, 0, tot_loops_, valid_faces_.size());
+  this->create_vertices(mesh);
+  this->create_polys_loops(mesh);
+  this->create_edges(mesh);
+  this->create_uv_verts(mesh);
+  this->create_normals(mesh);
+
+  if (import_params.validate_meshes) {
+    BKE_mesh_validate(mesh, false, true);
+  }
+  return mesh;
+}
+
+Object *MeshFromGeometry::create_object(Main *bmain,
+                                        Mesh *mesh,
+                                        Map<std::string, Material *> &materials,
+                                        const OBJImportParams &import_params)
+{
+  const char *name = mesh_geometry_.geometry_name.c_str();
+  Object *obj = BKE_object_add_only_object(bmain, OB_MESH, name);
+  Mesh *mesh_in_main = BKE_mesh_add(bmain, name);
+  obj->data = mesh_in_main;
+  BKE_mesh_nomain_to_mesh(mesh, mesh_in_main, obj, &CD_MASK_EVERYTHING, true);
+
+  this->create_materials(bmain, materials, obj);
+
+  float axes_transform[3][3];
+  unit_m3(axes_transform);
+  /* +Y-forward and +Z-up are the default Blender axis settings. */
+  mat3_from_axis_conversion(OBJ_AXIS_Y_FORWARD,
+                            OBJ_AXIS_Z_UP,
+                            import_params.forward_axis,
+                            import_params.up_axis,
+                            axes_transform);
+  /* mat3_from_axis_conversion returns a transposed matrix! */
+  transpose_m3(axes_transform);
+  float obmat[4][4];
+  unit_m4(obmat);
+  copy_m4_m3(obmat, axes_transform);
+  BKE_object_apply_mat4(obj, obmat, true, false);
+
+  return obj;
+}
+
+void MeshFromGeometry::create_vertex_map()
+{
+  const Span<PolyElem> faces = mesh_geometry_.face_elements;
+  const Span<PolyCorner> corners = mesh_geometry_.face_corners;
+  const int64_t tot_global_verts = global_vertices_.vertices.size();
+  auto is_valid_vert = [&](const int index) { return index >= 0 && index < tot_global_verts; };
+
+  /* Vertices declared while the object was active are only used when there are no faces or
+   * edges, files often declare all vertices before the objects that use them. */
+  const bool use_declared = mesh_geometry_.face_elements.is_empty() &&
+                            mesh_geometry_.edges.is_empty();
+  const int declared_min = mesh_geometry_.vertex_declared_min;
+  const int declared_max = use_declared ? std::min<int>(mesh_geometry_.vertex_declared_max,
+                                                        tot_global_verts - 1) :
+                                          -1;
+  int vert_min = declared_max >= declared_min ? declared_min : INT_MAX;
+  int vert_max = declared_max >= declared_min ? declared_max : -1;
+
+  valid_faces_.reserve(faces.size());
+  for (const int face_index : faces.index_range()) {
+    const PolyElem &face = faces[face_index];
+    if (face.corner_count < 3) {
+      continue;
+    }
+    bool is_valid = true;
+    int face_min = INT_MAX;
+    int face_max = -1;
+    for (const PolyCorner &corner : corners.slice(face.start_index, face.corner_count)) {
+      if (!is_valid_vert(corner.vert_index)) {
+        is_valid = false;
+        break;
+      }
+      face_min = std::min(face_min, corner.vert_index);
+      face_max = std::max(face_max, corner.vert_index);
+    }
+    if (is_valid) {
+      valid_faces_.append(face_index);
+      tot_loops_ += face.corner_count;
+      vert_min = std::min(vert_min, face_min);
+      vert_max = std::max(vert_max, face_max);
+    }
+  }
+  for (const int2 &edge : mesh_geometry_.edges) {
+    if (is_valid_vert(edge[0]) && is_valid_vert(edge[1]) && edge[0] != edge[1]) {
+      vert_min = std::min({vert_min, edge[0], edge[1]});
+      vert_max = std::max({vert_max, edge[0], edge[1]});
+      tot_loose_edges_++;
+    }
+  }
+  if (vert_max < vert_min) {
+    return;
+  }
+
+  /* Objects usually use a contiguous range of vertices, so an array is much cheaper than a map
+   * from global to local indices. */
+  vertex_map_offset_ = vert_min;
+  vertex_map_.reinitialize(vert_max - vert_min + 1);
+  vertex_map_.fill(-1);
+  for (int i = declared_min; i <= declared_max; i++) {
+    vertex_map_[i - vertex_map_offset_] = 0;
+  }
+  for (const int face_index : valid_faces_) {
+    const PolyElem &face = faces[face_index];
+    for (const PolyCorner &corner : corners.slice(face.start_index, face.corner_count)) {
+      vertex_map_[corner.vert_index - vertex_map_offset_] = 0;
+    }
+  }
+  for (const int2 &edge : mesh_geometry_.edges) {
+    if (is_valid_vert(edge[0]) && is_valid_vert(edge[1]) && edge[0] != edge[1]) {
+      vertex_map_[edge[0] - vertex_map_offset_] = 0;
+      vertex_map_[edge[1] - vertex_map_offset_] = 0;
+    }
+  }
+  /* Keep the order of the vertices in the file. */
+  for (int &new_index : vertex_map_) {
+    if (new_index == 0) {
+      new_index = tot_verts_++;
+    }
+  }
+}
+
+void MeshFromGeometry::create_vertices(Mesh *mesh)
+{
+  MutableSpan<MVert> verts{mesh->mvert, mesh->totvert};
+  const Span<float3> global_verts = global_vertices_.vertices;
+  threading::parallel_for(vertex_map_.index_range(), 4096, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      const int new_index = vertex_map_[i];
+      if (new_index != -1) {
+        copy_v3_v3(verts[new_index].co, global_verts[vertex_map_offset_ + i]);
+      }
+    }
+  });
+}
+
+void MeshFromGeometry::create_polys_loops(Mesh *mesh)
+{
+  const Span<PolyElem> faces = mesh_geometry_.face_elements;
+  const Span<PolyCorner> corners = mesh_geometry_.face_corners;
+  MutableSpan<MPoly> polys{mesh->mpoly, mesh->totpoly};
+  MutableSpan<MLoop> loops{mesh->mloop, mesh->totloop};
+
+  int loop_offset = 0;
+  for (const int i : valid_faces_.index_range()) {
+    polys[i].loopstart = loop_offset;
+    loop_offset += faces[valid_faces_[i]].corner_count;
+  }
+
+  threading::parallel_for(valid_faces_.index_range(), 1024, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      const PolyElem &face = faces[valid_faces_[i]];
+      MPoly &poly = polys[i];
+      poly.totloop = face.corner_count;
+      poly.mat_nr = std::max(face.material_index, 0);
+      poly.flag = face.shaded_smooth ? ME_SMOOTH : 0;
+      for (const int j : IndexRange(face.corner_count)) {
+        const PolyCorner &corner = corners[face.start_index + j];
+        loops[poly.loopstart + j].v = vertex_map_[corner.vert_index - vertex_map_offset_];
+      }
+    }
+  });
+}
+
+void MeshFromGeometry::create_edges(Mesh *mesh)
+{
+  const int64_t tot_global_verts = global_vertices_.vertices.size();
+  MutableSpan<MEdge> edges{mesh->medge, mesh->totedge};
+  int edge_index = 0;
+  for (const int2 &edge : mesh_geometry_.edges) {
+    if (edge[0] < 0 || edge[0] >= tot_global_verts || edge[1] < 0 ||
+        edge[1] >= tot_global_verts || edge[0] == edge[1]) {
+      continue;
+    }
+    MEdge &medge = edges[edge_index++];
+    medge.v1 = vertex_map_[edge[0] - vertex_map_offset_];
+    medge.v2 = vertex_map_[edge[1] - vertex_map_offset_];
+    medge.flag = ME_EDGEDRAW | ME_EDGERENDER;
+  }
+
+  /* Add the edges of faces, keeping the loose edges from above. */
+  BKE_mesh_calc_edges(mesh, true, false);
+  BKE_mesh_calc_edges_loose(mesh);
+}
+
+void MeshFromGeometry::create_uv_verts(Mesh *mesh)
+{
+  if (!mesh_geometry_.has_uv_vertices || valid_faces_.is_empty()) {
+    return;
+  }
+  const Span<PolyElem> faces = mesh_geometry_.face_elements;
+  const Span<PolyCorner> corners = mesh_geometry_.face_corners;
+  const Span<float2> global_uvs = global_vertices_.uv_vertices;
+  MLoopUV *mluv = static_cast<MLoopUV *>(CustomData_add_layer_named(
+      &mesh->ldata, CD_MLOOPUV, CD_CALLOC, nullptr, mesh->totloop, "UVMap"));
+  const Span<MPoly> polys{mesh->mpoly, mesh->totpoly};
+
+  threading::parallel_for(valid_faces_.index_range(), 1024, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      const PolyElem &face = faces[valid_faces_[i]];
+      for (const int j : IndexRange(face.corner_count)) {
+        const int uv_index = corners[face.start_index + j].uv_vert_index;
+        if (uv_index >= 0 && uv_index < global_uvs.size()) {
+          copy_v2_v2(mluv[polys[i].loopstart + j].uv, global_uvs[uv_index]);
+        }
+      }
+    }
+  });
+}
+
+void MeshFromGeometry::create_normals(Mesh *mesh)
+{
+  if (!mesh_geometry_.has_vertex_normals || valid_faces_.is_empty()) {
+    return;
+  }
+  const Span<PolyElem> faces = mesh_geometry_.face_elements;
+  const Span<PolyCorner> corners = mesh_geometry_.face_corners;
+  const Span<float3> global_normals = global_vertices_.vertex_normals;
+  const Span<MPoly> polys{mesh->mpoly, mesh->totpoly};
+
+  /* Zero vectors make the custom normal fall back to the automatically computed one. */
+  Array<float3> loop_normals(mesh->totloop, float3(0.0f));
+  threading::parallel_for(valid_faces_.index_range(), 1024, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      const PolyElem &face = faces[valid_faces_[i]];
+      for (const int j : IndexRange(face.corner_count)) {
+        const int normal_index = corners[face.start_index + j].vertex_normal_index;
+        if (normal_index >= 0 && normal_index < global_normals.size()) {
+          loop_normals[polys[i].loopstart + j] = global_normals[normal_index];
+        }
+      }
+    }
+  });
+
+  mesh->flag |= ME_AUTOSMOOTH;
+  BKE_mesh_set_custom_normals(mesh, reinterpret_cast<float(*)[3]>(loop_normals.data()));
+}
+
+void MeshFromGeometry::create_materials(Main *bmain,
+                                        Map<std::string, Material *> &materials,
+                                        Object *obj)
+{
+  for (const std::string &material_name : mesh_geometry_.material_names) {
+    bool is_new = false;
+    Material *mat = materials.lookup_or_add_cb(material_name, [&]() {
+      is_new = true;
+      return BKE_material_add(bmain, material_name.c_str());
+    });
+    BKE_object_material_slot_add(bmain, obj);
+    BKE_object_material_assign(bmain, obj, mat, obj->totcol, BKE_MAT_ASSIGN_USERPREF);
+    if (is_new) {
+      /* The material is only used by the objects it's assigned to. */
+      id_us_min(&mat->id);
+    }
+  }
+}
+
+}  // namespace blender::io::obj
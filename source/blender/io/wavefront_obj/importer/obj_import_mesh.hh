@@ -0,0 +1,87 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup obj
+ */
+
+#pragma once
+
+#include "BLI_array.hh"
+#include "BLI_map.hh"
+#include "BLI_utility_mixins.hh"
+
+#include "IO_wavefront_obj.h"
+#include "obj_import_objects.hh"
+
+struct Main;
+struct Material;
+struct Mesh;
+struct Object;
+
+namespace blender::io::obj {
+
+/**
+ * Creates a mesh directly from a #Geometry, without going through BMesh.
+ */
+class MeshFromGeometry : NonMovable, NonCopyable {
+ private:
+  const Geometry &mesh_geometry_;
+  const GlobalVertices &global_vertices_;
+
+  /** First global vertex index covered by #vertex_map_. */
+  int vertex_map_offset_ = 0;
+  /** Index of the mesh vertex for global vertex indices, -1 for vertices that are not used. */
+  Array<int> vertex_map_;
+  /** Faces that only reference existing vertices and have at least three corners. */
+  Vector<int> valid_faces_;
+  int tot_verts_ = 0;
+  int tot_loops_ = 0;
+  int tot_loose_edges_ = 0;
+
+ public:
+  MeshFromGeometry(const Geometry &mesh_geometry, const GlobalVertices &global_vertices)
+      : mesh_geometry_(mesh_geometry), global_vertices_(global_vertices)
+  {
+  }
+
+  /**
+   * Build a mesh outside of #Main, or return null when the geometry has no vertices.
+   * Doesn't change any global data, so meshes of different objects can be built in parallel.
+   */
+  Mesh *create_mesh(const OBJImportParams &import_params);
+
+  /**
+   * Create an object in `bmain` that takes ownership of `mesh` from #create_mesh.
+   *
+   * \param materials: Materials created by this import, shared by all objects using them.
+   */
+  Object *create_object(Main *bmain,
+                        Mesh *mesh,
+                        Map<std::string, Material *> &materials,
+                        const OBJImportParams &import_params);
+
+ private:
+  void create_vertex_map();
+  void create_vertices(Mesh *mesh);
+  void create_polys_loops(Mesh *mesh);
+  void create_edges(Mesh *mesh);
+  void create_uv_verts(Mesh *mesh);
+  void create_normals(Mesh *mesh);
+  void create_materials(Main *bmain, Map<std::string, Material *> &materials, Object *obj);
+};
+
+}  // namespace blender::io::obj
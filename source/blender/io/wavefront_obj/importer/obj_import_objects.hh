@@ -0,0 +1,81 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup obj
+ */
+
+#pragma once
+
+#include <climits>
+#include <string>
+
+#include "BLI_math_vec_types.hh"
+#include "BLI_vector.hh"
+
+namespace blender::io::obj {
+
+/**
+ * List of all vertex, UV vertex and vertex normal coordinates in the file.
+ * Indices in the OBJ file are global over all objects, so these are shared by all #Geometry.
+ */
+struct GlobalVertices {
+  Vector<float3> vertices;
+  Vector<float2> uv_vertices;
+  Vector<float3> vertex_normals;
+};
+
+/**
+ * A face corner, as given in `f v/vt/vn` lines.
+ * All indices are zero based indices into #GlobalVertices, -1 when not specified.
+ */
+struct PolyCorner {
+  int vert_index;
+  int uv_vert_index = -1;
+  int vertex_normal_index = -1;
+};
+
+struct PolyElem {
+  /** Index into #Geometry.material_names, -1 when no material is used. */
+  int material_index = -1;
+  bool shaded_smooth = false;
+  /** First corner of this face in #Geometry.face_corners. */
+  int start_index = 0;
+  int corner_count = 0;
+};
+
+/**
+ * Everything between two `o` lines, which becomes one mesh object.
+ */
+struct Geometry {
+  std::string geometry_name;
+  /** Materials used by the faces in the order of their first `usemtl`, becomes the slots. */
+  Vector<std::string> material_names;
+
+  Vector<PolyElem> face_elements;
+  Vector<PolyCorner> face_corners;
+  /** Edges from `l` lines, as indices into #GlobalVertices.vertices. */
+  Vector<int2> edges;
+
+  /** Range of vertices that were declared while this object was active. */
+  int vertex_declared_min = INT_MAX;
+  int vertex_declared_max = -1;
+
+  bool has_uv_vertices = false;
+  bool has_vertex_normals = false;
+};
+
+}  // namespace blender::io::obj
@@ -0,0 +1,217 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup obj
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "obj_import_string_utils.hh"
+
+namespace blender::io::obj {
+
+static bool is_digit(const char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static bool is_whitespace(const char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+/** A backslash directly followed by the end of the line joins the line with the next one. */
+static bool is_line_continuation(const char *p, const char *end)
+{
+  if (*p != '\\') {
+    return false;
+  }
+  p++;
+  if (p < end && *p == '\r') {
+    p++;
+  }
+  return p == end || *p == '\n';
+}
+
+const char *find_line_end(const char *buffer, const char *end)
+{
+  const char *p = buffer;
+  while (p < end) {
+    if (*p == '\n') {
+      const char *prev = p - 1;
+      if (prev >= buffer && *prev == '\r') {
+        prev--;
+      }
+      if (prev < buffer || *prev != '\\') {
+        return p;
+      }
+    }
+    p++;
+  }
+  return end;
+}
+
+const char *find_last_line_start(const char *buffer, const char *end)
+{
+  const char *p = end;
+  while (p > buffer) {
+    p--;
+    if (*p != '\n') {
+      continue;
+    }
+    const char *prev = p - 1;
+    if (prev >= buffer && *prev == '\r') {
+      prev--;
+    }
+    if (prev < buffer || *prev != '\\') {
+      return p + 1;
+    }
+  }
+  return nullptr;
+}
+
+StringRef drop_whitespace(StringRef str)
+{
+  const char *p = str.begin();
+  const char *end = str.end();
+  while (p < end && (is_whitespace(*p) || is_line_continuation(p, end))) {
+    p++;
+  }
+  return StringRef(p, end);
+}
+
+StringRef drop_non_whitespace(StringRef str)
+{
+  const char *p = str.begin();
+  const char *end = str.end();
+  while (p < end && !is_whitespace(*p)) {
+    p++;
+  }
+  return StringRef(p, end);
+}
+
+StringRef parse_int(StringRef str, const int fallback, int &r_value)
+{
+  str = drop_whitespace(str);
+  const char *p = str.begin();
+  const char *end = str.end();
+
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+  if (p == end || !is_digit(*p)) {
+    r_value = fallback;
+    return str;
+  }
+  int64_t value = 0;
+  while (p < end && is_digit(*p)) {
+    if (value < INT32_MAX) {
+      value = value * 10 + (*p - '0');
+    }
+    p++;
+  }
+  value = std::min<int64_t>(value, INT32_MAX);
+  r_value = int(negative ? -value : value);
+  return StringRef(p, end);
+}
+
+StringRef parse_float(StringRef str, const float fallback, float &r_value)
+{
+  /* Exactly representable powers of ten in double precision. */
+  static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                 1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  str = drop_whitespace(str);
+  const char *p = str.begin();
+  const char *end = str.end();
+
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+
+  /* Only the first 19 significant digits fit in the mantissa, the rest can't change the
+   * result after rounding to single precision. */
+  uint64_t mantissa = 0;
+  int significant_digits = 0;
+  int exponent = 0;
+  bool has_digits = false;
+  while (p < end && is_digit(*p)) {
+    if (significant_digits < 19) {
+      mantissa = mantissa * 10 + uint64_t(*p - '0');
+      significant_digits += mantissa != 0;
+    }
+    else {
+      exponent++;
+    }
+    has_digits = true;
+    p++;
+  }
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && is_digit(*p)) {
+      if (significant_digits < 19) {
+        mantissa = mantissa * 10 + uint64_t(*p - '0');
+        significant_digits += mantissa != 0;
+        exponent--;
+      }
+      has_digits = true;
+      p++;
+    }
+  }
+  if (!has_digits) {
+    /* Not a number (e.g. "nan" or garbage), skip the token so parsing continues after it. */
+    r_value = fallback;
+    return drop_non_whitespace(str);
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    int exponent_value;
+    const StringRef rest = parse_int(StringRef(p + 1, end), 0, exponent_value);
+    if (rest.begin() != p + 1) {
+      exponent += std::clamp(exponent_value, -1000, 1000);
+      p = rest.begin();
+    }
+  }
+
+  double value = double(mantissa);
+  if (mantissa != 0 && exponent != 0) {
+    if (exponent > 0) {
+      value *= exponent <= 22 ? pow10[exponent] : std::pow(10.0, exponent);
+    }
+    else {
+      value /= -exponent <= 22 ? pow10[-exponent] : std::pow(10.0, -exponent);
+    }
+  }
+  r_value = float(negative ? -value : value);
+  return StringRef(p, end);
+}
+
+StringRef parse_floats(StringRef str, const float fallback, float *r_values, const int count)
+{
+  for (int i = 0; i < count; i++) {
+    str = parse_float(str, fallback, r_values[i]);
+  }
+  return str;
+}
+
+}  // namespace blender::io::obj
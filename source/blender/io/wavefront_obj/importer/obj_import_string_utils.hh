@@ -0,0 +1,80 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup obj
+ */
+
+#pragma once
+
+#include "BLI_string_ref.hh"
+
+/*
+ * Various text parsing utilities used by the OBJ importer.
+ * These are specialized for the OBJ format and don't depend on the locale,
+ * unlike the functions from the C standard library.
+ */
+
+namespace blender::io::obj {
+
+/**
+ * Find the end of the line starting at `buffer`. Lines ending with a backslash
+ * are continued on the next line, as allowed by the OBJ format.
+ *
+ * \return Pointer to the `\n` that ends the line, or `end` for the last line.
+ */
+const char *find_line_end(const char *buffer, const char *end);
+
+/**
+ * Find the start of the last line in `[buffer, end)` that is not continued on the next line,
+ * so everything before it can be parsed on its own.
+ *
+ * \return Pointer one past the `\n` ending the previous line, or nullptr when there is none.
+ */
+const char *find_last_line_start(const char *buffer, const char *end);
+
+/**
+ * Skip spaces, tabs and line continuations.
+ */
+StringRef drop_whitespace(StringRef str);
+
+/**
+ * Skip over everything that isn't whitespace.
+ */
+StringRef drop_non_whitespace(StringRef str);
+
+/**
+ * Parse an integer from the start of `str`, ending at whitespace or `/`.
+ *
+ * \param fallback: Value used when no number could be parsed.
+ * \return The rest of the string after the number.
+ */
+StringRef parse_int(StringRef str, int fallback, int &r_value);
+
+/**
+ * Parse a decimal floating point number (with optional exponent) from the start of `str`.
+ *
+ * \param fallback: Value used when no number could be parsed.
+ * \return The rest of the string after the number.
+ */
+StringRef parse_float(StringRef str, float fallback, float &r_value);
+
+/**
+ * Parse `count` whitespace separated floats, missing values are set to `fallback`.
+ */
+StringRef parse_floats(StringRef str, float fallback, float *r_values, int count);
+
+}  // namespace blender::io::obj
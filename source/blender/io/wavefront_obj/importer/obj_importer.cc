@@ -0,0 +1,120 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup obj
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <system_error>
+
+#include "DNA_collection_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_collection.h"
+#include "BKE_context.h"
+#include "BKE_layer.h"
+
+#include "BLI_map.hh"
+#include "BLI_task.hh"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+
+#include "obj_import_file_reader.hh"
+#include "obj_import_mesh.hh"
+#include "obj_importer.hh"
+
+namespace blender::io::obj {
+
+void importer_main(bContext *C, const OBJImportParams &import_params)
+{
+  importer_main(CTX_data_main(C), CTX_data_scene(C), CTX_data_view_layer(C), import_params);
+}
+
+void importer_main(Main *bmain,
+                   Scene *scene,
+                   ViewLayer *view_layer,
+                   const OBJImportParams &import_params)
+{
+  Vector<std::unique_ptr<Geometry>> all_geometries;
+  GlobalVertices global_vertices;
+  try {
+    OBJParser obj_parser{import_params};
+    obj_parser.parse(all_geometries, global_vertices);
+  }
+  catch (const std::system_error &ex) {
+    std::cerr << ex.code().category().name() << ": " << ex.what() << ": " << ex.code().message()
+              << std::endl;
+    return;
+  }
+
+  /* Objects with only vertices are point clouds when there is nothing else in the file,
+   * otherwise they are vertices declared before the objects that use them. */
+  auto has_elements = [](const std::unique_ptr<Geometry> &geometry) {
+    return !geometry->face_elements.is_empty() || !geometry->edges.is_empty();
+  };
+  const bool use_vertex_only_geometries = std::none_of(
+      all_geometries.begin(), all_geometries.end(), has_elements);
+  Vector<const Geometry *> geometries;
+  for (const std::unique_ptr<Geometry> &geometry : all_geometries) {
+    if (use_vertex_only_geometries || has_elements(geometry)) {
+      geometries.append(geometry.get());
+    }
+  }
+
+  /* Building the mesh data is independent for every object, only adding them to #Main is not
+   * thread-safe. */
+  Array<Mesh *> meshes(geometries.size(), nullptr);
+  Array<std::unique_ptr<MeshFromGeometry>> mesh_builders(geometries.size());
+  threading::parallel_for(geometries.index_range(), 1, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      mesh_builders[i] = std::make_unique<MeshFromGeometry>(*geometries[i], global_vertices);
+      meshes[i] = mesh_builders[i]->create_mesh(import_params);
+    }
+  });
+
+  Collection *collection = BKE_collection_add(
+      bmain, scene->master_collection, "OBJ import collection");
+  Map<std::string, Material *> materials;
+  Vector<Object *> objects;
+  for (const int64_t i : geometries.index_range()) {
+    if (meshes[i] == nullptr) {
+      continue;
+    }
+    Object *obj = mesh_builders[i]->create_object(bmain, meshes[i], materials, import_params);
+    BKE_collection_object_add(bmain, collection, obj);
+    objects.append(obj);
+  }
+
+  /* Sync the collection after all objects are created. */
+  BKE_layer_collection_sync(scene, view_layer);
+  /* After collection sync, select objects in the view layer and do DEG updates. */
+  for (Object *obj : objects) {
+    Base *base = BKE_view_layer_base_find(view_layer, obj);
+    BKE_view_layer_base_select_and_set_active(view_layer, base);
+
+    const int flags = ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY | ID_RECALC_ANIMATION |
+                      ID_RECALC_BASE_FLAGS;
+    DEG_id_tag_update_ex(bmain, &obj->id, flags);
+  }
+  DEG_id_tag_update(&collection->id, ID_RECALC_COPY_ON_WRITE);
+  DEG_id_tag_update(&scene->id, ID_RECALC_BASE_FLAGS);
+  DEG_relations_tag_update(bmain);
+}
+
+}  // namespace blender::io::obj
@@ -0,0 +1,45 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup obj
+ */
+
+#pragma once
+
+#include "IO_wavefront_obj.h"
+
+struct Main;
+struct Scene;
+struct ViewLayer;
+
+namespace blender::io::obj {
+
+/**
+ * Import the OBJ file given by `import_params.filepath` into the scene of the context.
+ */
+void importer_main(bContext *C, const OBJImportParams &import_params);
+
+/**
+ * Same as above, but without needing a context, all objects are added to a new collection in
+ * `scene` and selected in `view_layer`.
+ */
+void importer_main(Main *bmain,
+                   Scene *scene,
+                   ViewLayer *view_layer,
+                   const OBJImportParams &import_params);
+
+}  // namespace blender::io::obj
@@ -0,0 +1,251 @@
+/* Apache License, Version 2.0 */
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "testing/testing.h"
+#include "tests/blendfile_loading_base_test.h"
+
+#include "BKE_customdata.h"
+#include "BKE_lib_id.h"
+
+#include "BLI_fileops.h"
+#include "BLI_string.h"
+#include "BLI_vector.hh"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "obj_import_file_reader.hh"
+#include "obj_import_mesh.hh"
+#include "obj_import_string_utils.hh"
+
+namespace blender::io::obj {
+
+/* Relative to the release directory, see #blender::tests::flags_test_release_dir. */
+const char *const temp_import_file_path = "import_test.obj";
+
+struct ParsedFile {
+  Vector<std::unique_ptr<Geometry>> geometries;
+  GlobalVertices global_vertices;
+};
+
+/**
+ * Write `text` to a file and parse it. Small buffer and chunk sizes can be given to test that
+ * splitting the file doesn't change the result.
+ */
+static ParsedFile parse_text(const std::string &text,
+                             const size_t read_buffer_size = 64 * 1024 * 1024,
+                             const size_t chunk_size = 1024 * 1024)
+{
+  OBJImportParams params{};
+  const std::string filepath = blender::tests::flags_test_release_dir() + "/" +
+                               temp_import_file_path;
+  BLI_strncpy(params.filepath, filepath.c_str(), sizeof(params.filepath));
+  FILE *file = BLI_fopen(params.filepath, "wb");
+  EXPECT_NE(file, nullptr);
+  fwrite(text.data(), 1, text.size(), file);
+  fclose(file);
+
+  ParsedFile parsed;
+  {
+    OBJParser parser{params, read_buffer_size, chunk_size};
+    parser.parse(parsed.geometries, parsed.global_vertices);
+  }
+  BLI_delete(params.filepath, false, false);
+  return parsed;
+}
+
+const std::string cube_text =
+    "# A cube with two materials.\n"
+    "o Cube\n"
+    "v 1.0 1.0 -1.0\n"
+    "v 1.0 -1.0 -1.0\n"
+    "v 1.0 1.0 1.0\n"
+    "v 1.0 -1.0 1.0\n"
+    "v -1.0 1.0 -1.0\n"
+    "v -1.0 -1.0 -1.0\n"
+    "v -1.0 1.0 1.0\n"
+    "v -1.0 -1.0 1.0\n"
+    "vt 0.625 0.5\n"
+    "vt 0.875 0.5\n"
+    "vt 0.875 0.75\n"
+    "vt 0.625 0.75\n"
+    "vn 0.0 1.0 0.0\n"
+    "usemtl Red\n"
+    "s off\n"
+    "f 1/1/1 5/2/1 7/3/1 3/4/1\n"
+    "f 4 3 7 8\n"
+    "f 8 7 5 6\n"
+    "usemtl Green\n"
+    "s 1\n"
+    "f 6 2 4 8\n"
+    "f 2 1 3 4\n"
+    "f 6 5 1 2\n"
+    "o Wire\n"
+    "v 2.0 0.0 0.0\n"
+    "v 3.0 0.0 0.0\n"
+    "l -2 -1\n";
+
+TEST(obj_import_string_utils, parse_float)
+{
+  float value;
+  EXPECT_TRUE(parse_float("1.5", 0.0f, value).is_empty());
+  EXPECT_EQ(value, 1.5f);
+  parse_float("  -0.25", 0.0f, value);
+  EXPECT_EQ(value, -0.25f);
+  parse_float("+2e3", 0.0f, value);
+  EXPECT_EQ(value, 2000.0f);
+  parse_float("1.25E-2", 0.0f, value);
+  EXPECT_EQ(value, 0.0125f);
+  parse_float(".5", 0.0f, value);
+  EXPECT_EQ(value, 0.5f);
+  parse_float("0.1", 0.0f, value);
+  EXPECT_EQ(value, 0.1f);
+  parse_float("3.14159265358979323846264338327950288", 0.0f, value);
+  EXPECT_EQ(value, 3.14159265358979323846f);
+  parse_float("nan", 7.0f, value);
+  EXPECT_EQ(value, 7.0f);
+
+  float values[3];
+  const StringRef rest = parse_floats("1 2\\\n 3 4", 0.0f, values, 3);
+  EXPECT_EQ(values[0], 1.0f);
+  EXPECT_EQ(values[1], 2.0f);
+  EXPECT_EQ(values[2], 3.0f);
+  EXPECT_EQ(rest, " 4");
+}
+
+TEST(obj_import_string_utils, parse_int)
+{
+  int value;
+  EXPECT_EQ(parse_int("12/3", 0, value), "/3");
+  EXPECT_EQ(value, 12);
+  parse_int(" -7", 0, value);
+  EXPECT_EQ(value, -7);
+  parse_int("/", -1, value);
+  EXPECT_EQ(value, -1);
+}
+
+TEST(obj_import_string_utils, find_line_end)
+{
+  const StringRef text = "a\\\nb\nc\r\nd";
+  EXPECT_EQ(find_line_end(text.begin(), text.end()), text.begin() + 4);
+  EXPECT_EQ(find_last_line_start(text.begin(), text.end()), text.begin() + 8);
+  EXPECT_EQ(find_last_line_start(text.begin(), text.begin() + 4), nullptr);
+}
+
+TEST(obj_importer_parser, cube)
+{
+  ParsedFile parsed = parse_text(cube_text);
+  ASSERT_EQ(parsed.geometries.size(), 2);
+  EXPECT_EQ(parsed.global_vertices.vertices.size(), 10);
+  EXPECT_EQ(parsed.global_vertices.uv_vertices.size(), 4);
+  EXPECT_EQ(parsed.global_vertices.vertex_normals.size(), 1);
+
+  const Geometry &cube = *parsed.geometries[0];
+  EXPECT_EQ(cube.geometry_name, "Cube");
+  EXPECT_EQ(cube.face_elements.size(), 6);
+  EXPECT_EQ(cube.face_corners.size(), 24);
+  EXPECT_TRUE(cube.has_uv_vertices);
+  EXPECT_TRUE(cube.has_vertex_normals);
+  ASSERT_EQ(cube.material_names.size(), 2);
+  EXPECT_EQ(cube.material_names[0], "Red");
+  EXPECT_EQ(cube.material_names[1], "Green");
+  EXPECT_EQ(cube.face_elements[0].material_index, 0);
+  EXPECT_FALSE(cube.face_elements[0].shaded_smooth);
+  EXPECT_EQ(cube.face_elements[5].material_index, 1);
+  EXPECT_TRUE(cube.face_elements[5].shaded_smooth);
+  EXPECT_EQ(cube.face_corners[0].vert_index, 0);
+  EXPECT_EQ(cube.face_corners[0].uv_vert_index, 0);
+  EXPECT_EQ(cube.face_corners[0].vertex_normal_index, 0);
+  EXPECT_EQ(cube.face_corners[4].uv_vert_index, -1);
+
+  const Geometry &wire = *parsed.geometries[1];
+  EXPECT_EQ(wire.geometry_name, "Wire");
+  EXPECT_TRUE(wire.face_elements.is_empty());
+  ASSERT_EQ(wire.edges.size(), 1);
+  EXPECT_EQ(wire.edges[0], int2(8, 9));
+}
+
+TEST(obj_importer_parser, chunked_matches_whole)
+{
+  /* Negative indices, materials and smooth shading all depend on previous lines. */
+  std::string text;
+  for (int i = 0; i < 200; i++) {
+    text += "v " + std::to_string(i) + " 0.5 -1\n";
+    if (i % 7 == 0) {
+      text += "usemtl mat" + std::to_string(i % 3) + "\n";
+    }
+    if (i % 11 == 0) {
+      text += std::string("s ") + (i % 2 ? "off" : "1") + "\n";
+    }
+    if (i % 50 == 0) {
+      text += "o object" + std::to_string(i) + "\n";
+    }
+    if (i >= 3) {
+      text += "f -3 -2 \\\n -1\n";
+      text += "f " + std::to_string(i - 2) + " " + std::to_string(i) + " " +
+              std::to_string(i + 1) + "\n";
+    }
+  }
+
+  ParsedFile whole = parse_text(text);
+  ParsedFile chunked = parse_text(text, 64, 16);
+
+  EXPECT_EQ(whole.global_vertices.vertices.size(), 200);
+  EXPECT_EQ(chunked.global_vertices.vertices.size(), 200);
+  ASSERT_EQ(whole.geometries.size(), chunked.geometries.size());
+  for (const int64_t i : whole.geometries.index_range()) {
+    const Geometry &a = *whole.geometries[i];
+    const Geometry &b = *chunked.geometries[i];
+    EXPECT_EQ(a.geometry_name, b.geometry_name);
+    EXPECT_EQ(a.material_names, b.material_names);
+    ASSERT_EQ(a.face_elements.size(), b.face_elements.size());
+    ASSERT_EQ(a.face_corners.size(), b.face_corners.size());
+    for (const int64_t j : a.face_elements.index_range()) {
+      EXPECT_EQ(a.face_elements[j].material_index, b.face_elements[j].material_index);
+      EXPECT_EQ(a.face_elements[j].shaded_smooth, b.face_elements[j].shaded_smooth);
+      EXPECT_EQ(a.face_elements[j].start_index, b.face_elements[j].start_index);
+      EXPECT_EQ(a.face_elements[j].corner_count, b.face_elements[j].corner_count);
+    }
+    for (const int64_t j : a.face_corners.index_range()) {
+      EXPECT_EQ(a.face_corners[j].vert_index, b.face_corners[j].vert_index);
+    }
+  }
+}
+
+class obj_importer_mesh_test : public BlendfileLoadingBaseTest {
+};
+
+TEST_F(obj_importer_mesh_test, cube)
+{
+  ParsedFile parsed = parse_text(cube_text);
+  ASSERT_EQ(parsed.geometries.size(), 2);
+  OBJImportParams params{};
+
+  MeshFromGeometry cube_builder{*parsed.geometries[0], parsed.global_vertices};
+  Mesh *cube = cube_builder.create_mesh(params);
+  ASSERT_NE(cube, nullptr);
+  EXPECT_EQ(cube->totvert, 8);
+  EXPECT_EQ(cube->totedge, 12);
+  EXPECT_EQ(cube->totpoly, 6);
+  EXPECT_EQ(cube->totloop, 24);
+  EXPECT_EQ(cube->mpoly[5].mat_nr, 1);
+  EXPECT_TRUE(cube->mpoly[5].flag & ME_SMOOTH);
+  EXPECT_TRUE(CustomData_has_layer(&cube->ldata, CD_MLOOPUV));
+  EXPECT_TRUE(CustomData_has_layer(&cube->ldata, CD_CUSTOMLOOPNORMAL));
+  BKE_id_free(nullptr, cube);
+
+  /* Only the vertices used by the edge are part of the mesh. */
+  MeshFromGeometry wire_builder{*parsed.geometries[1], parsed.global_vertices};
+  Mesh *wire = wire_builder.create_mesh(params);
+  ASSERT_NE(wire, nullptr);
+  EXPECT_EQ(wire->totvert, 2);
+  EXPECT_EQ(wire->totedge, 1);
+  EXPECT_EQ(wire->totpoly, 0);
+  EXPECT_EQ(wire->mvert[1].co[0], 3.0f);
+  BKE_id_free(nullptr, wire);
+}
+
+}  // namespace blender::io::obj
@@ -138,6 +138,24 @@ void *DNA_struct_reconstruct(const struct DNA_ReconstructInfo *reconstruct_info,
                              int old_struct_nr,
                              int blocks,
                              const void *old_blocks);
+/**
+ * \return The size in bytes of a single struct reconstructed from \a old_struct_nr,
+ * zero when the struct doesn't exist in newsdna.
+ */
+int DNA_struct_reconstruct_size(const struct DNA_ReconstructInfo *reconstruct_info,
+                                int old_struct_nr);
+/**
+ * Same as #DNA_struct_reconstruct, but writes into \a new_blocks which must be zero initialized
+ * and large enough to hold \a blocks structs, see #DNA_struct_reconstruct_size.
+ *
+ * \note Only reads \a reconstruct_info, so separate ranges of the same array can be
+ * reconstructed from multiple threads.
+ */
+void DNA_struct_reconstruct_into(const struct DNA_ReconstructInfo *reconstruct_info,
+                                 int old_struct_nr,
+                                 int blocks,
+                                 const void *old_blocks,
+                                 void *new_blocks);
 
 /**
  * Returns the offset of the field with the specified name and type within the specified
@@ -46,6 +46,7 @@ struct MPoly;
 struct MVert;
 struct Material;
 struct Mesh;
+struct MeshLoopSplitCache;
 struct SubdivCCG;
 
 #
@@ -107,6 +108,12 @@ typedef struct Mesh_Runtime {
   /** Cache of non-manifold boundary data for Shrinkwrap Target Project. */
   struct ShrinkwrapBoundaryData *shrinkwrap_data;
 
+  /**
+   * Smooth fans of split normals, shared by meshes with the same topology.
+   * Defined in `mesh_normals.cc`.
+   */
+  struct MeshLoopSplitCache *loop_split_cache;
+
   /** Needed in case we need to lazily initialize the mesh. */
   CustomData_MeshMasks cd_mask_extra;
 
@@ -2302,7 +2302,11 @@ typedef struct NodesModifierData {
    * This can be used to help the user to debug a node tree.
    */
   void *runtime_eval_log;
-  void *_pad1;
+  /**
+   * #GeometryNodesCache with node results that are reused in the next evaluation.
+   * Only set on the original modifier.
+   */
+  void *runtime_cache;
 } NodesModifierData;
 
 typedef struct MeshToVolumeModifierData {
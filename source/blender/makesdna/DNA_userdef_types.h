@@ -666,7 +666,7 @@ typedef struct UserDef_Experimental {
   char use_sculpt_tools_tilt;
   char use_extended_asset_browser;
   char use_override_templates;
-  char _pad[1];
+  char use_undo_incremental_write;
   /** `makesdna` does not allow empty structs. */
 } UserDef_Experimental;
 
@@ -1662,6 +1662,24 @@ static IDProperty **rna_NodesModifier_properties(PointerRNA *ptr)
   NodesModifierSettings *settings = &nmd->settings;
   return &settings->properties;
 }
+
+static void rna_NodesModifier_node_statistics(NodesModifierData *nmd,
+                                              const char *node_path,
+                                              bool *r_found,
+                                              float *r_execution_time,
+                                              float *r_thread_time,
+                                              float *r_allocated_memory,
+                                              int *r_executions,
+                                              int *r_output_elements)
+{
+  NodesModifierNodeStats stats;
+  *r_found = MOD_nodes_node_stats_get(nmd, node_path, &stats);
+  *r_execution_time = (float)stats.execution_time;
+  *r_thread_time = (float)stats.thread_time;
+  *r_allocated_memory = (float)stats.allocated_bytes;
+  *r_executions = stats.executions;
+  *r_output_elements = (int)MIN2(stats.output_elements, INT_MAX);
+}
 #else
 
 static void rna_def_property_subdivision_common(StructRNA *srna)
@@ -6933,6 +6951,8 @@ static void rna_def_modifier_nodes(BlenderRNA *brna)
 {
   StructRNA *srna;
   PropertyRNA *prop;
+  FunctionRNA *func;
+  PropertyRNA *parm;
 
   srna = RNA_def_struct(brna, "NodesModifier", "Modifier");
   RNA_def_struct_ui_text(srna, "Nodes Modifier", "");
@@ -6949,6 +6969,67 @@ static void rna_def_modifier_nodes(BlenderRNA *brna)
   RNA_def_property_update(prop, 0, "rna_NodesModifier_node_group_update");
 
   RNA_define_lib_overridable(false);
+
+  func = RNA_def_function(srna, "node_statistics", "rna_NodesModifier_node_statistics");
+  RNA_def_function_ui_description(
+      func,
+      "Get the measurements of a node from the last evaluation of the modifier that was logged. "
+      "Evaluations are only logged when the object is evaluated in an active dependency graph");
+  parm = RNA_def_string(func,
+                        "node_path",
+                        NULL,
+                        0,
+                        "Node Path",
+                        "Names of the group nodes containing the node and the name of the node, "
+                        "separated by \"/\"");
+  RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+  parm = RNA_def_boolean(func, "found", false, "", "The node has been logged");
+  RNA_def_function_output(func, parm);
+  parm = RNA_def_float(func,
+                       "execution_time",
+                       0.0f,
+                       0.0f,
+                       FLT_MAX,
+                       "",
+                       "Total wall clock time in seconds",
+                       0.0f,
+                       FLT_MAX);
+  RNA_def_function_output(func, parm);
+  parm = RNA_def_float(func,
+                       "thread_time",
+                       0.0f,
+                       0.0f,
+                       FLT_MAX,
+                       "",
+                       "Total CPU time in seconds of the threads that executed the node, "
+                       "excluding work done on other threads",
+                       0.0f,
+                       FLT_MAX);
+  RNA_def_function_output(func, parm);
+  parm = RNA_def_float(func,
+                       "allocated_memory",
+                       0.0f,
+                       -FLT_MAX,
+                       FLT_MAX,
+                       "",
+                       "Change of the allocated memory in bytes during execution, includes "
+                       "allocations of nodes that were evaluated at the same time",
+                       -FLT_MAX,
+                       FLT_MAX);
+  RNA_def_function_output(func, parm);
+  parm = RNA_def_int(
+      func, "executions", 0, 0, INT_MAX, "", "Number of times the node was executed", 0, INT_MAX);
+  RNA_def_function_output(func, parm);
+  parm = RNA_def_int(func,
+                     "output_elements",
+                     0,
+                     0,
+                     INT_MAX,
+                     "",
+                     "Number of points, vertices, splines and instances in the output geometries",
+                     0,
+                     INT_MAX);
+  RNA_def_function_output(func, parm);
 }
 
 static void rna_def_modifier_mesh_to_volume(BlenderRNA *brna)
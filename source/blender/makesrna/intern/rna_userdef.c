@@ -6450,6 +6450,13 @@ static void rna_def_userdef_experimental(BlenderRNA *brna)
   RNA_def_property_ui_text(
       prop, "Override Templates", "Enable library override template in the python API");
 
+  prop = RNA_def_property(srna, "use_undo_incremental_write", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "use_undo_incremental_write", 1);
+  RNA_def_property_ui_text(prop,
+                           "Incremental Undo Write",
+                           "Only write data-blocks tagged as changed since the previous undo "
+                           "step, changes that are not tagged for update are not stored");
+
   prop = RNA_def_property(srna, "use_geometry_nodes_legacy", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_boolean_sdna(prop, NULL, "use_geometry_nodes_legacy", 1);
   RNA_def_property_ui_text(
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "BLI_sys_types.h"
+
 struct Main;
 struct NodesModifierData;
 struct Object;
@@ -33,6 +35,28 @@ void MOD_nodes_update_interface(struct Object *object, struct NodesModifierData
 
 void MOD_nodes_init(struct Main *bmain, struct NodesModifierData *nmd);
 
+typedef struct NodesModifierNodeStats {
+  /** Wall clock time in seconds. */
+  double execution_time;
+  /** CPU time in seconds of the thread that executed the node. */
+  double thread_time;
+  /** Change of the allocated memory during execution, approximate when running in parallel. */
+  int64_t allocated_bytes;
+  /** Number of elements in the output geometries. */
+  int64_t output_elements;
+  int executions;
+} NodesModifierNodeStats;
+
+/**
+ * Get the measurements of a node from the last logged evaluation of the modifier.
+ * \param node_path: Names of the group nodes that contain the node and the name of the node
+ * itself, separated by `/`.
+ * \return False if there is no log for the node.
+ */
+bool MOD_nodes_node_stats_get(const struct NodesModifierData *nmd,
+                              const char *node_path,
+                              NodesModifierNodeStats *r_stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,7 @@
 
 #include <cstring>
 #include <iostream>
+#include <mutex>
 #include <string>
 
 #include "MEM_guardedalloc.h"
@@ -38,6 +39,7 @@
 
 #include "DNA_collection_types.h"
 #include "DNA_defaults.h"
+#include "DNA_key_types.h"
 #include "DNA_material_types.h"
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -55,6 +57,7 @@
 #include "BKE_geometry_set_instances.hh"
 #include "BKE_global.h"
 #include "BKE_idprop.h"
+#include "BKE_key.h"
 #include "BKE_lib_id.h"
 #include "BKE_lib_query.h"
 #include "BKE_main.h"
@@ -737,6 +740,66 @@ void MOD_nodes_init(Main *bmain, NodesModifierData *nmd)
   BKE_ntree_update_main_tree(bmain, ntree, nullptr);
 }
 
+static int64_t logged_geometry_elements_num(const geo_log::NodeLog &node_log)
+{
+  int64_t elements_num = 0;
+  for (const geo_log::SocketLog &socket_log : node_log.output_logs()) {
+    const geo_log::GeometryValueLog *geometry_log = dynamic_cast<const geo_log::GeometryValueLog *>(
+        socket_log.value());
+    if (geometry_log == nullptr) {
+      continue;
+    }
+    if (geometry_log->mesh_info) {
+      elements_num += geometry_log->mesh_info->tot_verts;
+    }
+    if (geometry_log->curve_info) {
+      elements_num += geometry_log->curve_info->tot_splines;
+    }
+    if (geometry_log->pointcloud_info) {
+      elements_num += geometry_log->pointcloud_info->tot_points;
+    }
+    if (geometry_log->instances_info) {
+      elements_num += geometry_log->instances_info->tot_instances;
+    }
+  }
+  return elements_num;
+}
+
+bool MOD_nodes_node_stats_get(const NodesModifierData *nmd,
+                              const char *node_path,
+                              NodesModifierNodeStats *r_stats)
+{
+  memset(r_stats, 0, sizeof(*r_stats));
+  if (nmd->runtime_eval_log == nullptr) {
+    return false;
+  }
+  const geo_log::ModifierLog &modifier_log = *static_cast<const geo_log::ModifierLog *>(
+      nmd->runtime_eval_log);
+  const geo_log::TreeLog *tree_log = &modifier_log.root_tree();
+
+  StringRef path = node_path;
+  int64_t separator;
+  while ((separator = path.find('/')) != StringRef::not_found) {
+    tree_log = tree_log->lookup_child_log(path.substr(0, separator));
+    if (tree_log == nullptr) {
+      return false;
+    }
+    path = path.drop_prefix(separator + 1);
+  }
+  const geo_log::NodeLog *node_log = tree_log->lookup_node_log(path);
+  if (node_log == nullptr) {
+    return false;
+  }
+
+  const geo_log::NodeExecutionStats &stats = node_log->execution_stats();
+  r_stats->execution_time = stats.exec_time.count() / 1e6;
+  r_stats->thread_time = stats.thread_time.count() / 1e6;
+  r_stats->allocated_bytes = stats.allocated_bytes;
+  r_stats->executions = stats.executions;
+  r_stats->output_elements = logged_geometry_elements_num(*node_log);
+  return true;
+}
+
 static void initialize_group_input(NodesModifierData &nmd,
                                    const OutputSocketRef &socket,
                                    void *r_value)
@@ -792,6 +855,138 @@ static void initialize_group_input(NodesModifierData &nmd,
   }
 }
 
+static bool add_id_property_to_cache_key(
+    blender::modifiers::geometry_nodes::GeometryNodesCache &cache,
+    const IDProperty &property,
+    blender::modifiers::geometry_nodes::CacheKeyBuilder &key)
+{
+  key.add(property.type);
+  switch (property.type) {
+    case IDP_INT:
+      key.add(IDP_Int(&property));
+      return true;
+    case IDP_FLOAT:
+      key.add(IDP_Float(&property));
+      return true;
+    case IDP_DOUBLE:
+      key.add(IDP_Double(&property));
+      return true;
+    case IDP_STRING:
+      key.add(StringRef(IDP_String(&property)));
+      return true;
+    case IDP_ARRAY: {
+      key.add(property.subtype);
+      key.add(property.len);
+      switch (property.subtype) {
+        case IDP_INT:
+          key.add_bytes(IDP_Array(&property), sizeof(int) * property.len);
+          return true;
+        case IDP_FLOAT:
+          key.add_bytes(IDP_Array(&property), sizeof(float) * property.len);
+          return true;
+        case IDP_DOUBLE:
+          key.add_bytes(IDP_Array(&property), sizeof(double) * property.len);
+          return true;
+      }
+      return false;
+    }
+    case IDP_ID: {
+      return blender::modifiers::geometry_nodes::add_id_to_cache_key(
+          cache, IDP_Id(&property), key);
+    }
+  }
+  return false;
+}
+
+/**
+ * Compute a key that identifies the value of a group input, or nothing if it can't be identified.
+ * This has to take the same properties into account as #initialize_group_input.
+ */
+static std::optional<uint64_t> compute_group_input_cache_key(
+    blender::modifiers::geometry_nodes::GeometryNodesCache &cache,
+    const NodesModifierData &nmd,
+    const OutputSocketRef &socket)
+{
+  blender::modifiers::geometry_nodes::CacheKeyBuilder key;
+  key.add(StringRef("group input"));
+  key.add(StringRef(socket.identifier()));
+  if (nmd.settings.properties == nullptr) {
+    return std::nullopt;
+  }
+  const IDProperty *property = IDP_GetPropertyFromGroup(nmd.settings.properties,
+                                                        socket.identifier().c_str());
+  if (property == nullptr || !add_id_property_to_cache_key(cache, *property, key)) {
+    return std::nullopt;
+  }
+  for (const std::string &suffix : {use_attribute_suffix, attribute_name_suffix}) {
+    const IDProperty *attribute_property = IDP_GetPropertyFromGroup(
+        nmd.settings.properties, (socket.identifier() + suffix).c_str());
+    if (attribute_property != nullptr &&
+        !add_id_property_to_cache_key(cache, *attribute_property, key)) {
+      return std::nullopt;
+    }
+  }
+  return cache.key_id(key);
+}
+
+/**
+ * True when the geometry passed into the modifier may be different from the previous evaluation.
+ */
+static bool input_geometry_may_have_changed(const NodesModifierData &nmd,
+                                            const ModifierEvalContext &ctx)
+{
+  using blender::modifiers::geometry_nodes::id_changed_in_current_update;
+  const Object &object = *ctx.object;
+  if (object.id.recalc & ID_RECALC_COPY_ON_WRITE) {
+    return true;
+  }
+  if (object.data != nullptr && id_changed_in_current_update(*(const ID *)object.data)) {
+    return true;
+  }
+  const Key *shape_key = BKE_key_from_object(&object);
+  if (shape_key != nullptr && id_changed_in_current_update(shape_key->id)) {
+    return true;
+  }
+  /* The result of previous modifiers is not cached, so they may change it in every evaluation. */
+  LISTBASE_FOREACH (const ModifierData *, md, &object.modifiers) {
+    if (md == &nmd.modifier) {
+      break;
+    }
+    if (md->mode & (eModifierMode_Realtime | eModifierMode_Render)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static blender::modifiers::geometry_nodes::GeometryNodesCache *ensure_cache(
+    NodesModifierData &nmd, const ModifierEvalContext &ctx)
+{
+  using blender::modifiers::geometry_nodes::GeometryNodesCache;
+  /* Only cache in the active depsgraph, the same original modifier is evaluated by other
+   * depsgraphs (e.g. for rendering) with independent update tags. */
+  if (!DEG_is_active(ctx.depsgraph) || !DEG_is_evaluated_object(ctx.object)) {
+    return nullptr;
+  }
+  NodesModifierData *nmd_orig = (NodesModifierData *)BKE_modifier_get_original(ctx.object,
+                                                                               &nmd.modifier);
+  if (nmd_orig == nullptr || nmd_orig == &nmd) {
+    return nullptr;
+  }
+  static std::mutex mutex;
+  std::lock_guard lock{mutex};
+  if (nmd_orig->runtime_cache == nullptr) {
+    nmd_orig->runtime_cache = new GeometryNodesCache();
+  }
+  GeometryNodesCache *cache = static_cast<GeometryNodesCache *>(nmd_orig->runtime_cache);
+  if (ctx.object->id.recalc & ID_RECALC_COPY_ON_WRITE) {
+    /* The object has been edited or the depsgraph is new, any referenced data may be different
+     * from the previous evaluation without an update tag. */
+    cache->tag_external_data_changed();
+  }
+  return cache;
+}
+
 static Vector<SpaceSpreadsheet *> find_spreadsheet_editors(Main *bmain)
 {
   wmWindowManager *wm = (wmWindowManager *)bmain->wm.first;
@@ -1060,6 +1255,9 @@ static GeometrySet compute_geometry(const DerivedNodeTree &tree,
 
   Map<DOutputSocket, GMutablePointer> group_inputs;
 
+  blender::modifiers::geometry_nodes::GeometryNodesCache *cache = ensure_cache(*nmd, *ctx);
+  Map<DOutputSocket, uint64_t> input_value_keys;
+
   const DTreeContext *root_context = &tree.root_context();
   for (const NodeRef *group_input_node : group_input_nodes) {
     Span<const OutputSocketRef *> group_input_sockets = group_input_node->outputs().drop_back(1);
@@ -1077,6 +1275,12 @@ static GeometrySet compute_geometry(const DerivedNodeTree &tree,
           allocator.construct<GeometrySet>(input_geometry_set).release();
       group_inputs.add_new({root_context, first_input_socket}, geometry_set_in);
       remaining_input_sockets = remaining_input_sockets.drop_front(1);
+      if (cache != nullptr) {
+        blender::modifiers::geometry_nodes::CacheKeyBuilder key;
+        key.add(StringRef("input geometry"));
+        key.add(cache->external_version(key, input_geometry_may_have_changed(*nmd, *ctx)));
+        input_value_keys.add_new({root_context, first_input_socket}, cache->key_id(key));
+      }
     }
 
     /* Initialize remaining group inputs. */
@@ -1085,6 +1289,11 @@ static GeometrySet compute_geometry(const DerivedNodeTree &tree,
       void *value_in = allocator.allocate(cpp_type.size(), cpp_type.alignment());
       initialize_group_input(*nmd, *socket, value_in);
       group_inputs.add_new({root_context, socket}, {cpp_type, value_in});
+      if (cache != nullptr) {
+        if (std::optional<uint64_t> key = compute_group_input_cache_key(*cache, *nmd, *socket)) {
+          input_value_keys.add_new({root_context, socket}, *key);
+        }
+      }
     }
   }
 
@@ -1116,6 +1325,8 @@ static GeometrySet compute_geometry(const DerivedNodeTree &tree,
   eval_params.depsgraph = ctx->depsgraph;
   eval_params.self_object = ctx->object;
   eval_params.geo_logger = geo_logger.has_value() ? &*geo_logger : nullptr;
+  eval_params.cache = cache;
+  eval_params.input_value_keys = std::move(input_value_keys);
   blender::modifiers::geometry_nodes::evaluate_geometry_nodes(eval_params);
 
   GeometrySet output_geometry_set = std::move(*eval_params.r_output_values[0].get<GeometrySet>());
@@ -1664,6 +1875,7 @@ static void blendRead(BlendDataReader *reader, ModifierData *md)
   BLO_read_data_address(reader, &nmd->settings.properties);
   IDP_BlendDataRead(reader, &nmd->settings.properties);
   nmd->runtime_eval_log = nullptr;
+  nmd->runtime_cache = nullptr;
 }
 
 static void copyData(const ModifierData *md, ModifierData *target, const int flag)
@@ -1674,6 +1886,7 @@ static void copyData(const ModifierData *md, ModifierData *target, const int fla
   BKE_modifier_copydata_generic(md, target, flag);
 
   tnmd->runtime_eval_log = nullptr;
+  tnmd->runtime_cache = nullptr;
 
   if (nmd->settings.properties != nullptr) {
     tnmd->settings.properties = IDP_CopyProperty_ex(nmd->settings.properties, flag);
@@ -1689,6 +1902,12 @@ static void freeData(ModifierData *md)
   }
 
   clear_runtime_data(nmd);
+
+  if (nmd->runtime_cache != nullptr) {
+    delete static_cast<blender::modifiers::geometry_nodes::GeometryNodesCache *>(
+        nmd->runtime_cache);
+    nmd->runtime_cache = nullptr;
+  }
 }
 
 static void requiredDataMask(Object *UNUSED(ob),
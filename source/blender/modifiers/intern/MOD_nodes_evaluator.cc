@@ -16,6 +16,14 @@
 
 #include "MOD_nodes_evaluator.hh"
 
+#include "DNA_collection_types.h"
+#include "DNA_color_types.h"
+#include "DNA_genfile.h"
+#include "DNA_node_types.h"
+#include "DNA_sdna_types.h"
+
+#include "BKE_geometry_set.hh"
+#include "BKE_node.h"
 #include "BKE_type_conversions.hh"
 
 #include "NOD_geometry_exec.hh"
@@ -30,12 +38,18 @@
 
 #include "BLT_translation.h"
 
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+
 #include "BLI_enumerable_thread_specific.hh"
+#include "BLI_listbase.h"
 #include "BLI_stack.hh"
 #include "BLI_task.h"
 #include "BLI_task.hh"
 #include "BLI_vector_set.hh"
 
+#include <atomic>
 #include <chrono>
 
 namespace blender::modifiers::geometry_nodes {
@@ -141,8 +155,12 @@ struct InputState {
    * outputs are used, a node can tell the evaluator that an input will definitely be used or is
    * never used. This allows the evaluator to free values early, avoid copies and other unnecessary
    * computations.
+   *
+   * This is only changed while the node is locked, but it can be read without a lock to check if
+   * a value is still worth forwarding, because an input never stops being unused. The usage is
+   * checked again while the node is locked before a value is added to the input.
    */
-  ValueUsage usage = ValueUsage::Maybe;
+  std::atomic<ValueUsage> usage = ValueUsage::Maybe;
 
   /**
    * True when this input is/was used for an execution. While a node is running, only the inputs
@@ -192,6 +210,13 @@ struct OutputState {
    * the output is not needed anymore.
    */
   int potential_users = 0;
+
+  /**
+   * Identifies the value of this output in #GeometryNodesCache. This is only set for outputs of
+   * nodes that are loaded from the cache when possible. It does not change during evaluation, so
+   * it can be read without a lock.
+   */
+  std::optional<uint64_t> cache_key;
 };
 
 enum class NodeScheduleState {
@@ -264,6 +289,13 @@ struct NodeState {
    * not run twice at the same time accidentally.
    */
   NodeScheduleState schedule_state = NodeScheduleState::NotScheduled;
+
+  /**
+   * True when the node does not process geometry. Those nodes only compute single values or
+   * build fields, which is much cheaper than pushing them to the task pool separately. This does
+   * not change during evaluation and can be read without a lock.
+   */
+  bool is_cheap = false;
 };
 
 /**
@@ -336,6 +368,8 @@ class LockedNode : NonCopyable, NonMovable {
   }
 };
 
+static bool collection_changed_in_current_update(const Collection &collection);
+
 static const CPPType *get_socket_cpp_type(const SocketRef &socket)
 {
   const bNodeSocketType *typeinfo = socket.typeinfo();
@@ -417,9 +451,28 @@ static bool node_supports_laziness(const DNode node)
   return node->typeinfo()->geometry_node_execute_supports_laziness;
 }
 
+static bool node_is_cheap(const DNode node)
+{
+  for (const InputSocketRef *socket : node->inputs()) {
+    if (socket->is_available() && socket->typeinfo()->type == SOCK_GEOMETRY) {
+      return false;
+    }
+  }
+  for (const OutputSocketRef *socket : node->outputs()) {
+    if (socket->is_available() && socket->typeinfo()->type == SOCK_GEOMETRY) {
+      return false;
+    }
+  }
+  return true;
+}
+
 struct NodeTaskRunState {
-  /** The node that should be run on the same thread after the current node finished. */
-  DNode next_node_to_run;
+  /**
+   * Nodes that should be run on the same thread after the current node finished. This contains at
+   * most one node that is not cheap, so that expensive nodes can still run in parallel.
+   */
+  Vector<DNode, 16> nodes_to_run;
+  bool has_expensive_node_to_run = false;
 };
 
 /** Implements the callbacks that might be called when a node is executed. */
@@ -497,6 +550,9 @@ class GeometryNodesEvaluator {
     task_pool_ = BLI_task_pool_create(this, TASK_PRIORITY_HIGH);
 
     this->create_states_for_reachable_nodes();
+    if (params_.cache != nullptr) {
+      this->compute_cache_keys();
+    }
     this->forward_group_inputs();
     this->schedule_initial_nodes();
 
@@ -506,6 +562,10 @@ class GeometryNodesEvaluator {
 
     this->extract_group_outputs();
     this->destruct_node_states();
+
+    if (params_.cache != nullptr) {
+      params_.cache->remove_unused();
+    }
   }
 
   void create_states_for_reachable_nodes()
@@ -565,6 +625,7 @@ class GeometryNodesEvaluator {
     /* Construct arrays of the correct size. */
     node_state.inputs = allocator.construct_array<InputState>(node->inputs().size());
     node_state.outputs = allocator.construct_array<OutputState>(node->outputs().size());
+    node_state.is_cheap = node_is_cheap(node);
 
     /* Initialize input states. */
     for (const int i : node->inputs().index_range()) {
@@ -633,6 +694,337 @@ class GeometryNodesEvaluator {
     }
   }
 
+  /**
+   * Decide which node outputs are stored in the cache and compute their keys. Only nodes that
+   * don't depend on changing data and whose outputs are used by nodes that do (or by the group
+   * output) are cached. When those are loaded from the cache, the nodes to their left don't have
+   * to run, so storing their outputs as well would only cost memory.
+   */
+  void compute_cache_keys()
+  {
+    Map<DNode, std::optional<uint64_t>> key_by_node;
+
+    /* Compute the keys of all nodes, the keys of the nodes to the left are needed first. */
+    Stack<DNode> nodes_to_check;
+    for (const NodeWithState &item : node_states_) {
+      nodes_to_check.push(item.node);
+    }
+    while (!nodes_to_check.is_empty()) {
+      const DNode node = nodes_to_check.peek();
+      if (key_by_node.contains(node)) {
+        nodes_to_check.pop();
+        continue;
+      }
+      bool origins_handled = true;
+      for (const InputSocketRef *input_ref : node->inputs()) {
+        const DInputSocket input{node.context(), input_ref};
+        input.foreach_origin_socket([&](const DSocket origin) {
+          if (origin->is_output() && !key_by_node.contains(origin.node())) {
+            nodes_to_check.push(origin.node());
+            origins_handled = false;
+          }
+        });
+      }
+      if (origins_handled) {
+        nodes_to_check.pop();
+        key_by_node.add_new(node, this->compute_node_cache_key(node, key_by_node));
+      }
+    }
+
+    for (const NodeWithState &item : node_states_) {
+      const DNode node = item.node;
+      const std::optional<uint64_t> node_key = key_by_node.lookup(node);
+      if (!node_key.has_value()) {
+        continue;
+      }
+      if (!this->is_used_by_uncached_node(node, key_by_node)) {
+        continue;
+      }
+      for (const int i : node->outputs().index_range()) {
+        CacheKeyBuilder output_key;
+        output_key.add(*node_key);
+        output_key.add(i);
+        item.state->outputs[i].cache_key = params_.cache->key_id(output_key);
+      }
+    }
+  }
+
+  bool is_used_by_uncached_node(const DNode node,
+                                const Map<DNode, std::optional<uint64_t>> &key_by_node)
+  {
+    bool is_used = false;
+    for (const OutputSocketRef *output_ref : node->outputs()) {
+      const DOutputSocket output{node.context(), output_ref};
+      output.foreach_target_socket(
+          [&](const DInputSocket target_socket,
+              const DOutputSocket::TargetSocketPathInfo &UNUSED(path_info)) {
+            const std::optional<uint64_t> *target_key = key_by_node.lookup_ptr(
+                target_socket.node());
+            /* Nodes without a key here are not evaluated at all. */
+            if (target_key != nullptr && !target_key->has_value()) {
+              is_used = true;
+            }
+          });
+    }
+    return is_used;
+  }
+
+  /**
+   * Compute a key that changes whenever the outputs of the node may change, or nothing if the
+   * node depends on data that may change without a way to detect it.
+   */
+  std::optional<uint64_t> compute_node_cache_key(
+      const DNode node, const Map<DNode, std::optional<uint64_t>> &key_by_node)
+  {
+    if (node->is_group_input_node() || node->is_group_output_node()) {
+      return std::nullopt;
+    }
+    CacheKeyBuilder key;
+    if (!this->add_node_settings_to_cache_key(node, key)) {
+      return std::nullopt;
+    }
+    const NodeState &node_state = this->get_node_state(node);
+    for (const int i : node->inputs().index_range()) {
+      if (node_state.inputs[i].type == nullptr) {
+        /* Unavailable and non-data sockets are ignored by the node. */
+        continue;
+      }
+      key.add(i);
+      const DInputSocket input = node.input(i);
+      bool is_linked = false;
+      bool is_cacheable = true;
+      input.foreach_origin_socket([&](const DSocket origin) {
+        is_linked = true;
+        if (origin->is_input()) {
+          /* The value of an unlinked group node input is used. */
+          if (!this->add_socket_value_to_cache_key(*origin->bsocket(), key)) {
+            is_cacheable = false;
+          }
+          return;
+        }
+        const std::optional<uint64_t> origin_key = this->get_output_cache_key(
+            DOutputSocket(origin), key_by_node);
+        if (origin_key.has_value()) {
+          key.add(*origin_key);
+        }
+        else {
+          is_cacheable = false;
+        }
+      });
+      if (!is_cacheable) {
+        return std::nullopt;
+      }
+      if (!is_linked && !this->add_socket_value_to_cache_key(*input->bsocket(), key)) {
+        return std::nullopt;
+      }
+    }
+    return params_.cache->key_id(key);
+  }
+
+  std::optional<uint64_t> get_output_cache_key(
+      const DOutputSocket socket, const Map<DNode, std::optional<uint64_t>> &key_by_node)
+  {
+    if (socket->node().is_group_input_node()) {
+      /* This can only be the group input of the root node group. */
+      const uint64_t *input_key = params_.input_value_keys.lookup_ptr(socket);
+      if (input_key == nullptr) {
+        return std::nullopt;
+      }
+      return *input_key;
+    }
+    const std::optional<uint64_t> node_key = key_by_node.lookup(socket.node());
+    if (!node_key.has_value()) {
+      return std::nullopt;
+    }
+    CacheKeyBuilder key;
+    key.add(*node_key);
+    key.add(socket->index());
+    return params_.cache->key_id(key);
+  }
+
+  bool add_node_settings_to_cache_key(const DNode node, CacheKeyBuilder &key)
+  {
+    const bNode &bnode = *node->bnode();
+    switch (bnode.type) {
+      case GEO_NODE_INPUT_SCENE_TIME:
+      case GEO_NODE_IS_VIEWPORT:
+      case GEO_NODE_IMAGE_TEXTURE:
+      case GEO_NODE_LEGACY_ATTRIBUTE_SAMPLE_TEXTURE:
+        /* These depend on the time, the evaluation mode or data that has no update tags. */
+        return false;
+      case GEO_NODE_OBJECT_INFO:
+      case GEO_NODE_COLLECTION_INFO:
+        if (!this->add_referenced_data_to_cache_key(node, key)) {
+          return false;
+        }
+        break;
+    }
+
+    key.add(StringRef(bnode.idname));
+    key.add(bnode.custom1);
+    key.add(bnode.custom2);
+    key.add(bnode.custom3);
+    key.add(bnode.custom4);
+    if (!add_id_to_cache_key(*params_.cache, bnode.id, key)) {
+      return false;
+    }
+    if (bnode.storage != nullptr) {
+      const StringRef storage_name = bnode.typeinfo->storagename;
+      /* Storage that contains pointers needs special handling, because the data they point to
+       * can change while the pointers stay the same. */
+      if (storage_name == "NodeInputString") {
+        const char *str = static_cast<const NodeInputString *>(bnode.storage)->string;
+        key.add(StringRef(str == nullptr ? "" : str));
+      }
+      else if (storage_name == "CurveMapping") {
+        add_curve_mapping_to_cache_key(static_cast<const CurveMapping *>(bnode.storage), key);
+      }
+      else if (storage_name == "NodeAttributeCurveMap") {
+        const NodeAttributeCurveMap &storage = *static_cast<const NodeAttributeCurveMap *>(
+            bnode.storage);
+        key.add(storage.data_type);
+        add_curve_mapping_to_cache_key(storage.curve_vec, key);
+        add_curve_mapping_to_cache_key(storage.curve_rgb, key);
+      }
+      else {
+        /* Other storage is compared by its bytes, which is only possible without pointers. DNA
+         * structs have no implicit padding. */
+        const SDNA &sdna = *DNA_sdna_current_get();
+        const int struct_nr = DNA_struct_find_nr(&sdna, storage_name.data());
+        if (struct_nr == -1 || dna_struct_has_pointers(sdna, struct_nr)) {
+          return false;
+        }
+        key.add_bytes(bnode.storage, sdna.types_size[sdna.structs[struct_nr]->type]);
+      }
+    }
+    return true;
+  }
+
+  /** True when the struct or a struct nested in it has pointer members. */
+  static bool dna_struct_has_pointers(const SDNA &sdna, const int struct_nr)
+  {
+    const SDNA_Struct &sdna_struct = *sdna.structs[struct_nr];
+    for (const SDNA_StructMember &member : Span(sdna_struct.members, sdna_struct.members_len)) {
+      const char *name = sdna.names[member.name];
+      if (ELEM(name[0], '*', '(')) {
+        return true;
+      }
+      const int member_struct_nr = DNA_struct_find_nr(&sdna, sdna.types[member.type]);
+      if (member_struct_nr != -1 && dna_struct_has_pointers(sdna, member_struct_nr)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Nodes that read objects or collections can be cached when it is known which data they read,
+   * because then update tags of that data tell when the output has to be computed again.
+   */
+  bool add_referenced_data_to_cache_key(const DNode node, CacheKeyBuilder &key)
+  {
+    const DInputSocket input = node.input(0);
+    const bNodeSocket *value_socket = input->bsocket();
+    bool is_computed = false;
+    input.foreach_origin_socket([&](const DSocket origin) {
+      if (origin->is_input()) {
+        value_socket = origin->bsocket();
+      }
+      else {
+        is_computed = true;
+      }
+    });
+    if (is_computed) {
+      return false;
+    }
+
+    GeometryNodesCache &cache = *params_.cache;
+    const Object &self_object = *params_.self_object;
+    /* The outputs may be relative to the transform of the modified object. */
+    CacheKeyBuilder self_transform_key;
+    self_transform_key.add(StringRef("self transform"));
+    self_transform_key.add(self_object.id.session_uuid);
+    key.add(cache.external_version(self_transform_key,
+                                   self_object.id.recalc & ID_RECALC_TRANSFORM));
+
+    const ID *id = nullptr;
+    if (value_socket->type == SOCK_OBJECT) {
+      id = reinterpret_cast<const ID *>(
+          static_cast<const bNodeSocketValueObject *>(value_socket->default_value)->value);
+    }
+    else if (value_socket->type == SOCK_COLLECTION) {
+      id = reinterpret_cast<const ID *>(
+          static_cast<const bNodeSocketValueCollection *>(value_socket->default_value)->value);
+    }
+    else {
+      return false;
+    }
+    return add_id_to_cache_key(cache, id, key);
+  }
+
+  /**
+   * \return False when the value references data that may change without a way to detect it.
+   */
+  bool add_socket_value_to_cache_key(const bNodeSocket &socket, CacheKeyBuilder &key)
+  {
+    key.add(socket.type);
+    const void *value = socket.default_value;
+    if (value == nullptr) {
+      return true;
+    }
+    const ID *id = nullptr;
+    switch (socket.type) {
+      case SOCK_OBJECT:
+        id = reinterpret_cast<const ID *>(
+            static_cast<const bNodeSocketValueObject *>(value)->value);
+        break;
+      case SOCK_COLLECTION:
+        id = reinterpret_cast<const ID *>(
+            static_cast<const bNodeSocketValueCollection *>(value)->value);
+        break;
+      case SOCK_TEXTURE:
+        id = reinterpret_cast<const ID *>(
+            static_cast<const bNodeSocketValueTexture *>(value)->value);
+        break;
+      case SOCK_IMAGE:
+        id = reinterpret_cast<const ID *>(
+            static_cast<const bNodeSocketValueImage *>(value)->value);
+        break;
+      case SOCK_MATERIAL:
+        id = reinterpret_cast<const ID *>(
+            static_cast<const bNodeSocketValueMaterial *>(value)->value);
+        break;
+      default:
+        key.add_bytes(value, MEM_allocN_len(value));
+        return true;
+    }
+    /* Nodes may read the referenced data, so changes of it have to change the key. */
+    return add_id_to_cache_key(*params_.cache, id, key);
+  }
+
+  static void add_curve_mapping_to_cache_key(const CurveMapping *curve_mapping,
+                                             CacheKeyBuilder &key)
+  {
+    if (curve_mapping == nullptr) {
+      return;
+    }
+    key.add(curve_mapping->flag);
+    key.add(curve_mapping->preset);
+    key.add(curve_mapping->changed_timestamp);
+    key.add_bytes(&curve_mapping->clipr, sizeof(rctf));
+    key.add_bytes(&curve_mapping->curr, sizeof(rctf));
+    key.add_bytes(curve_mapping->black, sizeof(curve_mapping->black));
+    key.add_bytes(curve_mapping->white, sizeof(curve_mapping->white));
+    for (const CurveMap &curve_map : Span(curve_mapping->cm, CM_TOT)) {
+      key.add(curve_map.totpoint);
+      for (const CurveMapPoint &point : Span(curve_map.curve, curve_map.totpoint)) {
+        key.add(point.x);
+        key.add(point.y);
+        key.add(point.flag);
+      }
+    }
+  }
+
   void destruct_node_states()
   {
     threading::parallel_for(
@@ -755,17 +1147,21 @@ class GeometryNodesEvaluator {
     const NodeWithState *root_node_with_state = (const NodeWithState *)task_data;
 
     /* First, the node provided by the task pool is executed. During the execution other nodes
-     * might be scheduled. One of those nodes is not added to the task pool but is executed in the
-     * loop below directly. This has two main benefits:
-     * - Fewer round trips through the task pool which add threading overhead.
+     * might be scheduled. Cheap nodes and one other node are not added to the task pool but are
+     * executed in the loop below directly. This has two main benefits:
+     * - Fewer round trips through the task pool which add threading overhead. For trees with
+     *   many small field nodes, that overhead can be larger than the work done by the nodes.
      * - Helps with cpu cache efficiency, because a thread is more likely to process data that it
      *   has processed shortly before.
      */
-    DNode next_node_to_run = root_node_with_state->node;
-    while (next_node_to_run) {
-      NodeTaskRunState run_state;
-      evaluator.node_task_run(next_node_to_run, &run_state);
-      next_node_to_run = run_state.next_node_to_run;
+    NodeTaskRunState run_state;
+    run_state.nodes_to_run.append(root_node_with_state->node);
+    while (!run_state.nodes_to_run.is_empty()) {
+      const DNode node = run_state.nodes_to_run.pop_last();
+      if (!evaluator.get_node_state(node).is_cheap) {
+        run_state.has_expensive_node_to_run = false;
+      }
+      evaluator.node_task_run(node, &run_state);
     }
   }
 
@@ -779,19 +1175,31 @@ class GeometryNodesEvaluator {
 
     NodeState &node_state = *node_states_.lookup_key_as(node).state;
 
-    const bool do_execute_node = this->node_task_preprocessing(node, node_state, run_state);
+    Vector<GMutablePointer> cached_outputs;
+    const bool do_execute_node = this->node_task_preprocessing(
+        node, node_state, cached_outputs, run_state);
 
     /* Only execute the node if all prerequisites are met. There has to be an output that is
      * required and all required inputs have to be provided already. */
     if (do_execute_node) {
-      this->execute_node(node, node_state, run_state);
+      if (cached_outputs.is_empty()) {
+        this->execute_node(node, node_state, run_state);
+      }
+      else {
+        this->forward_cached_outputs(node, node_state, cached_outputs, run_state);
+      }
     }
 
     this->node_task_postprocessing(node, node_state, do_execute_node, run_state);
   }
 
+  /**
+   * \param r_cached_outputs: Filled with values for all outputs that are needed when they are
+   *   loaded from the cache instead of executing the node.
+   */
   bool node_task_preprocessing(const DNode node,
                                NodeState &node_state,
+                               Vector<GMutablePointer> &r_cached_outputs,
                                NodeTaskRunState *run_state)
   {
     bool do_execute_node = false;
@@ -807,6 +1215,12 @@ class GeometryNodesEvaluator {
       if (!this->prepare_node_outputs_for_execution(locked_node)) {
         return;
       }
+      /* Check the cache before any inputs are requested, so that the nodes that would compute
+       * them don't run either. */
+      if (this->try_load_outputs_from_cache(locked_node, r_cached_outputs)) {
+        do_execute_node = true;
+        return;
+      }
       /* Initialize inputs that don't support laziness. This is done after at least one output is
        * required and before we check that all required inputs are provided. This reduces the
        * number of "round-trips" through the task pool by one for most nodes. */
@@ -870,6 +1284,47 @@ class GeometryNodesEvaluator {
     return true;
   }
 
+  bool try_load_outputs_from_cache(LockedNode &locked_node, Vector<GMutablePointer> &r_values)
+  {
+    if (params_.cache == nullptr || locked_node.node_state.has_been_executed) {
+      return false;
+    }
+    const DNode node = locked_node.node;
+    LinearAllocator<> &allocator = local_allocators_.local();
+    Vector<GMutablePointer> values(node->outputs().size());
+    bool all_values_loaded = true;
+    for (const int i : node->outputs().index_range()) {
+      OutputState &output_state = locked_node.node_state.outputs[i];
+      if (output_state.has_been_computed ||
+          output_state.output_usage_for_execution == ValueUsage::Unused) {
+        continue;
+      }
+      /* All outputs that may be used have to be loaded, because the node can't be executed to
+       * compute only some of them afterwards. */
+      if (!output_state.cache_key.has_value()) {
+        all_values_loaded = false;
+        break;
+      }
+      const CPPType &type = *get_socket_cpp_type(node.output(i));
+      void *buffer = allocator.allocate(type.size(), type.alignment());
+      if (!params_.cache->try_copy_value(*output_state.cache_key, type, buffer)) {
+        all_values_loaded = false;
+        break;
+      }
+      values[i] = {type, buffer};
+    }
+    if (!all_values_loaded) {
+      for (GMutablePointer value : values) {
+        if (value.get() != nullptr) {
+          value.destruct();
+        }
+      }
+      return false;
+    }
+    r_values = std::move(values);
+    return true;
+  }
+
   bool prepare_node_outputs_for_execution(LockedNode &locked_node)
   {
     bool execution_is_necessary = false;
@@ -966,8 +1421,6 @@ class GeometryNodesEvaluator {
    */
   void execute_node(const DNode node, NodeState &node_state, NodeTaskRunState *run_state)
   {
-    const bNode &bnode = *node->bnode();
-
     if (node_state.has_been_executed) {
       if (!node_supports_laziness(node)) {
         /* Nodes that don't support laziness must not be executed more than once. */
@@ -976,6 +1429,36 @@ class GeometryNodesEvaluator {
     }
     node_state.has_been_executed = true;
 
+    if (params_.geo_logger == nullptr) {
+      this->execute_node_by_type(node, node_state, run_state);
+      return;
+    }
+
+    /* The measurements include forwarding the outputs, which the nodes may do while they are
+     * running. Field evaluations are included in the node that evaluates them. */
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point begin = Clock::now();
+    const double thread_begin = PIL_check_thread_seconds_timer();
+    const size_t memory_begin = MEM_get_memory_in_use();
+
+    this->execute_node_by_type(node, node_state, run_state);
+
+    const size_t memory_end = MEM_get_memory_in_use();
+    const double thread_end = PIL_check_thread_seconds_timer();
+    const Clock::time_point end = Clock::now();
+
+    geo_log::NodeExecutionStats stats;
+    stats.exec_time = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+    stats.thread_time = std::chrono::microseconds(int64_t((thread_end - thread_begin) * 1e6));
+    stats.allocated_bytes = int64_t(memory_end) - int64_t(memory_begin);
+    stats.executions = 1;
+    params_.geo_logger->local().log_execution_stats(node, stats);
+  }
+
+  void execute_node_by_type(const DNode node, NodeState &node_state, NodeTaskRunState *run_state)
+  {
+    const bNode &bnode = *node->bnode();
+
     /* Use the geometry node execute callback if it exists. */
     if (bnode.typeinfo->geometry_node_execute != nullptr) {
       this->execute_geometry_node(node, node_state, run_state);
@@ -1002,15 +1485,7 @@ class GeometryNodesEvaluator {
       params.error_message_add(geo_log::NodeWarningType::Legacy,
                                TIP_("Legacy node will be removed before Blender 4.0"));
     }
-    using Clock = std::chrono::steady_clock;
-    Clock::time_point begin = Clock::now();
     bnode.typeinfo->geometry_node_execute(params);
-    Clock::time_point end = Clock::now();
-    const std::chrono::microseconds duration =
-        std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
-    if (params_.geo_logger != nullptr) {
-      params_.geo_logger->local().log_execution_time(node, duration);
-    }
   }
 
   void execute_multi_function_node(const DNode node,
@@ -1154,6 +1629,20 @@ class GeometryNodesEvaluator {
     }
   }
 
+  void forward_cached_outputs(const DNode node,
+                              NodeState &node_state,
+                              Span<GMutablePointer> values,
+                              NodeTaskRunState *run_state)
+  {
+    for (const int i : values.index_range()) {
+      if (values[i].get() == nullptr) {
+        continue;
+      }
+      this->forward_output(node.output(i), values[i], run_state);
+      node_state.outputs[i].has_been_computed = true;
+    }
+  }
+
   void execute_unknown_node(const DNode node, NodeState &node_state, NodeTaskRunState *run_state)
   {
     LinearAllocator<> &allocator = local_allocators_.local();
@@ -1425,6 +1914,10 @@ class GeometryNodesEvaluator {
   {
     BLI_assert(value_to_forward.get() != nullptr);
 
+    if (params_.cache != nullptr) {
+      this->add_output_value_to_cache(from_socket, value_to_forward);
+    }
+
     LinearAllocator<> &allocator = local_allocators_.local();
 
     Vector<DSocket> log_original_value_sockets;
@@ -1482,6 +1975,39 @@ class GeometryNodesEvaluator {
         allocator, forward_original_value_sockets, value_to_forward, from_socket, run_state);
   }
 
+  void add_output_value_to_cache(const DOutputSocket socket, const GPointer value)
+  {
+    const NodeWithState *node_with_state = node_states_.lookup_key_ptr_as(socket.node());
+    if (node_with_state == nullptr) {
+      return;
+    }
+    const std::optional<uint64_t> &cache_key =
+        node_with_state->state->outputs[socket->index()].cache_key;
+    if (!cache_key.has_value()) {
+      return;
+    }
+    GeometryNodesCache &cache = *params_.cache;
+    if (cache.contains_value(*cache_key)) {
+      return;
+    }
+    const CPPType &type = *value.type();
+    if (type.is<GeometrySet>()) {
+      GeometrySet geometry = *value.get<GeometrySet>();
+      /* The cache may outlive data that is only referenced by the geometry, like the evaluated
+       * mesh of another object. */
+      geometry.ensure_owns_direct_data();
+      cache.add_value(*cache_key, {type, &geometry});
+      return;
+    }
+    const ValueOrFieldCPPType *value_or_field_type = dynamic_cast<const ValueOrFieldCPPType *>(
+        &type);
+    /* Fields are not cached, because they can reference multi-functions that only exist during
+     * the current evaluation. */
+    if (value_or_field_type != nullptr && !value_or_field_type->is_field(value.get())) {
+      cache.add_value(*cache_key, value);
+    }
+  }
+
   bool should_forward_to_socket(const DInputSocket socket)
   {
     const DNode to_node = socket.node();
@@ -1493,9 +2019,12 @@ class GeometryNodesEvaluator {
     NodeState &target_node_state = *target_node_with_state->state;
     InputState &target_input_state = target_node_state.inputs[socket->index()];
 
-    std::lock_guard lock{target_node_state.mutex};
-    /* Do not forward to an input socket whose value won't be used. */
-    return target_input_state.usage != ValueUsage::Unused;
+    /* Do not forward to an input socket whose value won't be used. This is checked without locking
+     * the node, because the usage may change right after the check anyway. A stale read can only
+     * let a value through, since an input never stops being unused, and
+     * #add_value_to_input_socket checks the usage again while the node is locked. The relaxed load
+     * is enough because nothing else is read based on the result. */
+    return target_input_state.usage.load(std::memory_order_relaxed) != ValueUsage::Unused;
   }
 
   void forward_to_sockets_with_same_type(LinearAllocator<> &allocator,
@@ -1541,6 +2070,11 @@ class GeometryNodesEvaluator {
     InputState &input_state = node_state.inputs[socket->index()];
 
     this->with_locked_node(node, node_state, run_state, [&](LockedNode &locked_node) {
+      if (input_state.usage == ValueUsage::Unused) {
+        /* The input became unused after #should_forward_to_socket checked it. */
+        value.destruct();
+        return;
+      }
       if (socket->is_multi_input_socket()) {
         /* Add a new value to the multi-input. */
         MultiInputValue &multi_value = *input_state.value.multi;
@@ -1755,12 +2289,20 @@ class GeometryNodesEvaluator {
       this->send_output_unused_notification(socket, run_state);
     }
     for (const DNode &node_to_schedule : locked_node.delayed_scheduled_nodes) {
-      if (run_state != nullptr && !run_state->next_node_to_run) {
+      if (run_state == nullptr) {
+        this->add_node_to_task_pool(node_to_schedule);
+      }
+      else if (this->get_node_state(node_to_schedule).is_cheap) {
+        /* Batch cheap nodes on the current thread, they are not worth a separate task. */
+        run_state->nodes_to_run.append(node_to_schedule);
+      }
+      else if (!run_state->has_expensive_node_to_run) {
         /* Execute the node on the same thread after the current node finished. */
         /* Currently, this assumes that it is always best to run the first node that is scheduled
          * on the same thread. That is usually correct, because the geometry socket which carries
          * the most data usually comes first in nodes. */
-        run_state->next_node_to_run = node_to_schedule;
+        run_state->nodes_to_run.append(node_to_schedule);
+        run_state->has_expensive_node_to_run = true;
       }
       else {
         /* Push the node to the task pool so that another thread can start working on it. */
@@ -1950,6 +2492,175 @@ void NodeParamsProvider::set_default_remaining_outputs()
   }
 }
 
+static bool collection_changed_in_current_update(const Collection &collection)
+{
+  if (id_changed_in_current_update(collection.id)) {
+    return true;
+  }
+  LISTBASE_FOREACH (const CollectionObject *, collection_object, &collection.gobject) {
+    if (id_changed_in_current_update(collection_object->ob->id)) {
+      return true;
+    }
+  }
+  LISTBASE_FOREACH (const CollectionChild *, collection_child, &collection.children) {
+    if (collection_changed_in_current_update(*collection_child->collection)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool id_changed_in_current_update(const ID &id)
+{
+  /* Updates that don't change any data that is accessible in geometry nodes. */
+  const int ignored_flags = ID_RECALC_SELECT | ID_RECALC_BASE_FLAGS | ID_RECALC_SHADING |
+                            ID_RECALC_EDITORS;
+  return (id.recalc & ~ignored_flags) != 0;
+}
+
+GeometryNodesCache::~GeometryNodesCache()
+{
+  for (GMutablePointer value : values_.values()) {
+    value.destruct();
+    MEM_freeN(value.get());
+  }
+}
+
+bool add_id_to_cache_key(GeometryNodesCache &cache, const ID *id, CacheKeyBuilder &key)
+{
+  if (id == nullptr) {
+    key.add(0u);
+    return true;
+  }
+  bool changed;
+  switch (GS(id->name)) {
+    case ID_OB:
+    case ID_TE:
+      changed = id_changed_in_current_update(*id);
+      break;
+    case ID_GR:
+      changed = collection_changed_in_current_update(*reinterpret_cast<const Collection *>(id));
+      break;
+    case ID_MA:
+      /* Materials are only assigned to geometry, their data is not read. */
+      key.add(id->session_uuid);
+      return true;
+    default:
+      /* E.g. images can change without update tags. */
+      return false;
+  }
+  /* The session UUID identifies the data-block, the pointer might be reused for another one. */
+  CacheKeyBuilder id_key;
+  id_key.add(StringRef("id"));
+  id_key.add(id->session_uuid);
+  key.add(id->session_uuid);
+  key.add(cache.external_version(id_key, changed));
+  return true;
+}
+
+uint64_t GeometryNodesCache::key_id(const CacheKeyBuilder &key)
+{
+  std::lock_guard lock{mutex_};
+  const uint64_t id = key_ids_.lookup_or_add_cb(key.data(), [&]() { return ++last_key_id_; });
+  used_key_ids_.add(id);
+  return id;
+}
+
+uint64_t GeometryNodesCache::external_version(const CacheKeyBuilder &external_key,
+                                              const bool changed)
+{
+  std::lock_guard lock{mutex_};
+  used_external_keys_.add(external_key.data());
+  if (changed) {
+    const uint64_t version = ++last_version_;
+    external_versions_.add_overwrite(external_key.data(), version);
+    return version;
+  }
+  return external_versions_.lookup_or_add_cb(external_key.data(),
+                                              [&]() { return ++last_version_; });
+}
+
+void GeometryNodesCache::tag_external_data_changed()
+{
+  std::lock_guard lock{mutex_};
+  /* New versions are created when the versions are requested again. */
+  external_versions_.clear();
+}
+
+bool GeometryNodesCache::contains_value(const uint64_t key)
+{
+  std::lock_guard lock{mutex_};
+  if (values_.contains(key)) {
+    used_value_keys_.add(key);
+    return true;
+  }
+  return false;
+}
+
+bool GeometryNodesCache::try_copy_value(const uint64_t key, const CPPType &type, void *r_value)
+{
+  std::lock_guard lock{mutex_};
+  const GMutablePointer *value = values_.lookup_ptr(key);
+  if (value == nullptr || *value->type() != type) {
+    return false;
+  }
+  type.copy_construct(value->get(), r_value);
+  used_value_keys_.add(key);
+  return true;
+}
+
+void GeometryNodesCache::add_value(const uint64_t key, const GPointer value)
+{
+  const CPPType &type = *value.type();
+  void *buffer = MEM_mallocN_aligned(type.size(), type.alignment(), __func__);
+  type.copy_construct(value.get(), buffer);
+
+  std::lock_guard lock{mutex_};
+  used_value_keys_.add(key);
+  if (!values_.add(key, {type, buffer})) {
+    /* Another thread added the same value already. */
+    type.destruct(buffer);
+    MEM_freeN(buffer);
+  }
+}
+
+void GeometryNodesCache::remove_unused()
+{
+  std::lock_guard lock{mutex_};
+  Vector<uint64_t> keys_to_remove;
+  for (auto item : values_.items()) {
+    if (!used_value_keys_.contains(item.key)) {
+      keys_to_remove.append(item.key);
+    }
+  }
+  for (const uint64_t key : keys_to_remove) {
+    GMutablePointer value = values_.pop(key);
+    value.destruct();
+    MEM_freeN(value.get());
+  }
+  Vector<std::string> key_datas_to_remove;
+  for (auto item : key_ids_.items()) {
+    if (!used_key_ids_.contains(item.value)) {
+      key_datas_to_remove.append(item.key);
+    }
+  }
+  for (const std::string &key_data : key_datas_to_remove) {
+    key_ids_.remove(key_data);
+  }
+  key_datas_to_remove.clear();
+  for (const std::string &key_data : external_versions_.keys()) {
+    if (!used_external_keys_.contains(key_data)) {
+      key_datas_to_remove.append(key_data);
+    }
+  }
+  for (const std::string &key_data : key_datas_to_remove) {
+    external_versions_.remove(key_data);
+  }
+  used_key_ids_.clear();
+  used_value_keys_.clear();
+  used_external_keys_.clear();
+}
+
 void evaluate_geometry_nodes(GeometryNodesEvaluationParams &params)
 {
   GeometryNodesEvaluator evaluator{params};
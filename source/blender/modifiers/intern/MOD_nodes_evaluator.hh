@@ -16,7 +16,13 @@
 
 #pragma once
 
+#include <mutex>
+#include <string>
+
 #include "BLI_map.hh"
+#include "BLI_set.hh"
+#include "BLI_string_ref.hh"
+#include "BLI_utility_mixins.hh"
 
 #include "NOD_derived_node_tree.hh"
 #include "NOD_geometry_nodes_eval_log.hh"
@@ -33,9 +39,124 @@ namespace geo_log = blender::nodes::geometry_nodes_eval_log;
 namespace blender::modifiers::geometry_nodes {
 
 using namespace nodes::derived_node_tree_types;
+using fn::CPPType;
 using fn::GMutablePointer;
 using fn::GPointer;
 
+/**
+ * Builds the keys that identify values in #GeometryNodesCache. Only add data that has the same
+ * bytes whenever it means the same thing, e.g. no pointers and no structs with padding.
+ * The data is kept, so that keys are compared exactly, see #GeometryNodesCache::key_id.
+ */
+class CacheKeyBuilder {
+ private:
+  std::string data_;
+
+ public:
+  void add_bytes(const void *data, const int64_t size)
+  {
+    data_.append(static_cast<const char *>(data), size_t(size));
+  }
+
+  template<typename T> void add(const T &value)
+  {
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+    this->add_bytes(&value, sizeof(T));
+  }
+
+  void add(const StringRef str)
+  {
+    this->add<int64_t>(str.size());
+    this->add_bytes(str.data(), str.size());
+  }
+
+  const std::string &data() const
+  {
+    return data_;
+  }
+};
+
+/**
+ * Keeps values computed by nodes across evaluations of the same modifier, so that parts of the
+ * node tree that don't depend on anything that changed since the last evaluation (e.g. everything
+ * that does not depend on the scene time) don't have to be computed again.
+ *
+ * Values are identified by keys that are computed from everything that influences the value: the
+ * node and its settings, unlinked input values and the keys of linked inputs. Data that comes from
+ * outside of the node tree, like the modifier input geometry or objects, is identified by a
+ * version that changes whenever the data changed.
+ *
+ * The cache can be accessed from multiple threads.
+ */
+class GeometryNodesCache : NonCopyable, NonMovable {
+ private:
+  std::mutex mutex_;
+  /** Unique identifiers of the data of all keys, see #key_id. */
+  Map<std::string, uint64_t> key_ids_;
+  uint64_t last_key_id_ = 0;
+  Map<uint64_t, GMutablePointer> values_;
+  Map<std::string, uint64_t> external_versions_;
+  uint64_t last_version_ = 0;
+  /** Keys that have been accessed since the last call to #remove_unused. */
+  Set<uint64_t> used_key_ids_;
+  Set<uint64_t> used_value_keys_;
+  Set<std::string> used_external_keys_;
+
+ public:
+  ~GeometryNodesCache();
+
+  /**
+   * Get an identifier for the key that is only the same for keys with the same data. Keys with
+   * a colliding hash therefore never share values. Keys of node outputs contain the identifiers
+   * of the keys of their inputs, so that their data doesn't grow with the size of the tree.
+   */
+  uint64_t key_id(const CacheKeyBuilder &key);
+
+  /**
+   * Get the current version of some data that comes from outside of the node tree.
+   * \param changed: True when the data is known to have changed since the last evaluation, a
+   *   new version is created then.
+   */
+  uint64_t external_version(const CacheKeyBuilder &external_key, bool changed);
+
+  /**
+   * Create new versions for all data from outside of the node tree. This is used when it is not
+   * known which data changed.
+   */
+  void tag_external_data_changed();
+
+  /**
+   * Copy the cached value into the uninitialized buffer.
+   * \return False if there is no cached value of that type for the key.
+   */
+  bool try_copy_value(uint64_t key, const CPPType &type, void *r_value);
+
+  /** True when there is a value for the key already. */
+  bool contains_value(uint64_t key);
+
+  /** Store a copy of the value. */
+  void add_value(uint64_t key, GPointer value);
+
+  /**
+   * Free all values and versions that have not been used since the last call, typically at the
+   * end of every evaluation. Otherwise values that became outdated would never be freed.
+   */
+  void remove_unused();
+};
+
+/**
+ * True when the evaluated data-block has been updated in the current depsgraph evaluation in a
+ * way that may change the data that geometry nodes read from it.
+ */
+bool id_changed_in_current_update(const ID &id);
+
+/**
+ * Add a data-block that is read by a node or passed to a group input to the key, with a version
+ * that changes whenever the data-block is updated.
+ * \return False when changes of the data-block can't be detected.
+ */
+bool add_id_to_cache_key(GeometryNodesCache &cache, const ID *id, CacheKeyBuilder &key);
+
 struct GeometryNodesEvaluationParams {
   blender::LinearAllocator<> allocator;
 
@@ -53,6 +174,15 @@ struct GeometryNodesEvaluationParams {
   Object *self_object;
   geo_log::GeoLogger *geo_logger;
 
+  /**
+   * Optional cache that keeps node outputs that don't depend on the time or other changing data
+   * across evaluations. Only values that are computed from data in the node tree, from objects and
+   * collections referenced by it and from group inputs in #input_value_keys are cached.
+   */
+  GeometryNodesCache *cache = nullptr;
+  /** Identify the values in #input_values across evaluations, see #GeometryNodesCache. */
+  Map<DOutputSocket, uint64_t> input_value_keys;
+
   Vector<GMutablePointer> r_output_values;
 };
 
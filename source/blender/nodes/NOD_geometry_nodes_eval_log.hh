@@ -171,9 +171,35 @@ struct NodeWithWarning {
   NodeWarning warning;
 };
 
-struct NodeWithExecutionTime {
+/** Measurements of node executions. Nodes that support laziness can be executed more than once. */
+struct NodeExecutionStats {
+  /** Wall clock time. */
+  std::chrono::microseconds exec_time{0};
+  /**
+   * CPU time of the thread that executed the node. Work that the node does on other threads is
+   * not included, so this is lower than #exec_time when the node is waiting or multi-threaded.
+   */
+  std::chrono::microseconds thread_time{0};
+  /**
+   * Change of the allocated memory during the execution. This includes allocations of other nodes
+   * that run at the same time, so it is only exact when nodes are evaluated on a single thread.
+   */
+  int64_t allocated_bytes = 0;
+  int executions = 0;
+
+  NodeExecutionStats &operator+=(const NodeExecutionStats &other)
+  {
+    exec_time += other.exec_time;
+    thread_time += other.thread_time;
+    allocated_bytes += other.allocated_bytes;
+    executions += other.executions;
+    return *this;
+  }
+};
+
+struct NodeWithExecutionStats {
   DNode node;
-  std::chrono::microseconds exec_time;
+  NodeExecutionStats stats;
 };
 
 struct NodeWithDebugMessage {
@@ -201,7 +227,7 @@ class LocalGeoLogger {
   std::unique_ptr<LinearAllocator<>> allocator_;
   Vector<ValueOfSockets> values_;
   Vector<NodeWithWarning> node_warnings_;
-  Vector<NodeWithExecutionTime> node_exec_times_;
+  Vector<NodeWithExecutionStats> node_exec_stats_;
   Vector<NodeWithDebugMessage> node_debug_messages_;
 
   friend ModifierLog;
@@ -215,7 +241,7 @@ class LocalGeoLogger {
   void log_value_for_sockets(Span<DSocket> sockets, GPointer value);
   void log_multi_value_socket(DSocket socket, Span<GPointer> values);
   void log_node_warning(DNode node, NodeWarningType type, std::string message);
-  void log_execution_time(DNode node, std::chrono::microseconds exec_time);
+  void log_execution_stats(DNode node, const NodeExecutionStats &stats);
   /**
    * Log a message that will be displayed in the node editor next to the node.
    * This should only be used for debugging purposes and not to display information to users.
@@ -295,7 +321,7 @@ class NodeLog {
   Vector<SocketLog> output_logs_;
   Vector<NodeWarning, 0> warnings_;
   Vector<std::string, 0> debug_messages_;
-  std::chrono::microseconds exec_time_;
+  NodeExecutionStats exec_stats_;
 
   friend ModifierLog;
 
@@ -326,7 +352,12 @@ class NodeLog {
 
   std::chrono::microseconds execution_time() const
   {
-    return exec_time_;
+    return exec_stats_.exec_time;
+  }
+
+  const NodeExecutionStats &execution_stats() const
+  {
+    return exec_stats_;
   }
 
   Vector<const GeometryAttributeInfo *> lookup_available_attributes() const;
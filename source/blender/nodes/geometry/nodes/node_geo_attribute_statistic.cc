@@ -14,13 +14,10 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
-#include <algorithm>
-#include <numeric>
-
 #include "UI_interface.h"
 #include "UI_resources.h"
 
-#include "BLI_math_base_safe.h"
+#include "GEO_instances_field_evaluation.hh"
 
 #include "NOD_socket_search_link.hh"
 
@@ -34,6 +31,8 @@ static void node_declare(NodeDeclarationBuilder &b)
   b.add_input<decl::Bool>(N_("Selection")).default_value(true).supports_field().hide_value();
   b.add_input<decl::Float>(N_("Attribute")).hide_value().supports_field();
   b.add_input<decl::Vector>(N_("Attribute"), "Attribute_001").hide_value().supports_field();
+  b.add_input<decl::Bool>(N_("Instances"))
+      .description(N_("Also use the geometry of instances, without the instance transforms"));
 
   b.add_output<decl::Float>(N_("Mean"));
   b.add_output<decl::Float>(N_("Median"));
@@ -159,39 +158,74 @@ static void node_gather_link_searches(GatherLinkSearchOpParams &params)
   }
 }
 
-template<typename T> static T compute_sum(const Span<T> data)
-{
-  return std::accumulate(data.begin(), data.end(), T());
-}
-
-static float compute_variance(const Span<float> data, const float mean)
+/**
+ * Evaluate the field on the selected elements of all components. When instances are used, the
+ * instanced geometry is evaluated in place instead of realizing the instances first, which would
+ * copy the geometry for every instance.
+ */
+static geometry::InstancesFieldValues gather_selected_values(const GeometrySet &geometry_set,
+                                                             const AttributeDomain domain,
+                                                             const fn::GField &field,
+                                                             const Field<bool> &selection_field,
+                                                             const bool use_instances)
 {
-  if (data.size() <= 1) {
-    return 0.0f;
+  if (use_instances) {
+    return geometry::evaluate_field_on_instances(geometry_set, domain, field, selection_field);
   }
 
-  float sum_of_squared_differences = std::accumulate(
-      data.begin(), data.end(), 0.0f, [mean](float accumulator, float value) {
-        float difference = mean - value;
-        return accumulator + difference * difference;
-      });
-
-  return sum_of_squared_differences / (data.size() - 1);
+  geometry::InstancesFieldValues values;
+  for (const GeometryComponent *component : geometry_set.get_components_for_read()) {
+    if (component->attribute_domain_supported(domain)) {
+      GeometryComponentFieldContext field_context{*component, domain};
+      const int domain_size = component->attribute_domain_size(domain);
+
+      fn::FieldEvaluator data_evaluator{field_context, domain_size};
+      data_evaluator.add(field);
+      data_evaluator.set_selection(selection_field);
+      data_evaluator.evaluate();
+      const GVArray &component_data = data_evaluator.get_evaluated(0);
+      const IndexMask selection = data_evaluator.get_evaluated_selection_as_mask();
+
+      fn::GArray<> selected_data(field.cpp_type(), selection.size());
+      for (const int i : selection.index_range()) {
+        component_data.get(selection[i], selected_data[i]);
+      }
+      values.component_values.append(std::move(selected_data));
+    }
+  }
+  return values;
 }
 
-static float median_of_sorted_span(const Span<float> data)
+/**
+ * Statistics of one float or one vector component of the values. Instanced values are weighted
+ * by the number of instances instead of being repeated.
+ */
+static geometry::WeightedStatistics calc_statistics(const geometry::InstancesFieldValues &values,
+                                                    const int axis,
+                                                    const bool calc_median)
 {
-  if (data.is_empty()) {
-    return 0.0f;
-  }
-
-  const float median = data[data.size() / 2];
-
-  /* For spans of even length, the median is the average of the middle two elements. */
-  if (data.size() % 2 == 0) {
-    return (median + data[data.size() / 2 - 1]) * 0.5f;
+  Vector<Span<float>> spans;
+  Vector<int64_t> counts;
+  Vector<Array<float>> axis_values;
+  values.foreach_values([&](const fn::GSpan span, const int64_t count) {
+    if (axis == -1) {
+      spans.append(span.typed<float>());
+    }
+    else {
+      const Span<float3> vectors = span.typed<float3>();
+      Array<float> floats(vectors.size());
+      for (const int i : vectors.index_range()) {
+        floats[i] = vectors[i][axis];
+      }
+      axis_values.append(std::move(floats));
+    }
+    counts.append(count);
+  });
+  /* Arrays with an inline buffer can move, so only reference them when they are all added. */
+  for (const Array<float> &floats : axis_values) {
+    spans.append(floats);
   }
-  return median;
+  return geometry::calc_weighted_statistics(spans, counts, calc_median);
 }
 
 static void node_geo_exec(GeoNodeExecParams params)
@@ -200,44 +234,16 @@ static void node_geo_exec(GeoNodeExecParams params)
   const bNode &node = params.node();
   const CustomDataType data_type = static_cast<CustomDataType>(node.custom1);
   const AttributeDomain domain = static_cast<AttributeDomain>(node.custom2);
-  Vector<const GeometryComponent *> components = geometry_set.get_components_for_read();
+  const bool use_instances = params.get_input<bool>("Instances");
 
   const Field<bool> selection_field = params.get_input<Field<bool>>("Selection");
 
   switch (data_type) {
     case CD_PROP_FLOAT: {
       const Field<float> input_field = params.get_input<Field<float>>("Attribute");
-      Vector<float> data;
-      for (const GeometryComponent *component : components) {
-        if (component->attribute_domain_supported(domain)) {
-          GeometryComponentFieldContext field_context{*component, domain};
-          const int domain_size = component->attribute_domain_size(domain);
-
-          fn::FieldEvaluator data_evaluator{field_context, domain_size};
-          data_evaluator.add(input_field);
-          data_evaluator.set_selection(selection_field);
-          data_evaluator.evaluate();
-          const VArray<float> &component_data = data_evaluator.get_evaluated<float>(0);
-          const IndexMask selection = data_evaluator.get_evaluated_selection_as_mask();
-
-          const int next_data_index = data.size();
-          data.resize(next_data_index + selection.size());
-          MutableSpan<float> selected_data = data.as_mutable_span().slice(next_data_index,
-                                                                          selection.size());
-          for (const int i : selection.index_range()) {
-            selected_data[i] = component_data[selection[i]];
-          }
-        }
-      }
+      const geometry::InstancesFieldValues values = gather_selected_values(
+          geometry_set, domain, input_field, selection_field, use_instances);
 
-      float mean = 0.0f;
-      float median = 0.0f;
-      float sum = 0.0f;
-      float min = 0.0f;
-      float max = 0.0f;
-      float range = 0.0f;
-      float standard_deviation = 0.0f;
-      float variance = 0.0f;
       const bool sort_required = params.output_is_required("Min") ||
                                  params.output_is_required("Max") ||
                                  params.output_is_required("Range") ||
@@ -247,75 +253,30 @@ static void node_geo_exec(GeoNodeExecParams params)
       const bool variance_required = params.output_is_required("Standard Deviation") ||
                                      params.output_is_required("Variance");
 
-      if (data.size() != 0) {
-        if (sort_required) {
-          std::sort(data.begin(), data.end());
-          median = median_of_sorted_span(data);
-
-          min = data.first();
-          max = data.last();
-          range = max - min;
-        }
-        if (sum_required || variance_required) {
-          sum = compute_sum<float>(data);
-          mean = sum / data.size();
-
-          if (variance_required) {
-            variance = compute_variance(data, mean);
-            standard_deviation = std::sqrt(variance);
-          }
-        }
-      }
+      const geometry::WeightedStatistics statistics = calc_statistics(
+          values, -1, params.output_is_required("Median"));
 
       if (sum_required) {
-        params.set_output("Sum", sum);
-        params.set_output("Mean", mean);
+        params.set_output("Sum", statistics.sum);
+        params.set_output("Mean", statistics.mean);
       }
       if (sort_required) {
-        params.set_output("Min", min);
-        params.set_output("Max", max);
-        params.set_output("Range", range);
-        params.set_output("Median", median);
+        params.set_output("Min", statistics.min);
+        params.set_output("Max", statistics.max);
+        params.set_output("Range", statistics.max - statistics.min);
+        params.set_output("Median", statistics.median);
       }
       if (variance_required) {
-        params.set_output("Standard Deviation", standard_deviation);
-        params.set_output("Variance", variance);
+        params.set_output("Standard Deviation", std::sqrt(statistics.variance));
+        params.set_output("Variance", statistics.variance);
       }
       break;
     }
     case CD_PROP_FLOAT3: {
       const Field<float3> input_field = params.get_input<Field<float3>>("Attribute_001");
-      Vector<float3> data;
-      for (const GeometryComponent *component : components) {
-        if (component->attribute_domain_supported(domain)) {
-          GeometryComponentFieldContext field_context{*component, domain};
-          const int domain_size = component->attribute_domain_size(domain);
-
-          fn::FieldEvaluator data_evaluator{field_context, domain_size};
-          data_evaluator.add(input_field);
-          data_evaluator.set_selection(selection_field);
-          data_evaluator.evaluate();
-          const VArray<float3> &component_data = data_evaluator.get_evaluated<float3>(0);
-          const IndexMask selection = data_evaluator.get_evaluated_selection_as_mask();
-
-          const int next_data_index = data.size();
-          data.resize(data.size() + selection.size());
-          MutableSpan<float3> selected_data = data.as_mutable_span().slice(next_data_index,
-                                                                           selection.size());
-          for (const int i : selection.index_range()) {
-            selected_data[i] = component_data[selection[i]];
-          }
-        }
-      }
+      const geometry::InstancesFieldValues values = gather_selected_values(
+          geometry_set, domain, input_field, selection_field, use_instances);
 
-      float3 median{0};
-      float3 min{0};
-      float3 max{0};
-      float3 range{0};
-      float3 sum{0};
-      float3 mean{0};
-      float3 variance{0};
-      float3 standard_deviation{0};
       const bool sort_required = params.output_is_required("Min_001") ||
                                  params.output_is_required("Max_001") ||
                                  params.output_is_required("Range_001") ||
@@ -325,63 +286,28 @@ static void node_geo_exec(GeoNodeExecParams params)
       const bool variance_required = params.output_is_required("Standard Deviation_001") ||
                                      params.output_is_required("Variance_001");
 
-      Array<float> data_x;
-      Array<float> data_y;
-      Array<float> data_z;
-      if (sort_required || variance_required) {
-        data_x.reinitialize(data.size());
-        data_y.reinitialize(data.size());
-        data_z.reinitialize(data.size());
-        for (const int i : data.index_range()) {
-          data_x[i] = data[i].x;
-          data_y[i] = data[i].y;
-          data_z[i] = data[i].z;
-        }
-      }
-
-      if (data.size() != 0) {
-        if (sort_required) {
-          std::sort(data_x.begin(), data_x.end());
-          std::sort(data_y.begin(), data_y.end());
-          std::sort(data_z.begin(), data_z.end());
-
-          const float x_median = median_of_sorted_span(data_x);
-          const float y_median = median_of_sorted_span(data_y);
-          const float z_median = median_of_sorted_span(data_z);
-          median = float3(x_median, y_median, z_median);
-
-          min = float3(data_x.first(), data_y.first(), data_z.first());
-          max = float3(data_x.last(), data_y.last(), data_z.last());
-          range = max - min;
-        }
-        if (sum_required || variance_required) {
-          sum = compute_sum(data.as_span());
-          mean = sum / data.size();
-
-          if (variance_required) {
-            const float x_variance = compute_variance(data_x, mean.x);
-            const float y_variance = compute_variance(data_y, mean.y);
-            const float z_variance = compute_variance(data_z, mean.z);
-            variance = float3(x_variance, y_variance, z_variance);
-            standard_deviation = float3(
-                std::sqrt(variance.x), std::sqrt(variance.y), std::sqrt(variance.z));
-          }
-        }
-      }
+      const bool median_required = params.output_is_required("Median_001");
+      const geometry::WeightedStatistics x = calc_statistics(values, 0, median_required);
+      const geometry::WeightedStatistics y = calc_statistics(values, 1, median_required);
+      const geometry::WeightedStatistics z = calc_statistics(values, 2, median_required);
 
       if (sum_required) {
-        params.set_output("Sum_001", sum);
-        params.set_output("Mean_001", mean);
+        params.set_output("Sum_001", float3(x.sum, y.sum, z.sum));
+        params.set_output("Mean_001", float3(x.mean, y.mean, z.mean));
       }
       if (sort_required) {
+        const float3 min(x.min, y.min, z.min);
+        const float3 max(x.max, y.max, z.max);
         params.set_output("Min_001", min);
         params.set_output("Max_001", max);
-        params.set_output("Range_001", range);
-        params.set_output("Median_001", median);
+        params.set_output("Range_001", max - min);
+        params.set_output("Median_001", float3(x.median, y.median, z.median));
       }
       if (variance_required) {
-        params.set_output("Standard Deviation_001", standard_deviation);
-        params.set_output("Variance_001", variance);
+        params.set_output(
+            "Standard Deviation_001",
+            float3(std::sqrt(x.variance), std::sqrt(y.variance), std::sqrt(z.variance)));
+        params.set_output("Variance_001", float3(x.variance, y.variance, z.variance));
       }
       break;
     }
@@ -63,13 +63,13 @@ static bool calculate_mesh_proximity(const VArray<float3> &positions,
   BVHTreeFromMesh bvh_data;
   switch (type) {
     case GEO_NODE_PROX_TARGET_POINTS:
-      BKE_bvhtree_from_mesh_get(&bvh_data, &mesh, BVHTREE_FROM_VERTS, 2);
+      BKE_bvhtree_from_mesh_get_shared(&bvh_data, &mesh, BVHTREE_FROM_VERTS, 2);
       break;
     case GEO_NODE_PROX_TARGET_EDGES:
-      BKE_bvhtree_from_mesh_get(&bvh_data, &mesh, BVHTREE_FROM_EDGES, 2);
+      BKE_bvhtree_from_mesh_get_shared(&bvh_data, &mesh, BVHTREE_FROM_EDGES, 2);
       break;
     case GEO_NODE_PROX_TARGET_FACES:
-      BKE_bvhtree_from_mesh_get(&bvh_data, &mesh, BVHTREE_FROM_LOOPTRI, 2);
+      BKE_bvhtree_from_mesh_get_shared(&bvh_data, &mesh, BVHTREE_FROM_LOOPTRI, 2);
       break;
   }
 
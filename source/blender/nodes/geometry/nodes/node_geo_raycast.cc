@@ -15,6 +15,7 @@
  */
 
 #include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
 
 #include "BKE_attribute_math.hh"
 #include "BKE_bvhutils.h"
@@ -154,60 +155,82 @@ static void raycast_to_mesh(IndexMask mask,
                             int &hit_count)
 {
   BVHTreeFromMesh tree_data;
-  BKE_bvhtree_from_mesh_get(&tree_data, &mesh, BVHTREE_FROM_LOOPTRI, 4);
+  BKE_bvhtree_from_mesh_get_shared(&tree_data, &mesh, BVHTREE_FROM_LOOPTRI, 4);
   if (tree_data.tree == nullptr) {
     free_bvhtree_from_mesh(&tree_data);
     return;
   }
 
-  for (const int i : mask) {
-    const float ray_length = ray_lengths[i];
-    const float3 ray_origin = ray_origins[i];
-    const float3 ray_direction = math::normalize(ray_directions[i]);
-
-    BVHTreeRayHit hit;
-    hit.index = -1;
-    hit.dist = ray_length;
-    if (BLI_bvhtree_ray_cast(tree_data.tree,
-                             ray_origin,
-                             ray_direction,
-                             0.0f,
-                             &hit,
-                             tree_data.raycast_callback,
-                             &tree_data) != -1) {
-      hit_count++;
-      if (!r_hit.is_empty()) {
-        r_hit[i] = hit.index >= 0;
-      }
-      if (!r_hit_indices.is_empty()) {
-        /* The caller must be able to handle invalid indices anyway, so don't clamp this value. */
-        r_hit_indices[i] = hit.index;
-      }
-      if (!r_hit_positions.is_empty()) {
-        r_hit_positions[i] = hit.co;
-      }
-      if (!r_hit_normals.is_empty()) {
-        r_hit_normals[i] = hit.no;
-      }
-      if (!r_hit_distances.is_empty()) {
-        r_hit_distances[i] = hit.dist;
-      }
+  BVHTreeTriangles triangles;
+  triangles.positions = tree_data.vert[0].co;
+  triangles.positions_stride = sizeof(MVert);
+  triangles.tri_corners = tree_data.looptri[0].tri;
+  triangles.tri_corners_stride = sizeof(MLoopTri);
+  triangles.corner_verts = &tree_data.loop[0].v;
+  triangles.corner_verts_stride = sizeof(MLoop);
+
+  /* Rays are cast in batches, which avoids a callback for every triangle and tests the bounds of
+   * multiple rays at once. */
+  const int64_t batch_size = 256;
+  Array<float3> origins(batch_size);
+  Array<float3> directions(batch_size);
+  Array<BVHTreeRayHit> hits(batch_size);
+  for (int64_t batch_start = 0; batch_start < mask.size(); batch_start += batch_size) {
+    const IndexMask batch_mask = mask.slice(
+        IndexRange(batch_start, std::min(batch_size, mask.size() - batch_start)));
+    for (const int64_t j : batch_mask.index_range()) {
+      const int64_t i = batch_mask[j];
+      origins[j] = ray_origins[i];
+      directions[j] = math::normalize(ray_directions[i]);
+      hits[j].index = -1;
+      hits[j].dist = ray_lengths[i];
     }
-    else {
-      if (!r_hit.is_empty()) {
-        r_hit[i] = false;
-      }
-      if (!r_hit_indices.is_empty()) {
-        r_hit_indices[i] = -1;
-      }
-      if (!r_hit_positions.is_empty()) {
-        r_hit_positions[i] = float3(0.0f, 0.0f, 0.0f);
-      }
-      if (!r_hit_normals.is_empty()) {
-        r_hit_normals[i] = float3(0.0f, 0.0f, 0.0f);
+
+    hit_count += BLI_bvhtree_ray_cast_triangles(tree_data.tree,
+                                                &triangles,
+                                                reinterpret_cast<float(*)[3]>(origins.data()),
+                                                reinterpret_cast<float(*)[3]>(directions.data()),
+                                                hits.data(),
+                                                int(batch_mask.size()),
+                                                BVH_RAYCAST_DEFAULT);
+
+    for (const int64_t j : batch_mask.index_range()) {
+      const int64_t i = batch_mask[j];
+      const BVHTreeRayHit &hit = hits[j];
+      if (hit.index != -1) {
+        if (!r_hit.is_empty()) {
+          r_hit[i] = hit.index >= 0;
+        }
+        if (!r_hit_indices.is_empty()) {
+          /* The caller must be able to handle invalid indices anyway, so don't clamp this value. */
+          r_hit_indices[i] = hit.index;
+        }
+        if (!r_hit_positions.is_empty()) {
+          r_hit_positions[i] = hit.co;
+        }
+        if (!r_hit_normals.is_empty()) {
+          r_hit_normals[i] = hit.no;
+        }
+        if (!r_hit_distances.is_empty()) {
+          r_hit_distances[i] = hit.dist;
+        }
       }
-      if (!r_hit_distances.is_empty()) {
-        r_hit_distances[i] = ray_length;
+      else {
+        if (!r_hit.is_empty()) {
+          r_hit[i] = false;
+        }
+        if (!r_hit_indices.is_empty()) {
+          r_hit_indices[i] = -1;
+        }
+        if (!r_hit_positions.is_empty()) {
+          r_hit_positions[i] = float3(0.0f, 0.0f, 0.0f);
+        }
+        if (!r_hit_normals.is_empty()) {
+          r_hit_normals[i] = float3(0.0f, 0.0f, 0.0f);
+        }
+        if (!r_hit_distances.is_empty()) {
+          r_hit_distances[i] = ray_lengths[i];
+        }
       }
     }
   }
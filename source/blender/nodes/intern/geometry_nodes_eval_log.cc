@@ -67,10 +67,10 @@ ModifierLog::ModifierLog(GeoLogger &logger)
       node_log.warnings_.append(node_with_warning.warning);
     }
 
-    for (NodeWithExecutionTime &node_with_exec_time : local_logger.node_exec_times_) {
+    for (NodeWithExecutionStats &node_with_exec_stats : local_logger.node_exec_stats_) {
       NodeLog &node_log = this->lookup_or_add_node_log(log_by_tree_context,
-                                                       node_with_exec_time.node);
-      node_log.exec_time_ = node_with_exec_time.exec_time;
+                                                       node_with_exec_stats.node);
+      node_log.exec_stats_ += node_with_exec_stats.stats;
     }
 
     for (NodeWithDebugMessage &debug_message : local_logger.node_debug_messages_) {
@@ -486,9 +486,9 @@ void LocalGeoLogger::log_node_warning(DNode node, NodeWarningType type, std::str
   node_warnings_.append({node, {type, std::move(message)}});
 }
 
-void LocalGeoLogger::log_execution_time(DNode node, std::chrono::microseconds exec_time)
+void LocalGeoLogger::log_execution_stats(DNode node, const NodeExecutionStats &stats)
 {
-  node_exec_times_.append({node, exec_time});
+  node_exec_stats_.append({node, stats});
 }
 
 void LocalGeoLogger::log_debug_message(DNode node, std::string message)
@@ -22,6 +22,29 @@ def _run(filepath):
     return result
 
 
+def _run_save(args):
+    import bpy
+    import os
+    import tempfile
+    import time
+
+    bpy.ops.wm.open_mainfile(filepath=args['filepath'])
+
+    with tempfile.TemporaryDirectory() as tempdir:
+        filepath = os.path.join(tempdir, "save_test.blend")
+
+        # Save once to ensure the output file is allocated.
+        bpy.ops.wm.save_as_mainfile(filepath=filepath, compress=args['compress'], copy=True)
+
+        # Measure saving the second time
+        start_time = time.time()
+        bpy.ops.wm.save_as_mainfile(filepath=filepath, compress=args['compress'], copy=True)
+        elapsed_time = time.time() - start_time
+
+    result = {'time': elapsed_time}
+    return result
+
+
 class BlendLoadTest(api.Test):
     def __init__(self, filepath):
         self.filepath = filepath
@@ -37,6 +60,24 @@ class BlendLoadTest(api.Test):
         return result
 
 
+class BlendSaveTest(api.Test):
+    def __init__(self, filepath, compress):
+        self.filepath = filepath
+        self.compress = compress
+
+    def name(self):
+        return self.filepath.stem + ("_compressed" if self.compress else "")
+
+    def category(self):
+        return "blend_save"
+
+    def run(self, env, device_id):
+        args = {'filepath': str(self.filepath), 'compress': self.compress}
+        result, _ = env.run_in_blender(_run_save, args)
+        return result
+
+
 def generate(env):
     filepaths = env.find_blend_files('*/*')
-    return [BlendLoadTest(filepath) for filepath in filepaths]
+    return [BlendLoadTest(filepath) for filepath in filepaths] + \
+        [BlendSaveTest(filepath, compress) for filepath in filepaths for compress in (False, True)]
@@ -0,0 +1,76 @@
+# Apache License, Version 2.0
+
+import api
+
+
+def _run(args):
+    import bmesh
+    import time
+
+    def grid_create():
+        bm = bmesh.new()
+        size = args['size']
+        bmesh.ops.create_grid(bm, x_segments=size, y_segments=size, size=1.0)
+        return bm
+
+    operator_time = 0.0
+    num_runs = 3
+    for i in range(num_runs):
+        # Setup is not measured, only the operator.
+        bm = grid_create()
+        if args['operator'] == 'remove_doubles':
+            # Every vertex gets a duplicate to merge.
+            bmesh.ops.duplicate(bm, geom=bm.verts[:] + bm.edges[:] + bm.faces[:])
+            start_time = time.time()
+            bmesh.ops.remove_doubles(bm, verts=bm.verts[:], dist=0.0001)
+        else:
+            start_time = time.time()
+            bmesh.ops.subdivide_edges(bm,
+                                      edges=bm.edges[:],
+                                      cuts=args['cuts'],
+                                      use_grid_fill=True,
+                                      smooth=args['smooth'],
+                                      fractal=args['fractal'])
+        operator_time += time.time() - start_time
+        bm.free()
+
+    result = {'time': operator_time / num_runs}
+    return result
+
+
+class BMeshOperatorTest(api.Test):
+    def __init__(self, operator, size, cuts=1, smooth=0.0, fractal=0.0):
+        self.operator = operator
+        self.size = size
+        self.cuts = cuts
+        self.smooth = smooth
+        self.fractal = fractal
+
+    def name(self):
+        if self.operator == 'remove_doubles':
+            return f"remove_doubles_grid_{self.size}"
+        name = f"subdivide_grid_{self.size}_cuts_{self.cuts}"
+        if self.smooth != 0.0:
+            name += "_smooth"
+        if self.fractal != 0.0:
+            name += "_fractal"
+        return name
+
+    def category(self):
+        return "bmesh_operators"
+
+    def run(self, env, device_id):
+        args = {'operator': self.operator,
+                'size': self.size,
+                'cuts': self.cuts,
+                'smooth': self.smooth,
+                'fractal': self.fractal}
+        result, _ = env.run_in_blender(_run, args)
+        return result
+
+
+def generate(env):
+    return [BMeshOperatorTest('remove_doubles', 1000),
+            BMeshOperatorTest('subdivide', 500, cuts=2),
+            BMeshOperatorTest('subdivide', 500, cuts=2, smooth=1.0),
+            BMeshOperatorTest('subdivide', 500, cuts=2, fractal=1.0)]
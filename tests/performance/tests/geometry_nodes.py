@@ -0,0 +1,114 @@
+# Apache License, Version 2.0
+
+import api
+
+
+def _run(args):
+    import bpy
+    import time
+
+    bpy.ops.wm.read_factory_settings(use_empty=True)
+    bpy.ops.mesh.primitive_plane_add()
+    ob = bpy.context.object
+
+    group = bpy.data.node_groups.new("Benchmark", 'GeometryNodeTree')
+    group.inputs.new('NodeSocketGeometry', "Geometry")
+    group.outputs.new('NodeSocketGeometry', "Geometry")
+    nodes = group.nodes
+    links = group.links
+    group_input = nodes.new('NodeGroupInput')
+    group_output = nodes.new('NodeGroupOutput')
+
+    # Everything depends on the time, so that no node result can be reused between frames.
+    time_node = nodes.new('GeometryNodeInputSceneTime')
+    time_socket = time_node.outputs['Frame']
+
+    geometry_socket = group_input.outputs[0]
+    if args['work'] == 'overhead':
+        # Many nodes that only compute single values, so that almost all of the time is spent in
+        # the evaluator. Values are combined in a balanced tree to allow parallel evaluation.
+        values = []
+        for i in range(args['node_count']):
+            math_node = nodes.new('ShaderNodeMath')
+            math_node.operation = 'MULTIPLY'
+            links.new(time_socket, math_node.inputs[0])
+            math_node.inputs[1].default_value = 1.0 + i * 0.001
+            values.append(math_node.outputs[0])
+        while len(values) > 1:
+            next_values = []
+            for a, b in zip(values[0::2], values[1::2]):
+                math_node = nodes.new('ShaderNodeMath')
+                math_node.operation = 'ADD'
+                links.new(a, math_node.inputs[0])
+                links.new(b, math_node.inputs[1])
+                next_values.append(math_node.outputs[0])
+            if len(values) % 2 == 1:
+                next_values.append(values[-1])
+            values = next_values
+        combine_node = nodes.new('ShaderNodeCombineXYZ')
+        links.new(values[0], combine_node.inputs[0])
+        transform_node = nodes.new('GeometryNodeTransform')
+        links.new(geometry_socket, transform_node.inputs['Geometry'])
+        links.new(combine_node.outputs[0], transform_node.inputs['Translation'])
+        geometry_socket = transform_node.outputs[0]
+    else:
+        # Few nodes that do a lot of work each.
+        grid_node = nodes.new('GeometryNodeMeshGrid')
+        grid_node.inputs['Vertices X'].default_value = 1000
+        grid_node.inputs['Vertices Y'].default_value = 1000
+        position_node = nodes.new('GeometryNodeInputPosition')
+        noise_node = nodes.new('ShaderNodeTexNoise')
+        links.new(position_node.outputs[0], noise_node.inputs['Vector'])
+        links.new(time_socket, noise_node.inputs['Scale'])
+        set_position_node = nodes.new('GeometryNodeSetPosition')
+        links.new(grid_node.outputs[0], set_position_node.inputs['Geometry'])
+        links.new(noise_node.outputs['Color'], set_position_node.inputs['Offset'])
+        geometry_socket = set_position_node.outputs[0]
+    links.new(geometry_socket, group_output.inputs[0])
+
+    modifier = ob.modifiers.new("Benchmark", 'NODES')
+    modifier.node_group = group
+
+    scene = bpy.context.scene
+    scene.frame_start = 1
+    scene.frame_end = 50
+
+    # Evaluate once so that setup costs are not measured.
+    scene.frame_set(scene.frame_start)
+
+    start_time = time.time()
+    elapsed_time = 0.0
+    num_frames = 0
+    while elapsed_time < 5.0:
+        for i in range(scene.frame_start, scene.frame_end + 1):
+            scene.frame_set(i)
+        num_frames += scene.frame_end + 1 - scene.frame_start
+        elapsed_time = time.time() - start_time
+
+    result = {'time': elapsed_time / num_frames}
+    return result
+
+
+class GeometryNodesTest(api.Test):
+    def __init__(self, work, node_count=0):
+        self.work = work
+        self.node_count = node_count
+
+    def name(self):
+        if self.work == 'overhead':
+            return f"evaluator_overhead_{self.node_count}_nodes"
+        return "node_work"
+
+    def category(self):
+        return "geometry_nodes"
+
+    def run(self, env, device_id):
+        args = {'work': self.work, 'node_count': self.node_count}
+        result, _ = env.run_in_blender(_run, args)
+        return result
+
+
+def generate(env):
+    return [GeometryNodesTest('overhead', 1000),
+            GeometryNodesTest('overhead', 10000),
+            GeometryNodesTest('node_work')]
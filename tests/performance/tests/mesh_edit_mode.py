@@ -0,0 +1,58 @@
+# Apache License, Version 2.0
+
+import api
+
+
+def _run(args):
+    import bpy
+    import time
+
+    bpy.ops.wm.read_factory_settings(use_empty=True)
+    size = args['size']
+    bpy.ops.mesh.primitive_grid_add(x_subdivisions=size, y_subdivisions=size)
+    mesh = bpy.context.object.data
+    # Custom data layers are converted too, so include a few of them.
+    mesh.uv_layers.new()
+    mesh.attributes.new("float", 'FLOAT', 'POINT')
+    mesh.attributes.new("color", 'FLOAT_COLOR', 'CORNER')
+
+    # Enter edit mode once, so that setup costs are not measured.
+    bpy.ops.object.mode_set(mode='EDIT')
+    bpy.ops.object.mode_set(mode='OBJECT')
+
+    enter_time = 0.0
+    exit_time = 0.0
+    num_toggles = 5
+    for i in range(num_toggles):
+        start_time = time.time()
+        bpy.ops.object.mode_set(mode='EDIT')
+        enter_time += time.time() - start_time
+
+        start_time = time.time()
+        bpy.ops.object.mode_set(mode='OBJECT')
+        exit_time += time.time() - start_time
+
+    result = {'time': (enter_time + exit_time) / num_toggles,
+              'enter_time': enter_time / num_toggles,
+              'exit_time': exit_time / num_toggles}
+    return result
+
+
+class MeshEditModeTest(api.Test):
+    def __init__(self, size):
+        self.size = size
+
+    def name(self):
+        return f"grid_{self.size}"
+
+    def category(self):
+        return "mesh_edit_mode"
+
+    def run(self, env, device_id):
+        args = {'size': self.size}
+        result, _ = env.run_in_blender(_run, args)
+        return result
+
+
+def generate(env):
+    return [MeshEditModeTest(500), MeshEditModeTest(2000)]
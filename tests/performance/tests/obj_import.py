@@ -0,0 +1,56 @@
+# Apache License, Version 2.0
+
+import api
+import glob
+import pathlib
+
+
+def _run(args):
+    import bpy
+    import os
+    import tempfile
+    import time
+
+    with tempfile.TemporaryDirectory() as tempdir:
+        filepath = args['filepath']
+        if not filepath:
+            # Generate a dense grid, so the test doesn't depend on benchmark files.
+            bpy.ops.wm.read_factory_settings(use_empty=True)
+            bpy.ops.mesh.primitive_grid_add(x_subdivisions=2000, y_subdivisions=2000)
+            filepath = os.path.join(tempdir, "grid.obj")
+            bpy.ops.wm.obj_export(filepath=filepath, export_materials=False)
+
+        # Import once to ensure it's cached by OS
+        bpy.ops.wm.read_factory_settings(use_empty=True)
+        bpy.ops.wm.obj_import(filepath=filepath)
+        bpy.ops.wm.read_factory_settings(use_empty=True)
+
+        # Measure importing the second time
+        start_time = time.time()
+        bpy.ops.wm.obj_import(filepath=filepath)
+        elapsed_time = time.time() - start_time
+
+    result = {'time': elapsed_time}
+    return result
+
+
+class OBJImportTest(api.Test):
+    def __init__(self, filepath):
+        self.filepath = filepath
+
+    def name(self):
+        return self.filepath.stem if self.filepath else "generated_grid"
+
+    def category(self):
+        return "obj_import"
+
+    def run(self, env, device_id):
+        args = {'filepath': str(self.filepath) if self.filepath else ""}
+        result, _ = env.run_in_blender(_run, args)
+        return result
+
+
+def generate(env):
+    dirpath = env.benchmarks_dir / 'obj_import'
+    filepaths = [pathlib.Path(filename) for filename in glob.iglob(str(dirpath / '*.obj'))]
+    return [OBJImportTest(None)] + [OBJImportTest(filepath) for filepath in filepaths]